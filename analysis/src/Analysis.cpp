@@ -36,43 +36,91 @@
 #include <sirikata/core/util/MotionPath.hpp>
 #include "AnalysisEvents.hpp"
 #include "RecordedMotionPath.hpp"
+#include "TraceFile.hpp"
+#include "ParallelAnalysis.hpp"
 #include <algorithm>
 
 namespace Sirikata {
 
-bool read_record(std::istream& is, uint16* type_hint_out, std::string* payload_out) {
-    if (!is) return false;
+bool read_record(std::istream& is, uint16* type_hint_out, std::string* payload_out, TraceRecordOrder* order) {
+    while(true) {
+        if (!is) return false;
 
-    uint32 record_size;
-    is.read( (char*)&record_size, sizeof(record_size) );
-    if (!is) return false;
+        uint32 record_size;
+        is.read( (char*)&record_size, sizeof(record_size) );
+        if (!is) return false;
 
-    is.read( (char*)type_hint_out, sizeof(uint16) );
-    if (!is) return false;
+        is.read( (char*)type_hint_out, sizeof(uint16) );
+        if (!is) return false;
 
-    assert(payload_out != NULL);
-    payload_out->resize(record_size, (char)0);
-    is.read( (char*)payload_out->c_str(), record_size );
-    if (!is) return false;
+        assert(payload_out != NULL);
+        payload_out->resize(record_size, (char)0);
+        is.read( (char*)payload_out->c_str(), record_size );
+        if (!is) return false;
 
-    return true;
+        if (*type_hint_out != TraceThreadRunTag) {
+            if (order != NULL)
+                order->seqno = order->next_seqno++;
+            return true;
+        }
+
+        // Start of a run of records from a thread, remember where it came
+        // from and keep going to the real record
+        uint32 thread;
+        uint64 seqno;
+        if (record_size != sizeof(thread) + sizeof(seqno)) return false;
+        memcpy(&thread, payload_out->c_str(), sizeof(thread));
+        memcpy(&seqno, payload_out->c_str() + sizeof(thread), sizeof(seqno));
+        if (order != NULL) {
+            order->thread = thread;
+            order->next_seqno = seqno;
+        }
+    }
 }
 
 TimedMotionVector3f extractTimedMotionVector(const Sirikata::Trace::ITimedMotionVector& tmv) {
     return TimedMotionVector3f( tmv.t(), MotionVector3f(tmv.position(), tmv.velocity()) );
 }
 
-Event* Event::parse(uint16 type_hint, const std::string& record, const ServerID& trace_server_id) {
-    std::istringstream record_is(record);
+bool parse_timestamp_record(uint16 type_hint, const char* data, uint32 size, MessageCreationTimestampEvent* evt_out) {
+    uint32 base_size = sizeof(evt_out->time) + sizeof(evt_out->uid) + sizeof(evt_out->path);
+    uint32 ports_size = sizeof(evt_out->srcport) + sizeof(evt_out->dstport);
+
+    if (type_hint == MessageTimestampTag) {
+        if (size < base_size) return false;
+    }
+    else if (type_hint == MessageCreationTimestampTag) {
+        if (size < base_size + ports_size) return false;
+    }
+    else {
+        return false;
+    }
+
+    const char* pos = data;
+    memcpy(&evt_out->time, pos, sizeof(evt_out->time)); pos += sizeof(evt_out->time);
+    memcpy(&evt_out->uid, pos, sizeof(evt_out->uid)); pos += sizeof(evt_out->uid);
+    memcpy(&evt_out->path, pos, sizeof(evt_out->path)); pos += sizeof(evt_out->path);
+    if (type_hint == MessageCreationTimestampTag) {
+        memcpy(&evt_out->srcport, pos, sizeof(evt_out->srcport)); pos += sizeof(evt_out->srcport);
+        memcpy(&evt_out->dstport, pos, sizeof(evt_out->dstport));
+    }
+    else {
+        evt_out->srcport = 0;
+        evt_out->dstport = 0;
+    }
+    return true;
+}
 
-    if (!record_is)
-      return NULL;
+Event* Event::parse(uint16 type_hint, const std::string& record, const ServerID& trace_server_id, const TraceRecordOrder* order) {
+    return parse(type_hint, record.data(), record.size(), trace_server_id, order);
+}
 
+Event* Event::parse(uint16 type_hint, const char* data, uint32 size, const ServerID& trace_server_id, const TraceRecordOrder* order) {
     Event* evt = NULL;
 
 #define PARSE_PBJ_RECORD(type)                                          \
     PBJEvent<type>* pevt = new PBJEvent<type>;                          \
-    pevt->data.ParseFromIstream(&record_is);                            \
+    pevt->data.ParseFromArray(data, size);                              \
     pevt->time = pevt->data.t();                                        \
     evt = pevt;
 
@@ -102,18 +150,16 @@ Event* Event::parse(uint16 type_hint, const std::string& record, const ServerID&
     }
     else if (type_hint == MessageCreationTimestampTag) {
               MessageCreationTimestampEvent *pevt = new MessageCreationTimestampEvent;
-              record_is.read((char*)&pevt->time, sizeof(pevt->time));
-              record_is.read((char*)&pevt->uid, sizeof(pevt->uid));
-              record_is.read((char*)&pevt->path, sizeof(pevt->path));
-              record_is.read((char*)&pevt->srcport, sizeof(pevt->srcport));
-              record_is.read((char*)&pevt->dstport,sizeof(pevt->dstport));
+              parse_timestamp_record(type_hint, data, size, pevt);
               evt=pevt;
           }
     else if (type_hint == MessageTimestampTag) {
               MessageTimestampEvent *pevt = new MessageTimestampEvent;
-              record_is.read((char*)&pevt->time, sizeof(pevt->time));
-              record_is.read((char*)&pevt->uid, sizeof(pevt->uid));
-              record_is.read((char*)&pevt->path, sizeof(pevt->path));
+              MessageCreationTimestampEvent tevt;
+              parse_timestamp_record(type_hint, data, size, &tevt);
+              pevt->time = tevt.time;
+              pevt->uid = tevt.uid;
+              pevt->path = tevt.path;
               evt=pevt;
           }
     else if (type_hint == ServerDatagramQueuedTag) {
@@ -169,6 +215,11 @@ Event* Event::parse(uint16 type_hint, const std::string& record, const ServerID&
           SILOG(analysis, error,"\n*****I got an unknown tag in analysis.cpp.  Value:  "<<(uint32)type_hint<<"\n");
       }
 
+    if (evt != NULL && order != NULL) {
+        evt->thread = order->thread;
+        evt->seqno = order->seqno;
+    }
+
     return evt;
 }
 
@@ -231,68 +282,118 @@ void sort_events(EventListMapType& lists) {
 
 
 LocationErrorAnalysis::LocationErrorAnalysis(const char* opt_name, const uint32 nservers) {
-    // read in all our data
-    for(uint32 server_id = 1; server_id <= nservers; server_id++) {
-        String loc_file = GetPerServerFile(opt_name, server_id);
-        std::ifstream is(loc_file.c_str(), std::ios::in);
+    // index each server's trace separately, reading only the server events up
+    // front, then merge those. Object events are parsed per observer, through
+    // the object index, when they're first needed.
+    std::vector<String> trace_files = PerServerFiles(opt_name, nservers);
+    mTraces.resize(nservers, NULL);
+    std::vector<ServerEventListMap> server_partials(nservers);
+    ParallelFor(
+        nservers,
+        std::tr1::bind(&LocationErrorAnalysis::readServerTrace, &trace_files, std::tr1::placeholders::_1, &mTraces, &server_partials)
+    );
+
+    EventListMerger<EventList, ServerEventListMap>::merge(server_partials, mServerEventLists);
+
+    // The object index also holds server events, which are indexed by the
+    // object they're about, so only keep objects which received updates
+    std::set<UUID> observers;
+    for(std::vector<TraceFile*>::const_iterator trace_it = mTraces.begin(); trace_it != mTraces.end(); trace_it++) {
+        std::vector<UUID> objects;
+        (*trace_it)->objects(&objects);
+        for(std::vector<UUID>::const_iterator obj_it = objects.begin(); obj_it != objects.end(); obj_it++) {
+            const TraceFile::IndexEntryList& records = (*trace_it)->objectRecords(*obj_it);
+            for(TraceFile::IndexEntryList::const_iterator rec_it = records.begin(); rec_it != records.end(); rec_it++) {
+                uint16 type_hint = (*trace_it)->record(*rec_it).type_hint;
+                if (type_hint == ProximityTag || type_hint == ObjectLocationTag) {
+                    observers.insert(*obj_it);
+                    break;
+                }
+            }
+        }
+    }
+    mObservers.assign(observers.begin(), observers.end());
+}
 
-        while(is) {
-            uint16 type_hint;
-            std::string raw_evt;
-            if (!read_record(is, &type_hint, &raw_evt)) break;
-            Event* evt = Event::parse(type_hint, raw_evt, server_id);
-            if (evt == NULL)
-                break;
+void LocationErrorAnalysis::readServerTrace(const std::vector<String>* trace_files, uint32 idx, std::vector<TraceFile*>* traces, std::vector<ServerEventListMap>* server_partials) {
+    ServerID server_id = idx + 1;
+    ServerEventListMap& server_event_lists = (*server_partials)[idx];
 
-            ObjectEvent* obj_evt = dynamic_cast<ObjectEvent*>(evt);
-            ProximityEvent* pe = dynamic_cast<ProximityEvent*>(evt);
-            LocationEvent* le = dynamic_cast<LocationEvent*>(evt);
-            ServerObjectLocUpdateEvent* sobj_evt = dynamic_cast<ServerObjectLocUpdateEvent*>(evt);
-            ServerLocUpdateEvent* sloc_evt = dynamic_cast<ServerLocUpdateEvent*>(evt);
-
-            if (obj_evt != NULL && (pe != NULL || le != NULL)) {
-                ObjectEventListMap::iterator it = mEventLists.find( obj_evt->receiver );
-                if (it == mEventLists.end()) {
-                    mEventLists[ obj_evt->receiver ] = new EventList;
-                    it = mEventLists.find( obj_evt->receiver );
-                }
-                assert( it != mEventLists.end() );
+    TraceFile::TypeHintSet types;
+    types.insert(ProximityTag);
+    types.insert(ObjectLocationTag);
+    types.insert(ServerObjectEventTag);
+    types.insert(ServerLocationTag);
 
-                EventList* evt_list = it->second;
-                evt_list->push_back(obj_evt);
-            }
-            else if (sobj_evt != NULL) {
-                ServerEventListMap::iterator it = mServerEventLists.find( sobj_evt->data.receiver() );
-                if (it == mServerEventLists.end()) {
-                    mServerEventLists[ sobj_evt->data.receiver() ] = new EventList;
-                    it = mServerEventLists.find( sobj_evt->data.receiver() );
-                }
-                assert( it != mServerEventLists.end() );
+    TraceFile* trace = new TraceFile((*trace_files)[idx], server_id, types, true);
+    (*traces)[idx] = trace;
+
+    TraceFile::TypeHintSet server_types;
+    server_types.insert(ServerObjectEventTag);
+    server_types.insert(ServerLocationTag);
+
+    for(TraceFile::TypeHintSet::const_iterator type_it = server_types.begin(); type_it != server_types.end(); type_it++) {
+      const TraceFile::IndexEntryList& records = trace->records(*type_it);
+      for(TraceFile::IndexEntryList::const_iterator rec_it = records.begin(); rec_it != records.end(); rec_it++) {
+        Event* evt = trace->parseEvent(*rec_it);
+        if (evt == NULL)
+            continue;
+
+        ServerObjectLocUpdateEvent* sobj_evt = dynamic_cast<ServerObjectLocUpdateEvent*>(evt);
+        ServerLocUpdateEvent* sloc_evt = dynamic_cast<ServerLocUpdateEvent*>(evt);
 
-                EventList* evt_list = it->second;
-                evt_list->push_back(sobj_evt);
+        if (sobj_evt != NULL) {
+            ServerEventListMap::iterator it = server_event_lists.find( sobj_evt->data.receiver() );
+            if (it == server_event_lists.end()) {
+                server_event_lists[ sobj_evt->data.receiver() ] = new EventList;
+                it = server_event_lists.find( sobj_evt->data.receiver() );
             }
-            else if (sloc_evt != NULL) {
-                ServerEventListMap::iterator it = mServerEventLists.find( sloc_evt->data.receiver() );
-                if (it == mServerEventLists.end()) {
-                    mServerEventLists[ sloc_evt->data.receiver() ] = new EventList;
-                    it = mServerEventLists.find( sloc_evt->data.receiver() );
-                }
-                assert( it != mServerEventLists.end() );
+            assert( it != server_event_lists.end() );
 
-                EventList* evt_list = it->second;
-                evt_list->push_back(sloc_evt);
+            EventList* evt_list = it->second;
+            evt_list->push_back(sobj_evt);
+        }
+        else if (sloc_evt != NULL) {
+            ServerEventListMap::iterator it = server_event_lists.find( sloc_evt->data.receiver() );
+            if (it == server_event_lists.end()) {
+                server_event_lists[ sloc_evt->data.receiver() ] = new EventList;
+                it = server_event_lists.find( sloc_evt->data.receiver() );
             }
-            else {
-                delete evt;
+            assert( it != server_event_lists.end() );
+
+            EventList* evt_list = it->second;
+            evt_list->push_back(sloc_evt);
+        }
+        else {
+            delete evt;
+            continue;
+        }
+      }
+    }
+
+    sort_events<EventList, ServerEventListMap>(server_event_lists);
+}
+
+LocationErrorAnalysis::EventList* LocationErrorAnalysis::loadEventList(const UUID& observer) const {
+    EventList* evt_list = new EventList;
+    for(std::vector<TraceFile*>::const_iterator trace_it = mTraces.begin(); trace_it != mTraces.end(); trace_it++) {
+        const TraceFile* trace = *trace_it;
+        const TraceFile::IndexEntryList& records = trace->objectRecords(observer);
+        for(TraceFile::IndexEntryList::const_iterator rec_it = records.begin(); rec_it != records.end(); rec_it++) {
+            // Server events about observer are in the same index
+            uint16 type_hint = trace->record(*rec_it).type_hint;
+            if (type_hint != ProximityTag && type_hint != ObjectLocationTag)
                 continue;
-            }
 
+            Event* evt = trace->parseEvent(*rec_it);
+            if (evt == NULL)
+                continue;
+            evt_list->push_back(evt);
         }
     }
 
-    sort_events<EventList, ObjectEventListMap>(mEventLists);
-    sort_events<EventList, ServerEventListMap>(mServerEventLists);
+    std::sort(evt_list->begin(), evt_list->end(), EventTimeComparator());
+    return evt_list;
 }
 
 LocationErrorAnalysis::~LocationErrorAnalysis() {
@@ -300,13 +401,18 @@ LocationErrorAnalysis::~LocationErrorAnalysis() {
         EventList* event_list = event_lists_it->second;
         for(EventList::iterator events_it = event_list->begin(); events_it != event_list->end(); events_it++)
             delete *events_it;
+        delete event_list;
     }
 
     for(ServerEventListMap::iterator event_lists_it = mServerEventLists.begin(); event_lists_it != mServerEventLists.end(); event_lists_it++) {
         EventList* event_list = event_lists_it->second;
         for(EventList::iterator events_it = event_list->begin(); events_it != event_list->end(); events_it++)
             delete *events_it;
+        delete event_list;
     }
+
+    for(std::vector<TraceFile*>::iterator trace_it = mTraces.begin(); trace_it != mTraces.end(); trace_it++)
+        delete *trace_it;
 }
 
 bool LocationErrorAnalysis::observed(const UUID& observer, const UUID& seen) const {
@@ -461,10 +567,10 @@ double LocationErrorAnalysis::averageError(const UUID& observer, const UUID& see
 double LocationErrorAnalysis::globalAverageError(const Duration& sampling_rate) const {
     double total_error = 0.0;
     uint32 total_pairs = 0;
-    for(ObjectEventListMap::const_iterator observer_it = mEventLists.begin(); observer_it != mEventLists.end(); observer_it++) {
-        UUID observer = observer_it->first;
-        for(ObjectEventListMap::const_iterator seen_it = mEventLists.begin(); seen_it != mEventLists.end(); seen_it++) {
-            UUID seen = seen_it->first;
+    for(std::vector<UUID>::const_iterator observer_it = mObservers.begin(); observer_it != mObservers.end(); observer_it++) {
+        UUID observer = *observer_it;
+        for(std::vector<UUID>::const_iterator seen_it = mObservers.begin(); seen_it != mObservers.end(); seen_it++) {
+            UUID seen = *seen_it;
             if (observer == seen) continue;
             if (observed(observer, seen)) {
                 double error = averageError(observer, seen, sampling_rate);
@@ -478,9 +584,14 @@ double LocationErrorAnalysis::globalAverageError(const Duration& sampling_rate)
 
 LocationErrorAnalysis::EventList* LocationErrorAnalysis::getEventList(const UUID& observer) const {
     ObjectEventListMap::const_iterator event_lists_it = mEventLists.find(observer);
-    if (event_lists_it == mEventLists.end()) return NULL;
+    if (event_lists_it != mEventLists.end()) return event_lists_it->second;
 
-    return event_lists_it->second;
+    if (!std::binary_search(mObservers.begin(), mObservers.end(), observer))
+        return NULL;
+
+    EventList* event_list = loadEventList(observer);
+    mEventLists[observer] = event_list;
+    return event_list;
 }
 
 LocationErrorAnalysis::EventList* LocationErrorAnalysis::getEventList(const ServerID& observer) const {
@@ -522,45 +633,61 @@ void insert_event(EventType* evt, EventListMapType& lists) {
 }
 
 BandwidthAnalysis::BandwidthAnalysis(const char* opt_name, const uint32 nservers) {
-    // read in all our data
+    // read in all our data, each server's trace separately, then merge them
     mNumberOfServers = nservers;
 
-    for(uint32 server_id = 1; server_id <= nservers; server_id++) {
-        String loc_file = GetPerServerFile(opt_name, server_id);
-        std::ifstream is(loc_file.c_str(), std::ios::in);
+    std::vector<String> trace_files = PerServerFiles(opt_name, nservers);
+    std::vector<ServerDatagramEventListMap> partials(nservers);
+    ParallelFor(
+        nservers,
+        std::tr1::bind(&BandwidthAnalysis::readServerTrace, &trace_files, std::tr1::placeholders::_1, &partials)
+    );
 
-        while(is) {
-            uint16 type_hint;
-            std::string raw_evt;
-            if (!read_record(is, &type_hint, &raw_evt)) break;
-            Event* evt = Event::parse(type_hint, raw_evt, server_id);
-            if (evt == NULL)
-                break;
+    EventListMerger<DatagramEventList, ServerDatagramEventListMap>::merge(partials, mDatagramEventLists);
+}
 
-            bool used = false;
+void BandwidthAnalysis::readServerTrace(const std::vector<String>* trace_files, uint32 idx, std::vector<ServerDatagramEventListMap>* partials) {
+    ServerID server_id = idx + 1;
+    ServerDatagramEventListMap& datagram_lists = (*partials)[idx];
 
-            DatagramQueuedEvent* datagram_queued_evt = dynamic_cast<DatagramQueuedEvent*>(evt);
-            DatagramSentEvent* datagram_sent_evt = dynamic_cast<DatagramSentEvent*>(evt);
-            DatagramReceivedEvent* datagram_received_evt = dynamic_cast<DatagramReceivedEvent*>(evt);
-            if (datagram_queued_evt != NULL) {
-                used = true;
-                insert_event<DatagramQueuedEvent, DatagramEventList, ServerDatagramEventListMap>(datagram_queued_evt, mDatagramEventLists);
-            }
-            else if (datagram_sent_evt != NULL) {
-                used = true;
-                insert_event<DatagramSentEvent, DatagramEventList, ServerDatagramEventListMap>(datagram_sent_evt, mDatagramEventLists);
-            }
-            else if (datagram_received_evt != NULL) {
-                used = true;
-                insert_event<DatagramReceivedEvent, DatagramEventList, ServerDatagramEventListMap>(datagram_received_evt, mDatagramEventLists);
-            }
+    TraceFile::TypeHintSet types;
+    types.insert(ServerDatagramQueuedTag);
+    types.insert(ServerDatagramSentTag);
+    types.insert(ServerDatagramReceivedTag);
+
+    TraceFile trace((*trace_files)[idx], server_id, types);
 
-            if (!used) delete evt;
+    for(TraceFile::TypeHintSet::const_iterator type_it = types.begin(); type_it != types.end(); type_it++) {
+      const TraceFile::IndexEntryList& records = trace.records(*type_it);
+      for(TraceFile::IndexEntryList::const_iterator rec_it = records.begin(); rec_it != records.end(); rec_it++) {
+        Event* evt = trace.parseEvent(*rec_it);
+        if (evt == NULL)
+            continue;
+
+        bool used = false;
+
+        DatagramQueuedEvent* datagram_queued_evt = dynamic_cast<DatagramQueuedEvent*>(evt);
+        DatagramSentEvent* datagram_sent_evt = dynamic_cast<DatagramSentEvent*>(evt);
+        DatagramReceivedEvent* datagram_received_evt = dynamic_cast<DatagramReceivedEvent*>(evt);
+        if (datagram_queued_evt != NULL) {
+            used = true;
+            insert_event<DatagramQueuedEvent, DatagramEventList, ServerDatagramEventListMap>(datagram_queued_evt, datagram_lists);
+        }
+        else if (datagram_sent_evt != NULL) {
+            used = true;
+            insert_event<DatagramSentEvent, DatagramEventList, ServerDatagramEventListMap>(datagram_sent_evt, datagram_lists);
         }
+        else if (datagram_received_evt != NULL) {
+            used = true;
+            insert_event<DatagramReceivedEvent, DatagramEventList, ServerDatagramEventListMap>(datagram_received_evt, datagram_lists);
+        }
+
+        if (!used) delete evt;
+      }
     }
 
     // Sort all lists of events by time
-    sort_events<DatagramEventList, ServerDatagramEventListMap>(mDatagramEventLists);
+    sort_events<DatagramEventList, ServerDatagramEventListMap>(datagram_lists);
 }
 
 BandwidthAnalysis::~BandwidthAnalysis() {
@@ -798,39 +925,93 @@ void LatencyAnalysis::PacketData::addPacketReceivedEvent(DatagramReceivedEvent*s
     }
 }
 
-LatencyAnalysis::LatencyAnalysis(const char* opt_name, const uint32 nservers) {
-    // read in all our data
-    mNumberOfServers = nservers;
-    std::tr1::unordered_map<uint64,PacketData> packetFlow;
-    for(uint32 server_id = 1; server_id <= nservers; server_id++) {
-        String loc_file = GetPerServerFile(opt_name, server_id);
-        std::ifstream is(loc_file.c_str(), std::ios::in);
+void LatencyAnalysis::PacketData::merge(const PacketData& other) {
+    // Every event for a packet describes the same packet, so just take its
+    // details if we haven't seen any events for it yet
+    if (_send_start_time == Time::null() && _receive_end_time == Time::null()) {
+        mSize = other.mSize;
+        mId = other.mId;
+        source = other.source;
+        dest = other.dest;
+    }
+    if (other._send_start_time != Time::null() &&
+        (_send_start_time == Time::null() || _send_start_time >= other._send_start_time)) {
+        _send_start_time = other._send_start_time;
+        _send_end_time = other._send_end_time;
+    }
+    if (other._receive_end_time != Time::null() &&
+        (_receive_end_time == Time::null() || _receive_end_time <= other._receive_end_time)) {
+        _receive_start_time = other._receive_start_time;
+        _receive_end_time = other._receive_end_time;
+    }
+}
 
-        while(is) {
-            uint16 type_hint;
-            std::string raw_evt;
-            if (!read_record(is, &type_hint, &raw_evt)) break;
-            Event* evt = Event::parse(type_hint, raw_evt, server_id);
-            if (evt == NULL)
-                break;
+void LatencyAnalysis::readServerTrace(const std::vector<String>* trace_files, uint32 idx, std::vector<PacketFlowShards>* partials) {
+    ServerID server_id = idx + 1;
+    PacketFlowShards& shards = (*partials)[idx];
 
+    // Only datagram records are needed, skip everything else without
+    // parsing it
+    TraceFile trace((*trace_files)[idx], server_id, TraceFile::TypeHintSet());
+    uint64 pos = 0;
+    TraceRecordOrder order;
+    TraceFile::Record rec;
+    while(trace.readRecord(&pos, &rec, &order)) {
+        if (rec.type_hint != ServerDatagramReceivedTag && rec.type_hint != ServerDatagramQueuedTag)
+            continue;
+        Event* evt = Event::parse(rec.type_hint, rec.data, rec.size, server_id, &order);
+        if (evt == NULL)
+            break;
 
-            {
-                DatagramReceivedEvent* datagram_evt = dynamic_cast<DatagramReceivedEvent*>(evt);
-                if (datagram_evt != NULL) {
-                    packetFlow[datagram_evt->data.uid()].addPacketReceivedEvent(datagram_evt);
-                }
+
+        {
+            DatagramReceivedEvent* datagram_evt = dynamic_cast<DatagramReceivedEvent*>(evt);
+            if (datagram_evt != NULL) {
+                uint64 uid = datagram_evt->data.uid();
+                shards[uid % shards.size()][uid].addPacketReceivedEvent(datagram_evt);
             }
-            {
-                DatagramQueuedEvent* datagram_evt = dynamic_cast<DatagramQueuedEvent*>(evt);
-                if (datagram_evt != NULL) {
-                    packetFlow[datagram_evt->data.uid()].addPacketSentEvent(datagram_evt);
-                }
+        }
+        {
+            DatagramQueuedEvent* datagram_evt = dynamic_cast<DatagramQueuedEvent*>(evt);
+            if (datagram_evt != NULL) {
+                uint64 uid = datagram_evt->data.uid();
+                shards[uid % shards.size()][uid].addPacketSentEvent(datagram_evt);
             }
-
-            delete evt;
         }
+
+        delete evt;
     }
+}
+
+void LatencyAnalysis::mergeShard(std::vector<PacketFlowShards>* partials, uint32 shard, PacketFlowShards* merged) {
+    PacketFlowMap& merged_flows = (*merged)[shard];
+    for(std::vector<PacketFlowShards>::iterator part_it = partials->begin(); part_it != partials->end(); part_it++) {
+        PacketFlowMap& flows = (*part_it)[shard];
+        for(PacketFlowMap::iterator flow_it = flows.begin(); flow_it != flows.end(); flow_it++)
+            merged_flows[flow_it->first].merge(flow_it->second);
+        flows.clear();
+    }
+}
+
+LatencyAnalysis::LatencyAnalysis(const char* opt_name, const uint32 nservers) {
+    // read in all our data
+    mNumberOfServers = nservers;
+
+    // Each server's trace is read separately, splitting packets into shards
+    // by id so that each shard can then be merged across servers
+    // independently
+    uint32 nshards = AnalysisThreads();
+    std::vector<String> trace_files = PerServerFiles(opt_name, nservers);
+    std::vector<PacketFlowShards> partials(nservers, PacketFlowShards(nshards));
+    ParallelFor(
+        nservers,
+        std::tr1::bind(&LatencyAnalysis::readServerTrace, &trace_files, std::tr1::placeholders::_1, &partials)
+    );
+    PacketFlowShards packetFlow(nshards);
+    ParallelFor(
+        nshards,
+        std::tr1::bind(&LatencyAnalysis::mergeShard, &partials, std::tr1::placeholders::_1, &packetFlow)
+    );
 
     class LatencyStats {
     public:
@@ -875,7 +1056,8 @@ LatencyAnalysis::LatencyAnalysis(const char* opt_name, const uint32 nservers) {
 
     Time epoch(Time::null());
 
-    for (std::tr1::unordered_map<uint64,PacketData>::iterator i=packetFlow.begin(),ie=packetFlow.end();i!=ie;++i) {
+    for (PacketFlowShards::iterator shard_it=packetFlow.begin(),shard_ie=packetFlow.end();shard_it!=shard_ie;++shard_it)
+    for (PacketFlowMap::iterator i=shard_it->begin(),ie=shard_it->end();i!=ie;++i) {
         PacketData data = i->second;
 
         if (data._receive_end_time != epoch && data._send_start_time != epoch) {
@@ -42,6 +42,7 @@ namespace Sirikata {
 
 struct Event;
 struct ObjectEvent;
+class TraceFile;
 
 TimedMotionVector3f extractTimedMotionVector(const Sirikata::Trace::ITimedMotionVector& tmv);
 
@@ -63,10 +64,22 @@ protected:
     typedef std::map<UUID, EventList*> ObjectEventListMap;
     typedef std::map<ServerID, EventList*> ServerEventListMap;
 
+    // Object event lists are parsed from the traces the first time they're
+    // requested and cached until the analysis is destroyed
     EventList* getEventList(const UUID& observer) const;
     EventList* getEventList(const ServerID& observer) const;
 
-    ObjectEventListMap mEventLists;
+    // Map and index one server's trace, then read and sort its server events
+    static void readServerTrace(const std::vector<String>* trace_files, uint32 idx, std::vector<TraceFile*>* traces, std::vector<ServerEventListMap>* server_partials);
+
+    // Parse the location and proximity events observer received, in every
+    // server's trace
+    EventList* loadEventList(const UUID& observer) const;
+
+    std::vector<TraceFile*> mTraces;
+    // Objects which received location or proximity updates
+    std::vector<UUID> mObservers;
+    mutable ObjectEventListMap mEventLists;
     ServerEventListMap mServerEventLists;
 }; // class LocationErrorAnalysis
 
@@ -104,6 +117,9 @@ private:
     template<typename EventType, typename EventIteratorType>
     void computeJFI(const ServerID& sender, const ServerID& filter) const;
 
+    // Read and sort the events from one server's trace
+    static void readServerTrace(const std::vector<String>* trace_files, uint32 idx, std::vector<ServerDatagramEventListMap>* partials);
+
     ServerDatagramEventListMap mDatagramEventLists;
 
     uint32 mNumberOfServers;
@@ -128,7 +144,15 @@ class LatencyAnalysis {
         PacketData();
         void addPacketSentEvent(DatagramQueuedEvent*);
         void addPacketReceivedEvent(DatagramReceivedEvent*);
+        // Combine with the events for the same packet from another trace
+        void merge(const PacketData& other);
     };
+    typedef std::tr1::unordered_map<uint64, PacketData> PacketFlowMap;
+    // Packets split up by id, so shards can be merged independently
+    typedef std::vector<PacketFlowMap> PacketFlowShards;
+
+    static void readServerTrace(const std::vector<String>* trace_files, uint32 idx, std::vector<PacketFlowShards>* partials);
+    static void mergeShard(std::vector<PacketFlowShards>* partials, uint32 shard, PacketFlowShards* merged);
 
 public:
     LatencyAnalysis(const char* opt_name, const uint32 nservers);
@@ -45,23 +45,50 @@
 
 namespace Sirikata {
 
-/** Read a single trace record, storing the type hint in type_hint_out and the result in payload_out.*/
-bool read_record(std::istream& is, uint16* type_hint_out, std::string* payload_out);
+/** Tracks which thread recorded each trace record and its sequence number
+ *  within that thread, as recorded by TraceThreadRunTag records. Records from
+ *  traces without them all belong to thread 0.
+ */
+struct TraceRecordOrder {
+    TraceRecordOrder()
+     : thread(0), seqno(0), next_seqno(0)
+    {}
+
+    uint32 thread;
+    uint64 seqno;
+    uint64 next_seqno;
+};
+
+/** Read a single trace record, storing the type hint in type_hint_out and the
+ *  result in payload_out. TraceThreadRunTag records are consumed here rather
+ *  than returned; if order is non-NULL it is updated with the thread and
+ *  sequence number of the record that was read.
+ */
+bool read_record(std::istream& is, uint16* type_hint_out, std::string* payload_out, TraceRecordOrder* order = NULL);
 
 struct Event {
-    static Event* parse(uint16 type_hint, const std::string& record, const ServerID& trace_server_id);
+    static Event* parse(uint16 type_hint, const std::string& record, const ServerID& trace_server_id, const TraceRecordOrder* order = NULL);
+    static Event* parse(uint16 type_hint, const char* data, uint32 size, const ServerID& trace_server_id, const TraceRecordOrder* order = NULL);
 
     Event()
-     : time(Time::null())
+     : time(Time::null()),
+       thread(0),
+       seqno(0)
     {}
     virtual ~Event() {}
 
     Time time;
+    // Recording thread and sequence number, used to keep the order of
+    // events from one thread which have the same timestamp
+    uint32 thread;
+    uint64 seqno;
 };
 
 struct EventTimeComparator {
     bool operator()(const Event* lhs, const Event* rhs) const {
-        return (lhs->time < rhs->time);
+        if (lhs->time != rhs->time) return (lhs->time < rhs->time);
+        if (lhs->thread != rhs->thread) return (lhs->thread < rhs->thread);
+        return (lhs->seqno < rhs->seqno);
     }
 };
 
@@ -88,6 +115,12 @@ struct MessageCreationTimestampEvent : public MessageTimestampEvent {
     ObjectMessagePort dstport;
 };
 
+/** Decode a MessageTimestampTag or MessageCreationTimestampTag record into
+ *  evt_out without allocating an Event. Ports are 0 for MessageTimestampTag
+ *  records. Returns false for any other type of record.
+ */
+bool parse_timestamp_record(uint16 type_hint, const char* data, uint32 size, MessageCreationTimestampEvent* evt_out);
+
 
 // Object
 typedef PBJEvent<Trace::Object::Connected> ObjectConnectedEvent;
@@ -32,6 +32,7 @@
 
 #include "AnalysisEvents.hpp"
 #include "MessageLatency.hpp"
+#include "TraceFile.hpp"
 #include <sirikata/core/options/CommonOptions.hpp>
 
 #define INFO_LOG(msg) SILOG(msg_lat_anls,insane,msg)
@@ -904,6 +905,12 @@ void MessageLatencyAnalysis(const char* opt_name, const uint32 nservers, Message
     using std::tr1::placeholders::_2;
     ReportPairFunction report_func = std::tr1::bind(&reportPair, _1, _2, &results, stage_dump_file);
 
+    // Map each server's trace once; every round makes a pass over all of
+    // them, only looking at timestamp records
+    std::vector<TraceFile*> traces;
+    for(uint32 server_id = 1; server_id <= nservers; server_id++)
+        traces.push_back(new TraceFile(GetPerServerFile(opt_name, server_id), server_id, TraceFile::TypeHintSet()));
+
     // Round data
     uint32 round_max_packets = 1024*1024; // maximum # of packets per round
     uint64 round_base_id = 0; // we'll choose from ID's greater than this, and
@@ -916,19 +923,18 @@ void MessageLatencyAnalysis(const char* opt_name, const uint32 nservers, Message
 
         // Read in data for this round
         for(uint32 server_id = 1; server_id <= nservers; server_id++) {
-            String loc_file = GetPerServerFile(opt_name, server_id);
-            std::ifstream is(loc_file.c_str(), std::ios::in);
-
-            while(is) {
-                uint16 type_hint;
-                std::string raw_evt;
-                if (!read_record(is, &type_hint, &raw_evt)) break;
-                Event* evt = Event::parse(type_hint, raw_evt, server_id);
-                if (evt == NULL)
-                    break;
+            const TraceFile* trace = traces[server_id-1];
+            uint64 pos = 0;
+            TraceRecordOrder order;
+            TraceFile::Record rec;
+            while(trace->readRecord(&pos, &rec, &order)) {
+                // Decoded in place, these are the vast majority of records
+                MessageCreationTimestampEvent stamp;
+                MessageCreationTimestampEvent* tevt = NULL;
+                if (parse_timestamp_record(rec.type_hint, rec.data, rec.size, &stamp))
+                    tevt = &stamp;
 
                 {
-                    MessageTimestampEvent* tevt = dynamic_cast<MessageTimestampEvent*>(evt);
                     if (tevt != NULL) {
                         uint64 pid = tevt->uid;
 
@@ -960,15 +966,13 @@ void MessageLatencyAnalysis(const char* opt_name, const uint32 nservers, Message
                         if (should_insert) {
                             PacketData* pd = &packetFlow[tevt->uid];
                             pd->stamps[server_id].push_back(PacketSample(tevt->time, server_id, tevt->path));
-                            MessageCreationTimestampEvent* cevt = dynamic_cast<MessageCreationTimestampEvent*>(evt);
-                            if (cevt != NULL) {
-                                if (cevt->srcport!=0) pd->source_port = cevt->srcport;
-                                if (cevt->dstport!=0) pd->dest_port = cevt->dstport;
+                            if (rec.type_hint == MessageCreationTimestampTag) {
+                                if (tevt->srcport!=0) pd->source_port = tevt->srcport;
+                                if (tevt->dstport!=0) pd->dest_port = tevt->dstport;
                             }
                         }
                     }
                 }
-                delete evt;
             }
         }
 
@@ -1002,6 +1006,10 @@ void MessageLatencyAnalysis(const char* opt_name, const uint32 nservers, Message
             break;
     }
 
+    for(uint32 i = 0; i < traces.size(); i++)
+        delete traces[i];
+    traces.clear();
+
     if (stage_dump_file) {
         stage_dump_file->close();
         delete stage_dump_file;
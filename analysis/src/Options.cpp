@@ -61,6 +61,7 @@ void InitAnalysisOptions() {
 
 
         .addOption(new OptionValue(ANALYSIS_TOTAL_NUM_ALL_SERVERS ,"0",Sirikata::OptionValueType<uint32>(),"Number of all servers/trace files to go through."))
+        .addOption(new OptionValue(ANALYSIS_THREADS, "0", Sirikata::OptionValueType<uint32>(), "Number of threads to read and merge per-server traces with, 0 to use one per core."))
         
 
         
@@ -51,6 +51,7 @@
 #define ANALYSIS_FLOW_STATS "analysis.flow.stats"
 
 #define ANALYSIS_TOTAL_NUM_ALL_SERVERS "analysis.total.num.all.servers"
+#define ANALYSIS_THREADS "analysis.threads"
 
 #define OSEG_ANALYZE_AFTER         "oseg_analyze_after"
 
@@ -0,0 +1,63 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "ParallelAnalysis.hpp"
+#include "Options.hpp"
+#include <sirikata/core/options/Options.hpp>
+#include <sirikata/core/options/CommonOptions.hpp>
+#include <sirikata/core/util/Thread.hpp>
+#include <sirikata/core/util/AtomicTypes.hpp>
+
+namespace Sirikata {
+
+uint32 AnalysisThreads() {
+    uint32 nthreads = GetOptionValue<uint32>(ANALYSIS_THREADS);
+    if (nthreads == 0)
+        nthreads = Thread::hardware_concurrency();
+    return std::max(nthreads, (uint32)1);
+}
+
+std::vector<String> PerServerFiles(const char* opt_name, uint32 nservers) {
+    std::vector<String> files;
+    for(uint32 server_id = 1; server_id <= nservers; server_id++)
+        files.push_back(GetPerServerFile(opt_name, server_id));
+    return files;
+}
+
+namespace {
+
+// Workers just keep grabbing the next unprocessed index, so servers with
+// large traces don't hold up the ones after them
+void ParallelForWorker(AtomicValue<uint32>* next, uint32 count, const std::tr1::function<void(uint32)>& work) {
+    while(true) {
+        uint32 idx = ++(*next) - 1;
+        if (idx >= count) break;
+        work(idx);
+    }
+}
+
+} // namespace
+
+void ParallelFor(uint32 count, const std::tr1::function<void(uint32)>& work) {
+    uint32 nthreads = std::min(AnalysisThreads(), count);
+    AtomicValue<uint32> next(0);
+
+    if (nthreads <= 1) {
+        ParallelForWorker(&next, count, work);
+        return;
+    }
+
+    // The calling thread does its share of the work as well
+    std::vector<Thread*> workers;
+    for(uint32 i = 1; i < nthreads; i++)
+        workers.push_back(new Thread("Analysis Worker", std::tr1::bind(&ParallelForWorker, &next, count, work)));
+    ParallelForWorker(&next, count, work);
+
+    for(std::vector<Thread*>::iterator it = workers.begin(); it != workers.end(); it++) {
+        (*it)->join();
+        delete *it;
+    }
+}
+
+} // namespace Sirikata
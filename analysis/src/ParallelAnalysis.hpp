@@ -0,0 +1,112 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_ANALYSIS_PARALLEL_ANALYSIS_HPP_
+#define _SIRIKATA_ANALYSIS_PARALLEL_ANALYSIS_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include "AnalysisEvents.hpp"
+#include <algorithm>
+
+namespace Sirikata {
+
+/** Number of worker threads analyses should use, from the analysis.threads
+ *  option, or the number of hardware threads if that is 0.
+ */
+uint32 AnalysisThreads();
+
+/** Get the trace file names for servers 1 through nservers. Index i holds
+ *  the trace for server i + 1.
+ */
+std::vector<String> PerServerFiles(const char* opt_name, uint32 nservers);
+
+/** Call work(i) for every i in [0, count), spread across AnalysisThreads()
+ *  worker threads. Each index is processed exactly once and ParallelFor
+ *  returns once all of them have been processed. work must be safe to call
+ *  concurrently for different indices.
+ */
+void ParallelFor(uint32 count, const std::tr1::function<void(uint32)>& work);
+
+
+/** Merge per-server maps of event lists, each of which is already sorted by
+ *  EventTimeComparator, into one map. The lists for each key are merged in
+ *  parallel across keys, so the result is the same as concatenating and
+ *  sorting them, but each list only needs a log(#servers) pass merge.
+ *  Ties are kept in the order of partials, so the result is deterministic.
+ *  The partial maps' lists are freed and the partial maps cleared.
+ */
+template<typename EventListType, typename EventListMapType>
+class EventListMerger {
+public:
+    typedef typename EventListMapType::key_type KeyType;
+
+    static void merge(std::vector<EventListMapType>& partials, EventListMapType& merged) {
+        EventListMerger merger;
+        std::map<KeyType, uint32> key_idx;
+        for(typename std::vector<EventListMapType>::iterator part_it = partials.begin(); part_it != partials.end(); part_it++) {
+            for(typename EventListMapType::iterator list_it = part_it->begin(); list_it != part_it->end(); list_it++) {
+                typename std::map<KeyType, uint32>::iterator idx_it = key_idx.find(list_it->first);
+                if (idx_it == key_idx.end()) {
+                    idx_it = key_idx.insert( std::make_pair(list_it->first, (uint32)merger.mRuns.size()) ).first;
+                    EventListType*& merged_list = merged[list_it->first];
+                    if (merged_list == NULL)
+                        merged_list = new EventListType;
+                    merger.mOutputs.push_back(merged_list);
+                    merger.mRuns.push_back(RunList());
+                }
+                merger.mRuns[idx_it->second].push_back(list_it->second);
+            }
+        }
+
+        ParallelFor(
+            merger.mRuns.size(),
+            std::tr1::bind(&EventListMerger::mergeKey, &merger, std::tr1::placeholders::_1)
+        );
+
+        for(typename std::vector<EventListMapType>::iterator part_it = partials.begin(); part_it != partials.end(); part_it++) {
+            for(typename EventListMapType::iterator list_it = part_it->begin(); list_it != part_it->end(); list_it++)
+                delete list_it->second;
+            part_it->clear();
+        }
+    }
+
+private:
+    typedef std::vector<EventListType*> RunList;
+
+    void mergeKey(uint32 idx) {
+        const RunList& runs = mRuns[idx];
+        EventListType* out = mOutputs[idx];
+
+        // Lay the runs out back to back, remembering where each one starts,
+        // then merge neighbouring pairs until only one run is left
+        std::vector<size_t> bounds;
+        bounds.push_back(out->size());
+        for(typename RunList::const_iterator run_it = runs.begin(); run_it != runs.end(); run_it++) {
+            out->insert(out->end(), (*run_it)->begin(), (*run_it)->end());
+            bounds.push_back(out->size());
+        }
+
+        while(bounds.size() > 2) {
+            std::vector<size_t> next_bounds;
+            size_t i = 0;
+            for(; i + 2 < bounds.size(); i += 2) {
+                std::inplace_merge(
+                    out->begin() + bounds[i], out->begin() + bounds[i+1], out->begin() + bounds[i+2],
+                    EventTimeComparator()
+                );
+                next_bounds.push_back(bounds[i]);
+            }
+            for(; i < bounds.size(); i++)
+                next_bounds.push_back(bounds[i]);
+            bounds.swap(next_bounds);
+        }
+    }
+
+    std::vector<EventListType*> mOutputs;
+    std::vector<RunList> mRuns;
+}; // class EventListMerger
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_ANALYSIS_PARALLEL_ANALYSIS_HPP_
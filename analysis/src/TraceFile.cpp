@@ -0,0 +1,146 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "TraceFile.hpp"
+
+namespace Sirikata {
+
+// Every record starts with its payload size and type hint
+static const uint32 RecordHeaderSize = sizeof(uint32) + sizeof(uint16);
+
+TraceFile::TraceFile(const String& filename, const ServerID& server, const TypeHintSet& index_types, bool index_objects)
+ : mServer(server),
+   mData(NULL),
+   mSize(0)
+{
+    try {
+        mFile.open(filename);
+    }
+    catch(std::exception& e) {
+        // Missing and empty files can't be mapped, but just mean there's no
+        // trace data
+    }
+
+    if (mFile.is_open()) {
+        mData = mFile.data();
+        mSize = mFile.size();
+    }
+
+    buildIndex(index_types, index_objects);
+}
+
+TraceFile::~TraceFile() {
+    if (mFile.is_open())
+        mFile.close();
+}
+
+void TraceFile::buildIndex(const TypeHintSet& index_types, bool index_objects) {
+    if (index_types.empty())
+        return;
+
+    uint64 pos = 0;
+    TraceRecordOrder order;
+    Record rec;
+    while(readRecord(&pos, &rec, &order)) {
+        if (index_types.find(rec.type_hint) == index_types.end())
+            continue;
+
+        IndexEntry entry;
+        entry.offset = rec.offset;
+        entry.seqno = order.seqno;
+        entry.thread = order.thread;
+        mTypeIndex[rec.type_hint].push_back(entry);
+
+        UUID obj;
+        if (index_objects && recordObject(rec, &obj))
+            mObjectIndex[obj].push_back(entry);
+    }
+}
+
+bool TraceFile::readRecord(uint64* pos, Record* rec_out, TraceRecordOrder* order) const {
+    while(*pos + RecordHeaderSize <= mSize) {
+        rec_out->offset = *pos;
+        memcpy(&rec_out->size, mData + *pos, sizeof(rec_out->size));
+        memcpy(&rec_out->type_hint, mData + *pos + sizeof(rec_out->size), sizeof(rec_out->type_hint));
+        rec_out->data = mData + *pos + RecordHeaderSize;
+        // A partially written record at the end of the trace
+        if (*pos + RecordHeaderSize + rec_out->size > mSize)
+            return false;
+        *pos += RecordHeaderSize + rec_out->size;
+
+        if (rec_out->type_hint != TraceThreadRunTag) {
+            order->seqno = order->next_seqno++;
+            return true;
+        }
+
+        // Start of a run of records from one thread
+        if (rec_out->size == sizeof(order->thread) + sizeof(order->next_seqno)) {
+            memcpy(&order->thread, rec_out->data, sizeof(order->thread));
+            memcpy(&order->next_seqno, rec_out->data + sizeof(order->thread), sizeof(order->next_seqno));
+        }
+    }
+    return false;
+}
+
+bool TraceFile::recordObject(const Record& rec, UUID* obj_out) {
+#define RECORD_OBJECT(tag, type, field)                 \
+    if (rec.type_hint == tag) {                         \
+        type data;                                      \
+        if (!data.ParseFromArray(rec.data, rec.size))   \
+            return false;                               \
+        *obj_out = data.field();                        \
+        return true;                                    \
+    }
+
+    RECORD_OBJECT(ObjectConnectedTag, Trace::Object::Connected, source);
+    RECORD_OBJECT(ObjectGeneratedLocationTag, Trace::Object::GeneratedLoc, source);
+    RECORD_OBJECT(ObjectLocationTag, Trace::Object::LocUpdate, receiver);
+    RECORD_OBJECT(ProximityTag, Trace::Object::ProxUpdate, receiver);
+    RECORD_OBJECT(ServerLocationTag, Trace::LocProx::LocUpdate, object);
+    RECORD_OBJECT(ServerObjectEventTag, Trace::LocProx::ObjectEvent, object);
+    RECORD_OBJECT(MigrationBeginTag, Trace::Migration::Begin, object);
+    RECORD_OBJECT(MigrationAckTag, Trace::Migration::Ack, object);
+    RECORD_OBJECT(MigrationRoundTripTag, Trace::Migration::RoundTrip, object);
+
+#undef RECORD_OBJECT
+
+    return false;
+}
+
+const TraceFile::IndexEntryList& TraceFile::records(uint16 type_hint) const {
+    TypeIndex::const_iterator it = mTypeIndex.find(type_hint);
+    if (it == mTypeIndex.end()) return mEmptyList;
+    return it->second;
+}
+
+const TraceFile::IndexEntryList& TraceFile::objectRecords(const UUID& obj) const {
+    ObjectIndex::const_iterator it = mObjectIndex.find(obj);
+    if (it == mObjectIndex.end()) return mEmptyList;
+    return it->second;
+}
+
+void TraceFile::objects(std::vector<UUID>* objects_out) const {
+    for(ObjectIndex::const_iterator it = mObjectIndex.begin(); it != mObjectIndex.end(); it++)
+        objects_out->push_back(it->first);
+}
+
+TraceFile::Record TraceFile::record(const IndexEntry& entry) const {
+    Record rec;
+    rec.offset = entry.offset;
+    memcpy(&rec.size, mData + entry.offset, sizeof(rec.size));
+    memcpy(&rec.type_hint, mData + entry.offset + sizeof(rec.size), sizeof(rec.type_hint));
+    rec.data = mData + entry.offset + RecordHeaderSize;
+    return rec;
+}
+
+Event* TraceFile::parseEvent(const IndexEntry& entry) const {
+    Record rec = record(entry);
+
+    TraceRecordOrder order;
+    order.thread = entry.thread;
+    order.seqno = entry.seqno;
+    return Event::parse(rec.type_hint, rec.data, rec.size, mServer, &order);
+}
+
+} // namespace Sirikata
@@ -0,0 +1,102 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_ANALYSIS_TRACE_FILE_HPP_
+#define _SIRIKATA_ANALYSIS_TRACE_FILE_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include "AnalysisEvents.hpp"
+#include <boost/iostreams/device/mapped_file.hpp>
+
+namespace Sirikata {
+
+/** TraceFile provides random access to a single server's trace file without
+ *  reading it into memory. The file is memory mapped and a side index is
+ *  built in one streaming pass over it, holding the location of every record
+ *  of the requested types, both by type and, optionally, by the object the
+ *  record is about. Analyses can then walk just the records they need,
+ *  decoding each one only when they get to it, instead of parsing every
+ *  record in the file into an Event up front.
+ */
+class TraceFile {
+public:
+    typedef std::set<uint16> TypeHintSet;
+
+    /** Location of an indexed record, along with the thread that recorded it
+     *  and its sequence number within that thread.
+     */
+    struct IndexEntry {
+        uint64 offset;
+        uint64 seqno;
+        uint32 thread;
+    };
+    typedef std::vector<IndexEntry> IndexEntryList;
+
+    /** A record's type hint and payload, pointing into the mapped file. */
+    struct Record {
+        uint64 offset;
+        uint16 type_hint;
+        const char* data;
+        uint32 size;
+    };
+
+    /** Map and index filename. Only records with type hints in index_types
+     *  are indexed, and an empty set skips the indexing pass entirely. If
+     *  index_objects is true, records about a specific object (e.g. location
+     *  and proximity updates, migrations) are also indexed by that object. A
+     *  missing or empty file is treated as a trace without any records.
+     */
+    TraceFile(const String& filename, const ServerID& server, const TypeHintSet& index_types, bool index_objects = false);
+    ~TraceFile();
+
+    const ServerID& server() const { return mServer; }
+
+    /** Indexed records with the given type hint, in file order. */
+    const IndexEntryList& records(uint16 type_hint) const;
+
+    /** Indexed records about the given object, in file order. Empty unless
+     *  object indexing was requested.
+     */
+    const IndexEntryList& objectRecords(const UUID& obj) const;
+    /** Get all objects with indexed records. */
+    void objects(std::vector<UUID>* objects_out) const;
+
+    /** Sequential access to all records, for passes that need to look at
+     *  most of the file anyway and so don't benefit from an index. Reads the
+     *  record at *pos into rec_out and advances *pos past it, returning false
+     *  at the end of the file. Start with *pos = 0 and a fresh order, which is
+     *  updated with the thread and sequence number of each record.
+     */
+    bool readRecord(uint64* pos, Record* rec_out, TraceRecordOrder* order) const;
+
+    /** Get the record an index entry refers to. */
+    Record record(const IndexEntry& entry) const;
+
+    /** Parse the record an index entry refers to into a new Event, which the
+     *  caller owns. Returns NULL if the record type isn't recognized.
+     */
+    Event* parseEvent(const IndexEntry& entry) const;
+
+private:
+    void buildIndex(const TypeHintSet& index_types, bool index_objects);
+
+    // Extract the object a record is about, if there is one
+    static bool recordObject(const Record& rec, UUID* obj_out);
+
+    typedef std::tr1::unordered_map<uint16, IndexEntryList> TypeIndex;
+    typedef std::tr1::unordered_map<UUID, IndexEntryList, UUID::Hasher> ObjectIndex;
+
+    ServerID mServer;
+    boost::iostreams::mapped_file_source mFile;
+    const char* mData;
+    uint64 mSize;
+
+    TypeIndex mTypeIndex;
+    ObjectIndex mObjectIndex;
+    IndexEntryList mEmptyList;
+}; // class TraceFile
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_ANALYSIS_TRACE_FILE_HPP_
@@ -260,8 +260,8 @@ LocationVisualization::LocationVisualization(const char *opt_name, const uint32
     mSegmentationChangeIterator = mSegmentationChangeEvents.begin();
 
     // Create map of per-object motion paths
-    for(ObjectEventListMap::iterator it = mEventLists.begin(); it != mEventLists.end(); it++) {
-        UUID objid = it->first;
+    for(std::vector<UUID>::iterator it = mObservers.begin(); it != mObservers.end(); it++) {
+        UUID objid = *it;
         mObjectMotions[objid] = new RecordedMotionPath( *(getEventList(objid)) );
     }
 }
@@ -310,13 +310,10 @@ void LocationVisualization::displayError(const Duration&sampling_rate) {
 }
 
 void LocationVisualization::displayRandomViewerError(int seed, const Duration&sampling_rate) {
-    if (mEventLists.size() > 0) {
+    if (mObservers.size() > 0) {
         unsigned int which=seed;
-        which=which%mEventLists.size();
-        ObjectEventListMap::iterator iter=mEventLists.begin();
-        for (unsigned int i=0;i<which;++i,++iter) {
-        }
-        displayError(iter->first,sampling_rate);
+        which=which%mObservers.size();
+        displayError(mObservers[which],sampling_rate);
     }
     else {
         displayError(UUID::null(),sampling_rate);
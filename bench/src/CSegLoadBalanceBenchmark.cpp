@@ -0,0 +1,246 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "CSegLoadBalanceBenchmark.hpp"
+#include <sirikata/core/util/Timer.hpp>
+#include <sirikata/core/util/Random.hpp>
+
+#include "../../cseg/src/LoadBalancePlanner.hpp"
+
+#define WORLD_SIZE 1000.f
+#define WORLD_HEIGHT 100.f
+#define NUM_BACKGROUND 40000
+#define NUM_HOTSPOT 10000
+#define HOTSPOT_RADIUS 100.f
+// Radius of the circle the hotspot's center drifts around
+#define HOTSPOT_ORBIT 300.f
+#define BACKGROUND_MESSAGE_RATE 1
+#define HOTSPOT_MESSAGE_RATE 20
+// The world starts split into 2^INITIAL_DEPTH regions, and as many servers
+// again are idle
+#define INITIAL_DEPTH 3
+#define NUM_ROUNDS 200
+
+namespace Sirikata {
+
+namespace {
+
+Vector3f clampToWorld(const Vector3f& pos) {
+    return Vector3f(
+        std::max(0.f, std::min(WORLD_SIZE, pos.x)),
+        std::max(0.f, std::min(WORLD_SIZE, pos.y)),
+        std::max(0.f, std::min(WORLD_HEIGHT, pos.z))
+    );
+}
+
+// Splits node evenly, alternating between x and y, down to depth, assigning
+// servers to the leaves in order
+void buildTree(SegmentedRegion* node, uint32 depth, ServerID* next_server) {
+    if (depth == 0) {
+        node->mServer = (*next_server)++;
+        return;
+    }
+
+    const BoundingBox3f& box = node->mBoundingBox;
+    bool split_x = (node->mSplitAxis != SegmentedRegion::X);
+    Vector3f mid = (box.min() + box.max()) / 2.f;
+    Vector3f left_max = split_x ? Vector3f(mid.x, box.max().y, box.max().z) : Vector3f(box.max().x, mid.y, box.max().z);
+    Vector3f right_min = split_x ? Vector3f(mid.x, box.min().y, box.min().z) : Vector3f(box.min().x, mid.y, box.min().z);
+
+    node->mLeftChild = new SegmentedRegion(node);
+    node->mRightChild = new SegmentedRegion(node);
+    node->mLeftChild->mBoundingBox = BoundingBox3f(box.min(), left_max);
+    node->mRightChild->mBoundingBox = BoundingBox3f(right_min, box.max());
+    node->mLeftChild->mSplitAxis = node->mRightChild->mSplitAxis = split_x ? SegmentedRegion::X : SegmentedRegion::Y;
+
+    buildTree(node->mLeftChild, depth-1, next_server);
+    buildTree(node->mRightChild, depth-1, next_server);
+}
+
+void collectLeaves(SegmentedRegion* node, std::vector<SegmentedRegion*>* leaves) {
+    if (node->mLeftChild == NULL && node->mRightChild == NULL) {
+        leaves->push_back(node);
+        return;
+    }
+    collectLeaves(node->mLeftChild, leaves);
+    collectLeaves(node->mRightChild, leaves);
+}
+
+struct LeafCounts {
+    LeafCounts() : objects(0), messages(0) {}
+    uint32 objects;
+    uint32 messages;
+};
+typedef std::tr1::unordered_map<SegmentedRegion*, LeafCounts> LeafCountMap;
+
+// Assigns each object to a server, counting objects and messages per leaf,
+// and returns the cost of the most expensive server
+float32 assignObjects(SegmentedRegion* root, const std::vector<Vector3f>& positions, const std::vector<uint32>& rates,
+                      const LoadBalancePlanner::Parameters& params, std::vector<ServerID>* servers,
+                      LeafCountMap* counts) {
+    std::map<ServerID, float32> server_costs;
+    for(uint32 i = 0; i < positions.size(); i++) {
+        SegmentedRegion* leaf = root->lookup(positions[i]);
+        if (leaf == NULL) {
+            (*servers)[i] = NullServerID;
+            continue;
+        }
+        (*servers)[i] = leaf->mServer;
+        if (counts != NULL) {
+            LeafCounts& c = (*counts)[leaf];
+            c.objects++;
+            c.messages += rates[i];
+        }
+        server_costs[leaf->mServer] += params.objectCost + params.messageCost * rates[i];
+    }
+
+    float32 max_cost = 0.f;
+    for(std::map<ServerID, float32>::iterator it = server_costs.begin(); it != server_costs.end(); it++)
+        max_cost = std::max(max_cost, it->second);
+    return max_cost;
+}
+
+} // namespace
+
+CSegLoadBalanceBenchmark::CSegLoadBalanceBenchmark(const FinishedCallback& finished_cb)
+        : Benchmark(finished_cb),
+          mForceStop(false)
+{
+}
+
+String CSegLoadBalanceBenchmark::name() {
+    return "cseg-load-balance";
+}
+
+void CSegLoadBalanceBenchmark::start() {
+    mForceStop = false;
+
+    BoundingBox3f world(Vector3f(0, 0, 0), Vector3f(WORLD_SIZE, WORLD_SIZE, WORLD_HEIGHT));
+    uint32 num_initial = 1 << INITIAL_DEPTH;
+
+    SegmentedRegion balanced(NULL), fixed(NULL);
+    balanced.mBoundingBox = fixed.mBoundingBox = world;
+    ServerID next_server = 1;
+    buildTree(&balanced, INITIAL_DEPTH, &next_server);
+    next_server = 1;
+    buildTree(&fixed, INITIAL_DEPTH, &next_server);
+
+    std::vector<ServerID> idle;
+    for(ServerID sid = 2 * num_initial; sid > num_initial; sid--)
+        idle.push_back(sid);
+
+    // Hotspot objects keep a fixed offset from the hotspot's center
+    uint32 num_objects = NUM_BACKGROUND + NUM_HOTSPOT;
+    std::vector<Vector3f> positions(num_objects), offsets(NUM_HOTSPOT);
+    std::vector<uint32> rates(num_objects);
+    for(uint32 i = 0; i < NUM_BACKGROUND; i++) {
+        positions[i] = Vector3f(randFloat()*WORLD_SIZE, randFloat()*WORLD_SIZE, randFloat()*WORLD_HEIGHT);
+        rates[i] = BACKGROUND_MESSAGE_RATE;
+    }
+    for(uint32 i = 0; i < NUM_HOTSPOT; i++) {
+        // Sum of uniforms, so the hotspot is densest in the middle
+        float32 r = HOTSPOT_RADIUS / 3.f;
+        offsets[i] = Vector3f(
+            randFloat(-r, r) + randFloat(-r, r) + randFloat(-r, r),
+            randFloat(-r, r) + randFloat(-r, r) + randFloat(-r, r),
+            randFloat(-WORLD_HEIGHT/2, WORLD_HEIGHT/2)
+        );
+        rates[NUM_BACKGROUND + i] = HOTSPOT_MESSAGE_RATE;
+    }
+
+    // Scale the thresholds to the population: split servers at 1.5x the cost
+    // they'd have if the initial servers were balanced, and merge when a pair
+    // has less than a fifth of that
+    LoadBalancePlanner::Parameters params;
+    float32 total_cost = NUM_BACKGROUND * (params.objectCost + params.messageCost * BACKGROUND_MESSAGE_RATE) +
+        NUM_HOTSPOT * (params.objectCost + params.messageCost * HOTSPOT_MESSAGE_RATE);
+    float32 initial_avg = total_cost / num_initial;
+    params.overloadCost = 1.5f * initial_avg;
+    params.underloadCost = 0.2f * initial_avg;
+    params.migrationBudget = 0.1f * initial_avg;
+    LoadBalancePlanner planner(params);
+
+    std::vector<ServerID> servers(num_objects), replanned(num_objects), fixed_servers(num_objects);
+    std::vector<SegmentedRegion*> roots(1, &balanced);
+    // Imbalance is measured against the cost every server, including the
+    // idle ones, would have if it were spread perfectly
+    float32 ideal_cost = total_cost / (2 * num_initial);
+    float64 balanced_imbalance = 0, fixed_imbalance = 0;
+    float32 balanced_worst = 0, fixed_worst = 0;
+    uint32 changes = 0, batches = 0, changed_servers = 0;
+    uint64 migrated = 0;
+    Duration plan_dur = Duration::zero();
+
+    for(uint32 round = 0; round < NUM_ROUNDS && !mForceStop; round++) {
+        float32 angle = 2.f * 3.14159265f * round / NUM_ROUNDS;
+        Vector3f center(WORLD_SIZE/2 + HOTSPOT_ORBIT * cos(angle), WORLD_SIZE/2 + HOTSPOT_ORBIT * sin(angle), WORLD_HEIGHT/2);
+        for(uint32 i = 0; i < NUM_HOTSPOT; i++)
+            positions[NUM_BACKGROUND + i] = clampToWorld(center + offsets[i]);
+
+        LeafCountMap counts;
+        float32 imbalance = assignObjects(&balanced, positions, rates, params, &servers, &counts) / ideal_cost;
+        balanced_imbalance += imbalance;
+        balanced_worst = std::max(balanced_worst, imbalance);
+
+        imbalance = assignObjects(&fixed, positions, rates, params, &fixed_servers, NULL) / ideal_cost;
+        fixed_imbalance += imbalance;
+        fixed_worst = std::max(fixed_worst, imbalance);
+
+        // Every space server reports on its region
+        std::vector<SegmentedRegion*> leaves;
+        collectLeaves(&balanced, &leaves);
+        for(uint32 i = 0; i < leaves.size(); i++) {
+            LeafCountMap::iterator it = counts.find(leaves[i]);
+            if (it == counts.end())
+                planner.reportLoad(leaves[i], 0, 0);
+            else
+                planner.reportLoad(leaves[i], it->second.objects, it->second.messages);
+        }
+
+        std::set<ServerID> changed;
+        Time plan_start = Timer::now();
+        uint32 round_changes = planner.plan(roots, &idle, &changed);
+        plan_dur += Timer::now() - plan_start;
+        if (round_changes == 0)
+            continue;
+
+        changes += round_changes;
+        batches++;
+        changed_servers += changed.size();
+
+        // Objects whose server changed because of the new segmentation
+        assignObjects(&balanced, positions, rates, params, &replanned, NULL);
+        for(uint32 i = 0; i < num_objects; i++) {
+            if (replanned[i] != servers[i])
+                migrated++;
+        }
+    }
+
+    std::vector<SegmentedRegion*> final_leaves;
+    collectLeaves(&balanced, &final_leaves);
+    balanced.destroy();
+    fixed.destroy();
+
+    if (mForceStop)
+        return;
+
+    SILOG(benchmark,info,
+          NUM_ROUNDS << " rounds with " << num_objects << " objects, " << num_initial << " initial servers and "
+          << num_initial << " idle, " << final_leaves.size() << " regions at the end");
+    SILOG(benchmark,info,
+          "Cost imbalance (max/ideal): balanced avg " << balanced_imbalance / NUM_ROUNDS << ", worst " << balanced_worst
+          << "; unbalanced avg " << fixed_imbalance / NUM_ROUNDS << ", worst " << fixed_worst);
+    SILOG(benchmark,info,
+          changes << " changes in " << batches << " batches touching " << changed_servers << " servers, "
+          << migrated << " objects migrated (" << (float64)migrated / NUM_ROUNDS << "/round), "
+          << planner.migratedCost() << " estimated cost migrated, planning took " << plan_dur);
+
+    notifyFinished();
+}
+
+void CSegLoadBalanceBenchmark::stop() {
+    mForceStop = true;
+}
+
+} // namespace Sirikata
@@ -0,0 +1,41 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_CSEG_LOAD_BALANCE_BENCHMARK_HPP_
+#define _SIRIKATA_CSEG_LOAD_BALANCE_BENCHMARK_HPP_
+
+#include "Benchmark.hpp"
+
+namespace Sirikata {
+
+/** CSegLoadBalanceBenchmark runs the LoadBalancePlanner used by the cseg
+ *  server's cost load balancer against a simulated world: a uniform
+ *  background population plus a hotspot of busier objects that drifts across
+ *  the world. Each round the fake space servers report the objects and
+ *  message rate in their regions and the planner makes one round of changes.
+ *  It reports how well cost is balanced compared to leaving the segmentation
+ *  alone, and how many objects had to migrate to get there.
+ */
+class CSegLoadBalanceBenchmark : public Benchmark {
+  public:
+    typedef std::tr1::function<void()> FinishedCallback;
+
+    static Benchmark* create(const FinishedCallback& finished_cb, const String& _param) {
+        return new CSegLoadBalanceBenchmark(finished_cb);
+    }
+
+    CSegLoadBalanceBenchmark(const FinishedCallback& finished_cb);
+
+    virtual String name();
+
+    virtual void start();
+    virtual void stop();
+
+  private:
+    bool mForceStop;
+}; // class CSegLoadBalanceBenchmark
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_CSEG_LOAD_BALANCE_BENCHMARK_HPP_
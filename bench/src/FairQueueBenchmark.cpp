@@ -0,0 +1,101 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "FairQueueBenchmark.hpp"
+#include <sirikata/core/util/Timer.hpp>
+#include <sirikata/core/queue/FairQueue.hpp>
+
+#define ITERATIONS 1000000
+#define MESSAGES_PER_QUEUE 4
+
+namespace Sirikata {
+
+namespace {
+
+struct FairQueueBenchmarkMessage {
+    FairQueueBenchmarkMessage(uint32 sz)
+     : mSize(sz)
+    {}
+
+    uint32 size() const {
+        return mSize;
+    }
+
+    uint32 mSize;
+};
+
+typedef Queue<FairQueueBenchmarkMessage*> BenchInputQueue;
+typedef FairQueue<FairQueueBenchmarkMessage, uint32, BenchInputQueue, FairQueueTreeIndex> BenchTreeFairQueue;
+typedef FairQueue<FairQueueBenchmarkMessage, uint32, BenchInputQueue, FairQueueHeapIndex> BenchHeapFairQueue;
+
+} // namespace
+
+FairQueueBenchmark::FairQueueBenchmark(const FinishedCallback& finished_cb)
+        : Benchmark(finished_cb),
+          mForceStop(false)
+{
+}
+
+String FairQueueBenchmark::name() {
+    return "fair-queue";
+}
+
+template<typename FairQueueType>
+bool FairQueueBenchmark::runQueue(const String& index_name, uint32 nqueues) {
+    FairQueueType fq;
+    // Messages are recycled: each popped message is pushed back onto the same
+    // input queue, keeping every queue backlogged.
+    std::vector<FairQueueBenchmarkMessage*> messages;
+    for(uint32 qi = 0; qi < nqueues; qi++) {
+        fq.addQueue(new BenchInputQueue(1 << 30), qi, (float)(1 + qi % 8));
+        for(uint32 mi = 0; mi < MESSAGES_PER_QUEUE; mi++) {
+            FairQueueBenchmarkMessage* msg = new FairQueueBenchmarkMessage(64 + (qi*7 + mi*13) % 1024);
+            messages.push_back(msg);
+            fq.push(qi, msg);
+        }
+    }
+
+    Time start_time = Timer::now();
+
+    uint32 key;
+    for(uint32 ii = 0; ii < ITERATIONS && !mForceStop; ii++) {
+        FairQueueBenchmarkMessage* msg = fq.pop(&key);
+        fq.push(key, msg);
+    }
+
+    Duration dur = Timer::now() - start_time;
+
+    // Drain so the input queues don't own the messages
+    while(!fq.empty())
+        fq.pop(&key);
+    for(uint32 mi = 0; mi < messages.size(); mi++)
+        delete messages[mi];
+
+    if (mForceStop)
+        return false;
+
+    SILOG(benchmark,info,
+          index_name << ", " << nqueues << " input queues, " << ITERATIONS << " pop/push, " << dur << ": "
+          << (dur.toMicroseconds()*1000/float(ITERATIONS)) << "ns/op, "
+          << float(ITERATIONS)/dur.toSeconds() << " ops/s");
+    return true;
+}
+
+void FairQueueBenchmark::start() {
+    mForceStop = false;
+
+    uint32 queue_counts[] = { 1000, 10000, 100000 };
+    for(uint32 ci = 0; ci < sizeof(queue_counts)/sizeof(queue_counts[0]); ci++) {
+        if (!runQueue<BenchTreeFairQueue>("tree index", queue_counts[ci])) return;
+        if (!runQueue<BenchHeapFairQueue>("heap index", queue_counts[ci])) return;
+    }
+
+    notifyFinished();
+}
+
+void FairQueueBenchmark::stop() {
+    mForceStop = true;
+}
+
+} // namespace Sirikata
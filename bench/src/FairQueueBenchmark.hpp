@@ -0,0 +1,39 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_FAIR_QUEUE_BENCHMARK_HPP_
+#define _SIRIKATA_FAIR_QUEUE_BENCHMARK_HPP_
+
+#include "Benchmark.hpp"
+
+namespace Sirikata {
+
+/** FairQueueBenchmark measures steady state pop/push throughput of FairQueue
+ *  with the tree and heap index policies for 1k to 100k input queues.
+ */
+class FairQueueBenchmark : public Benchmark {
+  public:
+    typedef std::tr1::function<void()> FinishedCallback;
+
+    static Benchmark* create(const FinishedCallback& finished_cb, const String& _param) {
+        return new FairQueueBenchmark(finished_cb);
+    }
+
+    FairQueueBenchmark(const FinishedCallback& finished_cb);
+
+    virtual String name();
+
+    virtual void start();
+    virtual void stop();
+
+  private:
+    template<typename FairQueueType>
+    bool runQueue(const String& index_name, uint32 nqueues);
+
+    bool mForceStop;
+}; // class FairQueueBenchmark
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_FAIR_QUEUE_BENCHMARK_HPP_
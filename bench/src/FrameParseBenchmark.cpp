@@ -0,0 +1,83 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "FrameParseBenchmark.hpp"
+#include <sirikata/core/util/Timer.hpp>
+#include <sirikata/core/network/Frame.hpp>
+
+#define NUM_FRAMES 20000
+#define FRAME_SIZE 48
+// Size of the reads the buffer is delivered in when using the FrameReader,
+// similar to what a stream read callback would see.
+#define READ_SIZE 65536
+
+namespace Sirikata {
+
+FrameParseBenchmark::FrameParseBenchmark(const FinishedCallback& finished_cb)
+        : Benchmark(finished_cb),
+          mForceStop(false)
+{
+}
+
+String FrameParseBenchmark::name() {
+    return "frame-parse";
+}
+
+void FrameParseBenchmark::start() {
+    mForceStop = false;
+
+    String payload(FRAME_SIZE, 'x');
+    String coalesced;
+    for(uint32 ii = 0; ii < NUM_FRAMES; ii++)
+        coalesced += Network::Frame::write(payload);
+
+    // Old API: every extracted frame copies the remainder of the buffer
+    uint64 parse_bytes = 0;
+    Time parse_start = Timer::now();
+    {
+        String data = coalesced;
+        while(!mForceStop) {
+            String parsed = Network::Frame::parse(data);
+            if (parsed.empty()) break;
+            parse_bytes += parsed.size();
+        }
+    }
+    Duration parse_dur = Timer::now() - parse_start;
+
+    if (mForceStop)
+        return;
+
+    // FrameReader: data arrives in chunks, frames are views into the buffer
+    uint64 reader_bytes = 0;
+    Time reader_start = Timer::now();
+    {
+        Network::FrameReader reader;
+        MemoryReference frame = MemoryReference::null();
+        for(uint32 offset = 0; offset < coalesced.size() && !mForceStop; offset += READ_SIZE) {
+            uint32 len = std::min((uint32)READ_SIZE, (uint32)(coalesced.size() - offset));
+            reader.append(coalesced.data() + offset, len);
+            while(reader.next(&frame))
+                reader_bytes += frame.size();
+        }
+    }
+    Duration reader_dur = Timer::now() - reader_start;
+
+    if (mForceStop)
+        return;
+
+    SILOG(benchmark,info,
+          "Frame::parse, " << NUM_FRAMES << " frames of " << FRAME_SIZE << " bytes (" << parse_bytes << " bytes), " << parse_dur << ": "
+          << float(NUM_FRAMES)/parse_dur.toSeconds() << " frames/s");
+    SILOG(benchmark,info,
+          "FrameReader, " << NUM_FRAMES << " frames of " << FRAME_SIZE << " bytes (" << reader_bytes << " bytes), " << reader_dur << ": "
+          << float(NUM_FRAMES)/reader_dur.toSeconds() << " frames/s");
+
+    notifyFinished();
+}
+
+void FrameParseBenchmark::stop() {
+    mForceStop = true;
+}
+
+} // namespace Sirikata
@@ -0,0 +1,37 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_FRAME_PARSE_BENCHMARK_HPP_
+#define _SIRIKATA_FRAME_PARSE_BENCHMARK_HPP_
+
+#include "Benchmark.hpp"
+
+namespace Sirikata {
+
+/** FrameParseBenchmark feeds one large coalesced buffer of small frames to
+ *  Network::Frame::parse and to Network::FrameReader and compares how quickly
+ *  each drains it.
+ */
+class FrameParseBenchmark : public Benchmark {
+  public:
+    typedef std::tr1::function<void()> FinishedCallback;
+
+    static Benchmark* create(const FinishedCallback& finished_cb, const String& _param) {
+        return new FrameParseBenchmark(finished_cb);
+    }
+
+    FrameParseBenchmark(const FinishedCallback& finished_cb);
+
+    virtual String name();
+
+    virtual void start();
+    virtual void stop();
+
+  private:
+    bool mForceStop;
+}; // class FrameParseBenchmark
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_FRAME_PARSE_BENCHMARK_HPP_
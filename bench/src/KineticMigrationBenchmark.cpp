@@ -0,0 +1,191 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "KineticMigrationBenchmark.hpp"
+#include <sirikata/core/util/Timer.hpp>
+#include <sirikata/core/util/Random.hpp>
+
+#include "../../space/src/KineticBoundaryQueue.hpp"
+
+#define NUM_OBJECTS 100000
+// Side length of the server's region, which is split into 2x2x2 boxes
+#define REGION_SIZE 500.f
+#define MAX_SPEED 5.f
+#define SIM_SECONDS 120
+// How often simulated time advances, i.e. the resolution of the timer
+#define STEP_MS 10
+// Location updates per step, each giving an object a new velocity
+#define UPDATES_PER_STEP 100
+
+namespace Sirikata {
+
+namespace {
+
+Vector3f randomPosition() {
+    return Vector3f(randFloat()*REGION_SIZE, randFloat()*REGION_SIZE, randFloat()*REGION_SIZE);
+}
+
+Vector3f randomVelocity() {
+    return Vector3f(randFloat(-MAX_SPEED, MAX_SPEED), randFloat(-MAX_SPEED, MAX_SPEED), randFloat(-MAX_SPEED, MAX_SPEED));
+}
+
+bool inServerRegion(const Vector3f& pos) {
+    return
+        pos.x >= 0 && pos.x <= REGION_SIZE &&
+        pos.y >= 0 && pos.y <= REGION_SIZE &&
+        pos.z >= 0 && pos.z <= REGION_SIZE;
+}
+
+// The exact time the object left the region, found by bisection between a
+// time it was inside and one it was outside. The region is convex and motion
+// is linear, so there's only one crossing.
+Time exitTime(const TimedMotionVector3f& motion, Time inside, Time outside) {
+    for(uint32 i = 0; i < 40 && (outside - inside) > Duration::microseconds((int64)1); i++) {
+        Time mid = inside + (outside - inside) / 2.0;
+        if (inServerRegion(motion.position(mid)))
+            inside = mid;
+        else
+            outside = mid;
+    }
+    return outside;
+}
+
+BoundingBoxList octants(float32 size) {
+    BoundingBoxList result;
+    float32 half = size / 2.f;
+    for(uint32 i = 0; i < 8; i++) {
+        Vector3f min( (i & 1) ? half : 0.f, (i & 2) ? half : 0.f, (i & 4) ? half : 0.f );
+        result.push_back(BoundingBox3f(min, min + Vector3f(half, half, half)));
+    }
+    return result;
+}
+
+} // namespace
+
+KineticMigrationBenchmark::KineticMigrationBenchmark(const FinishedCallback& finished_cb)
+        : Benchmark(finished_cb),
+          mForceStop(false)
+{
+}
+
+String KineticMigrationBenchmark::name() {
+    return "kinetic-migration";
+}
+
+void KineticMigrationBenchmark::start() {
+    mForceStop = false;
+
+    typedef std::tr1::unordered_map<UUID, uint32, UUID::Hasher> IndexMap;
+
+    Duration step = Duration::milliseconds((int64)STEP_MS);
+    Time t = Timer::now();
+    BoundingBoxList regions = octants(REGION_SIZE);
+
+    KineticBoundaryQueue queue(Duration::milliseconds(100.0));
+    queue.setRegions(regions, t);
+
+    // Migrated objects are replaced so the population stays the same
+    std::vector<UUID> ids(NUM_OBJECTS);
+    std::vector<TimedMotionVector3f> motions(NUM_OBJECTS);
+    IndexMap index;
+    for(uint32 i = 0; i < NUM_OBJECTS; i++) {
+        ids[i] = UUID::random();
+        motions[i] = TimedMotionVector3f(t, MotionVector3f(randomPosition(), randomVelocity()));
+        index[ids[i]] = i;
+    }
+
+    Time add_start = Timer::now();
+    for(uint32 i = 0; i < NUM_OBJECTS; i++)
+        queue.add(ids[i], motions[i], t);
+    Duration add_dur = Timer::now() - add_start;
+
+    uint32 nsteps = SIM_SECONDS * 1000 / STEP_MS;
+    uint32 updates = 0, migrations = 0, spurious = 0;
+    Duration total_latency = Duration::zero(), max_latency = Duration::zero();
+    uint32 seg_recomputed = 0;
+    Duration seg_dur;
+    std::vector<UUID> leaving;
+
+    Time run_start = Timer::now();
+    for(uint32 s = 0; s < nsteps && !mForceStop; s++) {
+        t += step;
+
+        leaving.clear();
+        queue.expire(t, &leaving);
+        for(uint32 li = 0; li < leaving.size(); li++) {
+            uint32 idx = index[leaving[li]];
+            if (inServerRegion(motions[idx].position(t))) {
+                spurious++;
+                continue;
+            }
+
+            Duration latency = t - exitTime(motions[idx], motions[idx].updateTime(), t);
+            total_latency += latency;
+            if (latency > max_latency) max_latency = latency;
+            migrations++;
+
+            queue.remove(ids[idx]);
+            index.erase(ids[idx]);
+            ids[idx] = UUID::random();
+            motions[idx] = TimedMotionVector3f(t, MotionVector3f(randomPosition(), randomVelocity()));
+            index[ids[idx]] = idx;
+            queue.add(ids[idx], motions[idx], t);
+        }
+
+        for(uint32 u = 0; u < UPDATES_PER_STEP; u++) {
+            uint32 idx = randInt<uint32>(0, NUM_OBJECTS-1);
+            motions[idx] = TimedMotionVector3f(t, MotionVector3f(motions[idx].position(t), randomVelocity()));
+            queue.update(ids[idx], motions[idx], t);
+            updates++;
+        }
+
+        // Halfway through, split one of the boxes in two. The region as a
+        // whole is the same, so only certificates for the split box (and
+        // any object that was outside) should be recomputed.
+        if (s == nsteps / 2) {
+            BoundingBoxList new_regions(regions.begin() + 1, regions.end());
+            Vector3f min = regions[0].min(), max = regions[0].max();
+            float32 mid_x = (min.x + max.x) / 2.f;
+            new_regions.push_back(BoundingBox3f(min, Vector3f(mid_x, max.y, max.z)));
+            new_regions.push_back(BoundingBox3f(Vector3f(mid_x, min.y, min.z), max));
+
+            Time seg_start = Timer::now();
+            seg_recomputed = queue.setRegions(new_regions, t);
+            seg_dur = Timer::now() - seg_start;
+        }
+    }
+    Duration run_dur = Timer::now() - run_start;
+
+    if (mForceStop)
+        return;
+
+    // Anything outside now should have been reported by the last expire()
+    uint32 missed = 0;
+    for(uint32 i = 0; i < NUM_OBJECTS; i++) {
+        if (!inServerRegion(motions[i].position(t)))
+            missed++;
+    }
+
+    SILOG(benchmark,info,
+          "Added " << NUM_OBJECTS << " objects in " << add_dur << ": "
+          << NUM_OBJECTS/add_dur.toSeconds() << " objects/s");
+    SILOG(benchmark,info,
+          nsteps << " steps of " << step << " with " << updates << " updates and " << migrations << " migrations in " << run_dur << ": "
+          << nsteps/run_dur.toSeconds() << " steps/s, "
+          << queue.certificatesComputed() << " certificates computed");
+    SILOG(benchmark,info,
+          "Trigger accuracy: latency avg " << (migrations ? total_latency / (float64)migrations : Duration::zero())
+          << ", max " << max_latency << " (timer resolution " << step << "), "
+          << spurious << " spurious, " << missed << " missed");
+    SILOG(benchmark,info,
+          "Segmentation change: " << seg_recomputed << " of " << NUM_OBJECTS << " certificates recomputed in " << seg_dur);
+
+    notifyFinished();
+}
+
+void KineticMigrationBenchmark::stop() {
+    mForceStop = true;
+}
+
+} // namespace Sirikata
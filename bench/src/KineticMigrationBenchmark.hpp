@@ -0,0 +1,41 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_KINETIC_MIGRATION_BENCHMARK_HPP_
+#define _SIRIKATA_KINETIC_MIGRATION_BENCHMARK_HPP_
+
+#include "Benchmark.hpp"
+
+namespace Sirikata {
+
+/** KineticMigrationBenchmark drives the KineticBoundaryQueue used by the
+ *  MigrationMonitor's kinetic mode with a large set of moving objects in a
+ *  server region made of several boxes, stepping simulated time forward the
+ *  way the MigrationMonitor's timer would. Along with throughput it checks
+ *  how accurately migrations are triggered against the exact time each
+ *  object left the region, and how many certificates a segmentation change
+ *  invalidates.
+ */
+class KineticMigrationBenchmark : public Benchmark {
+  public:
+    typedef std::tr1::function<void()> FinishedCallback;
+
+    static Benchmark* create(const FinishedCallback& finished_cb, const String& _param) {
+        return new KineticMigrationBenchmark(finished_cb);
+    }
+
+    KineticMigrationBenchmark(const FinishedCallback& finished_cb);
+
+    virtual String name();
+
+    virtual void start();
+    virtual void stop();
+
+  private:
+    bool mForceStop;
+}; // class KineticMigrationBenchmark
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_KINETIC_MIGRATION_BENCHMARK_HPP_
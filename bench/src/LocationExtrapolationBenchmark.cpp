@@ -0,0 +1,151 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "LocationExtrapolationBenchmark.hpp"
+#include <sirikata/core/util/Timer.hpp>
+#include <sirikata/core/util/UUID.hpp>
+#include <sirikata/core/util/MotionVectorStore.hpp>
+#include <sirikata/core/util/Random.hpp>
+#include <sirikata/core/util/PresenceProperties.hpp>
+
+#define NUM_OBJECTS 100000
+#define NUM_ITERATIONS 20
+
+namespace Sirikata {
+
+namespace {
+
+// The per-object record StandardLocationService kept in its map before
+// positions moved to a MotionVectorStore.
+struct LocationInfo {
+    SequencedPresenceProperties props;
+    String mesh_copied_str;
+    String physics_copied_str;
+    bool local;
+    bool aggregate;
+};
+typedef std::tr1::unordered_map<UUID, LocationInfo, UUID::Hasher> LocationMap;
+
+// What StandardLocationService::currentPosition() used to do
+Vector3f mapCurrentPosition(LocationMap& locations, const UUID& uuid, const Time& t) {
+    LocationMap::iterator it = locations.find(uuid);
+    LocationInfo locinfo = it->second;
+    TimedMotionVector3f loc = locinfo.props.location();
+    return loc.extrapolate(t).position();
+}
+
+} // namespace
+
+LocationExtrapolationBenchmark::LocationExtrapolationBenchmark(const FinishedCallback& finished_cb)
+        : Benchmark(finished_cb),
+          mForceStop(false)
+{
+}
+
+String LocationExtrapolationBenchmark::name() {
+    return "loc-extrapolate";
+}
+
+void LocationExtrapolationBenchmark::start() {
+    mForceStop = false;
+
+    typedef std::tr1::unordered_map<UUID, MotionVectorStore::Slot, UUID::Hasher> SlotMap;
+
+    Time base = Timer::now();
+    std::vector<UUID> ids;
+    LocationMap by_id;
+    SlotMap slots_by_id;
+    MotionVectorStore store;
+    for(uint32 i = 0; i < NUM_OBJECTS; i++) {
+        UUID id = UUID::random();
+        TimedMotionVector3f motion(
+            base + Duration::milliseconds((int64)(i % 1000)),
+            MotionVector3f(
+                Vector3f(randFloat()*1000.f, randFloat()*1000.f, randFloat()*1000.f),
+                Vector3f(randFloat()-.5f, randFloat()-.5f, randFloat()-.5f)
+            )
+        );
+        ids.push_back(id);
+        LocationInfo& locinfo = by_id[id];
+        locinfo.props.setLocation(motion, 0);
+        locinfo.props.setMesh(Transfer::URI("meerkat:///example/model.dae/optimized/0/model.dae"), 0);
+        locinfo.local = true;
+        locinfo.aggregate = false;
+        slots_by_id[id] = store.add(motion);
+    }
+    // Objects are visited in a different order than they were added
+    std::random_shuffle(ids.begin(), ids.end());
+
+    std::vector<Vector3f> out(NUM_OBJECTS);
+    std::vector<MotionVectorStore::Slot> slots(NUM_OBJECTS);
+    std::vector<float32> xs(store.capacity()), ys(store.capacity()), zs(store.capacity());
+    // Accumulated so the work can't be optimized away
+    float32 checksum = 0;
+
+    // Per call, map of full records
+    Time map_start = Timer::now();
+    for(uint32 it = 0; it < NUM_ITERATIONS && !mForceStop; it++) {
+        Time t = base + Duration::seconds(it + 1.0);
+        for(uint32 i = 0; i < NUM_OBJECTS; i++)
+            out[i] = mapCurrentPosition(by_id, ids[i], t);
+        checksum += out[it].x;
+    }
+    Duration map_dur = Timer::now() - map_start;
+
+    // Per call, slot lookup and a scalar extrapolation from the store
+    Time per_call_start = Timer::now();
+    for(uint32 it = 0; it < NUM_ITERATIONS && !mForceStop; it++) {
+        Time t = base + Duration::seconds(it + 1.0);
+        for(uint32 i = 0; i < NUM_OBJECTS; i++)
+            out[i] = store.extrapolate(t, slots_by_id[ids[i]]);
+        checksum += out[it].x;
+    }
+    Duration per_call_dur = Timer::now() - per_call_start;
+
+    // Batched by id: lookups to gather slots, then one call to extrapolate
+    Time batch_start = Timer::now();
+    for(uint32 it = 0; it < NUM_ITERATIONS && !mForceStop; it++) {
+        Time t = base + Duration::seconds(it + 1.0);
+        for(uint32 i = 0; i < NUM_OBJECTS; i++)
+            slots[i] = slots_by_id[ids[i]];
+        store.extrapolate(t, &slots[0], NUM_OBJECTS, &out[0]);
+        checksum += out[it].x;
+    }
+    Duration batch_dur = Timer::now() - batch_start;
+
+    // Snapshot: every object, no lookups
+    Time snapshot_start = Timer::now();
+    for(uint32 it = 0; it < NUM_ITERATIONS && !mForceStop; it++) {
+        Time t = base + Duration::seconds(it + 1.0);
+        store.extrapolateAll(t, &xs[0], &ys[0], &zs[0]);
+        checksum += xs[it];
+    }
+    Duration snapshot_dur = Timer::now() - snapshot_start;
+
+    if (mForceStop)
+        return;
+
+    float64 evals = (float64)NUM_OBJECTS * NUM_ITERATIONS;
+    SILOG(benchmark,info,
+          "Per call (map), " << NUM_OBJECTS << " objects x " << NUM_ITERATIONS << ", " << map_dur << ": "
+          << evals/map_dur.toSeconds() << " positions/s");
+    SILOG(benchmark,info,
+          "Per call (store), " << NUM_OBJECTS << " objects x " << NUM_ITERATIONS << ", " << per_call_dur << ": "
+          << evals/per_call_dur.toSeconds() << " positions/s");
+    SILOG(benchmark,info,
+          "Batch by id, " << NUM_OBJECTS << " objects x " << NUM_ITERATIONS << ", " << batch_dur << ": "
+          << evals/batch_dur.toSeconds() << " positions/s");
+    SILOG(benchmark,info,
+          "Snapshot, " << NUM_OBJECTS << " objects x " << NUM_ITERATIONS << ", " << snapshot_dur << ": "
+          << evals/snapshot_dur.toSeconds() << " positions/s");
+    SILOG(benchmark,insane, "Checksum " << checksum);
+
+    notifyFinished();
+}
+
+void LocationExtrapolationBenchmark::stop() {
+    mForceStop = true;
+}
+
+} // namespace Sirikata
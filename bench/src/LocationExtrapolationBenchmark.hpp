@@ -0,0 +1,39 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_LOCATION_EXTRAPOLATION_BENCHMARK_HPP_
+#define _SIRIKATA_LOCATION_EXTRAPOLATION_BENCHMARK_HPP_
+
+#include "Benchmark.hpp"
+
+namespace Sirikata {
+
+/** LocationExtrapolationBenchmark compares the cost of evaluating the current
+ *  position of every object in a large set one call at a time, the way
+ *  LocationService::currentPosition() did with a map of motion vectors,
+ *  against batched evaluation from a MotionVectorStore, both for a list of ids
+ *  and for a snapshot of all objects.
+ */
+class LocationExtrapolationBenchmark : public Benchmark {
+  public:
+    typedef std::tr1::function<void()> FinishedCallback;
+
+    static Benchmark* create(const FinishedCallback& finished_cb, const String& _param) {
+        return new LocationExtrapolationBenchmark(finished_cb);
+    }
+
+    LocationExtrapolationBenchmark(const FinishedCallback& finished_cb);
+
+    virtual String name();
+
+    virtual void start();
+    virtual void stop();
+
+  private:
+    bool mForceStop;
+}; // class LocationExtrapolationBenchmark
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_LOCATION_EXTRAPOLATION_BENCHMARK_HPP_
@@ -0,0 +1,442 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "LossySSTBenchmark.hpp"
+#include <sirikata/core/network/SSTImpl.hpp>
+#include <sirikata/core/network/IOService.hpp>
+#include <sirikata/core/network/IOStrand.hpp>
+#include <sirikata/core/service/Context.hpp>
+#include <sirikata/core/options/Options.hpp>
+#include <sirikata/core/options/CommonOptions.hpp>
+#include <sirikata/core/util/Timer.hpp>
+
+namespace Sirikata {
+
+namespace LossySST {
+
+// Endpoint IDs are just strings, which is all the in-process datagram layer
+// needs.
+class ID {
+public:
+    ID()
+     : mID()
+    {}
+    ID(const String& s)
+     : mID(s)
+    {}
+
+    const String& toString() const { return mID; }
+
+    bool operator<(const ID& rhs) const { return mID < rhs.mID; }
+    bool operator==(const ID& rhs) const { return mID == rhs.mID; }
+    bool operator!=(const ID& rhs) const { return mID != rhs.mID; }
+    class Hasher {
+    public:
+        size_t operator()(const ID& objr) const {
+            return std::tr1::hash<std::string>()(objr.mID);
+        }
+    };
+
+private:
+    String mID;
+};
+
+typedef Sirikata::SST::EndPoint<ID> Endpoint;
+typedef Sirikata::SST::Stream<ID> Stream;
+typedef Sirikata::SST::ConnectionManager<ID> ConnectionManager;
+
+// Delivers datagrams between endpoints in this process after a fixed delay,
+// dropping them at the requested rate. Drops come from a seeded generator so
+// runs with the same settings see the same loss pattern.
+class Service {
+public:
+    // src, src port, dst, dst port, data*, data size
+    typedef std::tr1::function<void(const ID&, const ObjectMessagePort, const ID&, const ObjectMessagePort, void*, uint32)> DatagramCallback;
+
+    Service(Network::IOStrand* strand, const Duration& delay, float32 drop_rate, uint32 seed)
+     : mStrand(strand),
+       mDelay(delay),
+       mDropRate(drop_rate),
+       mRandState(seed),
+       mSent(0),
+       mDropped(0)
+    {}
+
+    void listen(const ID& ep, ObjectMessagePort port, DatagramCallback cb) {
+        mHandlers[ep][port] = cb;
+    }
+    void unlisten(const ID& ep, ObjectMessagePort port) {
+        mHandlers[ep].erase(port);
+    }
+
+    void send(const ID& src, const ObjectMessagePort src_port, const ID& dst, const ObjectMessagePort dst_port, void* payload, uint32 payload_size) {
+        mSent++;
+        if (drop()) {
+            mDropped++;
+            return;
+        }
+
+        mStrand->post(
+            mDelay,
+            std::tr1::bind(&Service::deliver, this,
+                src, src_port,
+                dst, dst_port,
+                String((char*)payload, payload_size)
+            )
+        );
+    }
+
+    ObjectMessagePort unused(const ID& ep) {
+        PortHandlerMap& handlers = mHandlers[ep];
+        ObjectMessagePort idx = 1;
+        while(handlers.find(idx) != handlers.end())
+            idx++;
+        return idx;
+    }
+
+    uint64 sent() const { return mSent; }
+    uint64 dropped() const { return mDropped; }
+
+private:
+    bool drop() {
+        mRandState = mRandState * 1103515245 + 12345;
+        return ((mRandState >> 16) & 0x7FFF) / 32768.f < mDropRate;
+    }
+
+    void deliver(const ID& src, const ObjectMessagePort src_port, const ID& dst, const ObjectMessagePort dst_port, const String& payload) {
+        EndpointMap::iterator ep_it = mHandlers.find(dst);
+        if (ep_it == mHandlers.end()) return;
+        PortHandlerMap::iterator port_it = ep_it->second.find(dst_port);
+        if (port_it == ep_it->second.end()) return;
+        port_it->second(src, src_port, dst, dst_port, (void*)payload.data(), payload.size());
+    }
+
+    Network::IOStrand* mStrand;
+
+    typedef std::map<ObjectMessagePort, DatagramCallback> PortHandlerMap;
+    typedef std::map<ID, PortHandlerMap> EndpointMap;
+    EndpointMap mHandlers;
+
+    Duration mDelay;
+    float32 mDropRate;
+    uint32 mRandState;
+
+    uint64 mSent;
+    uint64 mDropped;
+};
+
+} // namespace LossySST
+
+namespace SST {
+
+template <>
+class BaseDatagramLayer<LossySST::ID>
+{
+  private:
+    typedef LossySST::ID EndPointType;
+
+  public:
+    typedef std::tr1::shared_ptr<BaseDatagramLayer<EndPointType> > Ptr;
+    typedef Ptr BaseDatagramLayerPtr;
+
+    typedef std::tr1::function<void(void*, int)> DataCallback;
+
+    static BaseDatagramLayerPtr getDatagramLayer(ConnectionVariables<EndPointType>* sstConnVars,
+                                                 EndPointType endPoint)
+    {
+        return sstConnVars->getDatagramLayer(endPoint);
+    }
+
+    static BaseDatagramLayerPtr createDatagramLayer(
+        ConnectionVariables<EndPointType>* sstConnVars,
+        EndPointType endPoint,
+        const Context* ctx,
+        LossySST::Service* service)
+    {
+        BaseDatagramLayerPtr datagramLayer = getDatagramLayer(sstConnVars, endPoint);
+        if (datagramLayer) return datagramLayer;
+
+        datagramLayer = BaseDatagramLayerPtr(
+            new BaseDatagramLayer(sstConnVars, ctx, service, endPoint)
+        );
+        sstConnVars->addDatagramLayer(endPoint, datagramLayer);
+
+        return datagramLayer;
+    }
+
+    static void stopListening(ConnectionVariables<EndPointType>* sstConnVars, EndPoint<EndPointType>& listeningEndPoint) {
+        EndPointType endPointID = listeningEndPoint.endPoint;
+
+        BaseDatagramLayerPtr bdl = sstConnVars->getDatagramLayer(endPointID);
+        if (!bdl) return;
+        sstConnVars->removeDatagramLayer(endPointID, true);
+        bdl->unlisten(listeningEndPoint);
+    }
+
+    void listenOn(EndPoint<EndPointType>& listeningEndPoint, DataCallback cb) {
+        mService->listen(
+            listeningEndPoint.endPoint, listeningEndPoint.port,
+            std::tr1::bind(
+                &BaseDatagramLayer::receiveMessageToCallback, this,
+                std::tr1::placeholders::_5,
+                std::tr1::placeholders::_6,
+                cb
+            )
+        );
+    }
+
+    void listenOn(const EndPoint<EndPointType>& listeningEndPoint) {
+        mService->listen(
+            listeningEndPoint.endPoint, listeningEndPoint.port,
+            std::tr1::bind(
+                &BaseDatagramLayer::receiveMessage, this,
+                std::tr1::placeholders::_1,
+                std::tr1::placeholders::_2,
+                std::tr1::placeholders::_3,
+                std::tr1::placeholders::_4,
+                std::tr1::placeholders::_5,
+                std::tr1::placeholders::_6
+            )
+        );
+    }
+
+    void unlisten(EndPoint<EndPointType>& ep) {
+        mService->unlisten(ep.endPoint, ep.port);
+    }
+
+    void send(EndPoint<EndPointType>* src, EndPoint<EndPointType>* dest, void* data, int len) {
+        mService->send(
+            src->endPoint, src->port,
+            dest->endPoint, dest->port,
+            data, len
+        );
+    }
+
+    const Context* context() {
+        return mContext;
+    }
+
+    uint32 getUnusedPort(const EndPointType& ep) {
+        return mService->unused(ep);
+    }
+
+    void invalidate() {
+        mSSTConnVars->removeDatagramLayer(mEndpoint, true);
+    }
+
+  private:
+    BaseDatagramLayer(ConnectionVariables<EndPointType>* sstConnVars, const Context* ctx, LossySST::Service* service, const EndPointType& ep)
+     : mContext(ctx),
+       mService(service),
+       mSSTConnVars(sstConnVars),
+       mEndpoint(ep)
+    {}
+
+    void receiveMessage(const LossySST::ID& src, const ObjectMessagePort src_port, const LossySST::ID& dst, const ObjectMessagePort dst_port, void* payload, uint32 payload_size) {
+        Connection<EndPointType>::handleReceive(
+            mSSTConnVars,
+            EndPoint<EndPointType> (src, src_port),
+            EndPoint<EndPointType> (dst, dst_port),
+            payload, payload_size
+        );
+    }
+
+    void receiveMessageToCallback(void* payload, uint32 payload_size, DataCallback cb) {
+        cb(payload, payload_size);
+    }
+
+    const Context* mContext;
+    LossySST::Service* mService;
+
+    ConnectionVariables<EndPointType>* mSSTConnVars;
+    EndPointType mEndpoint;
+};
+
+} // namespace SST
+
+namespace {
+
+using std::tr1::placeholders::_1;
+using std::tr1::placeholders::_2;
+
+// Drives a single transfer: the sender writes the entire payload as fast as
+// the stream will accept it and the IOService is stopped once the receiver
+// has read all of it.
+class LossyTransfer {
+public:
+    LossyTransfer(Network::IOService* ios, Network::IOStrand* strand, const String& payload)
+     : mIOService(ios),
+       mStrand(strand),
+       mPayload(payload),
+       mReceived(0),
+       mFinishTime(Time::null())
+    {}
+
+    void receiverConnected(int err, LossySST::Stream::Ptr s) {
+        if (err != SST_IMPL_SUCCESS) return;
+        mReceiveStream = s;
+        s->registerReadCallback(
+            std::tr1::bind(&LossyTransfer::read, this, _1, _2)
+        );
+    }
+
+    void senderConnected(int err, LossySST::Stream::Ptr s) {
+        if (err != SST_IMPL_SUCCESS) return;
+        mSendStream = s;
+        write(0);
+    }
+
+    bool finished() const { return mFinishTime != Time::null(); }
+    Time finishTime() const { return mFinishTime; }
+
+    void releaseStreams() {
+        mSendStream.reset();
+        mReceiveStream.reset();
+    }
+
+private:
+    void write(uint32 from) {
+        int written = mSendStream->write((const uint8*)mPayload.data() + from, mPayload.size() - from);
+        if (written > 0)
+            from += written;
+        if (from < mPayload.size())
+            mStrand->post(Duration::milliseconds(1), std::tr1::bind(&LossyTransfer::write, this, from));
+    }
+
+    void read(uint8* data, int size) {
+        mReceived += size;
+        if (mReceived >= mPayload.size() && !finished()) {
+            mFinishTime = Timer::now();
+            mIOService->stop();
+        }
+    }
+
+    Network::IOService* mIOService;
+    Network::IOStrand* mStrand;
+    const String& mPayload;
+    uint32 mReceived;
+    Time mFinishTime;
+
+    LossySST::Stream::Ptr mSendStream;
+    LossySST::Stream::Ptr mReceiveStream;
+};
+
+} // namespace
+
+LossySSTBenchmark::LossySSTBenchmark(const FinishedCallback& finished_cb, const String& param)
+ : Benchmark(finished_cb),
+   mForceStop(false)
+{
+    OptionValue* drop_rate;
+    OptionValue* delay;
+    OptionValue* bytes;
+    OptionValue* seed;
+    OptionValue* timeout;
+    Sirikata::InitializeClassOptions ico("LossySSTBenchmark", this,
+        drop_rate = new OptionValue("drop-rate", "0.02", Sirikata::OptionValueType<float32>(), "Fraction of datagrams dropped"),
+        delay = new OptionValue("delay", "5ms", Sirikata::OptionValueType<Duration>(), "One way delay of each datagram"),
+        bytes = new OptionValue("bytes", "1048576", Sirikata::OptionValueType<uint32>(), "Number of bytes to transfer"),
+        seed = new OptionValue("seed", "1", Sirikata::OptionValueType<uint32>(), "Seed for the drop pattern"),
+        timeout = new OptionValue("timeout", "120s", Sirikata::OptionValueType<Duration>(), "Maximum time to wait for each transfer"),
+        NULL);
+
+    OptionSet* optionsSet = OptionSet::getOptions("LossySSTBenchmark", this);
+    optionsSet->parse(param);
+
+    mDropRate = drop_rate->as<float32>();
+    mDelay = delay->as<Duration>();
+    mBytes = bytes->as<uint32>();
+    mSeed = seed->as<uint32>();
+    mTimeout = timeout->as<Duration>();
+}
+
+String LossySSTBenchmark::name() {
+    return "sst-lossy";
+}
+
+Duration LossySSTBenchmark::runTransfer(bool selective_acks) {
+    String payload;
+    payload.resize(mBytes);
+    for(uint32 i = 0; i < mBytes; i++)
+        payload[i] = ('a' + (i % 26));
+
+    Network::IOService* ios = new Network::IOService("LossySSTBenchmark");
+    Network::IOStrand* strand = ios->createStrand("LossySSTBenchmark Main");
+    Context* ctx = new Context("LossySSTBenchmark", ios, strand, NULL, Timer::now());
+
+    LossySST::Service* service = new LossySST::Service(strand, mDelay, mDropRate, mSeed);
+    LossySST::ConnectionManager* conn_mgr = new LossySST::ConnectionManager();
+    conn_mgr->setSelectiveAcks(selective_acks);
+
+    LossySST::ID receiver("receiver"), sender("sender");
+    conn_mgr->createDatagramLayer(receiver, ctx, service);
+    conn_mgr->createDatagramLayer(sender, ctx, service);
+
+    LossyTransfer transfer(ios, strand, payload);
+    conn_mgr->listen(
+        std::tr1::bind(&LossyTransfer::receiverConnected, &transfer, _1, _2),
+        LossySST::Endpoint(receiver, 1)
+    );
+
+    Time start_time = Timer::now();
+    conn_mgr->connectStream(
+        LossySST::Endpoint(sender, 1),
+        LossySST::Endpoint(receiver, 1),
+        std::tr1::bind(&LossyTransfer::senderConnected, &transfer, _1, _2)
+    );
+    ios->post(mTimeout, std::tr1::bind(&Network::IOService::stop, ios));
+    ios->run();
+
+    Duration result = transfer.finished() ? (transfer.finishTime() - start_time) : Duration::seconds(-1);
+    SILOG(benchmark,info,
+        (selective_acks ? "With" : "Without") << " selective acks: " <<
+        service->sent() << " datagrams sent, " << service->dropped() << " dropped");
+
+    // Same teardown order as the SST unit tests: pending handlers still
+    // reference the connection manager while the IOService is destroyed.
+    transfer.releaseStreams();
+    delete ctx;
+    delete strand;
+    delete ios;
+    delete conn_mgr;
+    delete service;
+
+    return result;
+}
+
+void LossySSTBenchmark::start() {
+    mForceStop = false;
+
+    // Streams read their window size from the global options
+    static bool options_initialized = false;
+    if (!options_initialized) {
+        InitOptions();
+        FakeParseOptions();
+        options_initialized = true;
+    }
+
+    SILOG(benchmark,info,
+        "Transferring " << mBytes << " bytes with " << (mDropRate*100) << "% loss and " << mDelay << " delay");
+
+    Duration without_sack = runTransfer(false);
+    if (mForceStop) return;
+    Duration with_sack = runTransfer(true);
+    if (mForceStop) return;
+
+    if (without_sack < Duration::zero() || with_sack < Duration::zero()) {
+        SILOG(benchmark,error,"Transfer timed out");
+    }
+    else {
+        SILOG(benchmark,info,"Without selective acks: " << without_sack << ", " << (mBytes / without_sack.toSeconds()) << " bytes/s");
+        SILOG(benchmark,info,"With selective acks: " << with_sack << ", " << (mBytes / with_sack.toSeconds()) << " bytes/s");
+    }
+
+    notifyFinished();
+}
+
+void LossySSTBenchmark::stop() {
+    mForceStop = true;
+}
+
+} // namespace Sirikata
@@ -0,0 +1,47 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_LOSSY_SST_BENCHMARK_HPP_
+#define _SIRIKATA_LOSSY_SST_BENCHMARK_HPP_
+
+#include "Benchmark.hpp"
+
+namespace Sirikata {
+
+/** LossySSTBenchmark measures how long SST takes to transfer a block of data
+ *  over an in-process datagram layer with configurable delay and drop rate,
+ *  with selective acks and fast retransmit disabled and then enabled. Since
+ *  no real network is involved, results are reproducible on any machine.
+ */
+class LossySSTBenchmark : public Benchmark {
+  public:
+    typedef std::tr1::function<void()> FinishedCallback;
+
+    static Benchmark* create(const FinishedCallback& finished_cb, const String& param) {
+        return new LossySSTBenchmark(finished_cb, param);
+    }
+
+    LossySSTBenchmark(const FinishedCallback& finished_cb, const String& param);
+
+    virtual String name();
+
+    virtual void start();
+    virtual void stop();
+
+  private:
+    // Returns the transfer time, or a negative duration if it timed out
+    Duration runTransfer(bool selective_acks);
+
+    bool mForceStop;
+
+    float32 mDropRate;
+    Duration mDelay;
+    uint32 mBytes;
+    uint32 mSeed;
+    Duration mTimeout;
+}; // class LossySSTBenchmark
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_LOSSY_SST_BENCHMARK_HPP_
@@ -0,0 +1,176 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "OSegCacheBenchmark.hpp"
+#include <sirikata/core/util/Timer.hpp>
+#include <sirikata/core/util/Random.hpp>
+#include <sirikata/core/service/Context.hpp>
+#include <sirikata/core/network/IOService.hpp>
+#include <sirikata/core/network/IOStrand.hpp>
+#include <sirikata/space/OSegCache.hpp>
+
+#include "../../space/src/caches/CacheLRUOriginal.hpp"
+#include "../../space/src/caches/CacheClock.hpp"
+#include "../../space/src/OSegSnapshot.hpp"
+
+#define NUM_OBJECTS 100000
+#define NUM_OPS 1000000
+// Fraction of operations which are migrations rather than lookups
+#define MIGRATE_FRACTION 0.01f
+#define NUM_SERVERS 16
+// Operations replayed after a simulated restart
+#define NUM_RESTART_OPS 20000
+#define SNAPSHOT_FILENAME "oseg-cache-benchmark.snapshot"
+
+namespace Sirikata {
+
+OSegCacheBenchmark::OSegCacheBenchmark(const FinishedCallback& finished_cb)
+        : Benchmark(finished_cb),
+          mForceStop(false)
+{
+}
+
+String OSegCacheBenchmark::name() {
+    return "oseg-cache";
+}
+
+void OSegCacheBenchmark::generateTrace(uint32 num_objects, uint32 num_ops, Trace* trace_out) {
+    // Zipf (s = 1) popularity, sampled from the cumulative distribution
+    std::vector<float64> cdf(num_objects);
+    float64 total = 0;
+    for(uint32 i = 0; i < num_objects; i++) {
+        total += 1.0 / (i + 1);
+        cdf[i] = total;
+    }
+
+    trace_out->resize(num_ops);
+    for(uint32 i = 0; i < num_ops; i++) {
+        Op& op = (*trace_out)[i];
+        op.type = (randFloat() < MIGRATE_FRACTION) ? Migrate : Lookup;
+        float64 r = randFloat() * total;
+        op.object = std::min(
+            (uint32)(std::lower_bound(cdf.begin(), cdf.end(), r) - cdf.begin()),
+            num_objects - 1
+        );
+    }
+}
+
+void OSegCacheBenchmark::replay(const String& cache_name, uint32 cache_size, OSegCache* cache, Context* ctx, const std::vector<UUID>& ids, const Trace& trace) {
+    uint32 hits = 0, lookups = 0;
+
+    Time start = Timer::now();
+    for(uint32 i = 0; i < trace.size() && !mForceStop; i++) {
+        const Op& op = trace[i];
+        const UUID& id = ids[op.object];
+        // Keep recentSimTime() moving without paying for it on every op
+        if (i % 1024 == 0) ctx->simTime();
+
+        if (op.type == Lookup) {
+            lookups++;
+            if (cache->get(id).notNull())
+                hits++;
+            else
+                cache->insert(id, OSegEntry(1 + op.object % NUM_SERVERS, 1.f));
+        }
+        else {
+            cache->remove(id);
+            cache->insert(id, OSegEntry(1 + (op.object + i) % NUM_SERVERS, 1.f));
+        }
+    }
+    Duration dur = Timer::now() - start;
+
+    if (mForceStop)
+        return;
+
+    SILOG(benchmark,info,
+          cache_name << ", " << cache_size << " entries, " << trace.size() << " ops, " << dur << ": "
+          << trace.size()/dur.toSeconds() << " ops/s, "
+          << (lookups ? (100.f * hits / lookups) : 0.f) << "% hits");
+}
+
+void OSegCacheBenchmark::restart(const String& cache_name, uint32 cache_size, OSegCache* before, OSegCache* preloaded, OSegCache* cold, Context* ctx, const std::vector<UUID>& ids, const Trace& trace) {
+    OSegSnapshot::Contents contents;
+    contents.server = 1;
+    contents.saved = Timer::now();
+    before->getEntries(&contents.cacheEntries);
+    uint64 bytes = OSegSnapshot::save(SNAPSHOT_FILENAME, contents);
+    Duration save_dur = Timer::now() - contents.saved;
+
+    Time load_start = Timer::now();
+    OSegSnapshot::Contents loaded;
+    bool ok = OSegSnapshot::load(SNAPSHOT_FILENAME, &loaded);
+    for(uint32 i = 0; i < loaded.cacheEntries.size(); i++)
+        preloaded->insert(loaded.cacheEntries[i].first, loaded.cacheEntries[i].second);
+    Duration load_dur = Timer::now() - load_start;
+    remove(SNAPSHOT_FILENAME);
+
+    if (bytes == 0 || !ok || loaded.cacheEntries.size() != contents.cacheEntries.size()) {
+        SILOG(benchmark,error, cache_name << " snapshot didn't round trip");
+        return;
+    }
+    SILOG(benchmark,info,
+          cache_name << ", " << cache_size << " entries, snapshot of " << contents.cacheEntries.size()
+          << " entries (" << bytes << " bytes) saved in " << save_dur << ", loaded in " << load_dur);
+
+    replay(cache_name + " after restart, cold", cache_size, cold, ctx, ids, trace);
+    replay(cache_name + " after restart, preloaded", cache_size, preloaded, ctx, ids, trace);
+}
+
+void OSegCacheBenchmark::start() {
+    mForceStop = false;
+
+    Network::IOService* ios = new Network::IOService("OSegCacheBenchmark");
+    Network::IOStrand* strand = ios->createStrand("OSegCacheBenchmark");
+    Context* ctx = new Context("OSegCacheBenchmark", ios, strand, NULL, Timer::now());
+
+    std::vector<UUID> ids;
+    for(uint32 i = 0; i < NUM_OBJECTS; i++)
+        ids.push_back(UUID::random());
+    Trace trace, restart_trace;
+    generateTrace(NUM_OBJECTS, NUM_OPS, &trace);
+    generateTrace(NUM_OBJECTS, NUM_RESTART_OPS, &restart_trace);
+
+    // Long enough that entries don't expire during the run, so only eviction
+    // policy affects hit rates.
+    Duration lifetime = Duration::seconds(3600.f);
+
+    // The default OSeg cache size and a cache big enough to hold the hot set
+    uint32 cache_sizes[] = { 200, 10000 };
+    for(uint32 si = 0; si < sizeof(cache_sizes)/sizeof(cache_sizes[0]) && !mForceStop; si++) {
+        uint32 cache_size = cache_sizes[si];
+
+        OSegCache* lru = new CacheLRUOriginal(ctx, cache_size, 25, lifetime);
+        replay("LRU (original)", cache_size, lru, ctx, ids, trace);
+        OSegCache* lru_preloaded = new CacheLRUOriginal(ctx, cache_size, 25, lifetime);
+        OSegCache* lru_cold = new CacheLRUOriginal(ctx, cache_size, 25, lifetime);
+        restart("LRU (original)", cache_size, lru, lru_preloaded, lru_cold, ctx, ids, restart_trace);
+        delete lru;
+        delete lru_preloaded;
+        delete lru_cold;
+
+        OSegCache* clock = new CacheClock(ctx, cache_size, lifetime);
+        replay("CLOCK", cache_size, clock, ctx, ids, trace);
+        OSegCache* clock_preloaded = new CacheClock(ctx, cache_size, lifetime);
+        OSegCache* clock_cold = new CacheClock(ctx, cache_size, lifetime);
+        restart("CLOCK", cache_size, clock, clock_preloaded, clock_cold, ctx, ids, restart_trace);
+        delete clock;
+        delete clock_preloaded;
+        delete clock_cold;
+    }
+
+    delete ctx;
+    delete strand;
+    delete ios;
+
+    if (mForceStop)
+        return;
+
+    notifyFinished();
+}
+
+void OSegCacheBenchmark::stop() {
+    mForceStop = true;
+}
+
+} // namespace Sirikata
@@ -0,0 +1,63 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_OSEG_CACHE_BENCHMARK_HPP_
+#define _SIRIKATA_OSEG_CACHE_BENCHMARK_HPP_
+
+#include "Benchmark.hpp"
+#include <sirikata/core/util/UUID.hpp>
+
+namespace Sirikata {
+
+class OSegCache;
+class Context;
+
+/** OSegCacheBenchmark replays the same OSeg lookup trace against each
+ *  OSegCache implementation and reports throughput and hit rate. The trace
+ *  follows what OSeg does with its cache: lookups are skewed towards popular
+ *  objects, a miss is followed by an insert of the looked up entry, and some
+ *  objects migrate, removing and then re-inserting their entries.
+ *
+ *  It then simulates a restart of the space server: the cache is saved in an
+ *  OSegSnapshot and loaded into a new cache, and the hit rate over the start
+ *  of a new trace is compared against starting with an empty cache.
+ */
+class OSegCacheBenchmark : public Benchmark {
+  public:
+    typedef std::tr1::function<void()> FinishedCallback;
+
+    static Benchmark* create(const FinishedCallback& finished_cb, const String& _param) {
+        return new OSegCacheBenchmark(finished_cb);
+    }
+
+    OSegCacheBenchmark(const FinishedCallback& finished_cb);
+
+    virtual String name();
+
+    virtual void start();
+    virtual void stop();
+
+  private:
+    enum OpType {
+        Lookup,
+        Migrate
+    };
+    struct Op {
+        OpType type;
+        uint32 object;
+    };
+    typedef std::vector<Op> Trace;
+
+    void generateTrace(uint32 num_objects, uint32 num_ops, Trace* trace_out);
+    void replay(const String& cache_name, uint32 cache_size, OSegCache* cache, Context* ctx, const std::vector<UUID>& ids, const Trace& trace);
+    // Snapshots before into preloaded, then replays trace against the
+    // preloaded cache and an empty one
+    void restart(const String& cache_name, uint32 cache_size, OSegCache* before, OSegCache* preloaded, OSegCache* cold, Context* ctx, const std::vector<UUID>& ids, const Trace& trace);
+
+    bool mForceStop;
+}; // class OSegCacheBenchmark
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_OSEG_CACHE_BENCHMARK_HPP_
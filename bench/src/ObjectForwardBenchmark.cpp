@@ -0,0 +1,112 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "ObjectForwardBenchmark.hpp"
+#include <sirikata/core/util/Timer.hpp>
+#include <sirikata/core/util/Random.hpp>
+#include <sirikata/core/network/ObjectMessage.hpp>
+#include <sirikata/space/ServerMessage.hpp>
+
+#define NUM_MESSAGES 1000
+#define NUM_ITERATIONS 200
+#define PAYLOAD_SIZE 256
+
+namespace Sirikata {
+
+ObjectForwardBenchmark::ObjectForwardBenchmark(const FinishedCallback& finished_cb)
+        : Benchmark(finished_cb),
+          mForceStop(false)
+{
+}
+
+String ObjectForwardBenchmark::name() {
+    return "object-forward";
+}
+
+void ObjectForwardBenchmark::report(const String& method, uint32 count, const Duration& dur) {
+    SILOG(benchmark,info,
+          method << ", " << count << " messages, " << dur << ": "
+          << count/dur.toSeconds() << " messages/s");
+}
+
+void ObjectForwardBenchmark::runFullParse(const MessageList& msgs) {
+    uint32 count = 0;
+    Time start = Timer::now();
+    for(uint32 it = 0; it < NUM_ITERATIONS && !mForceStop; it++) {
+        for(uint32 i = 0; i < msgs.size(); i++) {
+            Sirikata::Protocol::Object::ObjectMessage* obj_msg = new Sirikata::Protocol::Object::ObjectMessage();
+            bool parsed = parsePBJMessage(obj_msg, msgs[i]);
+            assert(parsed);
+            Message* fwd = new Message(1, SERVER_PORT_OBJECT_MESSAGE_ROUTING, 2, SERVER_PORT_OBJECT_MESSAGE_ROUTING, obj_msg);
+            delete fwd;
+            delete obj_msg;
+            count++;
+        }
+    }
+    Duration dur = Timer::now() - start;
+
+    if (mForceStop)
+        return;
+    report("Full parse", count, dur);
+}
+
+void ObjectForwardBenchmark::runEnvelope(const MessageList& msgs) {
+    uint32 count = 0;
+    Time start = Timer::now();
+    for(uint32 it = 0; it < NUM_ITERATIONS && !mForceStop; it++) {
+        for(uint32 i = 0; i < msgs.size(); i++) {
+            ObjectMessageEnvelope envelope;
+            bool parsed = envelope.parse(msgs[i]);
+            assert(parsed);
+            Message* fwd = new Message(1, SERVER_PORT_OBJECT_MESSAGE_ROUTING, 2, SERVER_PORT_OBJECT_MESSAGE_ROUTING, envelope);
+            delete fwd;
+            count++;
+        }
+    }
+    Duration dur = Timer::now() - start;
+
+    if (mForceStop)
+        return;
+    report("Envelope", count, dur);
+}
+
+void ObjectForwardBenchmark::start() {
+    mForceStop = false;
+
+    MessageList msgs;
+    for(uint32 i = 0; i < NUM_MESSAGES; i++) {
+        String payload(PAYLOAD_SIZE, ' ');
+        for(uint32 p = 0; p < PAYLOAD_SIZE; p++)
+            payload[p] = (char)randInt<int>(0, 255);
+        Sirikata::Protocol::Object::ObjectMessage* obj_msg = createObjectMessage(
+            1, UUID::random(), randInt<uint32>(1, 1000),
+            UUID::random(), randInt<uint32>(1, 1000),
+            payload
+        );
+        msgs.push_back(serializePBJMessage(*obj_msg));
+        delete obj_msg;
+    }
+
+    ObjectMessageEnvelope check;
+    if (!check.parse(msgs[0])) {
+        SILOG(benchmark,error,"Couldn't parse ObjectMessage envelope, skipping object-forward benchmark");
+        notifyFinished();
+        return;
+    }
+
+    runFullParse(msgs);
+    if (!mForceStop)
+        runEnvelope(msgs);
+
+    if (mForceStop)
+        return;
+
+    notifyFinished();
+}
+
+void ObjectForwardBenchmark::stop() {
+    mForceStop = true;
+}
+
+} // namespace Sirikata
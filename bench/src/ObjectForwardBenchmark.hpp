@@ -0,0 +1,46 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_OBJECT_FORWARD_BENCHMARK_HPP_
+#define _SIRIKATA_OBJECT_FORWARD_BENCHMARK_HPP_
+
+#include "Benchmark.hpp"
+
+namespace Sirikata {
+
+/** ObjectForwardBenchmark measures the cost of taking a serialized
+ *  ObjectMessage received from another server and wrapping it in a new server
+ *  Message for the next hop, which is all a server does with messages it is
+ *  only forwarding. It compares fully parsing the ObjectMessage (and
+ *  re-serializing it into the new Message) against reading only its envelope
+ *  and reusing the original bytes.
+ */
+class ObjectForwardBenchmark : public Benchmark {
+  public:
+    typedef std::tr1::function<void()> FinishedCallback;
+
+    static Benchmark* create(const FinishedCallback& finished_cb, const String& _param) {
+        return new ObjectForwardBenchmark(finished_cb);
+    }
+
+    ObjectForwardBenchmark(const FinishedCallback& finished_cb);
+
+    virtual String name();
+
+    virtual void start();
+    virtual void stop();
+
+  private:
+    typedef std::vector<String> MessageList;
+
+    void runFullParse(const MessageList& msgs);
+    void runEnvelope(const MessageList& msgs);
+    void report(const String& method, uint32 count, const Duration& dur);
+
+    bool mForceStop;
+}; // class ObjectForwardBenchmark
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_OBJECT_FORWARD_BENCHMARK_HPP_
@@ -0,0 +1,142 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "QueueBenchmark.hpp"
+#include <sirikata/core/util/Timer.hpp>
+#include <sirikata/core/util/Thread.hpp>
+#include <sirikata/core/queue/LockFreeQueue.hpp>
+#include <sirikata/core/queue/LockFreeRingQueue.hpp>
+#include <sirikata/core/queue/ThreadSafeQueue.hpp>
+#include <sirikata/core/queue/SizedThreadSafeQueue.hpp>
+
+#define ITERATIONS (1 << 20)
+#define MAX_PRODUCERS 16
+#define RING_CAPACITY 4096
+
+namespace Sirikata {
+
+namespace {
+
+// All queues carry pointers to a single shared item. SizedThreadSafeQueue needs
+// a size() to account for.
+struct QueueBenchmarkItem {
+    uint32 size() const { return 1; }
+};
+QueueBenchmarkItem gItem;
+
+typedef LockFreeQueue<QueueBenchmarkItem*> BenchLockFreeQueue;
+typedef ThreadSafeQueue<QueueBenchmarkItem*> BenchThreadSafeQueue;
+typedef SizedThreadSafeQueue<QueueBenchmarkItem*> BenchSizedThreadSafeQueue;
+typedef LockFreeRingQueue<QueueBenchmarkItem*> BenchRingQueue;
+
+// Adapt the different push signatures. Returns false if the push should be
+// retried.
+bool benchPush(BenchLockFreeQueue& q, QueueBenchmarkItem* v) {
+    q.push(v);
+    return true;
+}
+bool benchPush(BenchThreadSafeQueue& q, QueueBenchmarkItem* v) {
+    q.push(v);
+    return true;
+}
+bool benchPush(BenchSizedThreadSafeQueue& q, QueueBenchmarkItem* v) {
+    return q.push(v, false);
+}
+bool benchPush(BenchRingQueue& q, QueueBenchmarkItem* v) {
+    return q.push(v);
+}
+
+} // namespace
+
+QueueBenchmark::QueueBenchmark(const FinishedCallback& finished_cb)
+        : Benchmark(finished_cb),
+          mForceStop(false)
+{
+}
+
+String QueueBenchmark::name() {
+    return "queue";
+}
+
+template<typename QueueType>
+void QueueBenchmark::producerMain(QueueType* queue, uint32 count) {
+    for(uint32 ii = 0; ii < count && !mForceStop; ii++) {
+        while(!benchPush(*queue, &gItem) && !mForceStop)
+            Thread::yield();
+    }
+}
+
+template<typename QueueType>
+bool QueueBenchmark::runQueue(const String& queue_name, QueueType& queue, uint32 nproducers) {
+    uint32 per_producer = ITERATIONS / nproducers;
+    uint32 total = per_producer * nproducers;
+
+    Time start_time = Timer::now();
+
+    std::vector<Thread*> producers;
+    for(uint32 pi = 0; pi < nproducers; pi++) {
+        producers.push_back(
+            new Thread(
+                "QueueBenchmark Producer",
+                std::tr1::bind(&QueueBenchmark::producerMain<QueueType>, this, &queue, per_producer)
+            )
+        );
+    }
+
+    uint32 received = 0;
+    QueueBenchmarkItem* item = NULL;
+    while(received < total && !mForceStop) {
+        if (queue.pop(item))
+            received++;
+        else
+            Thread::yield();
+    }
+
+    for(uint32 pi = 0; pi < nproducers; pi++) {
+        producers[pi]->join();
+        delete producers[pi];
+    }
+
+    if (mForceStop)
+        return false;
+
+    Duration dur = Timer::now() - start_time;
+    SILOG(benchmark,info,
+          queue_name << ", " << nproducers << " producers, " << total << " items, " << dur << ": "
+          << (dur.toMicroseconds()*1000/float(total)) << "ns/item, "
+          << float(total)/dur.toSeconds() << " items/s");
+    return true;
+}
+
+void QueueBenchmark::start() {
+    mForceStop = false;
+
+    for(uint32 nproducers = 1; nproducers <= MAX_PRODUCERS; nproducers *= 2) {
+        {
+            BenchLockFreeQueue queue;
+            if (!runQueue("LockFreeQueue", queue, nproducers)) return;
+        }
+        {
+            BenchThreadSafeQueue queue;
+            if (!runQueue("ThreadSafeQueue", queue, nproducers)) return;
+        }
+        {
+            // Limit of 0 means unlimited, i.e. measure only the accounting cost
+            BenchSizedThreadSafeQueue queue(SizedResourceMonitor(0));
+            if (!runQueue("SizedThreadSafeQueue", queue, nproducers)) return;
+        }
+        {
+            BenchRingQueue queue(RING_CAPACITY);
+            if (!runQueue("LockFreeRingQueue", queue, nproducers)) return;
+        }
+    }
+
+    notifyFinished();
+}
+
+void QueueBenchmark::stop() {
+    mForceStop = true;
+}
+
+} // namespace Sirikata
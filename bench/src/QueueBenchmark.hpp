@@ -0,0 +1,42 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_QUEUE_BENCHMARK_HPP_
+#define _SIRIKATA_QUEUE_BENCHMARK_HPP_
+
+#include "Benchmark.hpp"
+
+namespace Sirikata {
+
+/** QueueBenchmark compares the throughput of the thread-safe queue
+ *  implementations (LockFreeQueue, ThreadSafeQueue, SizedThreadSafeQueue and
+ *  LockFreeRingQueue) with a single consumer and 1 to 16 producer threads.
+ */
+class QueueBenchmark : public Benchmark {
+  public:
+    typedef std::tr1::function<void()> FinishedCallback;
+
+    static Benchmark* create(const FinishedCallback& finished_cb, const String& _param) {
+        return new QueueBenchmark(finished_cb);
+    }
+
+    QueueBenchmark(const FinishedCallback& finished_cb);
+
+    virtual String name();
+
+    virtual void start();
+    virtual void stop();
+
+  private:
+    template<typename QueueType>
+    bool runQueue(const String& queue_name, QueueType& queue, uint32 nproducers);
+    template<typename QueueType>
+    void producerMain(QueueType* queue, uint32 count);
+
+    volatile bool mForceStop;
+}; // class QueueBenchmark
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_QUEUE_BENCHMARK_HPP_
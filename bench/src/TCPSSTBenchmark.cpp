@@ -186,6 +186,8 @@ void SSTBenchmark::computePingTime(Sirikata::Network::Chunk&chk, const Sirikata:
         SILOG(benchmark,info,"Test Time: "<<cur-mStartTime);
         SILOG(benchmark,info,"Ping Average "<<avg);
         SILOG(benchmark,info,"Transfer Rate "<<2*mNumPings*(double)chk.size()/(cur-mStartTime).toSeconds());
+        SILOG(benchmark,info,"Bytes per Send Call "<<mStream->averageSendBytesPerCall());
+        SILOG(benchmark,info,"Bytes per Receive Completion "<<mStream->averageReceiveBytesPerCompletion());
         stop();
     }else
     if (mPingRate.toSeconds()==0) {
@@ -0,0 +1,184 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "TCPSSTReadBatchBenchmark.hpp"
+#include <sirikata/core/network/IOService.hpp>
+#include <sirikata/core/network/IOStrand.hpp>
+#include <sirikata/core/network/StreamFactory.hpp>
+#include <sirikata/core/network/StreamListenerFactory.hpp>
+#include <sirikata/core/options/Options.hpp>
+#include <sirikata/core/util/PluginManager.hpp>
+#include <sirikata/core/util/Timer.hpp>
+#include <boost/lexical_cast.hpp>
+
+namespace Sirikata {
+
+using std::tr1::placeholders::_1;
+using std::tr1::placeholders::_2;
+
+TCPSSTReadBatchBenchmark::TCPSSTReadBatchBenchmark(const FinishedCallback& finished_cb, const String& param)
+ : Benchmark(finished_cb),
+   mForceStop(false),
+   mIOService(NULL),
+   mSender(NULL),
+   mReceiver(NULL),
+   mMessagesSent(0),
+   mBytesReceived(0),
+   mFinished(false),
+   mFinishTime(Time::null()),
+   mBytesPerCompletion(0.f)
+{
+    OptionValue* message_size;
+    OptionValue* num_messages;
+    OptionValue* read_batch_size;
+    OptionValue* port;
+    OptionValue* timeout;
+    Sirikata::InitializeClassOptions ico("TCPSSTReadBatchBenchmark", this,
+        message_size = new OptionValue("message-size", "64", Sirikata::OptionValueType<uint32>(), "Size of each message"),
+        num_messages = new OptionValue("num-messages", "100000", Sirikata::OptionValueType<uint32>(), "Number of messages to send"),
+        read_batch_size = new OptionValue("read-batch-size", "16", Sirikata::OptionValueType<int32>(), "tcpsst read-batch-size to compare against one receive per read"),
+        port = new OptionValue("port", "4092", Sirikata::OptionValueType<String>(), "Local port to listen on"),
+        timeout = new OptionValue("timeout", "60s", Sirikata::OptionValueType<Duration>(), "Maximum time to wait for each transfer"),
+        NULL);
+
+    OptionSet* optionsSet = OptionSet::getOptions("TCPSSTReadBatchBenchmark", this);
+    optionsSet->parse(param);
+
+    mMessageSize = std::max(message_size->as<uint32>(), (uint32)1);
+    mNumMessages = num_messages->as<uint32>();
+    mReadBatchSize = read_batch_size->as<int32>();
+    mPort = port->as<String>();
+    mTimeout = timeout->as<Duration>();
+}
+
+String TCPSSTReadBatchBenchmark::name() {
+    return "tcpsst-read-batch";
+}
+
+void TCPSSTReadBatchBenchmark::newStream(Network::Stream* strm, Network::Stream::SetCallbacks& cb) {
+    if (strm == NULL) return;
+    mReceiver = strm;
+    cb(std::tr1::bind(&TCPSSTReadBatchBenchmark::receiverConnected, this, _1, _2),
+        std::tr1::bind(&TCPSSTReadBatchBenchmark::received, this, _1, _2),
+        &Network::Stream::ignoreReadySendCallback);
+}
+
+void TCPSSTReadBatchBenchmark::receiverConnected(Network::Stream::ConnectionStatus status, const std::string& reason) {
+    if (status != Network::Stream::Connected && !mFinished)
+        SILOG(benchmark,error,"Receiving stream disconnected: " << reason);
+}
+
+void TCPSSTReadBatchBenchmark::received(Network::Chunk& chunk, const Network::Stream::PauseReceiveCallback& pause) {
+    mBytesReceived += chunk.size();
+    if (!mFinished && mBytesReceived >= (uint64)mMessageSize * mNumMessages) {
+        mFinished = true;
+        mFinishTime = Timer::now();
+        mBytesPerCompletion = mReceiver->averageReceiveBytesPerCompletion();
+        mIOService->stop();
+    }
+}
+
+void TCPSSTReadBatchBenchmark::senderConnected(Network::Stream::ConnectionStatus status, const std::string& reason) {
+    if (status == Network::Stream::Connected)
+        sendMore();
+    else if (!mFinished)
+        SILOG(benchmark,error,"Sending stream failed to connect: " << reason);
+}
+
+void TCPSSTReadBatchBenchmark::sendMore() {
+    while(mMessagesSent < mNumMessages && !mForceStop) {
+        if (!mSender->send(mMessage, Network::ReliableOrdered)) {
+            mSender->requestReadySendCallback();
+            return;
+        }
+        mMessagesSent++;
+    }
+}
+
+Duration TCPSSTReadBatchBenchmark::runTransfer(int32 read_batch_size, float* bytes_per_completion_out) {
+    mMessage.assign(mMessageSize, 'a');
+    mMessagesSent = 0;
+    mBytesReceived = 0;
+    mFinished = false;
+    mBytesPerCompletion = 0.f;
+    mReceiver = NULL;
+
+    mIOService = new Network::IOService("TCPSSTReadBatchBenchmark");
+    Network::IOStrand* strand = mIOService->createStrand("TCPSSTReadBatchBenchmark Main");
+
+    // read-batch-size is process wide and picked up by sockets as they're
+    // created, so setting it here covers both ends of this transfer
+    String options = "--read-batch-size=" + boost::lexical_cast<String>(read_batch_size);
+    Network::StreamListener* listener =
+        Network::StreamListenerFactory::getSingleton().getConstructor("tcpsst")(strand, Network::StreamFactory::getSingleton().getOptionParser("tcpsst")(options));
+    listener->listen(Network::Address("127.0.0.1", mPort),
+        std::tr1::bind(&TCPSSTReadBatchBenchmark::newStream, this, _1, _2));
+    listener->start();
+
+    mSender = Network::StreamFactory::getSingleton().getConstructor("tcpsst")(strand, Network::StreamFactory::getSingleton().getOptionParser("tcpsst")(options));
+    Time start_time = Timer::now();
+    mSender->connect(Network::Address("127.0.0.1", mPort),
+        &Network::Stream::ignoreSubstreamCallback,
+        std::tr1::bind(&TCPSSTReadBatchBenchmark::senderConnected, this, _1, _2),
+        &Network::Stream::ignoreReceivedCallback,
+        std::tr1::bind(&TCPSSTReadBatchBenchmark::sendMore, this));
+
+    mIOService->post(mTimeout, std::tr1::bind(&Network::IOService::stop, mIOService));
+    mIOService->run();
+
+    Duration result = mFinished ? (mFinishTime - start_time) : Duration::seconds(-1);
+    *bytes_per_completion_out = mBytesPerCompletion;
+
+    // Same teardown as the tcpsst unit tests: streams and listener first,
+    // then the strand and service their handlers were bound to
+    mSender->close();
+    delete mSender;
+    mSender = NULL;
+    if (mReceiver != NULL) {
+        mReceiver->close();
+        delete mReceiver;
+        mReceiver = NULL;
+    }
+    listener->stop();
+    delete listener;
+    delete strand;
+    delete mIOService;
+    mIOService = NULL;
+
+    return result;
+}
+
+void TCPSSTReadBatchBenchmark::start() {
+    static Sirikata::PluginManager pluginManager;
+    pluginManager.load("tcpsst");
+    mForceStop = false;
+
+    SILOG(benchmark,info,
+        "Sending " << mNumMessages << " messages of " << mMessageSize << " bytes, read-batch-size 0 vs " << mReadBatchSize);
+
+    float unbatched_bytes = 0.f, batched_bytes = 0.f;
+    Duration unbatched = runTransfer(0, &unbatched_bytes);
+    if (mForceStop) return;
+    Duration batched = runTransfer(mReadBatchSize, &batched_bytes);
+    if (mForceStop) return;
+
+    if (unbatched < Duration::zero() || batched < Duration::zero()) {
+        SILOG(benchmark,error,"Transfer timed out");
+    }
+    else {
+        uint64 total_bytes = (uint64)mMessageSize * mNumMessages;
+        SILOG(benchmark,info,"read-batch-size 0: " << unbatched << ", " << (total_bytes / unbatched.toSeconds()) << " bytes/s, " << unbatched_bytes << " bytes per receive completion");
+        SILOG(benchmark,info,"read-batch-size " << mReadBatchSize << ": " << batched << ", " << (total_bytes / batched.toSeconds()) << " bytes/s, " << batched_bytes << " bytes per receive completion");
+    }
+
+    notifyFinished();
+}
+
+void TCPSSTReadBatchBenchmark::stop() {
+    mForceStop = true;
+    if (mIOService != NULL)
+        mIOService->stop();
+}
+
+} // namespace Sirikata
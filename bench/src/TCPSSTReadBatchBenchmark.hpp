@@ -0,0 +1,66 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_TCPSST_READ_BATCH_BENCHMARK_HPP_
+#define _SIRIKATA_TCPSST_READ_BATCH_BENCHMARK_HPP_
+
+#include "Benchmark.hpp"
+#include <sirikata/core/network/Stream.hpp>
+#include <sirikata/core/network/StreamListener.hpp>
+
+namespace Sirikata {
+
+/** TCPSSTReadBatchBenchmark streams many small messages over a tcpsst
+ *  connection to localhost, once with a receive per read and once with the
+ *  given read-batch-size, and reports the transfer time and how many bytes
+ *  each receive completion handled on the receiving side.
+ */
+class TCPSSTReadBatchBenchmark : public Benchmark {
+  public:
+    typedef std::tr1::function<void()> FinishedCallback;
+
+    static Benchmark* create(const FinishedCallback& finished_cb, const String& param) {
+        return new TCPSSTReadBatchBenchmark(finished_cb, param);
+    }
+
+    TCPSSTReadBatchBenchmark(const FinishedCallback& finished_cb, const String& param);
+
+    virtual String name();
+
+    virtual void start();
+    virtual void stop();
+
+  private:
+    // Returns the transfer time, or a negative duration if it timed out
+    Duration runTransfer(int32 read_batch_size, float* bytes_per_completion_out);
+
+    void newStream(Network::Stream* strm, Network::Stream::SetCallbacks& cb);
+    void receiverConnected(Network::Stream::ConnectionStatus status, const std::string& reason);
+    void received(Network::Chunk& chunk, const Network::Stream::PauseReceiveCallback& pause);
+    void senderConnected(Network::Stream::ConnectionStatus status, const std::string& reason);
+    void sendMore();
+
+    bool mForceStop;
+
+    uint32 mMessageSize;
+    uint32 mNumMessages;
+    int32 mReadBatchSize;
+    String mPort;
+    Duration mTimeout;
+
+    // State for the current transfer
+    Network::IOService* mIOService;
+    Network::Stream* mSender;
+    Network::Stream* mReceiver;
+    Network::Chunk mMessage;
+    uint32 mMessagesSent;
+    uint64 mBytesReceived;
+    bool mFinished;
+    Time mFinishTime;
+    float mBytesPerCompletion;
+}; // class TCPSSTReadBatchBenchmark
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_TCPSST_READ_BATCH_BENCHMARK_HPP_
@@ -0,0 +1,122 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "TraceWriteBenchmark.hpp"
+#include <sirikata/core/util/Timer.hpp>
+#include <sirikata/core/util/Thread.hpp>
+#include <sirikata/core/trace/Trace.hpp>
+#include <sirikata/core/trace/BatchedBuffer.hpp>
+#include <boost/lexical_cast.hpp>
+
+#define DEFAULT_NUM_THREADS 4
+#define NUM_RECORDS_PER_THREAD 1000000
+#define TRACE_FILENAME "trace-write-benchmark.trace"
+
+namespace Sirikata {
+
+TraceWriteBenchmark::TraceWriteBenchmark(const FinishedCallback& finished_cb, const String& param)
+        : Benchmark(finished_cb),
+          mNumThreads(DEFAULT_NUM_THREADS),
+          mForceStop(false)
+{
+    if (!param.empty())
+        mNumThreads = std::max(boost::lexical_cast<uint32>(param), (uint32)1);
+}
+
+String TraceWriteBenchmark::name() {
+    return "trace-write";
+}
+
+void TraceWriteBenchmark::writeRecords(Method method, Trace::Trace* trace, BatchedBuffer* buffer) {
+    Time t = Timer::now();
+    for(uint64 uid = 0; uid < NUM_RECORDS_PER_THREAD && !mForceStop; uid++) {
+        Trace::MessagePath path = Trace::FORWARDING_STARTED;
+        switch(method) {
+          case Off:
+            // trace-message is off, so this only does the check
+            TRACE(trace, timestampMessage, t, uid, path);
+            break;
+          case Locked:
+            {
+                // The framing and write Trace::writeRecord used to do
+                uint32 total_size = sizeof(t) + sizeof(uid) + sizeof(path);
+                uint16 type_hint = MessageTimestampTag;
+                BatchedBuffer::IOVec data_vec[5] = {
+                    BatchedBuffer::IOVec(&total_size, sizeof(total_size)),
+                    BatchedBuffer::IOVec(&type_hint, sizeof(type_hint)),
+                    BatchedBuffer::IOVec(&t, sizeof(t)),
+                    BatchedBuffer::IOVec(&uid, sizeof(uid)),
+                    BatchedBuffer::IOVec(&path, sizeof(path)),
+                };
+                buffer->write(data_vec, 5);
+            }
+            break;
+          case Rings:
+            trace->timestampMessage(t, uid, path);
+            break;
+        }
+    }
+}
+
+void TraceWriteBenchmark::run(const String& method_name, Method method) {
+    Trace::Trace* trace = new Trace::Trace(TRACE_FILENAME);
+    BatchedBuffer* buffer = new BatchedBuffer();
+
+    Time start = Timer::now();
+    std::vector<Thread*> threads;
+    for(uint32 i = 0; i < mNumThreads; i++) {
+        threads.push_back(
+            new Thread("TraceWriteBenchmark", std::tr1::bind(&TraceWriteBenchmark::writeRecords, this, method, trace, buffer))
+        );
+    }
+    for(uint32 i = 0; i < threads.size(); i++) {
+        threads[i]->join();
+        delete threads[i];
+    }
+    Duration dur = Timer::now() - start;
+
+    trace->prepareShutdown();
+    trace->shutdown();
+    delete trace;
+    delete buffer;
+    remove(TRACE_FILENAME);
+
+    if (mForceStop)
+        return;
+
+    uint64 total = (uint64)mNumThreads * NUM_RECORDS_PER_THREAD;
+    SILOG(benchmark,info,
+          method_name << ", " << mNumThreads << " threads, " << total << " records, " << dur << ": "
+          << total/dur.toSeconds() << " records/s, "
+          << (dur.toMicro() * 1000.0 / NUM_RECORDS_PER_THREAD) << " ns/record/thread");
+}
+
+void TraceWriteBenchmark::start() {
+    mForceStop = false;
+
+    // The trace options have to be registered for Trace to read them, and
+    // only once per process
+    static bool options_initialized = false;
+    if (!options_initialized) {
+        Trace::Trace::InitOptions();
+        options_initialized = true;
+    }
+
+    run("Off", Off);
+    if (!mForceStop)
+        run("Locked BatchedBuffer", Locked);
+    if (!mForceStop)
+        run("Per-thread TraceRing", Rings);
+
+    if (mForceStop)
+        return;
+
+    notifyFinished();
+}
+
+void TraceWriteBenchmark::stop() {
+    mForceStop = true;
+}
+
+} // namespace Sirikata
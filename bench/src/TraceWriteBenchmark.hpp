@@ -0,0 +1,55 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_TRACE_WRITE_BENCHMARK_HPP_
+#define _SIRIKATA_TRACE_WRITE_BENCHMARK_HPP_
+
+#include "Benchmark.hpp"
+
+namespace Sirikata {
+
+namespace Trace {
+class Trace;
+}
+class BatchedBuffer;
+
+/** TraceWriteBenchmark measures the cost of recording message timestamp
+ *  records, the most common trace records, from several threads at once. It
+ *  compares tracing turned off (only the check for whether to record), the
+ *  single locked BatchedBuffer trace records used to go through, and the
+ *  per-thread TraceRings Trace now uses. The optional parameter is the number
+ *  of writer threads.
+ */
+class TraceWriteBenchmark : public Benchmark {
+  public:
+    typedef std::tr1::function<void()> FinishedCallback;
+
+    static Benchmark* create(const FinishedCallback& finished_cb, const String& _param) {
+        return new TraceWriteBenchmark(finished_cb, _param);
+    }
+
+    TraceWriteBenchmark(const FinishedCallback& finished_cb, const String& param);
+
+    virtual String name();
+
+    virtual void start();
+    virtual void stop();
+
+  private:
+    enum Method {
+        Off,
+        Locked,
+        Rings
+    };
+
+    void run(const String& method_name, Method method);
+    void writeRecords(Method method, Trace::Trace* trace, BatchedBuffer* buffer);
+
+    uint32 mNumThreads;
+    bool mForceStop;
+}; // class TraceWriteBenchmark
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_TRACE_WRITE_BENCHMARK_HPP_
@@ -36,7 +36,18 @@
 #include "TimerJitterBenchmark.hpp"
 #include "TimerMonotonicityBenchmark.hpp"
 #include "TCPSSTBenchmark.hpp"
+#include "TCPSSTReadBatchBenchmark.hpp"
 #include "UUIDSpeedBenchmark.hpp"
+#include "QueueBenchmark.hpp"
+#include "FairQueueBenchmark.hpp"
+#include "FrameParseBenchmark.hpp"
+#include "LossySSTBenchmark.hpp"
+#include "LocationExtrapolationBenchmark.hpp"
+#include "OSegCacheBenchmark.hpp"
+#include "KineticMigrationBenchmark.hpp"
+#include "CSegLoadBalanceBenchmark.hpp"
+#include "ObjectForwardBenchmark.hpp"
+#include "TraceWriteBenchmark.hpp"
 
 #include <sirikata/core/util/DynamicLibrary.hpp>
 
@@ -68,9 +79,21 @@ int main(int argc, char** argv) {
     ADD_BENCHMARK(timer-monotonicity, TimerMonotonicityBenchmark::create);
 
     ADD_BENCHMARK(ping, SSTBenchmark::create);
+    ADD_BENCHMARK(sst-lossy, LossySSTBenchmark::create);
+    ADD_BENCHMARK(tcpsst-read-batch, TCPSSTReadBatchBenchmark::create);
 
     ADD_BENCHMARK(uuid-create, UUIDSpeedBenchmark::create);
 
+    ADD_BENCHMARK(queue, QueueBenchmark::create);
+    ADD_BENCHMARK(fair-queue, FairQueueBenchmark::create);
+    ADD_BENCHMARK(frame-parse, FrameParseBenchmark::create);
+    ADD_BENCHMARK(loc-extrapolate, LocationExtrapolationBenchmark::create);
+    ADD_BENCHMARK(oseg-cache, OSegCacheBenchmark::create);
+    ADD_BENCHMARK(kinetic-migration, KineticMigrationBenchmark::create);
+    ADD_BENCHMARK(cseg-load-balance, CSegLoadBalanceBenchmark::create);
+    ADD_BENCHMARK(object-forward, ObjectForwardBenchmark::create);
+    ADD_BENCHMARK(trace-write, TraceWriteBenchmark::create);
+
     BenchmarkRunner runner(factory, Duration::seconds(30.f));
 
 
@@ -202,13 +202,18 @@ DistributedCoordinateSegmentation::DistributedCoordinateSegmentation(CSegContext
    mContext(ctx),
    mTopLevelRegion(NULL),
    mLastUpdateTime(Time::null()),
-   mLoadBalancer(this, nservers, perdim),
+   mLoadBalancer(NULL),
    mAvailableCSEGServers(GetOptionValue<uint16>("num-cseg-servers")),
    mUpperTreeCSEGServers(GetOptionValue<uint16>("num-upper-tree-cseg-servers")),
    mSidMap(sidmap)
 {
     CSEG_LOG(info, mAvailableCSEGServers << " : " << mUpperTreeCSEGServers);
 
+  if (GetOptionValue<String>("cseg-load-balancer") == "cost")
+    mLoadBalancer = new CostLoadBalancer(this, nservers, perdim);
+  else
+    mLoadBalancer = new LoadBalancer(this, nservers, perdim);
+
   assert(mAvailableCSEGServers >= mUpperTreeCSEGServers);
 
   assert (nservers >= (int)(perdim.x * perdim.y * perdim.z));
@@ -246,6 +251,8 @@ DistributedCoordinateSegmentation::DistributedCoordinateSegmentation(CSegContext
 DistributedCoordinateSegmentation::~DistributedCoordinateSegmentation() {
   //delete all the SegmentedRegion objects created with 'new'
   mTopLevelRegion.destroy();
+
+  delete mLoadBalancer;
 }
 
 void DistributedCoordinateSegmentation::ioServicingLoop() {
@@ -486,7 +493,7 @@ BoundingBox3f DistributedCoordinateSegmentation::region()  {
 }
 
 uint32 DistributedCoordinateSegmentation::numServers() {
-  return mLoadBalancer.numAvailableServers();
+  return mLoadBalancer->numAvailableServers();
 
   //int count = mTopLevelRegion.countServers();
   //return count;
@@ -518,7 +525,8 @@ void DistributedCoordinateSegmentation::handleLoadReport(boost::shared_ptr<tcp::
       if (sid == segRegion->mServer && bbox == segRegion->mBoundingBox) {
         segRegion->mLoadValue = message->load_value();
 
-        mLoadBalancer.reportRegionLoad(segRegion, sid, segRegion->mLoadValue);
+        mLoadBalancer->reportRegionLoad(segRegion, sid, segRegion->mLoadValue,
+                                        message->has_message_rate() ? message->message_rate() : 0);
       }
     }
     else {
@@ -530,7 +538,8 @@ void DistributedCoordinateSegmentation::handleLoadReport(boost::shared_ptr<tcp::
         // deal with the value for this region's load.
         if (sid == segRegion->mServer && bbox == segRegion->mBoundingBox) {
           segRegion->mLoadValue = message->load_value();
-          mLoadBalancer.reportRegionLoad(segRegion, sid, segRegion->mLoadValue);
+          mLoadBalancer->reportRegionLoad(segRegion, sid, segRegion->mLoadValue,
+                                          message->has_message_rate() ? message->message_rate() : 0);
         }
       }
       else {
@@ -602,7 +611,7 @@ void DistributedCoordinateSegmentation::poll() {
 void DistributedCoordinateSegmentation::service() {
   boost::unique_lock<boost::shared_mutex> lock(mCSEGReadWriteMutex);
 
-  mLoadBalancer.service();
+  mLoadBalancer->service();
 }
 
 void DistributedCoordinateSegmentation::notifySpaceServersOfChange(const std::vector<SegmentationInfo> segInfoVector)
@@ -842,7 +851,7 @@ void DistributedCoordinateSegmentation::asyncLLRead(boost::shared_ptr<tcp::socke
 
     mWholeTreeServerRegionMap.clear();
 
-    mLoadBalancer.handleSegmentationChange( csegMessage.change_message() );
+    mLoadBalancer->handleSegmentationChange( csegMessage.change_message() );
 
     sendToAllSpaceServers(csegMessage);
   }
@@ -865,7 +874,9 @@ void DistributedCoordinateSegmentation::asyncLLRead(boost::shared_ptr<tcp::socke
         //deal with the load from the space server
         segRegion->mLoadValue = csegMessage.ll_load_report_message().load_report_message().load_value();
 
-        mLoadBalancer.reportRegionLoad(segRegion, segRegion->mServer, segRegion->mLoadValue);
+        const Sirikata::Protocol::CSeg::LoadReportMessage& loadReport = csegMessage.ll_load_report_message().load_report_message();
+        mLoadBalancer->reportRegionLoad(segRegion, segRegion->mServer, segRegion->mLoadValue,
+                                        loadReport.has_message_rate() ? loadReport.message_rate() : 0);
       }
     }
     else {
@@ -1420,6 +1431,8 @@ void DistributedCoordinateSegmentation::sendLoadReportOnSocket(boost::shared_ptr
   csegMessage.mutable_ll_load_report_message().mutable_load_report_message().set_server(message.server());
   csegMessage.mutable_ll_load_report_message().mutable_load_report_message().set_load_value(message.load_value());
   csegMessage.mutable_ll_load_report_message().mutable_load_report_message().set_bbox(message.bbox());
+  if (message.has_message_rate())
+    csegMessage.mutable_ll_load_report_message().mutable_load_report_message().set_message_rate(message.message_rate());
 
   writeCSEGMessage(socket, csegMessage);
   //read ack message and discard
@@ -121,7 +121,7 @@ private:
     SegmentedRegion mTopLevelRegion;
     Time mLastUpdateTime;
 
-    LoadBalancer mLoadBalancer;
+    LoadBalancer* mLoadBalancer;
 
     std::vector<SegmentationChangeListener> mSpacePeers;
 
@@ -244,6 +244,7 @@ private:
     std::map<ServerID, SocketQueuePtr > mLeasedSocketsToCSEGServers;
 
     friend class LoadBalancer;
+    friend class CostLoadBalancer;
 
 
     SocketContainer getSocketToCSEGServer(ServerID server_id);
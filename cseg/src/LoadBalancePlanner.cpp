@@ -0,0 +1,337 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "LoadBalancePlanner.hpp"
+
+namespace Sirikata {
+
+namespace {
+// Boundary moves never shrink a leaf below this fraction of its parent
+const float32 MinLeafFraction = 0.05f;
+
+bool isLeaf(const SegmentedRegion* region) {
+    return (region->mLeftChild == NULL && region->mRightChild == NULL);
+}
+
+// The axis a parent was split along, i.e. the one its children don't span
+uint32 splitAxis(const SegmentedRegion* parent) {
+    const BoundingBox3f& pbox = parent->mBoundingBox;
+    const BoundingBox3f& lbox = parent->mLeftChild->mBoundingBox;
+    for(uint32 axis = 0; axis < 3; axis++) {
+        if (lbox.min()[axis] != pbox.min()[axis] || lbox.max()[axis] != pbox.max()[axis])
+            return axis;
+    }
+    return 0;
+}
+
+Vector3f withComponent(const Vector3f& v, uint32 axis, float32 val) {
+    Vector3f result = v;
+    if (axis == 0) result.x = val;
+    else if (axis == 1) result.y = val;
+    else result.z = val;
+    return result;
+}
+} // namespace
+
+LoadBalancePlanner::Parameters::Parameters()
+ : objectCost(1.f),
+   messageCost(0.1f),
+   smoothing(0.5f),
+   startImbalance(0.25f),
+   stopImbalance(0.1f),
+   overloadCost(2000.f),
+   underloadCost(100.f),
+   migrationBudget(500.f),
+   maxChangesPerRound(4)
+{
+}
+
+LoadBalancePlanner::LoadBalancePlanner(const Parameters& params)
+ : mParams(params),
+   mMigratedCost(0)
+{
+}
+
+void LoadBalancePlanner::reportLoad(SegmentedRegion* leaf, uint32 objects, uint32 messageRate) {
+    boost::mutex::scoped_lock lock(mMutex);
+
+    float32 reported = mParams.objectCost * objects + mParams.messageCost * messageRate;
+    LeafLoad& load = mLoads[leaf];
+    if (load.fresh)
+        load.cost = mParams.smoothing * reported + (1.f - mParams.smoothing) * load.cost;
+    else
+        load.cost = reported;
+    load.fresh = true;
+}
+
+float32 LoadBalancePlanner::cost(SegmentedRegion* leaf) {
+    boost::mutex::scoped_lock lock(mMutex);
+
+    LoadMap::iterator it = mLoads.find(leaf);
+    return (it == mLoads.end()) ? 0.f : it->second.cost;
+}
+
+bool LoadBalancePlanner::freshLoad(SegmentedRegion* leaf, float32* cost_out) {
+    LoadMap::iterator it = mLoads.find(leaf);
+    if (it == mLoads.end() || !it->second.fresh)
+        return false;
+    *cost_out = it->second.cost;
+    return true;
+}
+
+void LoadBalancePlanner::collect(SegmentedRegion* node, std::vector<SegmentedRegion*>* leaves, std::vector<SegmentedRegion*>* leaf_parents, std::map<ServerID, uint32>* leaves_per_server) {
+    if (isLeaf(node)) {
+        leaves->push_back(node);
+        (*leaves_per_server)[node->mServer]++;
+        return;
+    }
+
+    if (isLeaf(node->mLeftChild) && isLeaf(node->mRightChild))
+        leaf_parents->push_back(node);
+    collect(node->mLeftChild, leaves, leaf_parents, leaves_per_server);
+    collect(node->mRightChild, leaves, leaf_parents, leaves_per_server);
+}
+
+uint32 LoadBalancePlanner::plan(const std::vector<SegmentedRegion*>& roots, std::vector<ServerID>* idle, std::set<ServerID>* changed) {
+    boost::mutex::scoped_lock lock(mMutex);
+
+    std::vector<SegmentedRegion*> leaves, leaf_parents;
+    std::map<ServerID, uint32> leaves_per_server;
+    for(uint32 i = 0; i < roots.size(); i++)
+        collect(roots[i], &leaves, &leaf_parents, &leaves_per_server);
+
+    uint32 changes = 0;
+    // Estimated cost moved between servers this round
+    float32 moved_this_round = 0.f;
+    // Nodes changed this round, which shouldn't be changed again until their
+    // servers have reported on their new regions
+    RegionSet touched;
+
+    // Split the most overloaded leaves first, as long as servers are idle
+    std::vector< std::pair<float32, SegmentedRegion*> > overloaded;
+    for(uint32 i = 0; i < leaves.size(); i++) {
+        float32 c;
+        if (freshLoad(leaves[i], &c) && c > mParams.overloadCost)
+            overloaded.push_back(std::make_pair(c, leaves[i]));
+    }
+    std::sort(overloaded.begin(), overloaded.end());
+
+    // Without enough idle servers for them, reclaim servers from the cheapest
+    // sibling pairs that would stay well below the overload cost once merged
+    if (overloaded.size() > idle->size()) {
+        std::vector< std::pair<float32, SegmentedRegion*> > reclaimable;
+        for(uint32 i = 0; i < leaf_parents.size(); i++) {
+            SegmentedRegion* parent = leaf_parents[i];
+            float32 lcost, rcost;
+            if (parent->mLeftChild->mServer == parent->mRightChild->mServer ||
+                !freshLoad(parent->mLeftChild, &lcost) || !freshLoad(parent->mRightChild, &rcost))
+                continue;
+            if (lcost + rcost < mParams.overloadCost / 2)
+                reclaimable.push_back(std::make_pair(lcost + rcost, parent));
+        }
+        std::sort(reclaimable.begin(), reclaimable.end());
+
+        for(uint32 i = 0; i < reclaimable.size() && overloaded.size() > idle->size() && changes < mParams.maxChangesPerRound; i++) {
+            SegmentedRegion* parent = reclaimable[i].second;
+            ServerID lserver = parent->mLeftChild->mServer, rserver = parent->mRightChild->mServer;
+            float32 rcost = 0.f;
+            freshLoad(parent->mRightChild, &rcost);
+
+            merge(parent);
+            touched.insert(parent);
+            changed->insert(lserver);
+            changed->insert(rserver);
+            if (--leaves_per_server[rserver] == 0)
+                idle->push_back(rserver);
+            changes++;
+            moved_this_round += rcost;
+        }
+    }
+
+    for(int32 i = (int32)overloaded.size() - 1; i >= 0 && !idle->empty() && changes < mParams.maxChangesPerRound; i--) {
+        SegmentedRegion* leaf = overloaded[i].second;
+        ServerID new_server = idle->back();
+        idle->pop_back();
+
+        changed->insert(leaf->mServer);
+        changed->insert(new_server);
+        split(leaf, new_server);
+        touched.insert(leaf);
+        changes++;
+        moved_this_round += overloaded[i].first / 2;
+    }
+
+    // Merge sibling leaves that are both nearly idle
+    for(uint32 i = 0; i < leaf_parents.size() && changes < mParams.maxChangesPerRound; i++) {
+        SegmentedRegion* parent = leaf_parents[i];
+        if (touched.count(parent))
+            continue;
+        SegmentedRegion* left = parent->mLeftChild;
+        SegmentedRegion* right = parent->mRightChild;
+        if (touched.count(left) || touched.count(right))
+            continue;
+
+        float32 lcost, rcost;
+        if (!freshLoad(left, &lcost) || !freshLoad(right, &rcost))
+            continue;
+        if (lcost + rcost >= mParams.underloadCost)
+            continue;
+
+        ServerID lserver = left->mServer, rserver = right->mServer;
+        merge(parent);
+        touched.insert(parent);
+        changed->insert(lserver);
+        changed->insert(rserver);
+        if (rserver != lserver && --leaves_per_server[rserver] == 0)
+            idle->push_back(rserver);
+        changes++;
+        moved_this_round += rcost;
+    }
+
+    // Move boundaries between the most imbalanced siblings, within the budget
+    std::vector<LeafPair> imbalanced;
+    for(uint32 i = 0; i < leaf_parents.size(); i++) {
+        SegmentedRegion* parent = leaf_parents[i];
+        if (touched.count(parent) || !isLeaf(parent->mLeftChild) || !isLeaf(parent->mRightChild))
+            continue;
+        if (touched.count(parent->mLeftChild) || touched.count(parent->mRightChild))
+            continue;
+        if (parent->mLeftChild->mServer == parent->mRightChild->mServer)
+            continue;
+
+        float32 lcost, rcost;
+        if (!freshLoad(parent->mLeftChild, &lcost) || !freshLoad(parent->mRightChild, &rcost))
+            continue;
+        float32 total = lcost + rcost;
+        if (total <= 0.f)
+            continue;
+
+        LeafPair pair;
+        pair.parent = parent;
+        pair.imbalance = fabs(lcost - rcost) / total;
+        float32 threshold = mBalancing.count(parent) ? mParams.stopImbalance : mParams.startImbalance;
+        if (pair.imbalance > threshold)
+            imbalanced.push_back(pair);
+        else
+            mBalancing.erase(parent);
+    }
+    std::sort(imbalanced.begin(), imbalanced.end());
+
+    // Splits and merges aren't limited by the budget since they relieve
+    // servers that are overloaded or wasted, but they use it up
+    float32 budget = mParams.migrationBudget - moved_this_round;
+    for(uint32 i = 0; i < imbalanced.size() && changes < mParams.maxChangesPerRound && budget > 0.f; i++) {
+        SegmentedRegion* parent = imbalanced[i].parent;
+        float32 moved = moveBoundary(parent, budget);
+        if (moved <= 0.f) {
+            mBalancing.erase(parent);
+            continue;
+        }
+
+        mBalancing.insert(parent);
+        budget -= moved;
+        moved_this_round += moved;
+        changed->insert(parent->mLeftChild->mServer);
+        changed->insert(parent->mRightChild->mServer);
+        changes++;
+    }
+
+    mMigratedCost += moved_this_round;
+    return changes;
+}
+
+void LoadBalancePlanner::split(SegmentedRegion* leaf, ServerID new_server) {
+    const BoundingBox3f& box = leaf->mBoundingBox;
+    Vector3f extents = box.max() - box.min();
+    uint32 axis = 0;
+    if (extents.y > extents[axis]) axis = 1;
+    if (extents.z > extents[axis]) axis = 2;
+    float32 mid = (box.min()[axis] + box.max()[axis]) / 2.f;
+
+    leaf->mLeftChild = new SegmentedRegion(leaf);
+    leaf->mRightChild = new SegmentedRegion(leaf);
+    leaf->mLeftChild->mBoundingBox = BoundingBox3f(box.min(), withComponent(box.max(), axis, mid));
+    leaf->mRightChild->mBoundingBox = BoundingBox3f(withComponent(box.min(), axis, mid), box.max());
+    leaf->mLeftChild->mSplitAxis = leaf->mRightChild->mSplitAxis = (SegmentedRegion::SplitAxis)axis;
+    leaf->mLeftChild->mServer = leaf->mServer;
+    leaf->mRightChild->mServer = new_server;
+
+    // Until the servers report, assume the load was split evenly
+    LoadMap::iterator it = mLoads.find(leaf);
+    float32 half = (it == mLoads.end()) ? 0.f : it->second.cost / 2;
+    if (it != mLoads.end()) mLoads.erase(it);
+    mLoads[leaf->mLeftChild].cost = half;
+    mLoads[leaf->mRightChild].cost = half;
+}
+
+void LoadBalancePlanner::merge(SegmentedRegion* parent) {
+    float32 total = 0;
+    parent->mServer = parent->mLeftChild->mServer;
+    SegmentedRegion* children[2] = { parent->mLeftChild, parent->mRightChild };
+    for(uint32 i = 0; i < 2; i++) {
+        LoadMap::iterator it = mLoads.find(children[i]);
+        if (it != mLoads.end()) {
+            total += it->second.cost;
+            mLoads.erase(it);
+        }
+        delete children[i];
+    }
+    parent->mLeftChild = parent->mRightChild = NULL;
+    mBalancing.erase(parent);
+
+    mLoads[parent].cost = total;
+}
+
+float32 LoadBalancePlanner::moveBoundary(SegmentedRegion* parent, float32 budget) {
+    uint32 axis = splitAxis(parent);
+    SegmentedRegion* low = parent->mLeftChild;
+    SegmentedRegion* high = parent->mRightChild;
+    if (high->mBoundingBox.min()[axis] < low->mBoundingBox.min()[axis])
+        std::swap(low, high);
+
+    LeafLoad& low_load = mLoads[low];
+    LeafLoad& high_load = mLoads[high];
+    float32 half = (low_load.cost + high_load.cost) / 2;
+
+    float32 pmin = parent->mBoundingBox.min()[axis];
+    float32 pmax = parent->mBoundingBox.max()[axis];
+    float32 plane = low->mBoundingBox.max()[axis];
+    float32 min_width = (pmax - pmin) * MinLeafFraction;
+
+    // Assuming cost is spread evenly through each leaf, find how far the
+    // plane has to move into the more expensive leaf to even them out, or as
+    // far as the budget allows
+    float32 new_plane, moved;
+    if (low_load.cost > half) {
+        float32 density = low_load.cost / (plane - pmin);
+        moved = std::min(low_load.cost - half, budget);
+        new_plane = std::max(plane - moved / density, pmin + min_width);
+        moved = (plane - new_plane) * density;
+    }
+    else {
+        float32 density = high_load.cost / (pmax - plane);
+        moved = std::min(half - low_load.cost, budget);
+        new_plane = std::min(plane + moved / density, pmax - min_width);
+        moved = (new_plane - plane) * density;
+    }
+    if (moved <= 0.f || new_plane == plane)
+        return 0.f;
+
+    low->mBoundingBox = BoundingBox3f(low->mBoundingBox.min(), withComponent(low->mBoundingBox.max(), axis, new_plane));
+    high->mBoundingBox = BoundingBox3f(withComponent(high->mBoundingBox.min(), axis, new_plane), high->mBoundingBox.max());
+
+    if (new_plane < plane) {
+        low_load.cost -= moved;
+        high_load.cost += moved;
+    }
+    else {
+        low_load.cost += moved;
+        high_load.cost -= moved;
+    }
+    low_load.fresh = high_load.fresh = false;
+
+    return moved;
+}
+
+} // namespace Sirikata
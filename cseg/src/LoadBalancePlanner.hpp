@@ -0,0 +1,124 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_LOAD_BALANCE_PLANNER_HPP_
+#define _SIRIKATA_LOAD_BALANCE_PLANNER_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/space/SegmentedRegion.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace Sirikata {
+
+/** LoadBalancePlanner decides how to change a BSP segmentation to balance the
+ *  cost of the leaf regions, where a leaf's cost is a weighted sum of the
+ *  number of objects in it and the rate of messages its server handles, as
+ *  recently reported by that server. It only depends on the trees it is
+ *  given, so it can be driven by the cseg server or by a simulation.
+ *
+ *  Each round of planning:
+ *   - splits the most expensive leaves above the overload cost onto idle
+ *     servers, first reclaiming servers from the cheapest sibling pairs if
+ *     there aren't enough idle ones,
+ *   - merges sibling leaves whose combined cost is below the underload cost,
+ *     freeing a server,
+ *   - moves the plane between sibling leaves towards the position that
+ *     balances their costs, assuming objects are spread evenly within each
+ *     leaf.
+ *  Boundary moves use hysteresis: a pair starts balancing when its costs
+ *  differ by more than startImbalance and stops once they are within
+ *  stopImbalance. Boundary moves stop once the estimated cost moved
+ *  between servers in the round reaches migrationBudget, and the round stops
+ *  after maxChangesPerRound changes of any kind, so large rebalancing happens
+ *  in increments. Leaves aren't changed again until their servers report
+ *  load for the new regions.
+ */
+class LoadBalancePlanner {
+public:
+    struct Parameters {
+        Parameters();
+
+        // Cost of one object and of one message per second
+        float32 objectCost;
+        float32 messageCost;
+        // Weight of each new report in a leaf's smoothed cost
+        float32 smoothing;
+
+        float32 startImbalance;
+        float32 stopImbalance;
+        float32 overloadCost;
+        float32 underloadCost;
+
+        float32 migrationBudget;
+        uint32 maxChangesPerRound;
+    };
+
+    LoadBalancePlanner(const Parameters& params);
+
+    const Parameters& parameters() const { return mParams; }
+
+    /** Record the load of a leaf as reported by its server. */
+    void reportLoad(SegmentedRegion* leaf, uint32 objects, uint32 messageRate);
+
+    /** Smoothed cost of a leaf, or 0 if its server hasn't reported yet. */
+    float32 cost(SegmentedRegion* leaf);
+
+    /** Plan and apply one round of changes to the trees rooted at roots.
+     *  Splits take servers from the back of idle and merges append the
+     *  servers they free to it. Every server whose region changed is added to
+     *  changed.
+     *  \returns the number of changes made
+     */
+    uint32 plan(const std::vector<SegmentedRegion*>& roots, std::vector<ServerID>* idle, std::set<ServerID>* changed);
+
+    /** Total estimated cost moved between servers by all rounds so far. */
+    float64 migratedCost() const { return mMigratedCost; }
+
+private:
+    struct LeafLoad {
+        LeafLoad()
+         : cost(0),
+           fresh(false)
+        {}
+
+        float32 cost;
+        // Whether the server has reported since the leaf last changed, cost
+        // is only an estimate otherwise
+        bool fresh;
+    };
+    typedef std::tr1::unordered_map<SegmentedRegion*, LeafLoad> LoadMap;
+    typedef std::tr1::unordered_set<SegmentedRegion*> RegionSet;
+
+    // A parent with two leaf children, and how far apart their costs are
+    struct LeafPair {
+        SegmentedRegion* parent;
+        float32 imbalance;
+
+        bool operator<(const LeafPair& rhs) const {
+            return imbalance > rhs.imbalance;
+        }
+    };
+
+    static void collect(SegmentedRegion* node, std::vector<SegmentedRegion*>* leaves, std::vector<SegmentedRegion*>* leaf_parents, std::map<ServerID, uint32>* leaves_per_server);
+
+    bool freshLoad(SegmentedRegion* leaf, float32* cost_out);
+
+    void split(SegmentedRegion* leaf, ServerID new_server);
+    void merge(SegmentedRegion* parent);
+    // Returns the estimated cost moved, 0 if nothing could be moved
+    float32 moveBoundary(SegmentedRegion* parent, float32 budget);
+
+    Parameters mParams;
+
+    boost::mutex mMutex;
+    LoadMap mLoads;
+    // Parents of leaf pairs that are being balanced
+    RegionSet mBalancing;
+
+    float64 mMigratedCost;
+}; // class LoadBalancePlanner
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_LOAD_BALANCE_PLANNER_HPP_
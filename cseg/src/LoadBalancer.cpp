@@ -67,7 +67,7 @@ uint32 LoadBalancer::getAvailableServerIndex() {
   return availableSvrIndex;
 }
 
-void LoadBalancer::reportRegionLoad(SegmentedRegion* segRegion, ServerID sid, uint32 loadValue) {
+void LoadBalancer::reportRegionLoad(SegmentedRegion* segRegion, ServerID sid, uint32 loadValue, uint32 messageRate) {
   boost::mutex::scoped_lock overloadedRegionsListLock(mOverloadedRegionsListMutex);
   boost::mutex::scoped_lock underloadedRegionsListLock(mUnderloadedRegionsListMutex);
 
@@ -301,4 +301,61 @@ uint32 LoadBalancer::numAvailableServers() {
   return mAvailableServers.size();
 }
 
+
+
+CostLoadBalancer::CostLoadBalancer(DistributedCoordinateSegmentation* cseg, int nservers, const Vector3ui32& perdim)
+ : LoadBalancer(cseg, nservers, perdim),
+   mPlanner(LoadBalancePlanner::Parameters())
+{
+}
+
+void CostLoadBalancer::reportRegionLoad(SegmentedRegion* segRegion, ServerID sid, uint32 loadValue, uint32 messageRate) {
+  mPlanner.reportLoad(segRegion, loadValue, messageRate);
+}
+
+void CostLoadBalancer::service() {
+  std::vector<SegmentedRegion*> roots;
+  for (std::map<String, SegmentedRegion*>::iterator it = mCSeg->mHigherLevelTrees.begin();
+       it != mCSeg->mHigherLevelTrees.end(); it++)
+    roots.push_back(it->second);
+  for (std::map<String, SegmentedRegion*>::iterator it = mCSeg->mLowerLevelTrees.begin();
+       it != mCSeg->mLowerLevelTrees.end(); it++)
+    roots.push_back(it->second);
+
+  // Servers are handed out from the back, so reverse to use the lowest IDs first
+  std::vector<ServerID> idle;
+  for (int32 i = (int32)mAvailableServers.size() - 1; i >= 0; i--) {
+    if (mAvailableServers[i].mAvailable)
+      idle.push_back(mAvailableServers[i].mServer);
+  }
+
+  std::set<ServerID> changed;
+  if (mPlanner.plan(roots, &idle, &changed) == 0)
+    return;
+
+  std::set<ServerID> idleSet(idle.begin(), idle.end());
+  for (uint32 i=0; i<mAvailableServers.size(); i++)
+    mAvailableServers[i].mAvailable = (idleSet.find(mAvailableServers[i].mServer) != idleSet.end());
+
+  std::vector<SegmentationInfo> segInfoVector;
+  for (std::set<ServerID>::iterator it = changed.begin(); it != changed.end(); it++) {
+    mCSeg->mWholeTreeServerRegionMap.erase(*it);
+    mCSeg->mLowerTreeServerRegionMap.erase(*it);
+
+    SegmentationInfo segInfo;
+    segInfo.server = *it;
+    for (uint32 i=0; i<roots.size(); i++)
+      roots[i]->serverRegion(*it, segInfo.region);
+    // Servers left without a region get an empty box
+    if (segInfo.region.size() == 0)
+      segInfo.region.push_back(BoundingBox3f(Vector3f(0,0,0), Vector3f(0,0,0)));
+    segInfoVector.push_back(segInfo);
+  }
+
+  SILOG(cseg, info, "Rebalanced, " << changed.size() << " servers changed, "
+           << mPlanner.migratedCost() << " total cost migrated");
+
+  Thread thrd("CSeg Notify Space Servers", boost::bind(&DistributedCoordinateSegmentation::notifySpaceServersOfChange,mCSeg,segInfoVector));
+}
+
 }
@@ -37,6 +37,7 @@
 #include <sirikata/core/service/PollingService.hpp>
 #include <sirikata/space/SegmentedRegion.hpp>
 #include "CSegContext.hpp"
+#include "LoadBalancePlanner.hpp"
 
 #include "Protocol_CSeg.pbj.hpp"
 
@@ -56,30 +57,52 @@ class LoadBalancer {
 
 public:
   LoadBalancer(DistributedCoordinateSegmentation*, int nservers, const Vector3ui32& perdim);
-  ~LoadBalancer();
+  virtual ~LoadBalancer();
 
-  void reportRegionLoad(SegmentedRegion* region, ServerID sid, uint32 loadValue);
+  virtual void reportRegionLoad(SegmentedRegion* region, ServerID sid, uint32 loadValue, uint32 messageRate);
   void handleSegmentationChange(Sirikata::Protocol::CSeg::ChangeMessage segChangeMessage);
 
-  void service();
+  virtual void service();
 
   uint32 numAvailableServers() ;
 
   
 
-private:
+protected:
 
   uint32 getAvailableServerIndex();
-   
+
+  std::vector<ServerAvailability> mAvailableServers;
+
+  DistributedCoordinateSegmentation* mCSeg;
+
+private:
   
   std::vector<SegmentedRegion*> mOverloadedRegionsList;
   std::vector<SegmentedRegion*> mUnderloadedRegionsList;    
   boost::mutex mOverloadedRegionsListMutex;
   boost::mutex mUnderloadedRegionsListMutex;
 
-  std::vector<ServerAvailability> mAvailableServers;
+};
 
-  DistributedCoordinateSegmentation* mCSeg;
+/** CostLoadBalancer balances a weighted cost of the objects and message rate
+ *  each space server reports instead of object counts alone. Each call to
+ *  service() plans a bounded round of splits, merges and boundary moves with
+ *  a LoadBalancePlanner and notifies space servers of all the regions that
+ *  changed in one batch.
+ */
+class CostLoadBalancer : public LoadBalancer {
+
+public:
+  CostLoadBalancer(DistributedCoordinateSegmentation*, int nservers, const Vector3ui32& perdim);
+
+  virtual void reportRegionLoad(SegmentedRegion* region, ServerID sid, uint32 loadValue, uint32 messageRate);
+
+  virtual void service();
+
+private:
+
+  LoadBalancePlanner mPlanner;
 
 };
 
@@ -65,6 +65,8 @@ void InitCSegOptions() {
 
       .addOption(new OptionValue("num-upper-tree-cseg-servers", "1", Sirikata::OptionValueType<uint16>(), "Number of CSEG servers that solely maintain the upper tree"))
 
+      .addOption(new OptionValue("cseg-load-balancer", "threshold", Sirikata::OptionValueType<String>(), "Load balancer to use: threshold splits and merges regions by object count, cost balances objects and message rates with incremental boundary moves. cost needs space servers to report their load periodically, see their --cseg-load-report-interval"))
+
       ;
 }
 
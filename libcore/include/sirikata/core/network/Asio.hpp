@@ -71,6 +71,7 @@ class InternalIOStrand : public boost::asio::io_service::strand {
 public:
     InternalIOStrand(IOService &io);
     InternalIOStrand(IOService* io);
+    InternalIOStrand(InternalIOService &io);
 };
 
 
@@ -0,0 +1,137 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_CORE_NETWORK_CHUNK_POOL_HPP_
+#define _SIRIKATA_CORE_NETWORK_CHUNK_POOL_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace Sirikata {
+namespace Network {
+
+/** Free list of Chunks for received data. Released Chunks are cleared but
+ *  keep their storage, so a Chunk from allocate() usually comes with enough
+ *  capacity for a typical message already reserved. In particular, a stream
+ *  receive callback which takes ownership of the data by swapping it into a
+ *  pooled Chunk hands the pooled storage back to the stream's read buffer,
+ *  so in steady state neither side touches the allocator per message.
+ *  The data itself is still copied from the socket's read buffer into the
+ *  Chunk; streams don't hand out ref-counted slices of their read buffers.
+ *
+ *  Chunks may be released after the owner is done with the pool, so the
+ *  owner calls destroy() instead of deleting it, and the pool frees itself
+ *  once the last outstanding Chunk is returned.
+ */
+class ChunkPool {
+public:
+    struct Stats {
+        Stats()
+         : allocations(0),
+           reused(0),
+           discarded(0),
+           outstanding(0)
+        {}
+
+        // Total number of allocate() calls
+        uint64 allocations;
+        // Allocations satisfied from the free list, i.e. new Chunks avoided
+        uint64 reused;
+        // Released Chunks freed because the pool was full or they were too large
+        uint64 discarded;
+        // Chunks currently handed out
+        uint64 outstanding;
+
+        double reuseRate() const {
+            return (allocations == 0) ? 0.0 : ((double)reused / (double)allocations);
+        }
+    };
+
+    /** Create a pool holding at most max_free unused Chunks, none of which
+     *  keeps more than max_capacity bytes of storage.
+     */
+    ChunkPool(uint32 max_free = 256, uint32 max_capacity = 256*1024)
+     : mMaxFree(max_free),
+       mMaxCapacity(max_capacity),
+       mDestroyed(false)
+    {}
+
+    /** Get an empty Chunk. */
+    Chunk* allocate() {
+        boost::mutex::scoped_lock lock(mMutex);
+        mStats.allocations++;
+        mStats.outstanding++;
+
+        if (mFree.empty())
+            return new Chunk;
+
+        mStats.reused++;
+        Chunk* result = mFree.back();
+        mFree.pop_back();
+        return result;
+    }
+
+    /** Return a Chunk obtained from allocate(). */
+    void release(Chunk* chunk) {
+        chunk->clear();
+
+        bool delete_self = false;
+        {
+            boost::mutex::scoped_lock lock(mMutex);
+            if (mDestroyed || mFree.size() >= mMaxFree || chunk->capacity() > mMaxCapacity) {
+                mStats.discarded++;
+                delete chunk;
+            }
+            else {
+                mFree.push_back(chunk);
+            }
+            mStats.outstanding--;
+            delete_self = (mDestroyed && mStats.outstanding == 0);
+        }
+        if (delete_self)
+            delete this;
+    }
+
+    /** Release the owner's reference to the pool. The pool is deleted
+     *  immediately if no Chunks are outstanding, otherwise when the last one
+     *  is released.
+     */
+    void destroy() {
+        bool delete_self = false;
+        {
+            boost::mutex::scoped_lock lock(mMutex);
+            mDestroyed = true;
+            delete_self = (mStats.outstanding == 0);
+        }
+        if (delete_self)
+            delete this;
+    }
+
+    Stats stats() const {
+        boost::mutex::scoped_lock lock(mMutex);
+        return mStats;
+    }
+
+private:
+    ~ChunkPool() {
+        for(std::vector<Chunk*>::iterator it = mFree.begin(); it != mFree.end(); it++)
+            delete *it;
+    }
+
+    ChunkPool(const ChunkPool&);
+    ChunkPool& operator=(const ChunkPool&);
+
+    const uint32 mMaxFree;
+    const uint32 mMaxCapacity;
+
+    mutable boost::mutex mMutex;
+    std::vector<Chunk*> mFree;
+    Stats mStats;
+    bool mDestroyed;
+};
+
+} // namespace Network
+} // namespace Sirikata
+
+#endif //_SIRIKATA_CORE_NETWORK_CHUNK_POOL_HPP_
@@ -50,8 +50,48 @@ struct SIRIKATA_EXPORT Frame {
     /** Checks if a full message is available. Returns the contents and removes
      *  them from the argument if it has a whole packet; returns an empty string
      *  and does nothing to the argument if it does not have a whole packet.
+     *  Draining many messages this way copies the remaining data each time;
+     *  prefer FrameReader for streams.
      */
     static std::string parse(std::string& data);
+
+    /** Checks if a full message is available at the start of data without
+     *  copying or consuming anything. If there is one, frame is set to point at
+     *  its contents and the total number of bytes it occupies, including the
+     *  header, is returned. Otherwise returns 0.
+     */
+    static uint32 peek(const void* data, uint32 len, MemoryReference* frame);
+};
+
+/** Incrementally extracts frames from a stream of data. Data is appended as it
+ *  arrives and complete frames are handed out as views into the internal
+ *  buffer, so draining a buffer of N frames copies each byte once. Consumed
+ *  data is only discarded when it makes up most of the buffer.
+ */
+class SIRIKATA_EXPORT FrameReader {
+public:
+    FrameReader();
+
+    /** Add data received from the stream. Invalidates any previously returned
+     *  frames.
+     */
+    void append(const void* data, uint32 len);
+
+    /** Get the next complete frame, if there is one. The frame points into the
+     *  reader's buffer and remains valid until the next call to append().
+     *  \returns true if a frame was extracted
+     */
+    bool next(MemoryReference* frame);
+
+    /** Get the number of bytes buffered but not yet returned as frames. */
+    uint32 size() const {
+        return (uint32)(mBuffer.size() - mCursor);
+    }
+
+private:
+    std::string mBuffer;
+    // Offset of the first byte not yet returned in a frame
+    size_t mCursor;
 };
 
 } // namespace Network
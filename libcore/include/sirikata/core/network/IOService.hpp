@@ -38,6 +38,7 @@
 #include <sirikata/core/util/Noncopyable.hpp>
 #include <boost/thread.hpp>
 #include <sirikata/core/trace/WindowedStats.hpp>
+#include <sirikata/core/trace/LatencyHistogram.hpp>
 #include <sirikata/core/task/Time.hpp>
 #include <sirikata/core/command/Command.hpp>
 
@@ -57,6 +58,22 @@ class SIRIKATA_EXPORT IOService : public Noncopyable {
     InternalIOService* mImpl;
     const String mName;
 
+    // Per-thread run queues that strands are pinned to, or NULL if all
+    // handlers go through mImpl. See the constructor.
+    struct RunQueues;
+    RunQueues* mRunQueues;
+
+    // Queueing latency histograms for strand handlers, always collected.
+    // Each thread records into its own shard, which are only merged when
+    // stats are requested. Strands are keyed by name, stored in
+    // mStrandLatencyNames so the keys outlive the strands.
+    struct StrandLatencyShard;
+    struct StrandHandler;
+    const uint32 mLatencyID;
+    boost::mutex mLatencyMutex;
+    std::vector<StrandLatencyShard*> mLatencyShards;
+    std::set<String> mStrandLatencyNames;
+
 #ifdef SIRIKATA_TRACK_EVENT_QUEUES
     typedef std::tr1::function<void(const boost::system::error_code& e)> IOCallbackWithError;
 
@@ -112,6 +129,33 @@ class SIRIKATA_EXPORT IOService : public Noncopyable {
     void destroyingStrand(IOStrand* child);
 #endif
 
+    // Get the key a strand with the given name records latencies under
+    const String* strandLatencyKey(const String& strand_name);
+    // Wrap a handler a strand is about to queue. The time between queuing
+    // and running it is recorded in the running thread's shard and, with
+    // multiple run queues, it's counted as in countRunQueued.
+    IOCallback wrapStrandHandler(const String* strand_key, const IOCallback& handler, const char* tag);
+    void recordLatency(const String* strand_key, const char* tag, uint64 start_us);
+    StrandLatencyShard* threadLatencyShard();
+
+    // Get the queue a new strand should run its handlers through
+    InternalIOService& strandService();
+    // Wrap a handler a strand is about to queue so it keeps this service
+    // from running out of work until it has executed. Only used with
+    // multiple run queues.
+    IOCallback countRunQueued(const IOCallback& handler);
+    void runCounted(const IOCallback& handler);
+    void startRunCounted();
+    void finishRunCounted();
+    void updatePendingWork();
+    // Wake a thread blocked waiting for IO so it can pick up a strand
+    // handler that was just queued
+    void notifyRunQueued();
+    // Run loop and helpers for threads servicing multiple run queues
+    uint32 runQueues();
+    uint32 stealOne(uint32 home);
+    uint32 pollQueues();
+
   protected:
 
     friend class InternalIOStrand;
@@ -127,7 +171,21 @@ class SIRIKATA_EXPORT IOService : public Noncopyable {
 public:
 
 
-    IOService(const String& name);
+    /** Create an IOService.
+     *  \param name name of the service, used for debugging
+     *  \param run_queues the number of run queues handlers posted to strands
+     *         are spread across. With 1, every handler goes through a single
+     *         queue shared by all threads calling run(). With more, each
+     *         strand is pinned to a home queue and each thread calling run()
+     *         gets its own queue, so strand handlers tend to stay on one
+     *         thread and threads mostly avoid contending on a single queue.
+     *         Threads service their own queue first, then the shared queue
+     *         which holds IO completions, timers and handlers posted
+     *         directly to the service, and steal from other threads' queues
+     *         when both are empty. Normally this should match the number of
+     *         threads that will call run().
+     */
+    IOService(const String& name, uint32 run_queues = 1);
     ~IOService();
 
     /** Get the name of this IOService. */
@@ -230,6 +288,13 @@ public:
     // Respond to command to report all stats.
     void fillCommandResultWithStats(Command::Result& res);
 #endif
+    /** Fill in queueing latency percentiles for this IOService's strands,
+     *  aggregated by strand name and handler tag. Unlike the other stats
+     *  these are always available.
+     */
+    void fillCommandResultWithStrandLatency(Command::Result& res);
+    void commandStrandStats(const Command::Command& cmd, Command::Commander* cmdr, Command::CommandID cmdid);
+
     void commandReportStats(const Command::Command& cmd, Command::Commander* cmdr, Command::CommandID cmdid);
     static void commandReportAllStats(const Command::Command& cmd, Command::Commander* cmdr, Command::CommandID cmdid);
 };
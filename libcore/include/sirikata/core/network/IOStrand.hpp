@@ -64,6 +64,8 @@ class SIRIKATA_EXPORT IOStrand : public Noncopyable {
     IOService& mService;
     InternalIOStrand* mImpl;
     const String mName;
+    // Key for this strand's queueing latency stats in mService
+    const String* mLatencyKey;
 
 #ifdef SIRIKATA_TRACK_EVENT_QUEUES
     // Track all strands that have been allocated. This needs to be
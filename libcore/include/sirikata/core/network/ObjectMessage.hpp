@@ -80,6 +80,52 @@ public:
     };
 }; // class ObjectMessage
 
+/** A read only view of the routing fields of a serialized ObjectMessage:
+ *  source and destination objects and ports and the unique ID. These are
+ *  found by scanning the wire format directly, skipping over the payload, so
+ *  no ObjectMessage is allocated and nothing is copied. This lets a server
+ *  which is only forwarding a message make its routing decision and pass the
+ *  original bytes along untouched.
+ *
+ *  The envelope points into the data it was parsed from, so that data must
+ *  outlive it.
+ */
+class SIRIKATA_EXPORT ObjectMessageEnvelope {
+public:
+    ObjectMessageEnvelope();
+
+    /** Read the envelope fields from a serialized ObjectMessage. Returns false
+     *  if any are missing or the data is malformed, in which case the message
+     *  should be parsed normally instead.
+     */
+    bool parse(const MemoryReference& serialized);
+    bool parse(const std::string& serialized) {
+        return parse(MemoryReference(serialized));
+    }
+
+    const UUID& source_object() const { return mSourceObject; }
+    ObjectMessagePort source_port() const { return mSourcePort; }
+    const UUID& dest_object() const { return mDestObject; }
+    ObjectMessagePort dest_port() const { return mDestPort; }
+    uint64 unique() const { return mUnique; }
+    /** The payload, pointing into the serialized message. */
+    MemoryReference payload() const { return mPayload; }
+
+    /** The complete, unmodified serialized message. */
+    MemoryReference serialized() const { return mSerialized; }
+    /** Size of the serialized message, equivalent to ObjectMessage::ByteSize() */
+    int ByteSize() const { return (int)mSerialized.size(); }
+
+private:
+    MemoryReference mSerialized;
+    UUID mSourceObject;
+    ObjectMessagePort mSourcePort;
+    UUID mDestObject;
+    ObjectMessagePort mDestPort;
+    uint64 mUnique;
+    MemoryReference mPayload;
+}; // class ObjectMessageEnvelope
+
 // FIXME get rid of this
 SIRIKATA_FUNCTION_EXPORT void createObjectHostMessage(ObjectHostID source_server, const SpaceObjectReference& sporef_src, ObjectMessagePort src_port, const UUID& dest, ObjectMessagePort dest_port, const std::string& payload, ObjectMessage* result);
 
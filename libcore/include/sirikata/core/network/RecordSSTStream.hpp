@@ -60,12 +60,10 @@ private:
     RecordSSTStream(const RecordSSTStream&);
     
     void handleRead(uint8* data, int size) {
-        partial_frame.append((const char*)data, size);
-        while(true) {
-            String parsed = Network::Frame::parse(partial_frame);
-            if (parsed.empty()) return;
-            mCB( MemoryReference(parsed) );
-        }
+        frame_reader.append(data, size);
+        MemoryReference frame = MemoryReference::null();
+        while(frame_reader.next(&frame))
+            mCB(frame);
     }
 
     void writeSomeData(Liveness::Token alive) {
@@ -118,7 +116,7 @@ private:
     bool writing;
 
     // Backlog of data, i.e. incomplete frame
-    String partial_frame;
+    Network::FrameReader frame_reader;
 }; // class RecordSSTStream
 
 } // namespace Sirikata
@@ -0,0 +1,220 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_CORE_NETWORK_SST_BUFFER_POOL_HPP_
+#define _SIRIKATA_CORE_NETWORK_SST_BUFFER_POOL_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/util/AtomicTypes.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/intrusive_ptr.hpp>
+
+namespace Sirikata {
+namespace SST {
+
+/** Slab allocator for SST's segment and stream buffers. Blocks are carved out
+ *  of large slabs in a few power-of-two size classes and recycled through per
+ *  class free lists, so steady state traffic doesn't touch malloc. Requests
+ *  larger than the largest class fall through to malloc.
+ *
+ *  One pool is owned by each ConnectionManager. Since buffers can outlive the
+ *  manager (e.g. while a Connection is being torn down), the owner calls
+ *  destroy() instead of deleting the pool, and the pool frees itself once the
+ *  last outstanding block is returned.
+ */
+class SSTBufferPool {
+public:
+    struct Stats {
+        Stats()
+         : allocations(0),
+           hits(0),
+           oversized(0),
+           outstanding(0),
+           slabBytes(0)
+        {}
+
+        // Total number of allocate() calls
+        uint64 allocations;
+        // Allocations satisfied from a free list
+        uint64 hits;
+        // Allocations too large for any size class
+        uint64 oversized;
+        // Blocks currently handed out
+        uint64 outstanding;
+        // Memory reserved in slabs
+        uint64 slabBytes;
+
+        double hitRate() const {
+            return (allocations == 0) ? 0.0 : ((double)hits / (double)allocations);
+        }
+    };
+
+    SSTBufferPool()
+     : mDestroyed(false)
+    {
+        for(uint32 i = 0; i < NUM_SIZE_CLASSES; i++)
+            mFreeLists[i] = NULL;
+    }
+
+    /** Allocate a block of at least size bytes. */
+    void* allocate(uint32 size) {
+        uint32 sc = sizeClass(size);
+
+        boost::mutex::scoped_lock lock(mMutex);
+        mStats.allocations++;
+        mStats.outstanding++;
+
+        if (sc == NUM_SIZE_CLASSES) {
+            mStats.oversized++;
+            return malloc(size);
+        }
+
+        if (mFreeLists[sc] != NULL) {
+            mStats.hits++;
+        }
+        else {
+            refill(sc);
+        }
+        FreeBlock* block = mFreeLists[sc];
+        mFreeLists[sc] = block->next;
+        return block;
+    }
+
+    /** Return a block. size must match the size passed to allocate(). */
+    void release(void* data, uint32 size) {
+        uint32 sc = sizeClass(size);
+
+        bool delete_self = false;
+        {
+            boost::mutex::scoped_lock lock(mMutex);
+            if (sc == NUM_SIZE_CLASSES) {
+                free(data);
+            }
+            else {
+                FreeBlock* block = (FreeBlock*)data;
+                block->next = mFreeLists[sc];
+                mFreeLists[sc] = block;
+            }
+            mStats.outstanding--;
+            delete_self = (mDestroyed && mStats.outstanding == 0);
+        }
+        if (delete_self)
+            delete this;
+    }
+
+    /** Release the owner's reference to the pool. The pool is deleted
+     *  immediately if no blocks are outstanding, otherwise when the last one is
+     *  released.
+     */
+    void destroy() {
+        bool delete_self = false;
+        {
+            boost::mutex::scoped_lock lock(mMutex);
+            mDestroyed = true;
+            delete_self = (mStats.outstanding == 0);
+        }
+        if (delete_self)
+            delete this;
+    }
+
+    Stats stats() const {
+        boost::mutex::scoped_lock lock(mMutex);
+        return mStats;
+    }
+
+private:
+    enum {
+        MIN_BLOCK_SHIFT = 6, // 64 bytes
+        NUM_SIZE_CLASSES = 6, // up to 2048 bytes
+        SLAB_SIZE = 65536
+    };
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    ~SSTBufferPool() {
+        for(std::vector<uint8*>::iterator it = mSlabs.begin(); it != mSlabs.end(); it++)
+            delete[] *it;
+    }
+
+    SSTBufferPool(const SSTBufferPool&);
+    SSTBufferPool& operator=(const SSTBufferPool&);
+
+    static uint32 blockSize(uint32 sc) {
+        return (1 << (MIN_BLOCK_SHIFT + sc));
+    }
+
+    // Returns NUM_SIZE_CLASSES if size is too large for the pool
+    static uint32 sizeClass(uint32 size) {
+        uint32 sc = 0;
+        while(sc < NUM_SIZE_CLASSES && blockSize(sc) < size)
+            sc++;
+        return sc;
+    }
+
+    // Carve a new slab into blocks for the given size class. Must hold mMutex.
+    void refill(uint32 sc) {
+        uint8* slab = new uint8[SLAB_SIZE];
+        mSlabs.push_back(slab);
+        mStats.slabBytes += SLAB_SIZE;
+
+        uint32 bs = blockSize(sc);
+        for(uint32 offset = 0; offset + bs <= SLAB_SIZE; offset += bs) {
+            FreeBlock* block = (FreeBlock*)(slab + offset);
+            block->next = mFreeLists[sc];
+            mFreeLists[sc] = block;
+        }
+    }
+
+    mutable boost::mutex mMutex;
+    FreeBlock* mFreeLists[NUM_SIZE_CLASSES];
+    std::vector<uint8*> mSlabs;
+    Stats mStats;
+    bool mDestroyed;
+};
+
+/** Base for objects which live in an SSTBufferPool block together with their
+ *  payload and are reference counted intrusively via boost::intrusive_ptr, so
+ *  the object, its data and the reference count share a single pooled
+ *  allocation. Subclasses placement-new themselves into a block of block_size
+ *  bytes obtained from the pool; the block is returned to the pool when the
+ *  last reference goes away.
+ */
+class SSTPooledObject {
+protected:
+    SSTPooledObject(SSTBufferPool* pool, uint32 block_size)
+     : mRefCount(0),
+       mPool(pool),
+       mBlockSize(block_size)
+    {}
+
+    virtual ~SSTPooledObject() {}
+
+    friend void intrusive_ptr_add_ref(SSTPooledObject* obj) {
+        ++obj->mRefCount;
+    }
+
+    friend void intrusive_ptr_release(SSTPooledObject* obj) {
+        if (--obj->mRefCount == 0) {
+            SSTBufferPool* pool = obj->mPool;
+            uint32 block_size = obj->mBlockSize;
+            obj->~SSTPooledObject();
+            pool->release(obj, block_size);
+        }
+    }
+
+private:
+    SSTPooledObject(const SSTPooledObject&);
+    SSTPooledObject& operator=(const SSTPooledObject&);
+
+    AtomicValue<uint32> mRefCount;
+    SSTBufferPool* mPool;
+    uint32 mBlockSize;
+};
+
+} // namespace SST
+} // namespace Sirikata
+
+#endif //_SIRIKATA_CORE_NETWORK_SST_BUFFER_POOL_HPP_
@@ -35,6 +35,8 @@
 #define SST_IMPL_HPP
 
 #include <sirikata/core/network/SSTDecls.hpp>
+#include <sirikata/core/network/SSTBufferPool.hpp>
+#include <sirikata/core/network/SSTPayload.hpp>
 
 #include <sirikata/core/service/Service.hpp>
 #include <sirikata/core/util/Timer.hpp>
@@ -143,6 +145,17 @@ public:
     typedef typename CBTypes::ConnectionReturnCallbackFunction ConnectionReturnCallbackFunction;
     typedef typename CBTypes::StreamReturnCallbackFunction StreamReturnCallbackFunction;
 
+    ConnectionVariables()
+     : mBufferPool(new SSTBufferPool()),
+       mSelectiveAcks(false)
+    {}
+
+    ~ConnectionVariables() {
+        // Segments and buffers may still be held by connections and streams
+        // which outlive us, so the pool cleans itself up once they're gone.
+        mBufferPool->destroy();
+    }
+
   /* Returns 0 if no channel is available. Otherwise returns the lowest
      available channel. */
     uint32 getAvailableChannel(EndPointType& endPointType) {
@@ -203,6 +216,17 @@ public:
     StreamReturnCallbackMap  sListeningConnectionsCallbackMap;
     Mutex sStaticMembersLock;
 
+    // Backing storage for ChannelSegments and StreamBuffers
+    SSTBufferPool* mBufferPool;
+
+    // Whether streams advertise received ranges in their acks and use the
+    // ranges advertised by the other side for fast retransmit
+    bool mSelectiveAcks;
+
+private:
+    ConnectionVariables(const ConnectionVariables&);
+    ConnectionVariables& operator=(const ConnectionVariables&);
+
 };
 
 // This is just a template definition. The real implementation of BaseDatagramLayer
@@ -299,7 +323,10 @@ class SIRIKATA_EXPORT BaseDatagramLayer
 #define SST_IMPL_SUCCESS 0
 #define SST_IMPL_FAILURE -1
 
-class ChannelSegment {
+class ChannelSegment;
+typedef boost::intrusive_ptr<ChannelSegment> ChannelSegmentPtr;
+
+class ChannelSegment : public SSTPooledObject {
 public:
 
   uint8* mBuffer;
@@ -310,24 +337,43 @@ public:
   Time mTransmitTime;
   Time mAckTime;
 
-  ChannelSegment( const void* data, int len, uint64 channelSeqNum, uint64 ackSequenceNum) :
-                                               mBufferLength(len),
-					      mChannelSequenceNumber(channelSeqNum),
-					      mAckSequenceNumber(ackSequenceNum),
-					      mTransmitTime(Time::null()), mAckTime(Time::null())
-  {
-    mBuffer = new uint8[len];
-    memcpy( mBuffer, (const uint8*) data, len);
+  /** Allocate a segment holding a copy of data from pool. The segment and its
+   *  data share a single pooled block.
+   */
+  static ChannelSegmentPtr create(SSTBufferPool* pool, const void* data, int len, uint64 channelSeqNum, uint64 ackSequenceNum) {
+    return create(pool, NULL, 0, data, len, channelSeqNum, ackSequenceNum);
   }
 
-  ~ChannelSegment() {
-    delete [] mBuffer;
+  /** Allocate a segment from pool holding head followed by data, gathering
+   *  both straight into the pooled block.
+   */
+  static ChannelSegmentPtr create(SSTBufferPool* pool, const std::string& head, const void* data, int len, uint64 channelSeqNum, uint64 ackSequenceNum) {
+    return create(pool, head.data(), head.size(), data, len, channelSeqNum, ackSequenceNum);
   }
 
   void setAckTime(Time& ackTime) {
     mAckTime = ackTime;
   }
 
+private:
+  static ChannelSegmentPtr create(SSTBufferPool* pool, const void* head, int head_len, const void* data, int len, uint64 channelSeqNum, uint64 ackSequenceNum) {
+    uint32 block_size = sizeof(ChannelSegment) + head_len + len;
+    void* block = pool->allocate(block_size);
+    return ChannelSegmentPtr(new (block) ChannelSegment(pool, block_size, head, head_len, data, len, channelSeqNum, ackSequenceNum));
+  }
+
+  ChannelSegment(SSTBufferPool* pool, uint32 block_size, const void* head, int head_len, const void* data, int len, uint64 channelSeqNum, uint64 ackSequenceNum) :
+                                               SSTPooledObject(pool, block_size),
+                                               mBuffer((uint8*)(this+1)),
+                                               mBufferLength(head_len + len),
+					      mChannelSequenceNumber(channelSeqNum),
+					      mAckSequenceNumber(ackSequenceNum),
+					      mTransmitTime(Time::null()), mAckTime(Time::null())
+  {
+    if (head_len > 0)
+      memcpy( mBuffer, (const uint8*) head, head_len);
+    memcpy( mBuffer + head_len, (const uint8*) data, len);
+  }
 };
 
 template <class EndPointType>
@@ -379,8 +425,8 @@ private:
 
   uint32 mNumStreams;
 
-  std::deque< std::tr1::shared_ptr<ChannelSegment> > mQueuedSegments;
-  std::deque< std::tr1::shared_ptr<ChannelSegment> > mOutstandingSegments;
+  std::deque<ChannelSegmentPtr> mQueuedSegments;
+  std::deque<ChannelSegmentPtr> mOutstandingSegments;
   boost::mutex mOutstandingSegmentsMutex;
 
   uint16 mCwnd;
@@ -534,6 +580,23 @@ private:
 				       buffer.size());
   }
 
+  // Send sstMsg carrying payload, gathering the payload straight into the
+  // datagram instead of copying it into sstMsg first.
+  void sendSSTChannelPacket(Sirikata::Protocol::SST::SSTChannelHeader& sstMsg, const void* payload, uint32 len) {
+    if (mState == CONNECTION_DISCONNECTED) return;
+
+    std::string buffer;
+    buffer.reserve(len + 64);
+    if (!PayloadSerializer<Sirikata::Protocol::SST::SSTChannelHeader>::serializeHeader(sstMsg, len, &buffer)) {
+      sstMsg.set_payload(payload, len);
+      sendSSTChannelPacket(sstMsg);
+      return;
+    }
+    buffer.append((const char*)payload, len);
+    mDatagramLayer->send(&mLocalEndPoint, &mRemoteEndPoint, (void*) buffer.data(),
+				       buffer.size());
+  }
+
   const Context* getContext() {
     return mDatagramLayer->context();
   }
@@ -604,7 +667,7 @@ private:
       assert( !mQueuedSegments.empty() && mOutstandingSegments.size() <= mCwnd);
 
       for (int i = 0; (!mQueuedSegments.empty()) && mOutstandingSegments.size() <= mCwnd; i++) {
-	  std::tr1::shared_ptr<ChannelSegment> segment = mQueuedSegments.front();
+	  ChannelSegmentPtr segment = mQueuedSegments.front();
 
 	  Sirikata::Protocol::SST::SSTChannelHeader sstMsg;
 	  sstMsg.set_channel_id( mRemoteChannelID );
@@ -612,13 +675,11 @@ private:
 	  sstMsg.set_ack_count(1);
 	  sstMsg.set_ack_sequence_number(segment->mAckSequenceNumber);
 
-	  sstMsg.set_payload(segment->mBuffer, segment->mBufferLength);
-
           /*printf("%s sending packet from data sending loop to %s \n",
                    mLocalEndPoint.endPoint.toString().c_str()
                    , mRemoteEndPoint.endPoint.toString().c_str());*/
 
-	  sendSSTChannelPacket(sstMsg);
+	  sendSSTChannelPacket(sstMsg, segment->mBuffer, segment->mBufferLength);
 
 	  segment->mTransmitTime = curTime;
 	  mOutstandingSegments.push_back(segment);
@@ -892,6 +953,25 @@ private:
       return sendData(data, length, isAck, mLastReceivedSequenceNumber);
   }
 
+  // Gathering version for data packets, which are head followed by length
+  // bytes of data. Both are copied straight into the queued segment.
+  uint64 sendDataWithAutoAck(const std::string& head, const void* data, uint32 length) {
+    boost::mutex::scoped_lock lock(mQueueMutex);
+
+    assert(head.size() + length <= MAX_PAYLOAD_SIZE);
+
+    uint64 transmitSequenceNumber =  mTransmitSequenceNumber;
+
+    if (mQueuedSegments.size() < MAX_QUEUED_SEGMENTS) {
+      queueSegment( ChannelSegment::create(mSSTConnVars->mBufferPool,
+                    head, data, length, mTransmitSequenceNumber, mLastReceivedSequenceNumber) );
+    }
+
+    mTransmitSequenceNumber++;
+
+    return transmitSequenceNumber;
+  }
+
   // Explicit version, used when acking direct response to a packet
   uint64 sendData(const void* data, uint32 length, bool isAck, uint64 ack_seqno) {
     boost::mutex::scoped_lock lock(mQueueMutex);
@@ -907,23 +987,12 @@ private:
       sstMsg.set_ack_count(1);
       sstMsg.set_ack_sequence_number(ack_seqno);
 
-      sstMsg.set_payload(data, length);
-
-      sendSSTChannelPacket(sstMsg);
+      sendSSTChannelPacket(sstMsg, data, length);
     }
     else {
       if (mQueuedSegments.size() < MAX_QUEUED_SEGMENTS) {
-        mQueuedSegments.push_back( std::tr1::shared_ptr<ChannelSegment>(
-                                   new ChannelSegment(data, length, mTransmitSequenceNumber, ack_seqno) ) );
-        // Only service if we're going to be able to send
-        // immediately. Otherwise, we must already have outstanding
-        // packets waiting for a timeout, in which case this new
-        // packet will be dealt with as the existing servicing cycle
-        // completes.
-        if (mOutstandingSegments.size() <= mCwnd) {
-            mInSendingMode = true;
-            scheduleConnectionService();
-        }
+        queueSegment( ChannelSegment::create(mSSTConnVars->mBufferPool,
+                      data, length, mTransmitSequenceNumber, ack_seqno) );
       }
     }
 
@@ -932,6 +1001,20 @@ private:
     return transmitSequenceNumber;
   }
 
+  // Add a segment to the send queue. mQueueMutex must be locked.
+  void queueSegment(ChannelSegmentPtr segment) {
+    mQueuedSegments.push_back(segment);
+    // Only service if we're going to be able to send
+    // immediately. Otherwise, we must already have outstanding
+    // packets waiting for a timeout, in which case this new
+    // packet will be dealt with as the existing servicing cycle
+    // completes.
+    if (mOutstandingSegments.size() <= mCwnd) {
+        mInSendingMode = true;
+        scheduleConnectionService();
+    }
+  }
+
   void setState(int state) {
     mState = state;
   }
@@ -968,10 +1051,10 @@ private:
   void markAcknowledgedPacket(uint64 receivedAckNum) {
     boost::mutex::scoped_lock lock(mOutstandingSegmentsMutex);
 
-    for (std::deque< std::tr1::shared_ptr<ChannelSegment> >::iterator it = mOutstandingSegments.begin();
+    for (std::deque<ChannelSegmentPtr>::iterator it = mOutstandingSegments.begin();
          it != mOutstandingSegments.end(); it++)
     {
-        std::tr1::shared_ptr<ChannelSegment> segment = *it;
+        ChannelSegmentPtr segment = *it;
 
         if (!segment) {
           mOutstandingSegments.erase(it);
@@ -1671,7 +1754,10 @@ private:
 };
 
 
-class StreamBuffer{
+class StreamBuffer;
+typedef boost::intrusive_ptr<StreamBuffer> StreamBufferPtr;
+
+class StreamBuffer : public SSTPooledObject {
 public:
 
   uint8* mBuffer;
@@ -1681,21 +1767,32 @@ public:
   Time mTransmitTime;
   Time mAckTime;
 
-  StreamBuffer(const uint8* data, uint32 len, uint64 offset) :
-    mTransmitTime(Time::null()), mAckTime(Time::null())
-  {
-    mBuffer = new uint8[len+1];
+  // Highest stream byte sent when this buffer was last transmitted. Selective
+  // acks for data past this point mean this transmission was probably lost.
+  uint64 mRecoveryPoint;
+  // Number of such acks seen since the last transmission
+  uint16 mMissedAcks;
 
-    if (len > 0) {
-      memcpy(mBuffer,data,len);
-    }
+  /** Allocate a buffer with room for capacity bytes from pool. The first len
+   *  bytes are copied from data; more can be added with append().
+   */
+  static StreamBufferPtr create(SSTBufferPool* pool, const uint8* data, uint32 len, uint64 offset, uint32 capacity) {
+    assert(len <= capacity);
+    uint32 block_size = sizeof(StreamBuffer) + capacity + 1;
+    void* block = pool->allocate(block_size);
+    return StreamBufferPtr(new (block) StreamBuffer(pool, block_size, data, len, offset));
+  }
 
-    mBufferLength = len;
-    mOffset = offset;
+  static StreamBufferPtr create(SSTBufferPool* pool, const uint8* data, uint32 len, uint64 offset) {
+    return create(pool, data, len, offset, len);
   }
 
-  ~StreamBuffer() {
-      delete []mBuffer;
+  /** Append len bytes to the buffer. The caller must ensure this stays within
+   *  the capacity the buffer was created with.
+   */
+  void append(const uint8* data, uint32 len) {
+    memcpy(mBuffer+mBufferLength, data, len);
+    mBufferLength += len;
   }
 
     // This doesn't check the data, just that the StreamBuffers
@@ -1703,8 +1800,23 @@ public:
     bool operator==(const StreamBuffer& rhs) {
         return (mOffset == rhs.mOffset && mBufferLength == rhs.mBufferLength);
     }
+
+private:
+  StreamBuffer(SSTBufferPool* pool, uint32 block_size, const uint8* data, uint32 len, uint64 offset) :
+    SSTPooledObject(pool, block_size),
+    mTransmitTime(Time::null()), mAckTime(Time::null()),
+    mRecoveryPoint(0), mMissedAcks(0)
+  {
+    mBuffer = (uint8*)(this+1);
+
+    if (len > 0) {
+      memcpy(mBuffer,data,len);
+    }
+
+    mBufferLength = len;
+    mOffset = offset;
+  }
 };
-typedef std::tr1::shared_ptr<StreamBuffer> StreamBufferPtr;
 
 // Tracks segments that have been received in a stream, handling
 // merging them so we can deliver as much data in each callback as
@@ -1852,6 +1964,16 @@ public:
         return merged_ready;
     };
 
+    // Copy up to max_ranges of the lowest received but undelivered ranges
+    // into ranges_out, returning the number copied. These are the ranges
+    // reported back to the sender in selective acks.
+    uint32 lowestRanges(SegmentRange* ranges_out, uint32 max_ranges) const {
+        uint32 count = 0;
+        for(SegmentList::const_iterator it = mSegments.begin(); it != mSegments.end() && count < max_ranges; it++)
+            ranges_out[count++] = *it;
+        return count;
+    }
+
 private:
     // Lists/deques aren't particularly fast, but they let us muck with
     // the contents easily when we want to insert ranges we've
@@ -1994,7 +2116,7 @@ public:
       if (mCurrentQueueLength+len > MAX_QUEUE_LENGTH) {
 	return 0;
       }
-      mQueuedBuffers.push_back( std::tr1::shared_ptr<StreamBuffer>(new StreamBuffer(data, len, mNumBytesSent)) );
+      mQueuedBuffers.push_back( StreamBuffer::create(mSSTConnVars->mBufferPool, data, len, mNumBytesSent) );
       mCurrentQueueLength += len;
       mNumBytesSent += len;
 
@@ -2014,7 +2136,7 @@ public:
 	  break;
 	}
 
-	mQueuedBuffers.push_back( std::tr1::shared_ptr<StreamBuffer>(new StreamBuffer(data+currOffset, buffLen, mNumBytesSent)) );
+	mQueuedBuffers.push_back( StreamBuffer::create(mSSTConnVars->mBufferPool, data+currOffset, buffLen, mNumBytesSent) );
 	currOffset += buffLen;
 	mCurrentQueueLength += buffLen;
 	mNumBytesSent += buffLen;
@@ -2034,8 +2156,9 @@ public:
 #if SIRIKATA_PLATFORM != SIRIKATA_PLATFORM_WINDOWS
   /* Gathers data from the buffers described in 'vec',
      which is taken to be 'count' structures long, and
-     writes them to the stream. As each buffer is
-     written, it moves on to the next. If not all bytes
+     writes them to the stream. The data is packed into
+     as few packets as possible, so many small buffers
+     don't each cost a packet. If not all bytes
      can be transmitted immediately, they are queued
      locally until ready to transmit.
 
@@ -2047,20 +2170,45 @@ public:
              occurred
   */
   virtual int writev(const struct iovec* vec, int count) {
-    int totalBytesWritten = 0;
-
-    for (int i=0; i < count; i++) {
-      int numWritten = write( (const uint8*) vec[i].iov_base, vec[i].iov_len);
-
-      if (numWritten < 0) return -1;
+    if (mState == DISCONNECTED || mState == PENDING_DISCONNECT) {
+      return -1;
+    }
 
-      totalBytesWritten += numWritten;
+    boost::mutex::scoped_lock lock(mQueueMutex);
+    bool was_empty = mQueuedBuffers.empty();
 
-      if (numWritten == 0) {
-	return totalBytesWritten;
+    uint32 totalLen = 0;
+    for (int i=0; i < count; i++)
+      totalLen += vec[i].iov_len;
+    if (mCurrentQueueLength + totalLen > MAX_QUEUE_LENGTH)
+      totalLen = MAX_QUEUE_LENGTH - mCurrentQueueLength;
+
+    uint32 totalBytesWritten = 0;
+    int vecIdx = 0;
+    uint32 vecOffset = 0;
+    while (totalBytesWritten < totalLen) {
+      uint32 buffLen = std::min((uint32)MAX_PAYLOAD_SIZE, totalLen - totalBytesWritten);
+      StreamBufferPtr buffer = StreamBuffer::create(mSSTConnVars->mBufferPool, NULL, 0, mNumBytesSent, buffLen);
+
+      while (buffer->mBufferLength < buffLen) {
+        uint32 chunkLen = std::min((uint32)vec[vecIdx].iov_len - vecOffset, buffLen - buffer->mBufferLength);
+        buffer->append( ((const uint8*)vec[vecIdx].iov_base) + vecOffset, chunkLen );
+        vecOffset += chunkLen;
+        if (vecOffset == vec[vecIdx].iov_len) {
+          vecIdx++;
+          vecOffset = 0;
+        }
       }
+
+      mQueuedBuffers.push_back(buffer);
+      totalBytesWritten += buffLen;
+      mCurrentQueueLength += buffLen;
+      mNumBytesSent += buffLen;
     }
 
+    if (was_empty && totalBytesWritten > 0)
+      scheduleStreamService();
+
     return totalBytesWritten;
   }
 #endif
@@ -2282,6 +2430,7 @@ private:
   // ack_seqno is only required when the stream is remotely initiated
   int init(void* initial_data, uint32 length, bool remotelyInitiated, LSID remoteLSID, uint64 ack_seqno) {
     mNumInitRetransmissions = 1;
+    mSelectiveAcks = mSSTConnVars->mSelectiveAcks;
     if (remotelyInitiated) {
         mRemoteLSID = remoteLSID;
         mConnected = true;
@@ -2313,6 +2462,7 @@ private:
     }
 
     mNumBytesSent = mInitialDataLength;
+    mHighestByteSent = mInitialDataLength;
 
     if (length > mInitialDataLength) {
       int writeval = write( ((uint8*)initial_data) + mInitialDataLength, length - mInitialDataLength);
@@ -2483,7 +2633,7 @@ private:
 
         bool sentSomething = false;
 	while ( !mQueuedBuffers.empty() ) {
-	  std::tr1::shared_ptr<StreamBuffer> buffer = mQueuedBuffers.front();
+	  StreamBufferPtr buffer = mQueuedBuffers.front();
 
           // If we managed to get an ack late, then we will not have
           // been able to remove the actual buffer that got requeued
@@ -2506,13 +2656,13 @@ private:
 					    buffer->mOffset
 					    );
           buffer->mTransmitTime = curTime;
+          markTransmitted(buffer);
           sentSomething = true;
 
           // On the first send (or during a resend where we get a new
           // channel ID) we only mark this as waiting for an ack using
           // the specified channel segment ID.
-          assert(mWaitingForAcks.find(channelID) == mWaitingForAcks.end());
-          mWaitingForAcks[channelID] = buffer;
+          addWaitingForAck(channelID, buffer);
 
 	  mQueuedBuffers.pop_front();
 	  mCurrentQueueLength -= buffer->mBufferLength;
@@ -2577,6 +2727,7 @@ private:
       // they've timed out. They've been saved to the graveyard in
       // case we eventually get an ack back.
       mWaitingForAcks.clear();
+      mWaitingOffsets.clear();
     }
   }
 
@@ -2731,7 +2882,7 @@ private:
 
         // Clear out references tracking this buffer for acks. First,
         // the obvious one here.
-        mWaitingForAcks.erase(channelSegmentID);
+        eraseWaitingForAck(to_buffer_it);
         // Graveyard cleared below
     }
     else {
@@ -2744,18 +2895,14 @@ private:
 
             // Clear references tracking this buffer.
             mUnackedGraveyard.erase(unacked_buffer_it);
-            // In this case, we get rid of any entries actively
-            // waiting for acks. We could safely do this no matter
-            // where we found the ack, as we do with the graveyard
-            // below, but we don't since scanning through the list of
-            // waiting for acks is possibly very expensive, and in the
-            // common case much more expensive than scanning through
-            // the graveyard (which should usually be empty).
-            for(typename ChannelToBufferMap::iterator it = mWaitingForAcks.begin(); it != mWaitingForAcks.end(); ++it) {
-                if (*(it->second) == *acked_buffer) {
-                    mWaitingForAcks.erase(it);
-                    break;
-                }
+            // In this case, we also get rid of any entry actively
+            // waiting for an ack for a resend of the same data.
+            typename OffsetToChannelMap::iterator offset_it = mWaitingOffsets.find(acked_buffer->mOffset);
+            if (offset_it != mWaitingOffsets.end()) {
+                typename ChannelToBufferMap::iterator waiting_it = mWaitingForAcks.find(offset_it->second);
+                assert(waiting_it != mWaitingForAcks.end());
+                if (*(waiting_it->second) == *acked_buffer)
+                    eraseWaitingForAck(waiting_it);
             }
         }
     }
@@ -2765,16 +2912,20 @@ private:
     if (acked_buffer) {
         //printf("REMOVED ack packet at offset %d\n", (int)acked_buffer->mOffset);
 
-        acked_buffer->mAckTime = curTime;
-        // This gets updated regardless of the kind of ack because we
-        // we're removing all trace of that buffer now and the bytes
-        // are not really outstanding anymore since they've been
-        // acked, even though we might still have a packet in flight
-        // with those bytes. If we didn't do this when we ack from the
-        // graveyard, we'd end up never clearing these bytes because
-        // the newer channel ID becomes unackable (no more reference
-        // to them).
-        mNumOutstandingBytes -= acked_buffer->mBufferLength;
+        // Outstanding bytes get updated regardless of the kind of ack
+        // because we we're removing all trace of that buffer now and
+        // the bytes are not really outstanding anymore since they've
+        // been acked, even though we might still have a packet in
+        // flight with those bytes. If we didn't do this when we ack
+        // from the graveyard, we'd end up never clearing these bytes
+        // because the newer channel ID becomes unackable (no more
+        // reference to them).
+        //
+        // In either case, we also need to scan the graveyard for ones
+        // with the same offset due to retransmits (even if we found
+        // the acked one in the graveyard since we may have multiple
+        // retransmits)
+        removeAckedBuffer(acked_buffer, curTime);
 
         // These operations only work during a normal ack because the
         // info is either inaccurate (transmit and ack times from
@@ -2791,29 +2942,175 @@ private:
                 mTransmitWindowSize = 0;
             }
         }
+    }
 
-        // In either case, if we found the acked packet (we extracted
-        // the buffer), we need to scan the graveyard for ones with
-        // the same offset due to retransmits (even if we found the
-        // acked one in the graveyard since we may have multiple
-        // retransmits)
-        std::vector <uint64> graveyardChannelIDs;
-        for(typename ChannelToBufferMap::iterator graveyard_it = mUnackedGraveyard.begin(); graveyard_it != mUnackedGraveyard.end(); graveyard_it++) {
-            if (*(graveyard_it->second) == *acked_buffer)
-                graveyardChannelIDs.push_back(graveyard_it->first);
-        }
-        for (uint32 i=0; i< graveyardChannelIDs.size(); i++)
-            mUnackedGraveyard.erase(graveyardChannelIDs[i]);
+    // Selective acks can clear other buffers whose acks were lost and trigger
+    // fast retransmits of buffers that were probably dropped. An ACK without
+    // a selective ack block means the other side doesn't support them, so we
+    // stop sending ours and fall back on the retransmit timeout.
+    bool selectively_acked = false;
+    if (streamMsg->type() == streamMsg->ACK && mSelectiveAcks) {
+        if (streamMsg->payload().empty())
+            mSelectiveAcks = false;
+        else
+            selectively_acked = handleSelectiveAck(streamMsg->payload(), curTime);
     }
 
     // If we acked messages, we've cleared space in the transmit
     // buffer (the receiver cleared something out of its receive
     // buffer). We can send more data, so schedule servicing if we
     // have anything queued.
-    if (acked_buffer && !mQueuedBuffers.empty())
+    if ((acked_buffer || selectively_acked) && !mQueuedBuffers.empty())
         scheduleStreamService();
   }
 
+  // Record a (re)transmission of buffer for selective ack processing.
+  // mQueueMutex must be locked.
+  void markTransmitted(StreamBufferPtr buffer) {
+    uint64 buffer_end = buffer->mOffset + buffer->mBufferLength;
+    if (buffer_end > mHighestByteSent)
+        mHighestByteSent = buffer_end;
+    buffer->mRecoveryPoint = mHighestByteSent;
+    buffer->mMissedAcks = 0;
+  }
+
+  // Mark a buffer acked which may still be in mWaitingForAcks or the
+  // graveyard under other channel IDs. mQueueMutex must be locked.
+  void removeAckedBuffer(StreamBufferPtr buffer, const Time& curTime) {
+    buffer->mAckTime = curTime;
+    mNumOutstandingBytes -= buffer->mBufferLength;
+
+    std::vector <uint64> graveyardChannelIDs;
+    for(typename ChannelToBufferMap::iterator graveyard_it = mUnackedGraveyard.begin(); graveyard_it != mUnackedGraveyard.end(); graveyard_it++) {
+        if (*(graveyard_it->second) == *buffer)
+            graveyardChannelIDs.push_back(graveyard_it->first);
+    }
+    for (uint32 i=0; i< graveyardChannelIDs.size(); i++)
+        mUnackedGraveyard.erase(graveyardChannelIDs[i]);
+  }
+
+  // Process the selective ack block in an ACK packet's payload. Buffers the
+  // receiver reports as received are cleared even if their own acks were
+  // lost. Buffers which the receiver has seen later data past at least
+  // FAST_RETRANSMIT_THRESHOLD times are resent as soon as the transmit window
+  // allows instead of waiting for the retransmit timeout. Returns true if any
+  // buffers were acked. mQueueMutex must be locked.
+  bool handleSelectiveAck(const std::string& sack_data, const Time& curTime) {
+    int64 nextExpected;
+    ReceivedSegmentList::SegmentRange ranges[MAX_SACK_RANGES];
+    uint32 nranges = 0;
+    if (!decodeSelectiveAck(sack_data, &nextExpected, ranges, &nranges))
+        return false;
+
+    bool acked = ackWaitingRange(0, nextExpected, curTime);
+    int64 highestReceived = nextExpected;
+    for(uint32 i = 0; i < nranges; i++) {
+        acked = ackWaitingRange(ReceivedSegmentList::StartByte(ranges[i]), ReceivedSegmentList::EndByte(ranges[i]), curTime) || acked;
+        highestReceived = std::max(highestReceived, ReceivedSegmentList::EndByte(ranges[i]));
+    }
+
+    // Whatever is still waiting below the highest received byte is a hole the
+    // receiver skipped over
+    std::vector<uint64> retransmitChannelIDs;
+    for(typename OffsetToChannelMap::iterator it = mWaitingOffsets.begin();
+        it != mWaitingOffsets.end() && (int64)it->first < highestReceived; it++)
+    {
+        StreamBufferPtr buffer = mWaitingForAcks[it->second];
+        if (highestReceived <= (int64)buffer->mRecoveryPoint)
+            continue;
+        if (buffer->mMissedAcks < FAST_RETRANSMIT_THRESHOLD)
+            buffer->mMissedAcks++;
+        if (buffer->mMissedAcks == FAST_RETRANSMIT_THRESHOLD)
+            retransmitChannelIDs.push_back(it->second);
+    }
+
+    // Resend directly rather than requeuing so the buffer stays counted as
+    // outstanding exactly once. The old channel ID moves to the graveyard in
+    // case its ack was only delayed. Buffers the window has no room for stay
+    // at the threshold and go out on a later ack, or on the timeout.
+    for(uint32 i = 0; i < retransmitChannelIDs.size(); i++) {
+        uint64 oldChannelID = retransmitChannelIDs[i];
+        typename ChannelToBufferMap::iterator waiting_it = mWaitingForAcks.find(oldChannelID);
+        StreamBufferPtr buffer = waiting_it->second;
+        if (mTransmitWindowSize < buffer->mBufferLength)
+            break;
+
+        eraseWaitingForAck(waiting_it);
+        mUnackedGraveyard[oldChannelID] = buffer;
+
+        uint64 channelID = sendDataPacket(buffer->mBuffer, buffer->mBufferLength, buffer->mOffset);
+        buffer->mTransmitTime = curTime;
+        markTransmitted(buffer);
+        addWaitingForAck(channelID, buffer);
+        mLastSendTime = curTime;
+        mTransmitWindowSize -= buffer->mBufferLength;
+    }
+
+    return acked;
+  }
+
+  // Clear buffers waiting for acks which lie entirely within [start, end).
+  // Returns true if any were. mQueueMutex must be locked.
+  bool ackWaitingRange(int64 start, int64 end, const Time& curTime) {
+    bool acked = false;
+    typename OffsetToChannelMap::iterator it = mWaitingOffsets.lower_bound(start < 0 ? 0 : start);
+    while(it != mWaitingOffsets.end() && (int64)it->first < end) {
+        typename ChannelToBufferMap::iterator waiting_it = mWaitingForAcks.find(it->second);
+        assert(waiting_it != mWaitingForAcks.end());
+        StreamBufferPtr buffer = waiting_it->second;
+        it++;
+        if ((int64)(buffer->mOffset + buffer->mBufferLength) > end)
+            continue;
+
+        eraseWaitingForAck(waiting_it);
+        removeAckedBuffer(buffer, curTime);
+        acked = true;
+    }
+    return acked;
+  }
+
+  // Selective acks are carried in the payload of ACK packets as little endian
+  // uint64s: the next byte the receiver expects, followed by up to
+  // MAX_SACK_RANGES (start, end) pairs of data received past it. ACKs from
+  // peers without selective ack support just have an empty payload.
+  static void appendUint64(std::string* out, uint64 val) {
+    for(int i = 0; i < 8; i++)
+        out->push_back((char)((val >> (8*i)) & 0xFF));
+  }
+  static uint64 readUint64(const std::string& data, uint32 pos) {
+    uint64 val = 0;
+    for(int i = 7; i >= 0; i--)
+        val = (val << 8) | (uint8)data[pos+i];
+    return val;
+  }
+
+  std::string encodeSelectiveAck() {
+    ReceivedSegmentList::SegmentRange ranges[MAX_SACK_RANGES];
+    uint32 nranges = mReceivedSegments.lowestRanges(ranges, MAX_SACK_RANGES);
+
+    std::string result;
+    result.reserve(8 + 16*nranges);
+    appendUint64(&result, mNextByteExpected);
+    for(uint32 i = 0; i < nranges; i++) {
+        appendUint64(&result, ReceivedSegmentList::StartByte(ranges[i]));
+        appendUint64(&result, ReceivedSegmentList::EndByte(ranges[i]));
+    }
+    return result;
+  }
+
+  static bool decodeSelectiveAck(const std::string& data, int64* nextExpected, ReceivedSegmentList::SegmentRange* ranges, uint32* nranges) {
+    if (data.size() < 8 || (data.size() - 8) % 16 != 0)
+        return false;
+    *nextExpected = readUint64(data, 0);
+    *nranges = std::min((uint32)((data.size() - 8) / 16), (uint32)MAX_SACK_RANGES);
+    for(uint32 i = 0; i < *nranges; i++) {
+        int64 start = readUint64(data, 8 + 16*i);
+        int64 end = readUint64(data, 8 + 16*i + 8);
+        ranges[i] = ReceivedSegmentList::SegmentRange(start, end - start);
+    }
+    return true;
+  }
+
   LSID getLSID() {
     return mLSID;
   }
@@ -2877,6 +3174,8 @@ private:
     sstMsg.set_window( log((double)mReceiveWindowSize)/log(2.0)  );
     sstMsg.set_src_port(mLocalPort);
     sstMsg.set_dest_port(mRemotePort);
+    if (mSelectiveAcks)
+        sstMsg.set_payload(encodeSelectiveAck());
     std::string buffer = serializePBJMessage(sstMsg);
 
     //printf("Sending Ack packet with window %d\n", (int)sstMsg.window());
@@ -2897,12 +3196,17 @@ private:
 
     sstMsg.set_bsn(offset);
 
-    sstMsg.set_payload(data, len);
-
-    std::string buffer = serializePBJMessage(sstMsg);
-
     std::tr1::shared_ptr<Connection<EndPointType> > conn = mConnection.lock();
     assert(conn);
+
+    // The payload is gathered straight from the stream buffer into the
+    // channel segment rather than being copied through sstMsg
+    std::string header;
+    if (PayloadSerializer<Sirikata::Protocol::SST::SSTStreamHeader>::serializeHeader(sstMsg, len, &header))
+        return conn->sendDataWithAutoAck(header, data, len);
+
+    sstMsg.set_payload(data, len);
+    std::string buffer = serializePBJMessage(sstMsg);
     return conn->sendDataWithAutoAck(  buffer.data(), buffer.size(), false);
   }
 
@@ -2934,6 +3238,12 @@ private:
   uint32 mRemotePort;
 
   uint64 mNumBytesSent;
+  // End of the highest range of the stream transmitted so far
+  uint64 mHighestByteSent;
+  // Whether this stream sends and uses selective acks. Starts with the
+  // ConnectionVariables setting and is turned off if the other side's acks
+  // don't carry them.
+  bool mSelectiveAcks;
 
   LSID mParentLSID;
 
@@ -2944,8 +3254,13 @@ private:
   // Map from channel segment ID to the actual buffer of data for data
   // currently in flight. If we resend, this gets cleared, so it is
   // only tracking the *latest* channel ID for the buffer.
-  typedef std::map<uint64, std::tr1::shared_ptr<StreamBuffer> >  ChannelToBufferMap;
+  typedef std::map<uint64, StreamBufferPtr>  ChannelToBufferMap;
   ChannelToBufferMap mWaitingForAcks;
+  // Stream offset -> channel segment ID for the buffers in mWaitingForAcks,
+  // so selective acks can find them by the stream ranges they cover
+  typedef std::map<uint64, uint64> OffsetToChannelMap;
+  OffsetToChannelMap mWaitingOffsets;
+
   // Meanwhile, this tracks channel -> buffer for packets that missed
   // their ack deadline. A buffer can be in both mWaitingForAcks and
   // mUnackedGraveyard at the same time (and in the graveyard multiple
@@ -2965,7 +3280,23 @@ private:
   // the send queue.
   ChannelToBufferMap mUnackedGraveyard;
 
-  std::deque< std::tr1::shared_ptr<StreamBuffer> > mQueuedBuffers;
+  // Track a transmission of buffer under channelID while we wait for its ack.
+  // mWaitingForAcks and mWaitingOffsets are only updated through this and
+  // eraseWaitingForAck so they always hold the same buffers. mQueueMutex
+  // must be locked.
+  void addWaitingForAck(uint64 channelID, StreamBufferPtr buffer) {
+    assert(mWaitingForAcks.find(channelID) == mWaitingForAcks.end());
+    assert(mWaitingOffsets.find(buffer->mOffset) == mWaitingOffsets.end());
+    mWaitingForAcks[channelID] = buffer;
+    mWaitingOffsets[buffer->mOffset] = channelID;
+  }
+
+  void eraseWaitingForAck(typename ChannelToBufferMap::iterator it) {
+    mWaitingOffsets.erase(it->second->mOffset);
+    mWaitingForAcks.erase(it);
+  }
+
+  std::deque<StreamBufferPtr> mQueuedBuffers;
   uint32 mCurrentQueueLength;
 
   USID mUSID;
@@ -2976,6 +3307,14 @@ private:
   uint32 MAX_QUEUE_LENGTH;
   uint32 MAX_RECEIVE_WINDOW;
 
+  enum {
+      // Maximum number of received ranges reported in a selective ack
+      MAX_SACK_RANGES = 4,
+      // Number of selective acks reporting later data which trigger a
+      // retransmit of a buffer before its timeout
+      FAST_RETRANSMIT_THRESHOLD = 3
+  };
+
   boost::mutex mQueueMutex;
 
   bool mFirstRTO;
@@ -3123,12 +3462,32 @@ public:
       // Give the connections a chance to stop, performing specific
       // cleanup operations and notifying streams
       Connection<EndPointType>::stopConnections(&mSSTConnVars);
+
+      SSTBufferPool::Stats pool_stats = bufferPoolStats();
+      SST_LOG(detailed, "Buffer pool served " << pool_stats.allocations << " allocations, "
+          << (pool_stats.hitRate()*100) << "% from free lists, "
+          << pool_stats.oversized << " oversized, " << pool_stats.slabBytes << " bytes in slabs")
   }
 
   ~ConnectionManager() {
     Connection<EndPointType>::closeConnections(&mSSTConnVars);
   }
 
+  /** Get allocation counters for the pool backing this manager's packet
+   *  segments and stream buffers.
+   */
+  SSTBufferPool::Stats bufferPoolStats() const {
+    return mSSTConnVars.mBufferPool->stats();
+  }
+
+  /** Enable or disable selective acks and fast retransmit for streams managed
+   *  by this ConnectionManager. They are disabled by default. Streams stop
+   *  using them if the other side's acks show it doesn't support them.
+   */
+  void setSelectiveAcks(bool enabled) {
+    mSSTConnVars.mSelectiveAcks = enabled;
+  }
+
   bool connectStream(EndPoint <EndPointType> localEndPoint,
                      EndPoint <EndPointType> remoteEndPoint,
                      StreamReturnCallbackFunction cb)
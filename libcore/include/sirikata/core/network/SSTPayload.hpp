@@ -0,0 +1,122 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_CORE_NETWORK_SST_PAYLOAD_HPP_
+#define _SIRIKATA_CORE_NETWORK_SST_PAYLOAD_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/network/Message.hpp>
+
+namespace Sirikata {
+namespace SST {
+
+/** Serializes SST headers separately from their payloads, so a payload can be
+ *  gathered straight from the buffer it lives in into the packet instead of
+ *  being copied into the header's payload field, serialized with it and then
+ *  copied out again.
+ *
+ *  A protocol buffer is just a sequence of fields, so a header serialized
+ *  without its payload, followed by the payload field's key and length and
+ *  then the payload bytes, is the same message as the header with its
+ *  payload set. PBJMessageType must have a bytes field named payload.
+ */
+template<typename PBJMessageType>
+class PayloadSerializer {
+public:
+    /** Serialize header, which must not have its payload set, followed by the
+     *  key and length of a payload of payload_len bytes. Appending the payload
+     *  to out completes the message. Returns false if this isn't possible, in
+     *  which case the payload has to be set on the header and serialized
+     *  normally.
+     */
+    static bool serializeHeader(const PBJMessageType& header, uint32 payload_len, std::string* out) {
+        uint64 key = payloadKey(header);
+        if (key == 0 || !serializePBJMessage(out, header))
+            return false;
+        appendVarint(out, key);
+        appendVarint(out, payload_len);
+        return true;
+    }
+
+private:
+    enum {
+        WIRE_TYPE_VARINT = 0,
+        WIRE_TYPE_FIXED64 = 1,
+        WIRE_TYPE_LENGTH_DELIMITED = 2,
+        WIRE_TYPE_FIXED32 = 5
+    };
+
+    // The key of the payload field. Rather than duplicating the field number
+    // from the .pbj, it's found the first time through by serializing a copy
+    // of a real header with a recognizable payload. 0 if it couldn't be found.
+    static uint64 payloadKey(const PBJMessageType& header) {
+        static uint64 key = findPayloadKey(header);
+        return key;
+    }
+
+    static uint64 findPayloadKey(PBJMessageType prototype) {
+        const std::string marker("SSTPayloadSerializer");
+        prototype.set_payload(marker);
+        std::string serialized;
+        if (!serializePBJMessage(&serialized, prototype))
+            return 0;
+
+        const uint8* pos = (const uint8*)serialized.data();
+        const uint8* end = pos + serialized.size();
+        while(pos < end) {
+            uint64 key, value;
+            if (!readVarint(pos, end, &key)) return 0;
+            switch(key & 0x7) {
+              case WIRE_TYPE_VARINT:
+                if (!readVarint(pos, end, &value)) return 0;
+                break;
+              case WIRE_TYPE_FIXED64:
+                if (end - pos < 8) return 0;
+                pos += 8;
+                break;
+              case WIRE_TYPE_FIXED32:
+                if (end - pos < 4) return 0;
+                pos += 4;
+                break;
+              case WIRE_TYPE_LENGTH_DELIMITED:
+                if (!readVarint(pos, end, &value) || value > (uint64)(end - pos))
+                    return 0;
+                if (value == marker.size() && memcmp(pos, marker.data(), marker.size()) == 0)
+                    return key;
+                pos += value;
+                break;
+              default:
+                // Groups are never generated by PBJ
+                return 0;
+            }
+        }
+        return 0;
+    }
+
+    static bool readVarint(const uint8*& pos, const uint8* end, uint64* value_out) {
+        uint64 result = 0;
+        for(uint32 shift = 0; shift < 64 && pos < end; shift += 7) {
+            uint8 b = *pos++;
+            result |= ((uint64)(b & 0x7F)) << shift;
+            if ((b & 0x80) == 0) {
+                *value_out = result;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void appendVarint(std::string* out, uint64 value) {
+        while(value >= 0x80) {
+            out->push_back((char)((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out->push_back((char)value);
+    }
+};
+
+} // namespace SST
+} // namespace Sirikata
+
+#endif //_SIRIKATA_CORE_NETWORK_SST_PAYLOAD_HPP_
@@ -305,6 +305,20 @@ public:
         return Duration::zero();
     }
 
+    /** Get the average number of bytes handed to the underlying network library or OS
+     *  per write, or 0 if that isn't tracked by this Stream.
+     */
+    virtual float averageSendBytesPerCall() const {
+        return 0.f;
+    }
+
+    /** Get the average number of bytes read from the underlying network library or OS
+     *  per completed receive, or 0 if that isn't tracked by this Stream.
+     */
+    virtual float averageReceiveBytesPerCompletion() const {
+        return 0.f;
+    }
+
 };
 } // namespace Network
 } // namespace Sirikata
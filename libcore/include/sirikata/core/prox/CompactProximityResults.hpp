@@ -0,0 +1,96 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_LIBCORE_PROX_COMPACT_PROXIMITY_RESULTS_HPP_
+#define _SIRIKATA_LIBCORE_PROX_COMPACT_PROXIMITY_RESULTS_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include "Protocol_Prox.pbj.hpp"
+
+namespace Sirikata {
+
+/** Query parameter value ("encoding" : "compact") a querier uses to ask for
+ *  compact results.
+ */
+#define PROX_COMPACT_ENCODING "compact"
+
+/** Converts ProximityResults into CompactProximityResults (see
+ *  CompactProx.pbj). Compared to the full encoding:
+ *   - Locations are quantized relative to an origin, usually the querier's
+ *     position, so nearby objects need only a few bytes.
+ *   - Mesh URLs are interned, so each distinct URL is sent only once.
+ *   - When an object is added again, e.g. after a transient removal, only the
+ *     fields which changed since its last addition are sent.
+ *  An encoder holds the state for one stream of results and must see every
+ *  result on that stream, in order.
+ */
+class SIRIKATA_EXPORT CompactProximityEncoder {
+public:
+    CompactProximityEncoder(float32 quantum);
+
+    void encode(const Sirikata::Protocol::Prox::ProximityResults& results, const Vector3f& origin, String* payload_out);
+
+    float32 quantum() const { return mQuantum; }
+
+private:
+    friend class CompactProximityDecoder;
+
+    // Everything about an object we need to generate or apply changes
+    struct ObjectState {
+        ObjectState();
+
+        uint64 seqno;
+        bool aggregate;
+        Time locationT;
+        Vector3f position;
+        Vector3f velocity;
+        Time orientationT;
+        Quaternion orientation;
+        Quaternion orientationVelocity;
+        Vector3f centerOffset;
+        float32 centerBoundsRadius;
+        float32 maxObjectSize;
+        uint32 mesh;
+        String physics;
+        UUID parent;
+    };
+    typedef std::tr1::unordered_map<UUID, ObjectState, UUID::Hasher> ObjectStateMap;
+
+    float32 mQuantum;
+    ObjectStateMap mObjects;
+    typedef std::tr1::unordered_map<String, uint32> MeshIDMap;
+    MeshIDMap mMeshIDs;
+}; // class CompactProximityEncoder
+
+/** Converts CompactProximityResults back into ProximityResults, tracking the
+ *  same per stream state as CompactProximityEncoder. Locations are only as
+ *  accurate as the quantum they were encoded with.
+ */
+class SIRIKATA_EXPORT CompactProximityDecoder {
+public:
+    CompactProximityDecoder();
+
+    /** Decode payload into results_out. Returns false if the payload isn't a
+     *  compact result, in which case it should be parsed as the full encoding
+     *  instead.
+     */
+    bool decode(const String& payload, Sirikata::Protocol::Prox::ProximityResults* results_out);
+
+    /** Quickly checks whether payload looks like a compact result by looking at
+     *  its leading bytes, without parsing it. Full results never pass, so a
+     *  payload that fails this can go straight to the full decoder.
+     */
+    static bool isCompact(const String& payload);
+
+private:
+    typedef CompactProximityEncoder::ObjectState ObjectState;
+    typedef CompactProximityEncoder::ObjectStateMap ObjectStateMap;
+
+    ObjectStateMap mObjects;
+    std::tr1::unordered_map<uint32, String> mMeshes;
+}; // class CompactProximityDecoder
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_LIBCORE_PROX_COMPACT_PROXIMITY_RESULTS_HPP_
@@ -34,14 +34,18 @@
 #define _FAIR_MESSAGE_QUEUE_HPP_
 
 #include "Queue.hpp"
+#include "FairQueueIndex.hpp"
 #include <sirikata/core/util/Time.hpp>
 
 namespace Sirikata {
 
 /** Fair Queue with one input queue of Messages per Key, backed by a TQueue. Each
  *  input queue can be assigned a weight and selection happens according to FairQueuing.
+ *  IndexPolicy selects the data structures used to look up input queues by key
+ *  and by finish time (see FairQueueIndex.hpp). All policies produce the same
+ *  output; FairQueueHeapIndex scales better to many input queues.
  */
-template <class Message,class Key,class TQueue> class FairQueue {
+template <class Message,class Key,class TQueue,class IndexPolicy=FairQueueTreeIndex> class FairQueue {
 private:
     typedef TQueue MessageQueue;
 
@@ -82,17 +86,15 @@ private:
         Time nextFinishStartTime; // The time the next message to finish started at, used to recompute if front() changed
         Time nextFinishTime;
         bool enabled;
+        typename IndexPolicy::Hook indexHook;
     };
 
-    typedef std::map<Key, QueueInfo*> QueueInfoByKey; // NOTE: this could be unordered, but must be unique associative container
-    typedef std::multimap<Time, QueueInfo*> QueueInfoByFinishTime; // NOTE: this must be ordered multiple associative container
+    typedef typename IndexPolicy::template Index<Key, QueueInfo> QueueInfoByFinishTime;
+    typedef typename QueueInfoByFinishTime::ByKey QueueInfoByKey;
 
     typedef typename QueueInfoByKey::iterator ByKeyIterator;
     typedef typename QueueInfoByKey::const_iterator ConstByKeyIterator;
 
-    typedef typename QueueInfoByFinishTime::iterator ByTimeIterator;
-    typedef typename QueueInfoByFinishTime::const_iterator ConstByTimeIterator;
-
     typedef std::set<Key> KeySet;
     typedef std::set<QueueInfo*> QueueInfoSet;
 public:
@@ -185,6 +187,7 @@ public:
             return;
         QueueInfo* qi = it->second;
         qi->enabled = true;
+        mQueuesByTime.enabledChanged(qi);
         // Enabling a queue *might* affect the choice of the front queue if
         //  a. another queue is currently selected as the front
         //  b. the enabled queue is non-empty
@@ -201,6 +204,7 @@ public:
         assert(it != mQueuesByKey.end());
         QueueInfo* qi = it->second;
         qi->enabled = false;
+        mQueuesByTime.enabledChanged(qi);
 
         // Disabling a queue will only affect the choice of front queue if the
         // one disabled *was* the front queue.
@@ -400,51 +404,31 @@ protected:
     void nextMessage(Message** result_out, Time* vftime_out, QueueInfo** min_queue_info_out) {
         *result_out = NULL;
 
-        // If there's nothing in the queue, there is no next message
-        if (mQueuesByTime.empty())
+        // The index skips disabled queues for us
+        QueueInfo* min_queue_info = mQueuesByTime.front();
+        if (min_queue_info == NULL)
             return;
 
-        // Loop through until we find one that has data and can be handled.
-        bool advance = true; // Indicates whether the loop needs to advance, set to false when an unexpected front has already advanced to the next item in order to remove the current item
-        for(ByTimeIterator it = mQueuesByTime.begin(); it != mQueuesByTime.end(); advance ? it++ : it) {
-            QueueInfo* min_queue_info = it->second;
-
-            advance = true;
-
-            // First, check if this queue is even enabled
-            if (!min_queue_info->enabled)
-                continue;
+        // These just assert that this queue is just sane.
+        assert(min_queue_info->enabled);
+        assert(min_queue_info->nextFinishMessage != NULL);
+        assert(min_queue_info->nextFinishMessage == min_queue_info->messageQueue->front());
 
-            // These just assert that this queue is just sane.
-            assert(min_queue_info->nextFinishMessage != NULL);
-            assert(min_queue_info->nextFinishMessage == min_queue_info->messageQueue->front());
-
-            *min_queue_info_out = min_queue_info;
-            *vftime_out = min_queue_info->nextFinishTime;
-            *result_out = min_queue_info->nextFinishMessage;
-            break;
-        }
+        *min_queue_info_out = min_queue_info;
+        *vftime_out = min_queue_info->nextFinishTime;
+        *result_out = min_queue_info->nextFinishMessage;
     }
 
     // Finds and removes this queue from the time index (mQueuesByTime).
     void removeFromTimeIndex(QueueInfo* qi) {
-        std::pair<ByTimeIterator, ByTimeIterator> eq_range = mQueuesByTime.equal_range(qi->nextFinishTime);
-        ByTimeIterator start_q = eq_range.first;
-        ByTimeIterator end_q = eq_range.second;
-
-        for(ByTimeIterator it = start_q; it != end_q; it++) {
-            if (it->second == qi) {
-                mQueuesByTime.erase(it);
-                return;
-            }
-        }
+        mQueuesByTime.erase(qi);
     }
 
     // Computes the next finish time for this queue and, if it has one, inserts it into the time index
-    ByTimeIterator computeNextFinishTime(QueueInfo* qi, const Time& last_finish_time) {
+    void computeNextFinishTime(QueueInfo* qi, const Time& last_finish_time) {
         if ( qi->messageQueue->empty() ) {
             qi->nextFinishMessage = NULL;
-            return mQueuesByTime.end();
+            return;
         }
 
         // If we don't restrict to strict queues, front() may return NULL even though the queue is not empty.
@@ -453,16 +437,14 @@ protected:
         Message* front_msg = qi->messageQueue->front();
         if ( front_msg == NULL ) {
             qi->nextFinishMessage = NULL;
-            return mQueuesByTime.end();
+            return;
         }
 
         qi->nextFinishMessage = front_msg;
         qi->nextFinishTime = finishTime( front_msg->size(), qi, last_finish_time);
         qi->nextFinishStartTime = last_finish_time;
 
-        ByTimeIterator new_it = mQueuesByTime.insert( typename QueueInfoByFinishTime::value_type(qi->nextFinishTime, qi) );
-
-        return new_it;
+        mQueuesByTime.insert(qi);
     }
 
     void computeNextFinishTime(QueueInfo* qi) {
@@ -0,0 +1,236 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_FAIR_QUEUE_INDEX_HPP_
+#define _SIRIKATA_FAIR_QUEUE_INDEX_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/util/Time.hpp>
+
+namespace Sirikata {
+
+/** Index policies for FairQueue. A policy decides how FairQueue finds input
+ *  queues by key and how it keeps non-empty input queues ordered by the
+ *  virtual finish time of their front message. Each policy provides:
+ *
+ *   - Hook: per-queue state the index can store intrusively in the queue's
+ *     bookkeeping structure.
+ *   - Index<Key,QueueInfo>: the index itself, with a ByKey associative
+ *     container type and insert/erase/front operations on the time order.
+ *
+ *  Ties between equal finish times are always broken by insertion order, so
+ *  all policies pop messages in exactly the same order.
+ */
+
+/** The original index: a std::map by key and a std::multimap by finish
+ *  time. Every reindex allocates and rebalances a tree node, but keys iterate
+ *  in sorted order.
+ */
+struct FairQueueTreeIndex {
+    struct Hook {};
+
+    template<class Key, class QueueInfo>
+    class Index {
+      public:
+        typedef std::map<Key, QueueInfo*> ByKey; // NOTE: this could be unordered, but must be unique associative container
+
+        bool empty() const {
+            return mByTime.empty();
+        }
+
+        void insert(QueueInfo* qi) {
+            mByTime.insert( typename ByTime::value_type(qi->nextFinishTime, qi) );
+        }
+
+        // Finds and removes this queue, if it is present
+        void erase(QueueInfo* qi) {
+            std::pair<ByTimeIterator, ByTimeIterator> eq_range = mByTime.equal_range(qi->nextFinishTime);
+            for(ByTimeIterator it = eq_range.first; it != eq_range.second; it++) {
+                if (it->second == qi) {
+                    mByTime.erase(it);
+                    return;
+                }
+            }
+        }
+
+        // Disabled queues stay in the index and are skipped here
+        void enabledChanged(QueueInfo* qi) {
+        }
+
+        // Earliest finishing enabled queue, or NULL if there is none
+        QueueInfo* front() const {
+            for(ConstByTimeIterator it = mByTime.begin(); it != mByTime.end(); it++) {
+                if (it->second->enabled)
+                    return it->second;
+            }
+            return NULL;
+        }
+
+      private:
+        typedef std::multimap<Time, QueueInfo*> ByTime; // NOTE: this must be ordered multiple associative container
+        typedef typename ByTime::iterator ByTimeIterator;
+        typedef typename ByTime::const_iterator ConstByTimeIterator;
+
+        ByTime mByTime;
+    };
+};
+
+/** An index with a hash table by key and an intrusive binary min-heap by
+ *  (finish time, insertion sequence). Each queue records its own heap
+ *  position, so reindexing a queue is O(log n) with no allocation once the
+ *  heap's vector has grown. Disabled queues are parked outside the heap,
+ *  keeping their sequence number, so front() is O(1). Keys iterate in
+ *  unspecified order.
+ */
+struct FairQueueHeapIndex {
+    struct Hook {
+        Hook() : pos(NotIndexed), seq(0) {}
+
+        static const uint32 NotIndexed = 0xFFFFFFFF;
+        static const uint32 Parked = 0xFFFFFFFE;
+
+        uint32 pos; // Heap position, NotIndexed or Parked
+        uint64 seq;
+    };
+
+    template<class Key, class QueueInfo>
+    class Index {
+      public:
+        typedef std::tr1::unordered_map<Key, QueueInfo*> ByKey;
+
+        Index()
+         : mNextSeq(0),
+           mNumParked(0)
+        {}
+
+        bool empty() const {
+            return mHeap.empty() && mNumParked == 0;
+        }
+
+        void insert(QueueInfo* qi) {
+            assert(qi->indexHook.pos == Hook::NotIndexed);
+            qi->indexHook.seq = mNextSeq++;
+            if (qi->enabled)
+                heapInsert(qi);
+            else
+                park(qi);
+        }
+
+        void erase(QueueInfo* qi) {
+            if (qi->indexHook.pos == Hook::NotIndexed)
+                return;
+            if (qi->indexHook.pos == Hook::Parked) {
+                mNumParked--;
+                qi->indexHook.pos = Hook::NotIndexed;
+                return;
+            }
+            heapErase(qi);
+        }
+
+        void enabledChanged(QueueInfo* qi) {
+            if (qi->indexHook.pos == Hook::NotIndexed)
+                return;
+            if (qi->enabled && qi->indexHook.pos == Hook::Parked) {
+                mNumParked--;
+                qi->indexHook.pos = Hook::NotIndexed;
+                heapInsert(qi);
+            }
+            else if (!qi->enabled && qi->indexHook.pos != Hook::Parked) {
+                heapErase(qi);
+                park(qi);
+            }
+        }
+
+        QueueInfo* front() const {
+            if (mHeap.empty())
+                return NULL;
+            return mHeap[0].qi;
+        }
+
+      private:
+        // Heap entries carry their sort key so comparisons don't have to
+        // touch the QueueInfo, which is only written when an entry moves.
+        struct Entry {
+            Time finishTime;
+            uint64 seq;
+            QueueInfo* qi;
+        };
+
+        static bool before(const Entry& a, const Entry& b) {
+            if (a.finishTime != b.finishTime)
+                return a.finishTime < b.finishTime;
+            return a.seq < b.seq;
+        }
+
+        void park(QueueInfo* qi) {
+            qi->indexHook.pos = Hook::Parked;
+            mNumParked++;
+        }
+
+        void place(const Entry& entry, uint32 pos) {
+            mHeap[pos] = entry;
+            entry.qi->indexHook.pos = pos;
+        }
+
+        void heapInsert(QueueInfo* qi) {
+            Entry entry;
+            entry.finishTime = qi->nextFinishTime;
+            entry.seq = qi->indexHook.seq;
+            entry.qi = qi;
+            mHeap.push_back(entry);
+            siftUp(mHeap.size() - 1);
+        }
+
+        void heapErase(QueueInfo* qi) {
+            uint32 pos = qi->indexHook.pos;
+            qi->indexHook.pos = Hook::NotIndexed;
+            Entry last = mHeap.back();
+            mHeap.pop_back();
+            if (last.qi == qi)
+                return;
+            place(last, pos);
+            if (pos > 0 && before(last, mHeap[(pos-1)/2]))
+                siftUp(pos);
+            else
+                siftDown(pos);
+        }
+
+        void siftUp(uint32 pos) {
+            Entry entry = mHeap[pos];
+            while(pos > 0) {
+                uint32 parent = (pos-1)/2;
+                if (!before(entry, mHeap[parent]))
+                    break;
+                place(mHeap[parent], pos);
+                pos = parent;
+            }
+            place(entry, pos);
+        }
+
+        void siftDown(uint32 pos) {
+            Entry entry = mHeap[pos];
+            uint32 size = mHeap.size();
+            while(true) {
+                uint32 child = 2*pos + 1;
+                if (child >= size)
+                    break;
+                if (child+1 < size && before(mHeap[child+1], mHeap[child]))
+                    child++;
+                if (!before(mHeap[child], entry))
+                    break;
+                place(mHeap[child], pos);
+                pos = child;
+            }
+            place(entry, pos);
+        }
+
+        std::vector<Entry> mHeap;
+        uint64 mNextSeq;
+        uint32 mNumParked;
+    };
+};
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_FAIR_QUEUE_INDEX_HPP_
@@ -0,0 +1,203 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_LOCK_FREE_RING_QUEUE_HPP_
+#define _SIRIKATA_LOCK_FREE_RING_QUEUE_HPP_
+
+#include <sirikata/core/util/AtomicTypes.hpp>
+
+namespace Sirikata {
+
+#ifndef SIRIKATA_CACHE_LINE_SIZE
+#define SIRIKATA_CACHE_LINE_SIZE 64
+#endif
+
+/** A bounded multi-producer, multi-consumer queue with thread-safe push() and
+ *  pop() functions. It is a drop-in alternative to LockFreeQueue which never
+ *  allocates after construction: elements live in a fixed ring of slots, each
+ *  tagged with a sequence number which tells producers and consumers whether
+ *  the slot is ready for them. Producers and consumers only contend on their
+ *  own (cache line padded) position counter.
+ *
+ *  Because the queue is bounded, push() can fail. Callers get this back
+ *  pressure explicitly as a false return value (or a short count from
+ *  pushMultiple()) and can decide whether to drop, retry or fall back.
+ */
+template <typename T> class LockFreeRingQueue {
+private:
+    struct Slot {
+        AtomicValue<size_t> mSequence;
+        T mContent;
+    };
+
+    // Each position gets its own cache line so producers and consumers don't
+    // invalidate each other's lines.
+    struct PaddedPosition {
+        AtomicValue<size_t> mValue;
+        char mPad[SIRIKATA_CACHE_LINE_SIZE - sizeof(AtomicValue<size_t>)%SIRIKATA_CACHE_LINE_SIZE];
+    };
+
+    static size_t roundUpToPowerOfTwo(size_t val) {
+        size_t result = 2;
+        while(result < val)
+            result <<= 1;
+        return result;
+    }
+
+    // Noncopyable
+    LockFreeRingQueue(const LockFreeRingQueue& other);
+    void operator=(const LockFreeRingQueue& other);
+
+    char mPadStart[SIRIKATA_CACHE_LINE_SIZE];
+    const size_t mMask;
+    Slot* mSlots;
+    PaddedPosition mEnqueuePos;
+    PaddedPosition mDequeuePos;
+
+public:
+    /** Create a queue which can hold at least capacity elements. The actual
+     *  capacity is rounded up to a power of two.
+     */
+    explicit LockFreeRingQueue(size_t capacity)
+     : mMask(roundUpToPowerOfTwo(capacity) - 1),
+       mSlots(new Slot[mMask + 1])
+    {
+        for(size_t i = 0; i <= mMask; i++)
+            mSlots[i].mSequence = i;
+        mEnqueuePos.mValue = 0;
+        mDequeuePos.mValue = 0;
+    }
+
+    ~LockFreeRingQueue() {
+        delete[] mSlots;
+    }
+
+    /** Get the maximum number of elements the queue can hold. */
+    size_t capacity() const {
+        return mMask + 1;
+    }
+
+    /**
+     * Pushes value onto the queue
+     *
+     * @param value  Will be copied and placed onto the end of the queue.
+     * @returns      true if the value was pushed, false if the queue was full.
+     */
+    bool push(const T& value) {
+        Slot* slot;
+        size_t pos = mEnqueuePos.mValue.read();
+        while(true) {
+            slot = &mSlots[pos & mMask];
+            size_t seq = slot->mSequence.read();
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (mEnqueuePos.mValue.compareAndSwap(pos, pos+1))
+                    break;
+                pos = mEnqueuePos.mValue.read();
+            }
+            else if (diff < 0) {
+                // Slot still holds an element from the previous lap: full
+                return false;
+            }
+            else {
+                pos = mEnqueuePos.mValue.read();
+            }
+        }
+        slot->mContent = value;
+        memory_barrier();
+        slot->mSequence = pos + 1;
+        return true;
+    }
+
+    /**
+     * Pops the front value from the queue and places it in value.
+     *
+     * @param value  Will have the T at the front of the queue copied into it.
+     * @returns      whether value was changed (if the queue had at least one item).
+     */
+    bool pop(T& value) {
+        Slot* slot;
+        size_t pos = mDequeuePos.mValue.read();
+        while(true) {
+            slot = &mSlots[pos & mMask];
+            size_t seq = slot->mSequence.read();
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (mDequeuePos.mValue.compareAndSwap(pos, pos+1))
+                    break;
+                pos = mDequeuePos.mValue.read();
+            }
+            else if (diff < 0) {
+                return false;
+            }
+            else {
+                pos = mDequeuePos.mValue.read();
+            }
+        }
+        value = slot->mContent;
+        slot->mContent = T();
+        memory_barrier();
+        slot->mSequence = pos + mMask + 1;
+        return true;
+    }
+
+    /** Push values from the front of values until it is empty or the queue
+     *  fills up. Pushed values are removed from values, so anything left in it
+     *  afterwards was refused.
+     *  \returns the number of values pushed
+     */
+    size_t pushMultiple(std::deque<T>& values) {
+        size_t pushed = 0;
+        while(!values.empty() && push(values.front())) {
+            values.pop_front();
+            pushed++;
+        }
+        return pushed;
+    }
+
+    /** Pop up to max_count values, appending them to popResults.
+     *  \returns the number of values popped
+     */
+    size_t popMultiple(std::deque<T>* popResults, size_t max_count) {
+        size_t popped = 0;
+        T value;
+        while(popped < max_count && pop(value)) {
+            popResults->push_back(value);
+            popped++;
+        }
+        return popped;
+    }
+
+    /** Pops all elements currently in the queue into popResults. Unlike
+     *  ThreadSafeQueue this is not atomic with respect to concurrent pushes,
+     *  which may or may not end up in popResults.
+     */
+    void popAll(std::deque<T>* popResults) {
+        assert(popResults->empty());
+        popMultiple(popResults, capacity());
+    }
+
+    void swap(std::deque<T>& swapWith) {
+        if (!swapWith.empty())
+            throw std::runtime_error(std::string("Trying to swap with a nonempty queue"));
+        popAll(&swapWith);
+    }
+
+    bool probablyEmpty() {
+        return size() == 0;
+    }
+
+    /** Get the approximate number of elements in the queue. Only useful for
+     *  monitoring since it may be stale by the time it returns.
+     */
+    size_t size() {
+        size_t enq = mEnqueuePos.mValue.read();
+        size_t deq = mDequeuePos.mValue.read();
+        return (enq > deq) ? (enq - deq) : 0;
+    }
+};
+
+}
+
+#endif //_SIRIKATA_LOCK_FREE_RING_QUEUE_HPP_
@@ -0,0 +1,135 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_LOOKUP_BATCHER_HPP_
+#define _SIRIKATA_LOOKUP_BATCHER_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/trace/LatencyHistogram.hpp>
+
+namespace Sirikata {
+
+/** Collects lookups of keys into batches so a remote store can be asked for
+ *  many keys in one request (e.g. a Redis MGET) instead of one request per
+ *  key. The batcher only tracks keys: the owner decides when to send a batch,
+ *  normally when it is full or a short window after its first key was added,
+ *  and reports each key as complete when its result arrives.
+ *
+ *  A key that is already queued or in flight isn't added again, since the
+ *  result of the outstanding lookup will answer it. Along the way it records
+ *  the size of each batch and the latency of each lookup from the time it
+ *  was added until it completed.
+ *
+ *  Not thread safe.
+ */
+template<typename Key, typename Hasher = std::tr1::hash<Key> >
+class LookupBatcher {
+public:
+    LookupBatcher(uint32 max_batch)
+     : mMaxBatch(max_batch < 1 ? 1 : max_batch),
+       mBatchSizeCounts(mMaxBatch + 1, 0),
+       mBatches(0)
+    {}
+
+    uint32 maxBatch() const { return mMaxBatch; }
+
+    /** Queue a lookup of key, added at time t.
+     *  \returns true if this key started a new batch, in which case the owner
+     *  should arrange to send it soon.
+     */
+    bool add(const Key& key, const Time& t) {
+        if (mPending.find(key) != mPending.end())
+            return false;
+        mPending[key] = t;
+        mQueued.push_back(key);
+        return (mQueued.size() == 1);
+    }
+
+    bool full() const { return mQueued.size() >= mMaxBatch; }
+    bool empty() const { return mQueued.empty(); }
+    /** Number of keys waiting to be sent. */
+    uint32 queued() const { return mQueued.size(); }
+    /** Number of keys waiting to be sent or waiting for results. */
+    uint32 outstanding() const { return mPending.size(); }
+
+    /** Take up to maxBatch() queued keys as a batch to send. Anything left
+     *  over is still queued. Does nothing if there are no queued keys.
+     */
+    void take(std::vector<Key>* batch) {
+        batch->clear();
+        if (mQueued.empty()) return;
+
+        uint32 count = std::min((uint32)mQueued.size(), mMaxBatch);
+        batch->assign(mQueued.begin(), mQueued.begin() + count);
+        mQueued.erase(mQueued.begin(), mQueued.begin() + count);
+
+        mBatchSizeCounts[count]++;
+        mBatches++;
+    }
+
+    /** Mark the lookup of key complete at time t, successful or not.
+     *  \returns false if the key wasn't outstanding
+     */
+    bool complete(const Key& key, const Time& t) {
+        typename PendingMap::iterator it = mPending.find(key);
+        if (it == mPending.end())
+            return false;
+        mLatency.sample(t - it->second);
+        mPending.erase(it);
+        return true;
+    }
+
+    /** Forget all queued and in flight keys, e.g. after the connection they
+     *  were sent on is lost. Stats are kept.
+     */
+    void clear() {
+        mPending.clear();
+        mQueued.clear();
+    }
+
+    uint64 batches() const { return mBatches; }
+
+    /** Smallest batch size that at least fraction p of batches were no
+     *  larger than.
+     */
+    uint32 batchSizePercentile(double p) const {
+        if (mBatches == 0) return 0;
+        uint64 target = (uint64)(p * mBatches + 0.5);
+        if (target < 1) target = 1;
+        uint64 seen = 0;
+        for(uint32 i = 0; i < mBatchSizeCounts.size(); i++) {
+            seen += mBatchSizeCounts[i];
+            if (seen >= target) return i;
+        }
+        return mMaxBatch;
+    }
+
+    double averageBatchSize() const {
+        if (mBatches == 0) return 0;
+        uint64 total = 0;
+        for(uint32 i = 0; i < mBatchSizeCounts.size(); i++)
+            total += i * mBatchSizeCounts[i];
+        return (double)total / mBatches;
+    }
+
+    const Trace::LatencyHistogram& latency() const { return mLatency; }
+
+private:
+    typedef std::tr1::unordered_map<Key, Time, Hasher> PendingMap;
+
+    uint32 mMaxBatch;
+
+    // Time each queued or in flight key was added
+    PendingMap mPending;
+    std::deque<Key> mQueued;
+
+    // Number of batches of each size, indexed by size
+    std::vector<uint64> mBatchSizeCounts;
+    uint64 mBatches;
+    Trace::LatencyHistogram mLatency;
+}; // class LookupBatcher
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_LOOKUP_BATCHER_HPP_
@@ -0,0 +1,204 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_PAIRING_HEAP_HPP_
+#define _SIRIKATA_PAIRING_HEAP_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+
+namespace Sirikata {
+
+/** Addressable min-heap of (Key, Value) pairs, implemented as a pairing heap.
+ *  push() returns a Handle which stays valid until that element is popped or
+ *  erased, and can be used to erase the element or change its key. Pushes and
+ *  key decreases are O(1), pops, erases and key increases are amortized
+ *  O(log n).
+ *
+ *  Nodes live in a single vector and link to each other by index, so the heap
+ *  doesn't allocate once it has grown to its peak size and a handle is just an
+ *  index, making it cheap to store alongside the element it refers to.
+ */
+template<typename Key, typename Value, typename Compare = std::less<Key> >
+class PairingHeap {
+public:
+    typedef uint32 Handle;
+    enum {
+        InvalidHandle = 0xFFFFFFFF
+    };
+
+    PairingHeap(const Compare& comp = Compare())
+     : mComp(comp),
+       mRoot(InvalidHandle),
+       mSize(0)
+    {}
+
+    bool empty() const { return mSize == 0; }
+    uint32 size() const { return mSize; }
+
+    void clear() {
+        mNodes.clear();
+        mFree.clear();
+        mRoot = InvalidHandle;
+        mSize = 0;
+    }
+
+    Handle push(const Key& key, const Value& value) {
+        Handle h;
+        if (mFree.empty()) {
+            h = (Handle)mNodes.size();
+            mNodes.push_back(Node());
+        }
+        else {
+            h = mFree.back();
+            mFree.pop_back();
+        }
+        Node& n = mNodes[h];
+        n.key = key;
+        n.value = value;
+        n.child = n.sibling = n.prev = InvalidHandle;
+
+        mRoot = meld(mRoot, h);
+        mSize++;
+        return h;
+    }
+
+    /** Handle of the minimum element. The heap must not be empty. */
+    Handle top() const {
+        assert(!empty());
+        return mRoot;
+    }
+    const Key& topKey() const { return key(top()); }
+    const Value& topValue() const { return value(top()); }
+
+    const Key& key(Handle h) const { return mNodes[h].key; }
+    const Value& value(Handle h) const { return mNodes[h].value; }
+    Value& value(Handle h) { return mNodes[h].value; }
+
+    void pop() {
+        assert(!empty());
+        Handle old_root = mRoot;
+        mRoot = mergePairs(mNodes[old_root].child);
+        release(old_root);
+    }
+
+    void erase(Handle h) {
+        if (h == mRoot) {
+            pop();
+            return;
+        }
+        detach(h);
+        mRoot = meld(mRoot, mergePairs(mNodes[h].child));
+        release(h);
+    }
+
+    /** Change the key of an element, keeping its handle. */
+    void update(Handle h, const Key& new_key) {
+        Node& n = mNodes[h];
+        if (mComp(new_key, n.key)) {
+            // Decrease: only the link to the parent can be violated
+            n.key = new_key;
+            if (h != mRoot) {
+                detach(h);
+                mRoot = meld(mRoot, h);
+            }
+        }
+        else if (mComp(n.key, new_key)) {
+            // Increase: children may now belong above it, so split them off
+            // and merge everything back in
+            n.key = new_key;
+            Handle children = mergePairs(n.child);
+            mNodes[h].child = InvalidHandle;
+            if (h == mRoot) {
+                mRoot = meld(h, children);
+            }
+            else {
+                detach(h);
+                mRoot = meld(mRoot, meld(h, children));
+            }
+        }
+    }
+
+private:
+    struct Node {
+        Key key;
+        Value value;
+        Handle child;
+        Handle sibling;
+        // Parent for the leftmost child, otherwise the left sibling
+        Handle prev;
+    };
+
+    // Links two detached trees, returning the new root
+    Handle meld(Handle a, Handle b) {
+        if (a == InvalidHandle) return b;
+        if (b == InvalidHandle) return a;
+        if (mComp(mNodes[b].key, mNodes[a].key))
+            std::swap(a, b);
+
+        Node& parent = mNodes[a];
+        Node& child = mNodes[b];
+        child.prev = a;
+        child.sibling = parent.child;
+        if (parent.child != InvalidHandle)
+            mNodes[parent.child].prev = b;
+        parent.child = b;
+        parent.sibling = parent.prev = InvalidHandle;
+        return a;
+    }
+
+    // Standard two pass merge of a list of siblings: meld pairs left to
+    // right, then meld the results right to left.
+    Handle mergePairs(Handle first) {
+        if (first == InvalidHandle) return InvalidHandle;
+
+        mScratch.clear();
+        for(Handle h = first; h != InvalidHandle; ) {
+            Handle next = mNodes[h].sibling;
+            mNodes[h].sibling = mNodes[h].prev = InvalidHandle;
+            mScratch.push_back(h);
+            h = next;
+        }
+
+        uint32 npairs = 0;
+        for(uint32 i = 0; i < mScratch.size(); i += 2) {
+            Handle second = (i + 1 < mScratch.size()) ? mScratch[i+1] : (Handle)InvalidHandle;
+            mScratch[npairs++] = meld(mScratch[i], second);
+        }
+
+        Handle result = mScratch[npairs-1];
+        for(int32 i = (int32)npairs - 2; i >= 0; i--)
+            result = meld(mScratch[i], result);
+        return result;
+    }
+
+    // Unlinks a non-root node (and its subtree) from its parent and siblings
+    void detach(Handle h) {
+        Node& n = mNodes[h];
+        Node& prev = mNodes[n.prev];
+        if (prev.child == h)
+            prev.child = n.sibling;
+        else
+            prev.sibling = n.sibling;
+        if (n.sibling != InvalidHandle)
+            mNodes[n.sibling].prev = n.prev;
+        n.sibling = n.prev = InvalidHandle;
+    }
+
+    void release(Handle h) {
+        mFree.push_back(h);
+        mSize--;
+    }
+
+    Compare mComp;
+    std::vector<Node> mNodes;
+    std::vector<Handle> mFree;
+    // Reused by mergePairs so pops don't allocate
+    std::vector<Handle> mScratch;
+    Handle mRoot;
+    uint32 mSize;
+}; // class PairingHeap
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_PAIRING_HEAP_HPP_
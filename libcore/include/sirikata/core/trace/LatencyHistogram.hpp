@@ -0,0 +1,131 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_CORE_TRACE_LATENCY_HISTOGRAM_HPP_
+#define _SIRIKATA_CORE_TRACE_LATENCY_HISTOGRAM_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/task/Time.hpp>
+
+namespace Sirikata {
+namespace Trace {
+
+/** Fixed size histogram of durations, in the style of HdrHistogram. Samples
+ *  are bucketed by their power of two in microseconds and then linearly
+ *  within that power of two, so any reported value is within 1/SubBuckets of
+ *  the real one regardless of its magnitude. Recording a sample is a few bit
+ *  operations and an increment, and histograms are combined by adding their
+ *  counts, so it's cheap to keep many of them and merge them when needed.
+ */
+class LatencyHistogram {
+public:
+    enum {
+        SubBucketBits = 3,
+        SubBuckets = 1 << SubBucketBits,
+        // Samples of 2^MaxExponent us (about 12 days) or more are clamped
+        MaxExponent = 40,
+        NumBuckets = (MaxExponent - SubBucketBits + 1) * SubBuckets
+    };
+
+    LatencyHistogram()
+     : mCount(0),
+       mTotal(0),
+       mMin(0),
+       mMax(0)
+    {
+        for(uint32 i = 0; i < NumBuckets; i++)
+            mCounts[i] = 0;
+    }
+
+    /** Record a sample. Negative durations are recorded as 0. */
+    void sample(const Duration& d) {
+        int64 us = d.toMicroseconds();
+        uint64 val = (us < 0) ? 0 : (uint64)us;
+        if (val >= ((uint64)1 << MaxExponent))
+            val = ((uint64)1 << MaxExponent) - 1;
+
+        mCounts[bucket(val)]++;
+        if (mCount == 0 || val < mMin) mMin = val;
+        if (mCount == 0 || val > mMax) mMax = val;
+        mCount++;
+        mTotal += val;
+    }
+
+    /** Add all the samples from other to this histogram. */
+    void merge(const LatencyHistogram& other) {
+        if (other.mCount == 0) return;
+        for(uint32 i = 0; i < NumBuckets; i++)
+            mCounts[i] += other.mCounts[i];
+        if (mCount == 0 || other.mMin < mMin) mMin = other.mMin;
+        if (mCount == 0 || other.mMax > mMax) mMax = other.mMax;
+        mCount += other.mCount;
+        mTotal += other.mTotal;
+    }
+
+    uint64 count() const { return mCount; }
+
+    Duration min() const { return Duration::microseconds((int64)mMin); }
+    Duration max() const { return Duration::microseconds((int64)mMax); }
+    Duration average() const {
+        if (mCount == 0) return Duration::zero();
+        return Duration::microseconds((int64)(mTotal / mCount));
+    }
+
+    /** Get the smallest value that at least fraction p (in [0, 1]) of the
+     *  samples are less than or equal to, within the histogram's precision.
+     */
+    Duration percentile(double p) const {
+        if (mCount == 0) return Duration::zero();
+
+        uint64 target = (uint64)(p * mCount + 0.5);
+        if (target < 1) target = 1;
+        if (target > mCount) target = mCount;
+
+        uint64 seen = 0;
+        for(uint32 i = 0; i < NumBuckets; i++) {
+            seen += mCounts[i];
+            if (seen >= target) {
+                // Report the top of the bucket, but never outside the
+                // range of values actually seen
+                uint64 val = bucketMax(i);
+                if (val > mMax) val = mMax;
+                if (val < mMin) val = mMin;
+                return Duration::microseconds((int64)val);
+            }
+        }
+        return max();
+    }
+
+private:
+    static uint32 bucket(uint64 val) {
+        if (val < SubBuckets)
+            return (uint32)val;
+        uint32 exp = SubBucketBits;
+        while((val >> (exp + 1)) != 0)
+            exp++;
+        uint32 sub = (uint32)(val >> (exp - SubBucketBits)) - SubBuckets;
+        return (exp - SubBucketBits + 1) * SubBuckets + sub;
+    }
+
+    static uint64 bucketMax(uint32 idx) {
+        if (idx < SubBuckets)
+            return idx;
+        uint32 exp = idx / SubBuckets - 1 + SubBucketBits;
+        uint64 sub = idx % SubBuckets;
+        uint32 shift = exp - SubBucketBits;
+        return ((SubBuckets + sub + 1) << shift) - 1;
+    }
+
+    uint32 mCounts[NumBuckets];
+    uint64 mCount;
+    // In microseconds
+    uint64 mTotal;
+    uint64 mMin;
+    uint64 mMax;
+}; // class LatencyHistogram
+
+} // namespace Trace
+} // namespace Sirikata
+
+#endif //_SIRIKATA_CORE_TRACE_LATENCY_HISTOGRAM_HPP_
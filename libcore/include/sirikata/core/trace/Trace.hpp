@@ -38,6 +38,9 @@
 #include <sirikata/core/util/AtomicTypes.hpp>
 #include <sirikata/core/network/ObjectMessage.hpp>
 #include <sirikata/core/trace/BatchedBuffer.hpp>
+#include <sirikata/core/trace/TraceRing.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
 
 namespace Sirikata {
 namespace Trace {
@@ -96,6 +99,10 @@ struct Drops {
 
 #define ObjectConnectedTag 33
 
+// Precedes records from a single thread's TraceRing, giving the ring ID and
+// sequence number of the following record
+#define TraceThreadRunTag 35
+
 enum MessagePath {
     NONE, // Used when tag is needed but we don't have a name for it
 
@@ -216,7 +223,20 @@ private:
     // Thread which flushes data to disk periodically
     void storageThread(const String& filename);
 
-    BatchedBuffer data;
+    // Get the TraceRing for the current thread, creating it if necessary
+    TraceRing* threadRing();
+    // Rings are owned by the Trace, not the thread, so they can still be
+    // drained after the thread exits
+    static void noRingCleanup(TraceRing* ring) {}
+    // Returns true if any rings have data waiting to be stored
+    bool ringsPending();
+    // Store all data currently in the rings to of
+    void storeRings(FILE* of);
+
+    boost::thread_specific_ptr<TraceRing> mThreadRing;
+    boost::mutex mRingsMutex;
+    std::vector<TraceRing*> mRings;
+    uint32 mRingCapacity;
     bool mShuttingDown;
 
     Thread* mStorageThread;
@@ -224,6 +244,8 @@ private:
 
     // OptionValues that turn tracing on/off
     static OptionValue* mLogMessage;
+    // Size of each thread's TraceRing
+    static OptionValue* mThreadBufferSize;
 }; // class Trace
 
 } // namespace Trace
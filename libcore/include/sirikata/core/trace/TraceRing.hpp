@@ -0,0 +1,89 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_CORE_TRACE_RING_HPP_
+#define _SIRIKATA_CORE_TRACE_RING_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/util/AtomicTypes.hpp>
+#include <sirikata/core/trace/BatchedBuffer.hpp>
+
+namespace Sirikata {
+namespace Trace {
+
+/** TraceRing is a fixed size buffer of trace records with a single producer,
+ *  the thread generating the records, and a single consumer, the trace
+ *  storage thread. Neither side ever takes a lock.
+ *
+ *  Every record written to the ring is given the next sequence number for the
+ *  ring. When the consumer stores records it writes them in the normal trace
+ *  record format, preceded by a TraceThreadRunTag record giving the ring's ID and
+ *  the sequence number of the first record whenever the sequence doesn't just
+ *  continue from the last stored record. If the ring fills up, records are
+ *  dropped rather than blocking the producer, but they still use up sequence
+ *  numbers so the loss is visible when reading the trace.
+ */
+class SIRIKATA_EXPORT TraceRing {
+public:
+    /** Create a ring with the given ID, which identifies the producer in the
+     *  stored trace, and capacity in bytes, which must be a power of two.
+     */
+    TraceRing(uint32 id, uint32 capacity);
+    ~TraceRing();
+
+    uint32 id() const { return mID; }
+
+    /** Producer: append a record with the given type hint, whose payload is
+     *  the concatenation of the iovcnt buffers in iov. Returns false if the
+     *  record was dropped because the ring is full.
+     */
+    bool write(uint16 type_hint, const BatchedBuffer::IOVec* iov, uint32 iovcnt);
+
+    /** Consumer: write all records currently in the ring to os. */
+    void store(FILE* os);
+
+    /** Consumer: returns true if there are no records waiting to be stored. */
+    bool empty() const;
+
+    /** Number of records dropped because the ring was full. */
+    uint64 dropped() const { return mDropped.read(); }
+
+private:
+    // Each record in the ring is this header followed by size bytes of payload.
+    // Only the size and type hint are stored to the trace.
+    struct RecordHeader {
+        uint64 seqno;
+        uint32 size;
+        uint16 type_hint;
+    };
+    static const uint32 HeaderSize = sizeof(uint64) + sizeof(uint32) + sizeof(uint16);
+
+    // Copy in and out of the ring at a free running position, wrapping around
+    // the end of the buffer as necessary
+    void copyIn(uint32 pos, const void* src, uint32 len);
+    void copyOut(uint32 pos, void* dest, uint32 len) const;
+    void storeRange(FILE* os, uint32 pos, uint32 len) const;
+
+    const uint32 mID;
+    const uint32 mCapacity;
+    const uint32 mMask;
+    uint8* mBuffer;
+
+    // Free running positions, only written by the producer and consumer
+    // respectively. The difference is the number of bytes in use.
+    AtomicValue<uint32> mHead;
+    AtomicValue<uint32> mTail;
+
+    // Producer only
+    uint64 mNextSeqno;
+    AtomicValue<uint64> mDropped;
+    // Consumer only, the seqno following the last record stored
+    uint64 mNextStoredSeqno;
+    bool mStoredAny;
+}; // class TraceRing
+
+} // namespace Trace
+} // namespace Sirikata
+
+#endif //_SIRIKATA_CORE_TRACE_RING_HPP_
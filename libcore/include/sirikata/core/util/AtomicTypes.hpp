@@ -54,6 +54,9 @@ public:
     template<typename T> static T dec(volatile T*scalar) {
         return (T)InterlockedDecrement((volatile LONG*)scalar);
     }
+    template<typename T> static bool cas(volatile T*scalar, T comperand, T exchange) {
+        return (T)InterlockedCompareExchange((volatile LONG*)scalar,(LONG)exchange,(LONG)comperand)==comperand;
+    }
 };
 template<> class SizedAtomicValue<8> {
 public:
@@ -66,6 +69,9 @@ public:
     template<typename T> static T dec(volatile T*scalar) {
         return (T)InterlockedDecrement64((volatile LONGLONG*)scalar);
     }
+    template<typename T> static bool cas(volatile T*scalar, T comperand, T exchange) {
+        return (T)InterlockedCompareExchange64((volatile LONGLONG*)scalar,(LONGLONG)exchange,(LONGLONG)comperand)==comperand;
+    }
 };
 #elif defined(__APPLE__)
 template<int size> class SizedAtomicValue {
@@ -83,6 +89,9 @@ public:
     template <typename T> static T dec(volatile T*scalar) {
         return (T)OSAtomicDecrement32((int32*)scalar);
     }
+    template <typename T> static bool cas(volatile T*scalar, T comperand, T exchange) {
+        return OSAtomicCompareAndSwap32Barrier((int32)comperand, (int32)exchange, (int32*)scalar);
+    }
 };
 
 /** NOTE: These functions aren't available on Windows when compiling for
@@ -99,6 +108,9 @@ public:
     template <typename T> static T dec(volatile T*scalar) {
         return (T)OSAtomicDecrement64((int64*)scalar);
     }
+    template <typename T> static bool cas(volatile T*scalar, T comperand, T exchange) {
+        return OSAtomicCompareAndSwap64Barrier((int64)comperand, (int64)exchange, (int64*)scalar);
+    }
 };
 #else
 template<int size> class SizedAtomicValue {
@@ -112,6 +124,9 @@ public:
     template <typename T> static T dec(volatile T*scalar) {
         return __sync_sub_and_fetch(scalar, 1);
     }
+    template <typename T> static bool cas(volatile T*scalar, T comperand, T exchange) {
+        return __sync_bool_compare_and_swap(scalar, comperand, exchange);
+    }
 };
 #endif
 #ifdef _WIN32
@@ -182,8 +197,28 @@ public:
     T operator--(int) {
         return (--*this)+(T)1;
     }
+    /** Atomically replaces the value with exchange if it currently equals
+     *  comperand. Acts as a full memory barrier.
+     *  \returns true if the swap took place
+     */
+    bool compareAndSwap(T comperand, T exchange) {
+        return SizedAtomicValue<sizeof(T)>::cas(getThisAlignedAddress(mMemory),comperand,exchange);
+    }
 };
 
+/** Full hardware and compiler memory barrier. Use this to order plain writes
+ *  against a following AtomicValue assignment, which is not itself a barrier.
+ */
+inline void memory_barrier() {
+#ifdef _WIN32
+    MemoryBarrier();
+#elif defined(__APPLE__)
+    OSMemoryBarrier();
+#else
+    __sync_synchronize();
+#endif
+}
+
 template <class Node>
 inline bool compare_and_swap(volatile Node*volatile *target, volatile Node *comperand, volatile Node * exchange){
 #ifdef _WIN32
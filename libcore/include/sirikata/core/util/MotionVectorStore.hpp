@@ -0,0 +1,91 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_CORE_UTIL_MOTION_VECTOR_STORE_HPP_
+#define _SIRIKATA_CORE_UTIL_MOTION_VECTOR_STORE_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/util/MotionVector.hpp>
+
+namespace Sirikata {
+
+/** Stores a large number of TimedMotionVector3fs so their positions can be
+ *  extrapolated in bulk. Each value lives in a slot, which stays fixed until it
+ *  is removed; removed slots are reused by later additions. Callers keep their
+ *  own mapping from object to slot.
+ *
+ *  Values are stored in blocks of four slots, with each field laid out as a
+ *  small array within the block. A whole block can be extrapolated with a few
+ *  vector instructions, while looking up a single slot only touches the two
+ *  cache lines its block occupies.
+ *
+ *  Update times are stored in seconds relative to the first value added, so
+ *  extrapolation results can differ from TimedMotionVector3f::position() in the
+ *  last bit or so.
+ */
+class SIRIKATA_EXPORT MotionVectorStore {
+public:
+    typedef uint32 Slot;
+
+    MotionVectorStore();
+
+    Slot add(const TimedMotionVector3f& val);
+    void set(Slot slot, const TimedMotionVector3f& val);
+    void remove(Slot slot);
+
+    TimedMotionVector3f get(Slot slot) const;
+
+    /** Get the number of values stored. */
+    uint32 size() const {
+        return mNumSlots - mFreeSlots.size();
+    }
+    /** Get the number of slots available without allocating more storage,
+     *  including unused ones. Slots are always less than this value.
+     */
+    uint32 capacity() const {
+        return mBlocks.size() * BLOCK_SIZE;
+    }
+
+    /** Get the position of a single value at time t. */
+    Vector3f extrapolate(const Time& t, Slot slot) const;
+    /** Get the positions of count values at time t, storing them in out. */
+    void extrapolate(const Time& t, const Slot* slots, uint32 count, Vector3f* out) const;
+    /** Get the positions of all values at time t. Each array must hold
+     *  capacity() elements and is indexed by slot. Entries for unused slots are
+     *  filled in but meaningless.
+     */
+    void extrapolateAll(const Time& t, float32* x, float32* y, float32* z) const;
+
+private:
+    enum {
+        BLOCK_SIZE = 4
+    };
+
+    struct Block {
+        float64 time[BLOCK_SIZE];
+        float32 posX[BLOCK_SIZE];
+        float32 posY[BLOCK_SIZE];
+        float32 posZ[BLOCK_SIZE];
+        float32 velX[BLOCK_SIZE];
+        float32 velY[BLOCK_SIZE];
+        float32 velZ[BLOCK_SIZE];
+    };
+
+    float64 relativeSeconds(const Time& t) const {
+        return (t - mEpoch).toSeconds();
+    }
+
+    bool mHaveEpoch;
+    Time mEpoch;
+
+    std::vector<Block> mBlocks;
+    // Slots which have ever been used, i.e. the next slot to hand out when
+    // there are no free ones
+    uint32 mNumSlots;
+    std::vector<Slot> mFreeSlots;
+}; // class MotionVectorStore
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_CORE_UTIL_MOTION_VECTOR_STORE_HPP_
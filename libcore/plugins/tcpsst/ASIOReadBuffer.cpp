@@ -81,6 +81,14 @@ void ASIOReadBuffer::bindFunctions(IOStrand* strand) {
                 _2
             )
         );
+    mAsioFixedBufferReadable =
+        strand->wrap(
+            std::tr1::bind(&ASIOReadBuffer::asioFixedBufferReadable,
+                this,
+                _1,
+                _2
+            )
+        );
 }
 
 void BufferPrint(void * pointerkey, const char extension[16], const void * vbuf, size_t size) ;
@@ -201,6 +209,17 @@ static Stream::StreamID parseId(Chunk&newChunk,int&outBuffPosn) {
 void ASIOReadBuffer::readIntoFixedBuffer(const MultiplexedSocketPtr &parentSocket){
     mReadStatus=READING_FIXED_BUFFER;
 
+    if (mReadBatchSize) {
+        if (mInBatchedRead) {
+            // asioFixedBufferReadable will read again once we return to it
+            mBatchedReadMore=true;
+        }else {
+            parentSocket
+                ->getASIOSocketWrapper(mWhichBuffer).getSocket()
+                .async_receive(boost::asio::null_buffers(),mAsioFixedBufferReadable);
+        }
+        return;
+    }
     parentSocket
         ->getASIOSocketWrapper(mWhichBuffer).getSocket()
         .async_receive(boost::asio::buffer(mBuffer+mFixedBufferPos,sBufferLength-mFixedBufferPos),mAsioReadIntoFixedBuffer);
@@ -463,6 +482,7 @@ void ASIOReadBuffer::asioReadIntoChunk(const ErrorCode&error,std::size_t bytes_r
         if (error){
             processError(&*thus,error);
         }else {
+            thus->getASIOSocketWrapper(mWhichBuffer).recordReceiveCompletion(bytes_read);
             if (mChunkBufferPos>=mNewChunk.size()){
                 size_t vectorSize=mNewChunk.size();
                 assert(mChunkBufferPos==vectorSize);
@@ -501,12 +521,62 @@ void ASIOReadBuffer::asioReadIntoFixedBuffer(const ErrorCode&error,std::size_t b
         if (error){
             processError(&*thus,error);
         }else {
+            thus->getASIOSocketWrapper(mWhichBuffer).recordReceiveCompletion(bytes_read);
             translateFixedBuffer(thus);
         }
     }else {
         delete this;// the socket is deleted
     }
 }
+void ASIOReadBuffer::asioFixedBufferReadable(const ErrorCode&error,std::size_t bytes_read){
+    MultiplexedSocketPtr thus(mParentSocket.lock());
+
+    if (!thus) {
+        delete this;// the socket is deleted
+        return;
+    }
+    if (error) {
+        processError(&*thus,error);
+        return;
+    }
+
+    ASIOSocketWrapper &wrapper=thus->getASIOSocketWrapper(mWhichBuffer);
+    TCPSocket &socket=wrapper.getSocket();
+    std::size_t batchBytes=0;
+    mInBatchedRead=true;
+    mBatchedReadMore=true;
+    for (unsigned int reads=0;reads<mReadBatchSize&&mBatchedReadMore;++reads) {
+        ErrorCode readError;
+        // The socket was just reported readable, so the first read returns
+        // immediately with data, EOF or an error. Later reads only pick up
+        // data the kernel already has buffered so they never block.
+        if (reads&&socket.available(readError)==0&&!readError) {
+            break;
+        }
+        std::size_t bytesRead=0;
+        if (!readError) {
+            bytesRead=socket.read_some(boost::asio::buffer(mBuffer+mFixedBufferPos,sBufferLength-mFixedBufferPos),readError);
+        }
+        TCPSSTLOG(this,"rcv",&mBuffer[mFixedBufferPos],bytesRead,readError);
+        if (bytesRead)
+            BufferPrint(this, ".rcv", &(mBuffer[mFixedBufferPos]), bytesRead);
+        mFixedBufferPos+=bytesRead;
+        batchBytes+=bytesRead;
+        if (readError) {
+            mInBatchedRead=false;
+            processError(&*thus,readError);
+            return;
+        }
+        mBatchedReadMore=false;
+        translateFixedBuffer(thus);
+    }
+    mInBatchedRead=false;
+    wrapper.recordReceiveCompletion(batchBytes);
+    // Otherwise the stream was paused or is reading directly into a chunk
+    if (mBatchedReadMore) {
+        readIntoFixedBuffer(thus);
+    }
+}
 ASIOReadBuffer::ASIOReadBuffer(const MultiplexedSocketPtr &parentSocket,unsigned int whichSocket, TCPStream::StreamType type):mParentSocket(parentSocket){
     *(int*)mDataMask = 0;
     IOStrand* strand = parentSocket->getStrand();
@@ -518,6 +588,8 @@ ASIOReadBuffer::ASIOReadBuffer(const MultiplexedSocketPtr &parentSocket,unsigned
     mWhichBuffer=whichSocket;
     mCachedRejectedChunk=NULL;
     mStreamType = type;
+    mReadBatchSize = TCPStream::sReadBatchSize>0 ? TCPStream::sReadBatchSize : 0;
+    mInBatchedRead = mBatchedReadMore = false;
 }
 
 } }
@@ -83,6 +83,7 @@ private:
     ///Which actual low level tcp socket from the mParentSocket is used for communication
     unsigned int mWhichBuffer;
     ///A new chunk being read directly into--usually this member is only used to hold a large packet of information, otherwise the fixed length buffer is used
+    ///Its storage is reused from frame to frame unless a receive callback swaps it out (see ChunkPool); frames are copied here, never delivered as slices of mBuffer
     Chunk mNewChunk;
     Chunk *mCachedRejectedChunk;
     ///The StreamID of a new, partially examined new chunk
@@ -96,6 +97,13 @@ private:
     typedef boost::system::error_code ErrorCode;
     std::tr1::function<void(const ErrorCode&,std::size_t)> mAsioReadIntoFixedBuffer;
     std::tr1::function<void(const ErrorCode&,std::size_t)> mAsioReadIntoChunk;
+    std::tr1::function<void(const ErrorCode&,std::size_t)> mAsioFixedBufferReadable;
+    ///Maximum number of reads into mBuffer per readable notification, or 0 to issue an async_receive per read (see TCPStream::sReadBatchSize)
+    unsigned int mReadBatchSize;
+    ///Whether asioFixedBufferReadable is currently draining the socket
+    bool mInBatchedRead;
+    ///Set by readIntoFixedBuffer when translateFixedBuffer wants more data during a batched read
+    bool mBatchedReadMore;
 
     void bindFunctions(IOStrand* strand);
     /**
@@ -166,6 +174,15 @@ private:
      */
     void asioReadIntoFixedBuffer(const ErrorCode&error,std::size_t bytes_read);
 
+    /**
+     * The ASIO callback when the socket becomes readable and reads are batched
+     * The function reacts to errors by calling processErrors or a missing MultiplexedSocket by deleting this
+     * Otherwise the function reads into mBuffer and calls translateBuffer repeatedly, as long as translateBuffer
+     * asks for more data, the socket has more data buffered and fewer than mReadBatchSize reads have been made,
+     * then waits for the socket to become readable again if more data is needed
+     */
+    void asioFixedBufferReadable(const ErrorCode&error,std::size_t bytes_read);
+
     ASIOReadBuffer(const MultiplexedSocketPtr &parentSocket,unsigned int whichSocket, TCPStream::StreamType streamType);
     ///unimplemented: will fail due to bound function
     ASIOReadBuffer(const ASIOReadBuffer&);
@@ -213,43 +213,60 @@ void ASIOSocketWrapper::sendManyDequeItems(const std::tr1::weak_ptr<MultiplexedS
     mOutstandingDataParent.reset();
 
     if (parentMultiSocket) {
-        std::deque<TimestampedChunk> local_toSend;
-        local_toSend.swap(mToSend);
         if (error )   {
+            std::deque<TimestampedChunk> local_toSend;
+            local_toSend.swap(mToSend);
+            mToSendOffset=0;
             triggerMultiplexedConnectionError(&*parentMultiSocket,this,error);
             SILOG(tcpsst,insane,"Socket disconnected...waiting for recv to trigger error condition\n");
         } else {
-            size_t total_size=0;
-            for (std::deque<TimestampedChunk>::const_iterator i=local_toSend.begin(),ie=local_toSend.end();i!=ie;++i) {
-                finishedSendingChunk(*i);
-                size_t cursize=i->size();
-                total_size+=cursize;
-                if (cursize) {
-                    BufferPrint(this,".sec",&*i->chunk->begin(),cursize);
-                    TCPSSTLOG(this,"snd",&*i->begin(),i->size,error);
+            mSendCalls++;
+            mSendBytes+=bytes_sent;
+            //free everything that made it out, remembering how far into a partially written chunk we got
+            size_t remaining=bytes_sent;
+            while (remaining&&!mToSend.empty()) {
+                const TimestampedChunk&front=mToSend.front();
+                size_t cursize=front.size()-mToSendOffset;
+                if (remaining<cursize) {
+                    mToSendOffset+=remaining;
+                    remaining=0;
+                    break;
                 }
-                delete i->chunk;
+                remaining-=cursize;
+                finishedSendingChunk(front);
+                if (front.size()) {
+                    BufferPrint(this,".sec",&*front.chunk->begin(),front.size());
+                    TCPSSTLOG(this,"snd",&*front.chunk->begin(),front.size(),error);
+                }
+                delete front.chunk;
+                mToSend.pop_front();
+                mToSendOffset=0;
+            }
+            assert(remaining==0);//the socket can't have written more than we gave it
+            //empty chunks at the front were covered by the write as well
+            while (!mToSend.empty()&&mToSend.front().size()==0) {
+                finishedSendingChunk(mToSend.front());
+                delete mToSend.front().chunk;
+                mToSend.pop_front();
+            }
+            if (mToSend.empty()) {
+                //and send further items on the global queue if they are there
+                finishAsyncSend(parentMultiSocket);
+            }else {
+                //the write was partial or capped, finish what we have before looking at the queue again
+                sendQueuedChunks(parentMultiSocket);
             }
-            assert(total_size==bytes_sent);//otherwise should have given us an error
-            //and send further items on the global queue if they are there
-            finishAsyncSend(parentMultiSocket);
         }
     }
 }
-#define ASIOSocketWrapperBuffer(pointer,size) boost::asio::buffer(pointer,(size))
 
 
 void ASIOSocketWrapper::sendToWire(const MultiplexedSocketPtr&parentMultiSocket, TimestampedChunk toSend) {
-    //sending a single chunk is a straightforward call directly to asio
-    mToSend.resize(0);
+    //sending a single chunk is just a write of the one chunk
+    assert(mToSend.empty());
     mToSend.push_back(toSend);
-    BufferPrint(this,".buw",&*toSend.chunk->begin(),toSend.size());
-    mOutstandingDataParent=parentMultiSocket;//keep parent alive until send finishes
-
-    boost::asio::async_write(*mSocket,
-                             boost::asio::buffer(&*toSend.chunk->begin(),toSend.size()),
-                             boost::asio::transfer_at_least(toSend.size()),
-                             mSendManyDequeItems);
+    mToSendOffset=0;
+    sendQueuedChunks(parentMultiSocket);
 }
 void ASIOSocketWrapper::bindFunctions(const MultiplexedSocketPtr&parent) {
     mStrand = parent->getStrand();
@@ -265,25 +282,36 @@ void ASIOSocketWrapper::bindFunctions(const MultiplexedSocketPtr&parent) {
         );
 }
 void ASIOSocketWrapper::sendToWire(const MultiplexedSocketPtr&parentMultiSocket, std::deque<TimestampedChunk>&input_toSend){
-    std::vector<boost::asio::mutable_buffer> bufs;
+    assert(mToSend.empty());
+    mToSend.swap(input_toSend);
+    mToSendOffset=0;
+    sendQueuedChunks(parentMultiSocket);
+}
+void ASIOSocketWrapper::sendQueuedChunks(const MultiplexedSocketPtr&parentMultiSocket) {
+    //gather the chunks straight out of mToSend rather than copying them together, up to the per call limits.
+    //A chunk crossing the byte limit is written partially and picked up where it left off by the next call
+    std::vector<boost::asio::const_buffer> bufs;
+    bufs.reserve(std::min(mToSend.size(),(size_t)SEND_MAX_BUFFERS_PER_CALL));
     size_t total_size=0;
-    for (std::deque<TimestampedChunk>::const_iterator i=input_toSend.begin(),ie=input_toSend.end();i!=ie;++i) {
-        size_t cursize=i->chunk->size();
-        bufs.push_back(boost::asio::buffer(&*i->chunk->begin(),cursize));
-        total_size+=cursize;
-        if( cursize) {
-            BufferPrint(this,".buw",&*i->chunk->begin(),cursize);
+    size_t offset=mToSendOffset;
+    for (std::deque<TimestampedChunk>::const_iterator i=mToSend.begin(),ie=mToSend.end();
+         i!=ie&&bufs.size()<SEND_MAX_BUFFERS_PER_CALL&&total_size<SEND_MAX_BYTES_PER_CALL;
+         ++i) {
+        size_t cursize=i->size()-offset;
+        if (cursize) {
+            if (total_size+cursize>SEND_MAX_BYTES_PER_CALL)
+                cursize=SEND_MAX_BYTES_PER_CALL-total_size;
+            bufs.push_back(boost::asio::buffer(&*i->chunk->begin()+offset,cursize));
+            total_size+=cursize;
+            BufferPrint(this,".buw",&*i->chunk->begin()+offset,cursize);
         }
+        offset=0;
     }
-    mToSend.swap(input_toSend);
     mOutstandingDataParent=parentMultiSocket;//keep parent alive until send finishes
-    boost::asio::async_write(*mSocket,
-                            bufs,
-                            boost::asio::transfer_at_least(total_size),
-                             mSendManyDequeItems);
-
+    //a single write, rather than async_write, so each completion tells us what one call to the socket managed
+    mSocket->async_write_some(bufs,
+                              mSendManyDequeItems);
 }
-#undef ASIOSocketWrapperBuffer
 void ASIOSocketWrapper::retryQueuedSend(const MultiplexedSocketPtr&parentMultiSocket, uint32 current_status) {
     bool queue_check=(current_status&QUEUE_CHECK_FLAG)!=0;
     bool sending_packet=(current_status&ASYNCHRONOUS_SEND_FLAG)!=0;
@@ -592,4 +620,18 @@ Duration ASIOSocketWrapper::averageReceiveLatency() const {
     return Duration::zero();
 }
 
+float ASIOSocketWrapper::averageSendBytesPerCall() const {
+    uint64 calls=mSendCalls;
+    if (calls==0)
+        return 0.f;
+    return (float)mSendBytes/(float)calls;
+}
+
+float ASIOSocketWrapper::averageReceiveBytesPerCompletion() const {
+    uint64 completions=mReceiveCompletions;
+    if (completions==0)
+        return 0.f;
+    return (float)mReceiveBytes/(float)completions;
+}
+
 } }
@@ -36,6 +36,10 @@
 #include <sirikata/core/network/IOStrand.hpp>
 
 #define SEND_LATENCY_EWA_ALPHA .10f
+// Limits on how much a single write to the socket may cover, so one call
+// doesn't pin an unbounded number of chunks
+#define SEND_MAX_BUFFERS_PER_CALL 64
+#define SEND_MAX_BYTES_PER_CALL (256*1024)
 
 namespace Sirikata { namespace Network {
 class ASIOSocketWrapper;
@@ -88,7 +92,19 @@ class ASIOSocketWrapper {
     EWA<Duration> mAverageSendLatency;
 
     std::vector<Stream::StreamID> mPausedSendStreams;
+    /**
+     * Chunks handed to the socket and not yet completely written, in order. The first
+     * mToSendOffset bytes of the first chunk have already been written.
+     */
     std::deque<TimestampedChunk> mToSend;
+    size_t mToSendOffset;
+    // Number of writes issued to the socket and the bytes they covered
+    uint64 mSendCalls;
+    uint64 mSendBytes;
+    // Number of receive completions handled by the read buffer and the bytes
+    // they read
+    uint64 mReceiveCompletions;
+    uint64 mReceiveBytes;
     std::tr1::weak_ptr<MultiplexedSocket>mParent;
     std::tr1::shared_ptr<MultiplexedSocket>mOutstandingDataParent;
     /** Call this any time a chunk finishes being sent so statistics can be collected. */
@@ -105,9 +121,9 @@ class ASIOSocketWrapper {
     void finishAsyncSend(const MultiplexedSocketPtr&parentMultiSocket);
 
     /**
-     * The callback for when a single large Chunk at the front of a chunk deque was sent.
-     * If the whole large Chunk was not sent then the rest of the Chunk is passed back to sendToWire
-     * If the whole Chunk was shipped off, the sendToWire function is called with the rest of the queue unless it is empty in which case the finishAsyncSend is called
+     * The callback for when a write of the front of mToSend finishes.
+     * Chunks which were completely written are freed. If anything in mToSend is left, because the write was partial
+     * or capped, the rest is written with sendQueuedChunks, otherwise finishAsyncSend is called
      */
     void sendManyDequeItems(const std::tr1::weak_ptr<MultiplexedSocket>&parentMultiSocket, const ErrorCode &error, std::size_t bytes_sent);
 
@@ -118,10 +134,16 @@ class ASIOSocketWrapper {
 
 /**
  *  This function sends a while queue of packets to the network
- * The function sends each item using a vector of asio::buffers made from the passed in deque
+ * The items are moved onto mToSend and written directly out of their Chunks with sendQueuedChunks
  */
     void sendToWire(const MultiplexedSocketPtr&parentMultiSocket, std::deque<TimestampedChunk>&const_toSend);
 
+/**
+ * Issues a single gather write to the socket covering as much of mToSend as allowed by
+ * SEND_MAX_BUFFERS_PER_CALL and SEND_MAX_BYTES_PER_CALL
+ */
+    void sendQueuedChunks(const MultiplexedSocketPtr&parentMultiSocket);
+
 /**
  * If another thread claimed to be sending data asynchronously
  * This function checks to see if the send is still proceeding after the queue push
@@ -141,6 +163,11 @@ public:
        mSendingStatus(0),
        mSendQueue(SizedResourceMonitor(queuedBufferSize)),
        mAverageSendLatency(SEND_LATENCY_EWA_ALPHA),
+       mToSendOffset(0),
+       mSendCalls(0),
+       mSendBytes(0),
+       mReceiveCompletions(0),
+       mReceiveBytes(0),
        mParent(parent)
     {
         //mPacketLogger.reserve(268435456);
@@ -152,7 +179,12 @@ public:
        mReadBuffer(NULL),
        mSendingStatus(0),
        mSendQueue(socket.getResourceMonitor()),
-       mAverageSendLatency(SEND_LATENCY_EWA_ALPHA)
+       mAverageSendLatency(SEND_LATENCY_EWA_ALPHA),
+       mToSendOffset(0),
+       mSendCalls(0),
+       mSendBytes(0),
+       mReceiveCompletions(0),
+       mReceiveBytes(0)
     {
         MultiplexedSocketPtr parent(socket.mParent.lock());
         mParent=parent;
@@ -165,6 +197,11 @@ public:
        mSendingStatus(0),
        mSendQueue(SizedResourceMonitor(queuedBufferSize)),
        mAverageSendLatency(SEND_LATENCY_EWA_ALPHA),
+       mToSendOffset(0),
+       mSendCalls(0),
+       mSendBytes(0),
+       mReceiveCompletions(0),
+       mReceiveBytes(0),
        mParent(parent)
     {
         bindFunctions(parent);
@@ -241,6 +278,15 @@ public:
     // -- Statistics
     Duration averageSendLatency() const;
     Duration averageReceiveLatency() const;
+    float averageSendBytesPerCall() const;
+    float averageReceiveBytesPerCompletion() const;
+    /** Called by the read buffer for each completed receive, which may have
+     *  covered several reads from the socket.
+     */
+    void recordReceiveCompletion(std::size_t bytes_read) {
+        mReceiveCompletions++;
+        mReceiveBytes+=bytes_read;
+    }
     //converts 3 arrays into a contiguous array of base64 numbers, delimited with a '\0' at the end.
     static Chunk* toBase64ZeroDelim(const MemoryReference&a, const MemoryReference&b, const MemoryReference&c, const MemoryReference *bytesToPrependUnencoded=NULL);
     ///makes sure the UUID only consists of unicode-allowed characters and has no null values inside
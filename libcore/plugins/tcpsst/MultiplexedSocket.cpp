@@ -543,5 +543,27 @@ Duration MultiplexedSocket::averageReceiveLatency() const {
     return avg / (float)nsockets;
 }
 
+float MultiplexedSocket::averageSendBytesPerCall() const {
+    float avg = 0.f;
+
+    uint32 nsockets = (uint32)mSockets.size();
+    for(uint32 ii = 0; ii < nsockets; ++ii) {
+        avg += mSockets[ii].averageSendBytesPerCall();
+    }
+
+    return avg / (float)nsockets;
+}
+
+float MultiplexedSocket::averageReceiveBytesPerCompletion() const {
+    float avg = 0.f;
+
+    uint32 nsockets = (uint32)mSockets.size();
+    for(uint32 ii = 0; ii < nsockets; ++ii) {
+        avg += mSockets[ii].averageReceiveBytesPerCompletion();
+    }
+
+    return avg / (float)nsockets;
+}
+
 } // namespace Network
 } // namespace Sirikata
@@ -312,7 +312,9 @@ public:
 
     // -- Statistics
     Duration averageSendLatency() const;
+    float averageSendBytesPerCall() const;
     Duration averageReceiveLatency() const;
+    float averageReceiveBytesPerCompletion() const;
 };
 
 } // namespace Network
@@ -45,6 +45,7 @@
 #include <boost/thread.hpp>
 namespace Sirikata { namespace Network {
 int TCPStream::sFragmentPackets=0;
+int TCPStream::sReadBatchSize=0;
 using namespace boost::asio::ip;
 TCPStream::TCPStream(const MultiplexedSocketPtr&shared_socket,const Stream::StreamID&sid):mSocket(shared_socket),mID(sid),mSendStatus(new AtomicValue<int>(0)) {
     mNumSimultaneousSockets=shared_socket->numSockets();
@@ -70,6 +71,14 @@ Duration TCPStream::averageReceiveLatency() const {
     return mSocket->averageReceiveLatency();
 }
 
+float TCPStream::averageSendBytesPerCall() const {
+    return mSocket->averageSendBytesPerCall();
+}
+
+float TCPStream::averageReceiveBytesPerCompletion() const {
+    return mSocket->averageReceiveBytesPerCompletion();
+}
+
 void TCPStream::readyRead() {
     MultiplexedSocketPtr socket_copy = mSocket;
     if (socket_copy.get() == NULL) {
@@ -366,6 +375,10 @@ TCPStream::TCPStream(IOStrand* io,OptionSet*options):mSendStatus(new AtomicValue
     if (fragmentPackets->as<int>()!=-1) {
         sFragmentPackets = fragmentPackets->as<int>();
     }
+    OptionValue *readBatchSize=options->referenceOption("read-batch-size");
+    if (readBatchSize->as<int>()!=-1) {
+        sReadBatchSize = readBatchSize->as<int>();
+    }
     assert(numSimultSockets&&sendBufferSize);
     mNumSimultaneousSockets=(unsigned char)numSimultSockets->as<unsigned int>();
     assert(mNumSimultaneousSockets);
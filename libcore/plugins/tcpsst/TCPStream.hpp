@@ -113,6 +113,8 @@ public:
     };
     //if !=0 and type is RFC_6455, arbitrarily fragment packets 2 indicates more aggressive testing of fragmentation than 1 (testing option)
     static int sFragmentPackets;
+    //if !=0, wait for the socket to become readable and then read up to this many times per wakeup, processing each read as it completes, instead of issuing one async_receive per read
+    static int sReadBatchSize;
 private:
     friend class MultiplexedSocket;
     friend class TCPSetCallbacks;
@@ -215,6 +217,8 @@ public:
 
     virtual Duration averageSendLatency() const;
     virtual Duration averageReceiveLatency() const;
+    virtual float averageSendBytesPerCall() const;
+    virtual float averageReceiveBytesPerCompletion() const;
 };
 
 } // namespace Network
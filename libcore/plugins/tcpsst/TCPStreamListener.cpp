@@ -158,6 +158,10 @@ bool TCPStreamListener::listen (const Address&address,
     if (fragmentPackets->as<int>()!=-1) {
         TCPStream::sFragmentPackets = fragmentPackets->as<int>();
     }
+    OptionValue *readBatchSize = mOptions->referenceOption("read-batch-size");
+    if (readBatchSize->as<int>()!=-1) {
+        TCPStream::sReadBatchSize = readBatchSize->as<int>();
+    }
 
     assert(maxSimultSockets && sendBufferSize);
     DataPtr data (new Data(mStrand,
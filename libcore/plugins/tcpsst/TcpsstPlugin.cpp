@@ -51,6 +51,7 @@ static OptionSet*optionParser(const String&str) {
     OptionValue *zeroDelim=new OptionValue("base64","false",OptionValueType<bool>(),"True if the stream should be base64 (eg javascript compat)");
     OptionValue *oldWebsocket=new OptionValue("websocket-draft-76","false",OptionValueType<bool>(),"True if the stream should be websocket draft-76. False for RFC 6455");
     OptionValue *testFragmentPackets=new OptionValue("test-fragment-packet-level","-1",OptionValueType<int>(),"1 if packets should be fragmented at regular intervals in order to test the browser fragmentation. 2 if packets should be aggressively fragmented. 0 to explicitly disable fragmentation of packets. Option affects option globally for the duration of the run.");
+    OptionValue *readBatchSize=new OptionValue("read-batch-size","-1",OptionValueType<int>(),"If greater than 0, sockets wait until they are readable and then drain up to this many reads per wakeup, delivering every packet from them in one pass, rather than issuing a separate async receive per read. 0 to explicitly use one async receive per read. Option affects sockets created after it is set for the duration of the run.");
 
     InitializeClassOptions("tcpsstoptions",numSockets,
                      numSockets,
@@ -62,6 +63,7 @@ static OptionSet*optionParser(const String&str) {
                      kSendBufferSize,
                      kReceiveBufferSize,
                      testFragmentPackets,
+                     readBatchSize,
                      NULL);
     OptionSet*retval=OptionSet::getOptions("tcpsstoptions",numSockets);
     retval->parse(str);
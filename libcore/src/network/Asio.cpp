@@ -72,6 +72,11 @@ InternalIOStrand::InternalIOStrand(IOService* io)
 {
 }
 
+InternalIOStrand::InternalIOStrand(InternalIOService &io)
+ : boost::asio::io_service::strand(io)
+{
+}
+
 
 TCPSocket::TCPSocket(IOService&io):
     boost::asio::ip::tcp::socket(io.asioService())
@@ -58,22 +58,54 @@ std::string Frame::write(const std::string& data) {
 std::string Frame::parse(std::string& data) {
     std::string result;
 
-    if (data.size() < sizeof(uint32)) return result;
+    MemoryReference frame = MemoryReference::null();
+    uint32 consumed = peek(data.data(), data.size(), &frame);
+    if (consumed == 0) return result;
+
+    // Extract it
+    result.assign((const char*)frame.data(), frame.size());
+    // Remove it
+    data.erase(0, consumed);
+
+    return result;
+}
+
+uint32 Frame::peek(const void* data, uint32 len, MemoryReference* frame) {
+    if (len < sizeof(uint32)) return 0;
 
     // Try to parse the length
-    uint32 len;
-    memcpy(&len, &(data[0]), sizeof(uint32));
-    len = ntohl(len);
+    uint32 frame_len;
+    memcpy(&frame_len, data, sizeof(uint32));
+    frame_len = ntohl(frame_len);
 
     // Make sure we have the full packet
-    if (data.size() < sizeof(uint32) + len) return result;
+    if (len - sizeof(uint32) < frame_len) return 0;
 
-    // Extract it
-    result = data.substr(sizeof(uint32), len);
-    // Remove it
-    data = data.substr(sizeof(uint32) + len);
+    *frame = MemoryReference((const char*)data + sizeof(uint32), frame_len);
+    return sizeof(uint32) + frame_len;
+}
 
-    return result;
+
+FrameReader::FrameReader()
+ : mCursor(0)
+{
+}
+
+void FrameReader::append(const void* data, uint32 len) {
+    // Only compact when the consumed prefix is at least half the buffer, so
+    // each byte is moved at most a constant number of times on average.
+    if (mCursor > 0 && mCursor >= mBuffer.size() - mCursor) {
+        mBuffer.erase(0, mCursor);
+        mCursor = 0;
+    }
+    mBuffer.append((const char*)data, len);
+}
+
+bool FrameReader::next(MemoryReference* frame) {
+    uint32 consumed = Frame::peek(mBuffer.data() + mCursor, size(), frame);
+    if (consumed == 0) return false;
+    mCursor += consumed;
+    return true;
 }
 
 } // namespace Network
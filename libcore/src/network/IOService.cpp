@@ -40,6 +40,14 @@
 #include <sirikata/core/util/Timer.hpp>
 #include <sirikata/core/command/Commander.hpp>
 
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#endif
+
 namespace Sirikata {
 namespace Network {
 
@@ -64,9 +72,177 @@ AllIOServicesSet gAllIOServices;
 } // namespace
 #endif
 
+struct IOService::RunQueues {
+    RunQueues(uint32 nqueues)
+     : nextRunner(0),
+       nextStrand(0),
+       runners(0),
+       idleRunners(0),
+       pending(0),
+       pendingWork(NULL),
+       stopRequested(false),
+       stolen(0)
+    {
+        for(uint32 i = 0; i < nqueues; i++) {
+            queues.push_back(new InternalIOService(1));
+            // Run queues only ever see strand handlers, and running out of
+            // those doesn't mean the service is done, so they never stop on
+            // their own
+            queueWork.push_back(new InternalIOService::work(*queues.back()));
+        }
+    }
+
+    ~RunQueues() {
+        delete pendingWork;
+        for(uint32 i = 0; i < queues.size(); i++) {
+            delete queueWork[i];
+            delete queues[i];
+        }
+    }
+
+    std::vector<InternalIOService*> queues;
+    std::vector<InternalIOService::work*> queueWork;
+
+    // Assign home queues to threads calling run() and to new strands
+    AtomicValue<uint32> nextRunner;
+    AtomicValue<uint32> nextStrand;
+    // Threads in run(), and those blocked waiting on the shared queue
+    AtomicValue<uint32> runners;
+    AtomicValue<uint32> idleRunners;
+
+    // Strand handlers queued but not yet executed. While there are any,
+    // pendingWork keeps the shared queue from running out of work.
+    AtomicValue<uint32> pending;
+    boost::mutex pendingMutex;
+    InternalIOService::work* pendingWork;
+
+    AtomicValue<bool> stopRequested;
+    AtomicValue<uint32> stolen;
+};
+
+struct IOService::StrandLatencyShard {
+    typedef std::pair<const String*, const char*> Key;
+    typedef std::map<Key, Trace::LatencyHistogram> HistogramMap;
+
+    StrandLatencyShard()
+     : lastHistogram(NULL)
+    {}
+
+    // Owning thread only. Handlers from one strand tend to run back to back,
+    // so the last histogram used is cached and the map is only searched when
+    // the strand or tag changes. Entries are never removed, so the cached
+    // pointer stays valid.
+    Trace::LatencyHistogram* histogram(const Key& key) {
+        if (lastHistogram != NULL && key == lastKey)
+            return lastHistogram;
+        HistogramMap::iterator it = histograms.find(key);
+        if (it == histograms.end()) {
+            boost::lock_guard<boost::mutex> lock(mutex);
+            it = histograms.insert(std::make_pair(key, Trace::LatencyHistogram())).first;
+        }
+        lastKey = key;
+        lastHistogram = &it->second;
+        return lastHistogram;
+    }
+
+    // Held while adding histograms and while collecting stats. Samples are
+    // recorded without it, so stats collected while handlers are running may
+    // miss the samples being recorded at the time.
+    boost::mutex mutex;
+    HistogramMap histograms;
+
+    Key lastKey;
+    Trace::LatencyHistogram* lastHistogram;
+};
+
+// A queued strand handler, with what's needed to record its queueing latency
+// and, with multiple run queues, to stop counting it once it has run. Keeping
+// all of it in one wrapper means a handler is only wrapped once when queued.
+struct IOService::StrandHandler {
+    StrandHandler(IOService* _service, const String* _key, const char* _tag, uint64 _start_us, const IOCallback& _handler, bool _counted)
+     : service(_service),
+       key(_key),
+       tag(_tag),
+       start_us(_start_us),
+       handler(_handler),
+       counted(_counted)
+    {}
+
+    void operator()() const {
+        service->recordLatency(key, tag, start_us);
+        handler();
+        if (counted)
+            service->finishRunCounted();
+    }
+
+    IOService* service;
+    const String* key;
+    const char* tag;
+    uint64 start_us;
+    IOCallback handler;
+    bool counted;
+};
+
+namespace {
+void wakeRunner() {
+}
+
+// Handlers a runner takes from one queue before moving on, so a busy strand
+// can't hold off IO, timers or other strands
+const uint32 RunQueueBatch = 16;
+
+uint32 pollAtMost(InternalIOService* svc, uint32 max) {
+    uint32 count = 0;
+    while(count < max && svc->poll_one() > 0)
+        count++;
+    return count;
+}
+
+// Each thread's latency shards, by IOService. Shards are owned by their
+// IOService and IDs are never reused, so entries left behind by destroyed
+// services are never looked up again. Most threads only run one IOService, so
+// the last shard used is cached.
+struct ThreadLatencyShards {
+    ThreadLatencyShards()
+     : lastID(0),
+       lastShard(NULL)
+    {}
+
+    typedef std::tr1::unordered_map<uint32, void*> ShardMap;
+    ShardMap shards;
+    uint32 lastID;
+    void* lastShard;
+};
+boost::thread_specific_ptr<ThreadLatencyShards> gThreadLatencyShards;
+// IDs start at 1 so 0 never matches ThreadLatencyShards::lastID
+AtomicValue<uint32> gNextLatencyID(0);
+
+// Queueing latencies are differences between two readings, so they use a
+// clock that doesn't jump when the system time is adjusted
+uint64 monotonicMicroseconds() {
+#ifdef _WIN32
+    LARGE_INTEGER freq, now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (uint64)(now.QuadPart / freq.QuadPart) * 1000000 +
+        (uint64)(now.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart;
+#elif defined(__APPLE__)
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0)
+        mach_timebase_info(&timebase);
+    return mach_absolute_time() * timebase.numer / timebase.denom / 1000;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+} // namespace
 
-IOService::IOService(const String& name)
- : mName(name)
+IOService::IOService(const String& name, uint32 run_queues)
+ : mName(name),
+   mRunQueues(NULL),
+   mLatencyID(++gNextLatencyID)
 #ifdef SIRIKATA_TRACK_EVENT_QUEUES
    ,
    mTimersEnqueued(0),
@@ -77,6 +253,8 @@ IOService::IOService(const String& name)
 #endif
 {
     mImpl = new boost::asio::io_service(1);
+    if (run_queues > 1)
+        mRunQueues = new RunQueues(run_queues);
 
 #ifdef SIRIKATA_TRACK_EVENT_QUEUES
     AllIOServicesLockGuard lock(gAllIOServicesMutex);
@@ -85,6 +263,12 @@ IOService::IOService(const String& name)
 }
 
 IOService::~IOService(){
+    if (mRunQueues) {
+        SILOG(ioservice, detailed, "'" << name() << "' IOService stole " << mRunQueues->stolen.read() << " handlers across " << mRunQueues->queues.size() << " run queues");
+        delete mRunQueues;
+    }
+    for(std::vector<StrandLatencyShard*>::iterator it = mLatencyShards.begin(); it != mLatencyShards.end(); it++)
+        delete *it;
     delete mImpl;
 
 #ifdef SIRIKATA_TRACK_EVENT_QUEUES
@@ -102,34 +286,223 @@ IOStrand* IOService::createStrand(const String& name) {
     return res;
 }
 
+InternalIOService& IOService::strandService() {
+    if (!mRunQueues)
+        return *mImpl;
+    uint32 idx = (++mRunQueues->nextStrand - 1) % mRunQueues->queues.size();
+    return *(mRunQueues->queues[idx]);
+}
+
 uint32 IOService::pollOne() {
+    if (mRunQueues) {
+        if (mImpl->poll_one() > 0) return 1;
+        for(uint32 i = 0; i < mRunQueues->queues.size(); i++)
+            if (mRunQueues->queues[i]->poll_one() > 0) return 1;
+        return 0;
+    }
     return (uint32) mImpl->poll_one();
 }
 
 uint32 IOService::poll() {
+    if (mRunQueues)
+        return (uint32) mImpl->poll() + pollQueues();
     return (uint32) mImpl->poll();
 }
 
 uint32 IOService::runOne() {
+    if (mRunQueues) {
+        uint32 count = pollOne();
+        if (count > 0) return count;
+    }
     return (uint32) mImpl->run_one();
 }
 
 uint32 IOService::run() {
+    if (mRunQueues)
+        return runQueues();
     return (uint32) mImpl->run();
 }
 
 void IOService::runNoReturn() {
-    mImpl->run();
+    run();
 }
 
 void IOService::stop() {
+    if (mRunQueues) {
+        mRunQueues->stopRequested = true;
+        for(uint32 i = 0; i < mRunQueues->queues.size(); i++)
+            mRunQueues->queues[i]->stop();
+    }
     mImpl->stop();
 }
 
 void IOService::reset() {
+    if (mRunQueues) {
+        for(uint32 i = 0; i < mRunQueues->queues.size(); i++)
+            mRunQueues->queues[i]->reset();
+        mRunQueues->stopRequested = false;
+    }
     mImpl->reset();
 }
 
+uint32 IOService::pollQueues() {
+    uint32 count = 0;
+    for(uint32 i = 0; i < mRunQueues->queues.size(); i++)
+        count += (uint32) mRunQueues->queues[i]->poll();
+    return count;
+}
+
+uint32 IOService::stealOne(uint32 home) {
+    uint32 nqueues = mRunQueues->queues.size();
+    for(uint32 i = 1; i < nqueues; i++) {
+        if (mRunQueues->queues[(home + i) % nqueues]->poll_one() > 0) {
+            mRunQueues->stolen++;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+uint32 IOService::runQueues() {
+    RunQueues* rq = mRunQueues;
+    uint32 home = (++rq->nextRunner - 1) % rq->queues.size();
+    InternalIOService* own = rq->queues[home];
+    rq->runners++;
+
+    uint32 count = 0;
+    while(!rq->stopRequested.read()) {
+        // Prefer our own strands, then IO and timers, and only take work
+        // from other threads when there's nothing else to do
+        uint32 ran = pollAtMost(own, RunQueueBatch);
+        ran += pollAtMost(mImpl, RunQueueBatch);
+        if (ran == 0)
+            ran = stealOne(home);
+        if (ran == 0) {
+            // Nothing runnable, block until IO completes, a timer fires or
+            // notifyRunQueued wakes us up because a strand handler was
+            // queued. We count ourselves idle *before* checking the run queues
+            // one last time, and the increment is a full barrier, so a handler
+            // queued after that check sees us and posts a wakeup, and one
+            // queued before it is found here.
+            rq->idleRunners++;
+            ran = (uint32) own->poll_one();
+            if (ran == 0)
+                ran = stealOne(home);
+            if (ran == 0)
+                ran = (uint32) mImpl->run_one();
+            rq->idleRunners--;
+        }
+        count += ran;
+        if (ran > 0)
+            continue;
+
+        // The shared queue ran out of work, so all other threads are on
+        // their way out as well. Strand handlers dispatched directly from IO
+        // completions aren't counted as work, so the last thread out makes
+        // sure none are left behind, picking up again if running them
+        // generated more work.
+        if (--rq->runners > 0)
+            return count;
+        uint32 remaining = pollQueues();
+        if (remaining == 0 || rq->stopRequested.read())
+            return count + remaining;
+        count += remaining;
+        mImpl->reset();
+        rq->runners++;
+    }
+    rq->runners--;
+    return count;
+}
+
+IOCallback IOService::countRunQueued(const IOCallback& handler) {
+    startRunCounted();
+    return std::tr1::bind(&IOService::runCounted, this, handler);
+}
+
+void IOService::runCounted(const IOCallback& handler) {
+    handler();
+    finishRunCounted();
+}
+
+void IOService::startRunCounted() {
+    if (++mRunQueues->pending == 1)
+        updatePendingWork();
+}
+
+void IOService::finishRunCounted() {
+    if (--mRunQueues->pending == 0)
+        updatePendingWork();
+}
+
+void IOService::updatePendingWork() {
+    // Only transitions to and from 0 pending handlers get here, and the
+    // counter is rechecked under the lock, so racing transitions always
+    // leave the work in the state matching the latest count
+    boost::mutex::scoped_lock lock(mRunQueues->pendingMutex);
+    uint32 pending = mRunQueues->pending.read();
+    if (pending > 0 && mRunQueues->pendingWork == NULL) {
+        mRunQueues->pendingWork = new InternalIOService::work(*mImpl);
+    }
+    else if (pending == 0 && mRunQueues->pendingWork != NULL) {
+        delete mRunQueues->pendingWork;
+        mRunQueues->pendingWork = NULL;
+    }
+}
+
+const String* IOService::strandLatencyKey(const String& strand_name) {
+    boost::lock_guard<boost::mutex> lock(mLatencyMutex);
+    return &(*mStrandLatencyNames.insert(strand_name).first);
+}
+
+IOCallback IOService::wrapStrandHandler(const String* strand_key, const IOCallback& handler, const char* tag) {
+    bool counted = (mRunQueues != NULL);
+    if (counted)
+        startRunCounted();
+    return StrandHandler(this, strand_key, tag, monotonicMicroseconds(), handler, counted);
+}
+
+void IOService::recordLatency(const String* strand_key, const char* tag, uint64 start_us) {
+    uint64 now_us = monotonicMicroseconds();
+    threadLatencyShard()->histogram(StrandLatencyShard::Key(strand_key, tag))->sample(
+        Duration::microseconds((int64)(now_us - start_us))
+    );
+}
+
+IOService::StrandLatencyShard* IOService::threadLatencyShard() {
+    ThreadLatencyShards* shards = gThreadLatencyShards.get();
+    if (shards == NULL) {
+        shards = new ThreadLatencyShards();
+        gThreadLatencyShards.reset(shards);
+    }
+    if (shards->lastID == mLatencyID)
+        return static_cast<StrandLatencyShard*>(shards->lastShard);
+
+    StrandLatencyShard* shard = NULL;
+    ThreadLatencyShards::ShardMap::iterator it = shards->shards.find(mLatencyID);
+    if (it != shards->shards.end()) {
+        shard = static_cast<StrandLatencyShard*>(it->second);
+    }
+    else {
+        shard = new StrandLatencyShard();
+        {
+            boost::lock_guard<boost::mutex> lock(mLatencyMutex);
+            mLatencyShards.push_back(shard);
+        }
+        shards->shards[mLatencyID] = shard;
+    }
+    shards->lastID = mLatencyID;
+    shards->lastShard = shard;
+    return shard;
+}
+
+void IOService::notifyRunQueued() {
+    // Pairs with the increment in runQueues: the handler must be visible in
+    // its queue before we check for idle runners
+    memory_barrier();
+    if (mRunQueues->idleRunners.read() > 0)
+        mImpl->post(&wakeRunner);
+}
+
 #ifdef SIRIKATA_TRACK_EVENT_QUEUES
 IOCallback IOService::tracking_wrapper(const IOCallback& handler, const char* tag, const char* tagStat) {
     mEnqueued++;
@@ -420,6 +793,45 @@ void IOService::fillCommandResultWithStats(Command::Result& res) {
 }
 #endif
 
+void IOService::fillCommandResultWithStrandLatency(Command::Result& res) {
+    // Merge all threads' shards, combining strands and tags by name
+    typedef std::map<std::pair<String, String>, Trace::LatencyHistogram> MergedHistogramMap;
+    MergedHistogramMap merged;
+    {
+        boost::lock_guard<boost::mutex> lock(mLatencyMutex);
+        for(std::vector<StrandLatencyShard*>::iterator shard_it = mLatencyShards.begin(); shard_it != mLatencyShards.end(); shard_it++) {
+            boost::lock_guard<boost::mutex> shard_lock((*shard_it)->mutex);
+            StrandLatencyShard::HistogramMap& hists = (*shard_it)->histograms;
+            for(StrandLatencyShard::HistogramMap::iterator it = hists.begin(); it != hists.end(); it++) {
+                String tag = (it->first.second == NULL) ? "(NULL)" : it->first.second;
+                merged[std::make_pair(*(it->first.first), tag)].merge(it->second);
+            }
+        }
+    }
+
+    res.put("name", name());
+    res.put("strands", Command::Array());
+    Command::Array& strands = res.getArray("strands");
+    for(MergedHistogramMap::iterator it = merged.begin(); it != merged.end(); it++) {
+        const Trace::LatencyHistogram& hist = it->second;
+        strands.push_back(Command::Object());
+        strands.back().put("name", it->first.first);
+        strands.back().put("tag", it->first.second);
+        strands.back().put("count", (boost::uint64_t)hist.count());
+        strands.back().put("latency.average", hist.average().toString());
+        strands.back().put("latency.p50", hist.percentile(0.5).toString());
+        strands.back().put("latency.p90", hist.percentile(0.9).toString());
+        strands.back().put("latency.p99", hist.percentile(0.99).toString());
+        strands.back().put("latency.max", hist.max().toString());
+    }
+}
+
+void IOService::commandStrandStats(const Command::Command& cmd, Command::Commander* cmdr, Command::CommandID cmdid) {
+    Command::Result result = Command::EmptyResult();
+    fillCommandResultWithStrandLatency(result);
+    cmdr->result(cmdid, result);
+}
+
 void IOService::commandReportStats(const Command::Command& cmd, Command::Commander* cmdr, Command::CommandID cmdid) {
 #ifdef SIRIKATA_TRACK_EVENT_QUEUES
     AllIOServicesLockGuard lock(gAllIOServicesMutex);
@@ -41,7 +41,8 @@ namespace Network {
 
 IOStrand::IOStrand(IOService& io, const String& name)
  : mService(io),
-   mName(name)
+   mName(name),
+   mLatencyKey(io.strandLatencyKey(name))
 #ifdef SIRIKATA_TRACK_EVENT_QUEUES
    ,
    mTimersEnqueued(0),
@@ -50,7 +51,7 @@ IOStrand::IOStrand(IOService& io, const String& name)
    mWindowedHandlerLatencyStats(100)
 #endif
 {
-    mImpl = new InternalIOStrand(io);
+    mImpl = new InternalIOStrand(io.strandService());
 }
 
 IOStrand::~IOStrand() {
@@ -66,6 +67,7 @@ IOService& IOStrand::service() const {
 
 void IOStrand::dispatch(const IOCallback& handler, const char* tag) {
     assert(handler);
+    IOCallback wrapped = mService.wrapStrandHandler(mLatencyKey, handler, tag);
 #ifdef SIRIKATA_TRACK_EVENT_QUEUES
     mEnqueued++;
     {
@@ -74,19 +76,23 @@ void IOStrand::dispatch(const IOCallback& handler, const char* tag) {
             mTagCounts[tag] = 0;
         mTagCounts[tag]++;
     }
-    mImpl->dispatch(
-        mService.tracking_wrapper(
-            std::tr1::bind(&IOStrand::decrementCount, this, Timer::now(), handler, tag),
-            "(IOStrands)",tag
-        )
+    IOCallback tracked = mService.tracking_wrapper(
+        std::tr1::bind(&IOStrand::decrementCount, this, Timer::now(), wrapped, tag),
+        "(IOStrands)",tag
     );
+    mImpl->dispatch( tracked );
+    if (mService.mRunQueues)
+        mService.notifyRunQueued();
 #else
-    mImpl->dispatch( handler );
+    mImpl->dispatch( wrapped );
+    if (mService.mRunQueues)
+        mService.notifyRunQueued();
 #endif
 }
 
 void IOStrand::post(const IOCallback& handler, const char* tag) {
     assert(handler);
+    IOCallback wrapped = mService.wrapStrandHandler(mLatencyKey, handler, tag);
 #ifdef SIRIKATA_TRACK_EVENT_QUEUES
     mEnqueued++;
     {
@@ -95,14 +101,17 @@ void IOStrand::post(const IOCallback& handler, const char* tag) {
             mTagCounts[tag] = 0;
         mTagCounts[tag]++;
     }
-    mImpl->post(
-        mService.tracking_wrapper(
-            std::tr1::bind(&IOStrand::decrementCount, this, Timer::now(), handler, tag),
-            "(IOStrands)", tag
-        )
+    IOCallback tracked = mService.tracking_wrapper(
+        std::tr1::bind(&IOStrand::decrementCount, this, Timer::now(), wrapped, tag),
+        "(IOStrands)", tag
     );
+    mImpl->post( tracked );
+    if (mService.mRunQueues)
+        mService.notifyRunQueued();
 #else
-    mImpl->post( handler );
+    mImpl->post( wrapped );
+    if (mService.mRunQueues)
+        mService.notifyRunQueued();
 #endif
 }
 
@@ -116,17 +125,23 @@ void IOStrand::post(const Duration& waitFor, const IOCallback& handler, const ch
             mTagCounts[tag] = 0;
         mTagCounts[tag]++;
     }
+    IOCallback tracked = std::tr1::bind(&IOStrand::decrementTimerCount, this, Timer::now(), waitFor, handler, tag);
+    if (mService.mRunQueues)
+        tracked = mService.countRunQueued(tracked);
     mService.post(
         waitFor,
-        mImpl->wrap(
-            std::tr1::bind(&IOStrand::decrementTimerCount, this, Timer::now(), waitFor, handler, tag)
-        ),
+        mImpl->wrap(tracked),
         "(IOStrands)",tag
     );
 #else
     // This is fine because the timeout means we don't have any ordering
-    // constraints, so we can post through the service.
-    mService.post(waitFor, mImpl->wrap( handler ), "(IOStrands)", tag);
+    // constraints, so we can post through the service. With multiple run
+    // queues the handler still has to be counted since the strand will
+    // forward it to its own queue when the timer fires.
+    if (mService.mRunQueues)
+        mService.post(waitFor, mImpl->wrap( mService.countRunQueued(handler) ), "(IOStrands)", tag);
+    else
+        mService.post(waitFor, mImpl->wrap( handler ), "(IOStrands)", tag);
 #endif
 }
 
@@ -86,5 +86,232 @@ Sirikata::Protocol::Object::ObjectMessage* createObjectMessage(ServerID source_s
 }
 
 
+namespace {
+
+// Protocol buffers wire format, enough to find and skip fields
+enum WireType {
+    WireTypeVarint = 0,
+    WireTypeFixed64 = 1,
+    WireTypeLengthDelimited = 2,
+    WireTypeFixed32 = 5
+};
+
+struct WireField {
+    uint32 number;
+    uint32 wireType;
+    // Value of numeric fields
+    uint64 value;
+    // Contents of length delimited fields
+    const uint8* data;
+    uint32 length;
+};
+
+bool readVarint(const uint8*& pos, const uint8* end, uint64* value_out) {
+    uint64 result = 0;
+    for(uint32 shift = 0; shift < 64 && pos < end; shift += 7) {
+        uint8 b = *pos++;
+        result |= ((uint64)(b & 0x7F)) << shift;
+        if ((b & 0x80) == 0) {
+            *value_out = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool readFixed(const uint8*& pos, const uint8* end, uint32 nbytes, uint64* value_out) {
+    if ((uint32)(end - pos) < nbytes) return false;
+    uint64 result = 0;
+    for(uint32 i = 0; i < nbytes; i++)
+        result |= ((uint64)pos[i]) << (8*i);
+    pos += nbytes;
+    *value_out = result;
+    return true;
+}
+
+bool readField(const uint8*& pos, const uint8* end, WireField* field_out) {
+    uint64 key;
+    if (!readVarint(pos, end, &key)) return false;
+    field_out->number = (uint32)(key >> 3);
+    field_out->wireType = (uint32)(key & 0x7);
+    field_out->value = 0;
+    field_out->data = NULL;
+    field_out->length = 0;
+
+    switch(field_out->wireType) {
+      case WireTypeVarint:
+        return readVarint(pos, end, &field_out->value);
+      case WireTypeFixed64:
+        return readFixed(pos, end, 8, &field_out->value);
+      case WireTypeFixed32:
+        return readFixed(pos, end, 4, &field_out->value);
+      case WireTypeLengthDelimited:
+        {
+            uint64 length;
+            if (!readVarint(pos, end, &length) || length > (uint64)(end - pos))
+                return false;
+            field_out->data = pos;
+            field_out->length = (uint32)length;
+            pos += length;
+            return true;
+        }
+      default:
+        // Groups are never generated by PBJ
+        return false;
+    }
+}
+
+// Field numbers of the envelope fields. Rather than duplicating them from
+// ObjectMessage.pbj, they're found by serializing a message with
+// recognizable values, so the envelope can't silently get out of sync with
+// the protocol. If anything is unexpected, e.g. UUIDs aren't encoded as 16
+// raw bytes, the layout is invalid and envelopes always fail to parse,
+// falling back to a normal parse.
+struct EnvelopeLayout {
+    EnvelopeLayout();
+
+    bool valid;
+    uint32 sourceObject;
+    uint32 sourcePort;
+    uint32 destObject;
+    uint32 destPort;
+    uint32 unique;
+    uint32 payload;
+};
+
+EnvelopeLayout::EnvelopeLayout()
+ : valid(false),
+   sourceObject(0),
+   sourcePort(0),
+   destObject(0),
+   destPort(0),
+   unique(0),
+   payload(0)
+{
+    UUID::byte source_data[UUID::static_size], dest_data[UUID::static_size];
+    for(uint32 i = 0; i < UUID::static_size; i++) {
+        source_data[i] = (UUID::byte)(0x10 + i);
+        dest_data[i] = (UUID::byte)(0x80 + i);
+    }
+    UUID source_object(source_data, UUID::static_size), dest_object(dest_data, UUID::static_size);
+    const ObjectMessagePort source_port = 0x1234, dest_port = 0x5678;
+    const uint64 unique_id = 0x123456789ABCULL;
+    const std::string payload_data("ObjectMessageEnvelope");
+
+    Sirikata::Protocol::Object::ObjectMessage prototype;
+    prototype.set_source_object(source_object);
+    prototype.set_source_port(source_port);
+    prototype.set_dest_object(dest_object);
+    prototype.set_dest_port(dest_port);
+    prototype.set_unique(unique_id);
+    prototype.set_payload(payload_data);
+    std::string serialized = serializePBJMessage(prototype);
+
+    const uint8* pos = (const uint8*)serialized.data();
+    const uint8* end = pos + serialized.size();
+    while(pos < end) {
+        WireField field;
+        if (!readField(pos, end, &field)) return;
+
+        if (field.wireType == WireTypeLengthDelimited) {
+            if (field.length == UUID::static_size && memcmp(field.data, source_data, UUID::static_size) == 0)
+                sourceObject = field.number;
+            else if (field.length == UUID::static_size && memcmp(field.data, dest_data, UUID::static_size) == 0)
+                destObject = field.number;
+            else if (field.length == payload_data.size() && memcmp(field.data, payload_data.data(), payload_data.size()) == 0)
+                payload = field.number;
+        }
+        else {
+            if (field.value == source_port)
+                sourcePort = field.number;
+            else if (field.value == dest_port)
+                destPort = field.number;
+            else if (field.value == unique_id)
+                unique = field.number;
+        }
+    }
+
+    valid = (sourceObject != 0 && sourcePort != 0 && destObject != 0 &&
+        destPort != 0 && unique != 0 && payload != 0);
+    if (!valid)
+        SILOG(objectmessage,warn,"Couldn't determine ObjectMessage layout, envelopes will be unavailable.");
+}
+
+const EnvelopeLayout& envelopeLayout() {
+    static EnvelopeLayout layout;
+    return layout;
+}
+
+} // namespace
+
+ObjectMessageEnvelope::ObjectMessageEnvelope()
+ : mSerialized(MemoryReference::null()),
+   mSourcePort(0),
+   mDestPort(0),
+   mUnique(0),
+   mPayload(MemoryReference::null())
+{
+}
+
+bool ObjectMessageEnvelope::parse(const MemoryReference& serialized) {
+    const EnvelopeLayout& layout = envelopeLayout();
+    if (!layout.valid) return false;
+
+    mSerialized = serialized;
+    mPayload = MemoryReference::null();
+
+    enum {
+        FoundSourceObject = 1,
+        FoundSourcePort = 2,
+        FoundDestObject = 4,
+        FoundDestPort = 8,
+        FoundUnique = 16,
+        FoundPayload = 32,
+        FoundAll = 63
+    };
+    uint32 found = 0;
+
+    const uint8* pos = (const uint8*)serialized.data();
+    const uint8* end = pos + serialized.size();
+    while(pos < end) {
+        WireField field;
+        if (!readField(pos, end, &field)) return false;
+
+        bool delimited = (field.wireType == WireTypeLengthDelimited);
+        if (field.number == layout.sourceObject) {
+            if (!delimited || field.length != UUID::static_size) return false;
+            mSourceObject = UUID(field.data, UUID::static_size);
+            found |= FoundSourceObject;
+        }
+        else if (field.number == layout.destObject) {
+            if (!delimited || field.length != UUID::static_size) return false;
+            mDestObject = UUID(field.data, UUID::static_size);
+            found |= FoundDestObject;
+        }
+        else if (field.number == layout.payload) {
+            if (!delimited) return false;
+            mPayload = MemoryReference(field.data, field.length);
+            found |= FoundPayload;
+        }
+        else if (field.number == layout.sourcePort) {
+            if (delimited) return false;
+            mSourcePort = (ObjectMessagePort)field.value;
+            found |= FoundSourcePort;
+        }
+        else if (field.number == layout.destPort) {
+            if (delimited) return false;
+            mDestPort = (ObjectMessagePort)field.value;
+            found |= FoundDestPort;
+        }
+        else if (field.number == layout.unique) {
+            if (delimited) return false;
+            mUnique = field.value;
+            found |= FoundUnique;
+        }
+        // Anything else isn't needed for routing and is just skipped
+    }
+
+    return (found == FoundAll);
+}
 
 } // namespace Sirikata
@@ -0,0 +1,355 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include <sirikata/core/util/Standard.hh>
+#include <sirikata/core/prox/CompactProximityResults.hpp>
+#include <sirikata/core/network/Message.hpp>
+#include "Protocol_CompactProx.pbj.hpp"
+
+namespace Sirikata {
+
+namespace {
+
+// Version written in CompactProximityResults.encoding
+const uint32 COMPACT_ENCODING_VERSION = 1;
+
+// Fields are serialized in order, so every compact result starts with the
+// encoding field: the varint key for field 1 followed by the version, which
+// fits in a single byte. Full results start with their time instead.
+const char COMPACT_ENCODING_KEY = 0x08;
+
+// Largest quantized value we'll send, leaving plenty of headroom in a sint32
+const float64 MAX_QUANTIZED = (float64)(1 << 30);
+
+bool quantize(const Vector3f& val, float32 quantum, int32 out[3]) {
+    for(int i = 0; i < 3; i++) {
+        float64 q = floor((float64)val[i] / quantum + 0.5);
+        if (!(q < MAX_QUANTIZED && q > -MAX_QUANTIZED))
+            return false;
+        out[i] = (int32)q;
+    }
+    return true;
+}
+
+} // namespace
+
+CompactProximityEncoder::ObjectState::ObjectState()
+ : seqno(0),
+   aggregate(false),
+   locationT(Time::null()),
+   position(0, 0, 0),
+   velocity(0, 0, 0),
+   orientationT(Time::null()),
+   orientation(Quaternion::identity()),
+   orientationVelocity(Quaternion::identity()),
+   centerOffset(0, 0, 0),
+   centerBoundsRadius(0),
+   maxObjectSize(0),
+   mesh(0),
+   parent(UUID::null())
+{
+}
+
+
+CompactProximityEncoder::CompactProximityEncoder(float32 quantum)
+ : mQuantum(quantum)
+{
+}
+
+void CompactProximityEncoder::encode(const Sirikata::Protocol::Prox::ProximityResults& results, const Vector3f& origin, String* payload_out) {
+    Sirikata::Protocol::Prox::CompactProximityResults compact;
+    compact.set_encoding(COMPACT_ENCODING_VERSION);
+    compact.set_t(results.t());
+    compact.set_origin(origin);
+    compact.set_quantum(mQuantum);
+
+    for(int32 uidx = 0; uidx < results.update_size(); uidx++) {
+        Sirikata::Protocol::Prox::ProximityUpdate update = results.update(uidx);
+        Sirikata::Protocol::Prox::ICompactProximityUpdate compact_update = compact.add_update();
+
+        for(int32 aidx = 0; aidx < update.addition_size(); aidx++) {
+            Sirikata::Protocol::Prox::ObjectAddition addition = update.addition(aidx);
+            Sirikata::Protocol::Prox::ICompactObjectAddition compact_addition = compact_update.add_addition();
+
+            UUID objid = addition.object();
+            compact_addition.set_object(objid);
+            compact_addition.set_seqno(addition.seqno());
+
+            // Everything is diffed against what we last sent for the object,
+            // or against the defaults if we've never sent it
+            ObjectStateMap::iterator base_it = mObjects.find(objid);
+            bool have_base = (base_it != mObjects.end());
+            if (!have_base)
+                base_it = mObjects.insert( ObjectStateMap::value_type(objid, ObjectState()) ).first;
+            else
+                compact_addition.set_base_seqno(base_it->second.seqno);
+            ObjectState& state = base_it->second;
+            state.seqno = addition.seqno();
+
+            bool agg = (addition.has_type() && addition.type() == Sirikata::Protocol::Prox::ObjectAddition::Aggregate);
+            if (agg != state.aggregate) {
+                compact_addition.set_aggregate(agg);
+                state.aggregate = agg;
+            }
+
+            Time loc_t = addition.location().t();
+            Vector3f pos = addition.location().position(), vel = addition.location().velocity();
+            if (!have_base || loc_t != state.locationT || pos != state.position || vel != state.velocity) {
+                int32 qpos[3], qvel[3];
+                if (quantize(pos - origin, mQuantum, qpos) && quantize(vel, mQuantum, qvel)) {
+                    compact_addition.set_location_t( (loc_t - results.t()).toMicroseconds() );
+                    if (qpos[0] != 0) compact_addition.set_position_x(qpos[0]);
+                    if (qpos[1] != 0) compact_addition.set_position_y(qpos[1]);
+                    if (qpos[2] != 0) compact_addition.set_position_z(qpos[2]);
+                    if (qvel[0] != 0) compact_addition.set_velocity_x(qvel[0]);
+                    if (qvel[1] != 0) compact_addition.set_velocity_y(qvel[1]);
+                    if (qvel[2] != 0) compact_addition.set_velocity_z(qvel[2]);
+                }
+                else {
+                    Sirikata::Protocol::ITimedMotionVector motion = compact_addition.mutable_location();
+                    motion.set_t(loc_t);
+                    motion.set_position(pos);
+                    motion.set_velocity(vel);
+                }
+                state.locationT = loc_t;
+                state.position = pos;
+                state.velocity = vel;
+            }
+
+            if (addition.has_orientation()) {
+                Time orient_t = addition.orientation().t();
+                Quaternion orient = addition.orientation().position(), orient_vel = addition.orientation().velocity();
+                // Without a base, a static identity orientation is the default
+                bool changed = have_base ?
+                    (orient_t != state.orientationT || orient != state.orientation || orient_vel != state.orientationVelocity) :
+                    (orient != state.orientation || orient_vel != state.orientationVelocity);
+                if (changed) {
+                    Sirikata::Protocol::ITimedMotionQuaternion msg_orient = compact_addition.mutable_orientation();
+                    msg_orient.set_t(orient_t);
+                    msg_orient.set_position(orient);
+                    msg_orient.set_velocity(orient_vel);
+                }
+                state.orientationT = orient_t;
+                state.orientation = orient;
+                state.orientationVelocity = orient_vel;
+            }
+
+            if (addition.has_aggregate_bounds()) {
+                Vector3f center_offset = addition.aggregate_bounds().center_offset();
+                float32 center_bounds_radius = addition.aggregate_bounds().center_bounds_radius();
+                float32 max_object_size = addition.aggregate_bounds().max_object_size();
+                if (center_offset != state.centerOffset)
+                    compact_addition.set_center_offset(center_offset);
+                if (center_bounds_radius != state.centerBoundsRadius)
+                    compact_addition.set_center_bounds_radius(center_bounds_radius);
+                if (max_object_size != state.maxObjectSize)
+                    compact_addition.set_max_object_size(max_object_size);
+                state.centerOffset = center_offset;
+                state.centerBoundsRadius = center_bounds_radius;
+                state.maxObjectSize = max_object_size;
+            }
+
+            uint32 mesh_id = 0;
+            if (addition.has_mesh() && !addition.mesh().empty()) {
+                MeshIDMap::iterator mesh_it = mMeshIDs.find(addition.mesh());
+                if (mesh_it == mMeshIDs.end()) {
+                    mesh_id = mMeshIDs.size() + 1;
+                    mMeshIDs[addition.mesh()] = mesh_id;
+                    compact_addition.set_mesh(addition.mesh());
+                }
+                else {
+                    mesh_id = mesh_it->second;
+                }
+            }
+            if (mesh_id != state.mesh) {
+                compact_addition.set_mesh_id(mesh_id);
+                state.mesh = mesh_id;
+            }
+
+            String phy = addition.has_physics() ? addition.physics() : String();
+            if (phy != state.physics) {
+                compact_addition.set_physics(phy);
+                state.physics = phy;
+            }
+
+            UUID parent = addition.has_parent() ? addition.parent() : UUID::null();
+            if (parent != state.parent) {
+                compact_addition.set_parent(parent);
+                state.parent = parent;
+            }
+        }
+
+        for(int32 ridx = 0; ridx < update.removal_size(); ridx++) {
+            Sirikata::Protocol::Prox::ObjectRemoval removal = update.removal(ridx);
+            Sirikata::Protocol::Prox::IObjectRemoval compact_removal = compact_update.add_removal();
+            compact_removal.set_object(removal.object());
+            compact_removal.set_seqno(removal.seqno());
+            if (removal.has_type())
+                compact_removal.set_type(removal.type());
+
+            // Transiently removed objects often come back, so we only forget
+            // about permanently removed ones
+            if (removal.has_type() && removal.type() == Sirikata::Protocol::Prox::ObjectRemoval::Permanent)
+                mObjects.erase(removal.object());
+        }
+
+        for(int32 pidx = 0; pidx < update.reparent_size(); pidx++) {
+            Sirikata::Protocol::Prox::NodeReparent reparent = update.reparent(pidx);
+            Sirikata::Protocol::Prox::INodeReparent compact_reparent = compact_update.add_reparent();
+            compact_reparent.set_object(reparent.object());
+            compact_reparent.set_seqno(reparent.seqno());
+            compact_reparent.set_old_parent(reparent.old_parent());
+            compact_reparent.set_new_parent(reparent.new_parent());
+            compact_reparent.set_type(reparent.type());
+        }
+    }
+
+    serializePBJMessage(payload_out, compact);
+}
+
+
+
+CompactProximityDecoder::CompactProximityDecoder()
+{
+}
+
+bool CompactProximityDecoder::isCompact(const String& payload) {
+    return (payload.size() >= 2 &&
+        payload[0] == COMPACT_ENCODING_KEY &&
+        payload[1] == (char)COMPACT_ENCODING_VERSION);
+}
+
+bool CompactProximityDecoder::decode(const String& payload, Sirikata::Protocol::Prox::ProximityResults* results_out) {
+    Sirikata::Protocol::Prox::CompactProximityResults compact;
+    if (!isCompact(payload) || !compact.ParseFromString(payload) ||
+        !compact.has_encoding() || compact.encoding() != COMPACT_ENCODING_VERSION)
+        return false;
+
+    Time t = compact.t();
+    Vector3f origin = compact.origin();
+    float32 quantum = compact.quantum();
+    results_out->set_t(t);
+
+    for(int32 uidx = 0; uidx < compact.update_size(); uidx++) {
+        Sirikata::Protocol::Prox::CompactProximityUpdate compact_update = compact.update(uidx);
+        Sirikata::Protocol::Prox::IProximityUpdate update = results_out->add_update();
+
+        for(int32 aidx = 0; aidx < compact_update.addition_size(); aidx++) {
+            Sirikata::Protocol::Prox::CompactObjectAddition compact_addition = compact_update.addition(aidx);
+            Sirikata::Protocol::Prox::IObjectAddition addition = update.add_addition();
+
+            UUID objid = compact_addition.object();
+            // If we lost track of the base somehow, we have to fall back on
+            // defaults -- the same thing the encoder does when it has no base
+            ObjectStateMap::iterator base_it = mObjects.find(objid);
+            if (base_it == mObjects.end() || !compact_addition.has_base_seqno())
+                base_it = mObjects.insert( ObjectStateMap::value_type(objid, ObjectState()) ).first;
+            ObjectState& state = base_it->second;
+            if (!compact_addition.has_base_seqno())
+                state = ObjectState();
+            state.seqno = compact_addition.seqno();
+
+            if (compact_addition.has_aggregate())
+                state.aggregate = compact_addition.aggregate();
+
+            if (compact_addition.has_location()) {
+                state.locationT = compact_addition.location().t();
+                state.position = compact_addition.location().position();
+                state.velocity = compact_addition.location().velocity();
+            }
+            else if (compact_addition.has_location_t()) {
+                state.locationT = t + Duration::microseconds(compact_addition.location_t());
+                state.position = origin + Vector3f(
+                    compact_addition.position_x(), compact_addition.position_y(), compact_addition.position_z()
+                ) * quantum;
+                state.velocity = Vector3f(
+                    compact_addition.velocity_x(), compact_addition.velocity_y(), compact_addition.velocity_z()
+                ) * quantum;
+            }
+
+            // Without a base, the orientation defaults to a static identity
+            // orientation at the location's time
+            if (!compact_addition.has_base_seqno())
+                state.orientationT = state.locationT;
+            if (compact_addition.has_orientation()) {
+                state.orientationT = compact_addition.orientation().t();
+                state.orientation = compact_addition.orientation().position();
+                state.orientationVelocity = compact_addition.orientation().velocity();
+            }
+
+            if (compact_addition.has_center_offset())
+                state.centerOffset = compact_addition.center_offset();
+            if (compact_addition.has_center_bounds_radius())
+                state.centerBoundsRadius = compact_addition.center_bounds_radius();
+            if (compact_addition.has_max_object_size())
+                state.maxObjectSize = compact_addition.max_object_size();
+
+            if (compact_addition.has_mesh_id()) {
+                state.mesh = compact_addition.mesh_id();
+                if (compact_addition.has_mesh())
+                    mMeshes[state.mesh] = compact_addition.mesh();
+            }
+            if (compact_addition.has_physics())
+                state.physics = compact_addition.physics();
+            if (compact_addition.has_parent())
+                state.parent = compact_addition.parent();
+
+            addition.set_object(objid);
+            addition.set_seqno(state.seqno);
+            addition.set_type(
+                state.aggregate ?
+                Sirikata::Protocol::Prox::ObjectAddition::Aggregate :
+                Sirikata::Protocol::Prox::ObjectAddition::Object
+            );
+
+            Sirikata::Protocol::ITimedMotionVector motion = addition.mutable_location();
+            motion.set_t(state.locationT);
+            motion.set_position(state.position);
+            motion.set_velocity(state.velocity);
+
+            Sirikata::Protocol::ITimedMotionQuaternion msg_orient = addition.mutable_orientation();
+            msg_orient.set_t(state.orientationT);
+            msg_orient.set_position(state.orientation);
+            msg_orient.set_velocity(state.orientationVelocity);
+
+            Sirikata::Protocol::IAggregateBoundingInfo msg_bounds = addition.mutable_aggregate_bounds();
+            msg_bounds.set_center_offset(state.centerOffset);
+            msg_bounds.set_center_bounds_radius(state.centerBoundsRadius);
+            msg_bounds.set_max_object_size(state.maxObjectSize);
+
+            if (state.mesh != 0)
+                addition.set_mesh(mMeshes[state.mesh]);
+            if (!state.physics.empty())
+                addition.set_physics(state.physics);
+            if (state.parent != UUID::null())
+                addition.set_parent(state.parent);
+        }
+
+        for(int32 ridx = 0; ridx < compact_update.removal_size(); ridx++) {
+            Sirikata::Protocol::Prox::ObjectRemoval compact_removal = compact_update.removal(ridx);
+            Sirikata::Protocol::Prox::IObjectRemoval removal = update.add_removal();
+            removal.set_object(compact_removal.object());
+            removal.set_seqno(compact_removal.seqno());
+            if (compact_removal.has_type())
+                removal.set_type(compact_removal.type());
+
+            if (compact_removal.has_type() && compact_removal.type() == Sirikata::Protocol::Prox::ObjectRemoval::Permanent)
+                mObjects.erase(compact_removal.object());
+        }
+
+        for(int32 pidx = 0; pidx < compact_update.reparent_size(); pidx++) {
+            Sirikata::Protocol::Prox::NodeReparent compact_reparent = compact_update.reparent(pidx);
+            Sirikata::Protocol::Prox::INodeReparent reparent = update.add_reparent();
+            reparent.set_object(compact_reparent.object());
+            reparent.set_seqno(compact_reparent.seqno());
+            reparent.set_old_parent(compact_reparent.old_parent());
+            reparent.set_new_parent(compact_reparent.new_parent());
+            reparent.set_type(compact_reparent.type());
+        }
+    }
+
+    return true;
+}
+
+} // namespace Sirikata
@@ -208,6 +208,7 @@ void Context::setCommander(Command::Commander* c) {
         mCommander->unregisterCommand("context.shutdown");
         mCommander->unregisterCommand("context.report-stats");
         mCommander->unregisterCommand("context.report-all-stats");
+        mCommander->unregisterCommand("context.strands.stats");
     }
 
     mCommander = c;
@@ -226,6 +227,10 @@ void Context::setCommander(Command::Commander* c) {
             "context.report-all-stats",
             std::tr1::bind(&Network::IOService::commandReportAllStats, _1, _2, _3)
         );
+        mCommander->registerCommand(
+            "context.strands.stats",
+            std::tr1::bind(&Network::IOService::commandStrandStats, ioService, _1, _2, _3)
+        );
     }
 }
 
@@ -48,23 +48,34 @@ namespace Sirikata {
 namespace Trace {
 
 OptionValue* Trace::mLogMessage;
+OptionValue* Trace::mThreadBufferSize;
 
 #define TRACE_MESSAGE_NAME                  "trace-message"
+#define TRACE_THREAD_BUFFER_NAME            "trace-thread-buffer"
 
 void Trace::InitOptions() {
     mLogMessage = new OptionValue(TRACE_MESSAGE_NAME,"false",Sirikata::OptionValueType<bool>(),"Log object trace data");
+    mThreadBufferSize = new OptionValue(TRACE_THREAD_BUFFER_NAME,"8388608",Sirikata::OptionValueType<uint32>(),"Size in bytes of the per-thread trace buffers. Records are dropped if a thread fills its buffer before it is written to disk.");
 
     InitializeClassOptions::module(SIRIKATA_OPTIONS_MODULE)
         .addOption(mLogMessage)
+        .addOption(mThreadBufferSize)
         ;
 }
 
 
 Trace::Trace(const String& filename)
- : mShuttingDown(false),
+ : mThreadRing(&Trace::noRingCleanup),
+   mRingCapacity(1),
+   mShuttingDown(false),
    mStorageThread(NULL),
    mFinishStorage(false)
 {
+    // TraceRings need a power of two capacity
+    uint32 buffer_size = mThreadBufferSize->as<uint32>();
+    while(mRingCapacity < buffer_size && mRingCapacity < (1u << 31))
+        mRingCapacity <<= 1;
+
     mStorageThread = new Thread( "Trace Storage", std::tr1::bind(&Trace::storageThread, this, filename) );
 }
 
@@ -73,31 +84,65 @@ void Trace::prepareShutdown() {
 }
 
 void Trace::shutdown() {
-    data.flush();
     mFinishStorage = true;
     mStorageThread->join();
     delete mStorageThread;
 }
 
+TraceRing* Trace::threadRing() {
+    TraceRing* ring = mThreadRing.get();
+    if (ring == NULL) {
+        boost::lock_guard<boost::mutex> lck(mRingsMutex);
+        ring = new TraceRing(mRings.size() + 1, mRingCapacity);
+        mRings.push_back(ring);
+        mThreadRing.reset(ring);
+    }
+    return ring;
+}
+
+bool Trace::ringsPending() {
+    boost::lock_guard<boost::mutex> lck(mRingsMutex);
+    for(uint32 i = 0; i < mRings.size(); i++) {
+        if (!mRings[i]->empty())
+            return true;
+    }
+    return false;
+}
+
+void Trace::storeRings(FILE* of) {
+    std::vector<TraceRing*> rings;
+    {
+        boost::lock_guard<boost::mutex> lck(mRingsMutex);
+        rings = mRings;
+    }
+
+    for(uint32 i = 0; i < rings.size(); i++)
+        rings[i]->store(of);
+}
+
 void Trace::storageThread(const String& filename) {
     FILE* of = NULL;
 
     while( !mFinishStorage.read() ) {
         // Open the file in the loop so we never open the file if we never dump
         // any trace data
-        if (of == NULL && !data.empty())
+        if (of == NULL && ringsPending())
             of = fopen(filename.c_str(), "wb");
 
-        if (!data.empty()) {
-            data.store(of);
+        if (of != NULL) {
+            storeRings(of);
             fflush(of);
         }
 
-        Timer::sleep(Duration::seconds(1));
+        // Drain often enough that busy threads don't fill their rings
+        Timer::sleep(Duration::milliseconds((int64)100));
     }
 
+    if (of == NULL && ringsPending())
+        of = fopen(filename.c_str(), "wb");
+
     if (of != NULL) {
-        data.store(of);
+        storeRings(of);
         fflush(of);
 #if SIRIKATA_PLATFORM == SIRIKATA_PLATFORM_WINDOWS
         FlushFileBuffers((HANDLE) _get_osfhandle(_fileno(of)));
@@ -108,22 +153,9 @@ void Trace::storageThread(const String& filename) {
     }
 }
 
-void Trace::writeRecord(uint16 type_hint, BatchedBuffer::IOVec* data_orig, uint32 iovcnt) {
-    assert(iovcnt < 30);
-
-    BatchedBuffer::IOVec data_vec[32];
-
-    uint32 total_size = 0;
-    for(uint32 i = 0; i < iovcnt; i++)
-        total_size += data_orig[i].len;
-
-
-    data_vec[0] = BatchedBuffer::IOVec(&total_size, sizeof(total_size));
-    data_vec[1] = BatchedBuffer::IOVec(&type_hint, sizeof(type_hint));
-    for(uint32 i = 0; i < iovcnt; i++)
-        data_vec[i+2] = data_orig[i];
-
-    data.write(data_vec, iovcnt+2);
+void Trace::writeRecord(uint16 type_hint, BatchedBuffer::IOVec* data, uint32 iovcnt) {
+    // The ring adds the size and type hint framing
+    threadRing()->write(type_hint, data, iovcnt);
 }
 
 
@@ -138,6 +170,14 @@ void Drops::output() {
 
 Trace::~Trace() {
     drops.output();
+
+    uint64 ring_drops = 0;
+    for(uint32 i = 0; i < mRings.size(); i++) {
+        ring_drops += mRings[i]->dropped();
+        delete mRings[i];
+    }
+    if (ring_drops > 0)
+        SILOG(trace, warning, "Dropped " << ring_drops << " trace records because per-thread trace buffers were full, consider increasing --" << TRACE_THREAD_BUFFER_NAME);
 }
 
 
@@ -0,0 +1,126 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include <sirikata/core/util/Standard.hh>
+#include <sirikata/core/trace/TraceRing.hpp>
+#include <sirikata/core/trace/Trace.hpp>
+
+namespace Sirikata {
+namespace Trace {
+
+const uint32 TraceRing::HeaderSize;
+
+TraceRing::TraceRing(uint32 id, uint32 capacity)
+ : mID(id),
+   mCapacity(capacity),
+   mMask(capacity - 1),
+   mBuffer(new uint8[capacity]),
+   mHead(0),
+   mTail(0),
+   mNextSeqno(0),
+   mDropped(0),
+   mNextStoredSeqno(0),
+   mStoredAny(false)
+{
+    assert(capacity > HeaderSize && (capacity & mMask) == 0);
+}
+
+TraceRing::~TraceRing() {
+    delete[] mBuffer;
+}
+
+void TraceRing::copyIn(uint32 pos, const void* src, uint32 len) {
+    uint32 offset = pos & mMask;
+    uint32 first = std::min(len, mCapacity - offset);
+    memcpy(mBuffer + offset, src, first);
+    if (first < len)
+        memcpy(mBuffer, (const uint8*)src + first, len - first);
+}
+
+void TraceRing::copyOut(uint32 pos, void* dest, uint32 len) const {
+    uint32 offset = pos & mMask;
+    uint32 first = std::min(len, mCapacity - offset);
+    memcpy(dest, mBuffer + offset, first);
+    if (first < len)
+        memcpy((uint8*)dest + first, mBuffer, len - first);
+}
+
+void TraceRing::storeRange(FILE* os, uint32 pos, uint32 len) const {
+    uint32 offset = pos & mMask;
+    uint32 first = std::min(len, mCapacity - offset);
+    fwrite(mBuffer + offset, 1, first, os);
+    if (first < len)
+        fwrite(mBuffer, 1, len - first, os);
+}
+
+bool TraceRing::write(uint16 type_hint, const BatchedBuffer::IOVec* iov, uint32 iovcnt) {
+    uint64 seqno = mNextSeqno++;
+
+    uint32 size = 0;
+    for(uint32 i = 0; i < iovcnt; i++)
+        size += iov[i].len;
+
+    uint32 head = mHead.read();
+    uint32 tail = mTail.read();
+    // Don't overwrite anything until the consumer is done reading it
+    memory_barrier();
+    if (mCapacity - (head - tail) < HeaderSize + size) {
+        mDropped++;
+        return false;
+    }
+
+    uint32 pos = head;
+    copyIn(pos, &seqno, sizeof(seqno)); pos += sizeof(seqno);
+    copyIn(pos, &size, sizeof(size)); pos += sizeof(size);
+    copyIn(pos, &type_hint, sizeof(type_hint)); pos += sizeof(type_hint);
+    for(uint32 i = 0; i < iovcnt; i++) {
+        copyIn(pos, iov[i].base, iov[i].len);
+        pos += iov[i].len;
+    }
+
+    // Make the record visible only once all of it has been written
+    memory_barrier();
+    mHead = pos;
+    return true;
+}
+
+void TraceRing::store(FILE* os) {
+    uint32 head = mHead.read();
+    memory_barrier();
+    uint32 pos = mTail.read();
+
+    while(pos != head) {
+        RecordHeader hdr;
+        copyOut(pos, &hdr.seqno, sizeof(hdr.seqno));
+        copyOut(pos + sizeof(hdr.seqno), &hdr.size, sizeof(hdr.size));
+        copyOut(pos + sizeof(hdr.seqno) + sizeof(hdr.size), &hdr.type_hint, sizeof(hdr.type_hint));
+
+        if (!mStoredAny || hdr.seqno != mNextStoredSeqno) {
+            uint32 run_size = sizeof(mID) + sizeof(hdr.seqno);
+            uint16 run_hint = TraceThreadRunTag;
+            fwrite(&run_size, sizeof(run_size), 1, os);
+            fwrite(&run_hint, sizeof(run_hint), 1, os);
+            fwrite(&mID, sizeof(mID), 1, os);
+            fwrite(&hdr.seqno, sizeof(hdr.seqno), 1, os);
+            mStoredAny = true;
+        }
+        mNextStoredSeqno = hdr.seqno + 1;
+
+        // Size and type hint are stored contiguously in the ring, in the same
+        // layout as the trace record framing
+        storeRange(os, pos + sizeof(hdr.seqno), sizeof(hdr.size) + sizeof(hdr.type_hint) + hdr.size);
+        pos += HeaderSize + hdr.size;
+    }
+
+    // Only release the space once we're done reading from it
+    memory_barrier();
+    mTail = pos;
+}
+
+bool TraceRing::empty() const {
+    return (mHead.read() == mTail.read());
+}
+
+} // namespace Trace
+} // namespace Sirikata
@@ -0,0 +1,176 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include <sirikata/core/util/Standard.hh>
+#include <sirikata/core/util/MotionVectorStore.hpp>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace Sirikata {
+
+MotionVectorStore::MotionVectorStore()
+ : mHaveEpoch(false),
+   mEpoch(Time::null()),
+   mNumSlots(0)
+{
+}
+
+MotionVectorStore::Slot MotionVectorStore::add(const TimedMotionVector3f& val) {
+    if (!mHaveEpoch) {
+        mEpoch = val.updateTime();
+        mHaveEpoch = true;
+    }
+
+    Slot slot;
+    if (!mFreeSlots.empty()) {
+        slot = mFreeSlots.back();
+        mFreeSlots.pop_back();
+    }
+    else {
+        slot = mNumSlots++;
+        if (slot >= capacity()) {
+            Block empty;
+            memset(&empty, 0, sizeof(Block));
+            mBlocks.push_back(empty);
+        }
+    }
+    set(slot, val);
+    return slot;
+}
+
+void MotionVectorStore::set(Slot slot, const TimedMotionVector3f& val) {
+    assert(slot < mNumSlots);
+    Block& b = mBlocks[slot / BLOCK_SIZE];
+    uint32 l = slot % BLOCK_SIZE;
+    b.time[l] = relativeSeconds(val.updateTime());
+    b.posX[l] = val.position().x;
+    b.posY[l] = val.position().y;
+    b.posZ[l] = val.position().z;
+    b.velX[l] = val.velocity().x;
+    b.velY[l] = val.velocity().y;
+    b.velZ[l] = val.velocity().z;
+}
+
+void MotionVectorStore::remove(Slot slot) {
+    assert(slot < mNumSlots);
+    // Zero the slot so bulk extrapolation never sees garbage
+    Block& b = mBlocks[slot / BLOCK_SIZE];
+    uint32 l = slot % BLOCK_SIZE;
+    b.time[l] = 0;
+    b.posX[l] = 0; b.posY[l] = 0; b.posZ[l] = 0;
+    b.velX[l] = 0; b.velY[l] = 0; b.velZ[l] = 0;
+    mFreeSlots.push_back(slot);
+}
+
+TimedMotionVector3f MotionVectorStore::get(Slot slot) const {
+    assert(slot < mNumSlots);
+    const Block& b = mBlocks[slot / BLOCK_SIZE];
+    uint32 l = slot % BLOCK_SIZE;
+    return TimedMotionVector3f(
+        mEpoch + Duration::microseconds((int64)floor(b.time[l] * 1000000. + 0.5)),
+        MotionVector3f(
+            Vector3f(b.posX[l], b.posY[l], b.posZ[l]),
+            Vector3f(b.velX[l], b.velY[l], b.velZ[l])
+        )
+    );
+}
+
+Vector3f MotionVectorStore::extrapolate(const Time& t, Slot slot) const {
+    assert(slot < mNumSlots);
+    const Block& b = mBlocks[slot / BLOCK_SIZE];
+    uint32 l = slot % BLOCK_SIZE;
+    float32 dt = (float32)(relativeSeconds(t) - b.time[l]);
+    return Vector3f(
+        b.posX[l] + b.velX[l] * dt,
+        b.posY[l] + b.velY[l] * dt,
+        b.posZ[l] + b.velZ[l] * dt
+    );
+}
+
+void MotionVectorStore::extrapolate(const Time& t, const Slot* slots, uint32 count, Vector3f* out) const {
+    float64 now = relativeSeconds(t);
+    uint32 i = 0;
+
+#if defined(__SSE2__)
+    // Slots are usually scattered, so values are gathered into registers four
+    // at a time. The lookups don't depend on each other, so their cache misses
+    // can overlap.
+    __m128d now2 = _mm_set1_pd(now);
+    for(; i + 4 <= count; i += 4) {
+        const Block* b[4];
+        uint32 l[4];
+        for(uint32 j = 0; j < 4; j++) {
+            b[j] = &mBlocks[slots[i+j] / BLOCK_SIZE];
+            l[j] = slots[i+j] % BLOCK_SIZE;
+        }
+
+#define GATHER_FIELD(field) _mm_set_ps(b[3]->field[l[3]], b[2]->field[l[2]], b[1]->field[l[1]], b[0]->field[l[0]])
+        __m128 dt = _mm_movelh_ps(
+            _mm_cvtpd_ps(_mm_sub_pd(now2, _mm_set_pd(b[1]->time[l[1]], b[0]->time[l[0]]))),
+            _mm_cvtpd_ps(_mm_sub_pd(now2, _mm_set_pd(b[3]->time[l[3]], b[2]->time[l[2]])))
+        );
+        __m128 x = _mm_add_ps(GATHER_FIELD(posX), _mm_mul_ps(GATHER_FIELD(velX), dt));
+        __m128 y = _mm_add_ps(GATHER_FIELD(posY), _mm_mul_ps(GATHER_FIELD(velY), dt));
+        __m128 z = _mm_add_ps(GATHER_FIELD(posZ), _mm_mul_ps(GATHER_FIELD(velZ), dt));
+#undef GATHER_FIELD
+
+        float32 xs[4], ys[4], zs[4];
+        _mm_storeu_ps(xs, x);
+        _mm_storeu_ps(ys, y);
+        _mm_storeu_ps(zs, z);
+        for(uint32 j = 0; j < 4; j++)
+            out[i+j] = Vector3f(xs[j], ys[j], zs[j]);
+    }
+#endif
+
+    for(; i < count; i++)
+        out[i] = extrapolate(t, slots[i]);
+}
+
+void MotionVectorStore::extrapolateAll(const Time& t, float32* x, float32* y, float32* z) const {
+    float64 now = relativeSeconds(t);
+    uint32 num_blocks = mBlocks.size();
+
+#if defined(__SSE2__)
+    // Each block is exactly one vector wide. With AVX, a block's update times
+    // can also be converted in a single operation.
+#if defined(__AVX__)
+    __m256d now4 = _mm256_set1_pd(now);
+#else
+    __m128d now2 = _mm_set1_pd(now);
+#endif
+    for(uint32 bi = 0; bi < num_blocks; bi++) {
+        const Block& b = mBlocks[bi];
+#if defined(__AVX__)
+        __m128 dt = _mm256_cvtpd_ps(_mm256_sub_pd(now4, _mm256_loadu_pd(b.time)));
+#else
+        __m128 dt = _mm_movelh_ps(
+            _mm_cvtpd_ps(_mm_sub_pd(now2, _mm_loadu_pd(b.time))),
+            _mm_cvtpd_ps(_mm_sub_pd(now2, _mm_loadu_pd(b.time + 2)))
+        );
+#endif
+        uint32 base = bi * BLOCK_SIZE;
+        _mm_storeu_ps(x + base, _mm_add_ps(_mm_loadu_ps(b.posX), _mm_mul_ps(_mm_loadu_ps(b.velX), dt)));
+        _mm_storeu_ps(y + base, _mm_add_ps(_mm_loadu_ps(b.posY), _mm_mul_ps(_mm_loadu_ps(b.velY), dt)));
+        _mm_storeu_ps(z + base, _mm_add_ps(_mm_loadu_ps(b.posZ), _mm_mul_ps(_mm_loadu_ps(b.velZ), dt)));
+    }
+#else
+    for(uint32 bi = 0; bi < num_blocks; bi++) {
+        const Block& b = mBlocks[bi];
+        uint32 base = bi * BLOCK_SIZE;
+        for(uint32 l = 0; l < BLOCK_SIZE; l++) {
+            float32 dt = (float32)(now - b.time[l]);
+            x[base + l] = b.posX[l] + b.velX[l] * dt;
+            y[base + l] = b.posY[l] + b.velY[l] * dt;
+            z[base + l] = b.posZ[l] + b.velZ[l] * dt;
+        }
+    }
+#endif
+}
+
+} // namespace Sirikata
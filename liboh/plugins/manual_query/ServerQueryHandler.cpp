@@ -193,7 +193,7 @@ void ServerQueryHandler::handleCreatedProxSubstream(const OHDP::SpaceNodeID& sni
     serv_it->second->prox_stream = prox_stream;
 
     // Register to get data
-    String* prevdata = new String();
+    Network::FrameReader* prevdata = new Network::FrameReader();
     prox_stream->registerReadCallback(
         std::tr1::bind(&ServerQueryHandler::handleProximitySubstreamRead, this,
             snid, prox_stream, prevdata, _1, _2
@@ -204,29 +204,24 @@ void ServerQueryHandler::handleCreatedProxSubstream(const OHDP::SpaceNodeID& sni
     writeSomeProxData(serv_it->second);
 }
 
-void ServerQueryHandler::handleProximitySubstreamRead(const OHDP::SpaceNodeID& snid, OHDPSST::StreamPtr prox_stream, String* prevdata, uint8* buffer, int length) {
+void ServerQueryHandler::handleProximitySubstreamRead(const OHDP::SpaceNodeID& snid, OHDPSST::StreamPtr prox_stream, Network::FrameReader* prevdata, uint8* buffer, int length) {
     if (mContext->stopped()) {
         QPLOG(detailed, "Ignoring proximity update after system stop requested.");
         return;
     }
 
-    prevdata->append((const char*)buffer, length);
+    prevdata->append(buffer, length);
 
-    while(true) {
-        std::string msg = Network::Frame::parse(*prevdata);
-
-        // If we don't have a full message, just wait for more
-        if (msg.empty()) return;
-
-        // Otherwise, try to handle it
+    // Handle each full message; anything incomplete waits for more data
+    MemoryReference msg = MemoryReference::null();
+    while(prevdata->next(&msg))
         handleProximityMessage(snid, msg);
-    }
 
     // FIXME we should be getting a callback on stream close so we can clean up!
     //prox_stream->registerReadCallback(0);
 }
 
-void ServerQueryHandler::handleProximityMessage(const OHDP::SpaceNodeID& snid, const String& payload) {
+void ServerQueryHandler::handleProximityMessage(const OHDP::SpaceNodeID& snid, const MemoryReference& payload) {
     ServerQueryMap::iterator serv_it = mServerQueries.find(snid);
     if (serv_it == mServerQueries.end()) {
         QPLOG(debug, "Received proximity message without query. Query may have recently been destroyed.");
@@ -235,7 +230,7 @@ void ServerQueryHandler::handleProximityMessage(const OHDP::SpaceNodeID& snid, c
     ServerQueryStatePtr& query_state = serv_it->second;
 
     Sirikata::Protocol::Prox::ProximityResults contents;
-    bool parse_success = contents.ParseFromString(payload);
+    bool parse_success = contents.ParseFromArray(payload.data(), payload.size());
     if (!parse_success) {
         QPLOG(error, "Failed to decode proximity message");
         return;
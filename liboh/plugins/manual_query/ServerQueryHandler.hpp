@@ -9,6 +9,7 @@
 #include <sirikata/oh/SpaceNodeSession.hpp>
 #include <sirikata/pintoloc/ManualReplicatedClient.hpp>
 #include <sirikata/oh/OHSpaceTimeSynced.hpp>
+#include <sirikata/core/network/Frame.hpp>
 
 namespace Sirikata {
 namespace OH {
@@ -121,9 +122,9 @@ private:
     // Callback from creating proximity substream
     void handleCreatedProxSubstream(const OHDP::SpaceNodeID& snid, int success, OHDPSST::StreamPtr prox_stream);
     // Data read callback for prox substreams -- translate to proximity events
-    void handleProximitySubstreamRead(const OHDP::SpaceNodeID& snid, OHDPSST::StreamPtr prox_stream, String* prevdata, uint8* buffer, int length);
+    void handleProximitySubstreamRead(const OHDP::SpaceNodeID& snid, OHDPSST::StreamPtr prox_stream, Network::FrameReader* prevdata, uint8* buffer, int length);
     // Handle decode proximity message
-    void handleProximityMessage(const OHDP::SpaceNodeID& snid, const String& payload);
+    void handleProximityMessage(const OHDP::SpaceNodeID& snid, const MemoryReference& payload);
 
     // Location
     // Handlers for substreams for space-managed updates
@@ -11,6 +11,8 @@
 #include <sirikata/proxyobject/ProxyManager.hpp>
 #include <sirikata/oh/OHSpaceTimeSynced.hpp>
 #include <sirikata/core/odp/SST.hpp>
+#include <sirikata/core/options/Options.hpp>
+#include <json_spirit/json_spirit.h>
 
 #define SOQP_LOG(lvl, msg) SILOG(simple-object-query-processor, lvl, msg)
 
@@ -19,13 +21,18 @@ namespace OH {
 namespace Simple {
 
 SimpleObjectQueryProcessor* SimpleObjectQueryProcessor::create(ObjectHostContext* ctx, const String& args) {
-    return new SimpleObjectQueryProcessor(ctx);
+    OptionSet* optionsSet = OptionSet::getOptions("oh_simple_query", NULL);
+    optionsSet->parse(args);
+
+    bool compact_results = optionsSet->referenceOption("compact-results")->as<bool>();
+    return new SimpleObjectQueryProcessor(ctx, compact_results);
 }
 
 
-SimpleObjectQueryProcessor::SimpleObjectQueryProcessor(ObjectHostContext* ctx)
+SimpleObjectQueryProcessor::SimpleObjectQueryProcessor(ObjectHostContext* ctx, bool compact_results)
  : ObjectQueryProcessor(ctx),
-   mContext(ctx)
+   mContext(ctx),
+   mCompactResults(compact_results)
 {
 }
 
@@ -105,13 +112,20 @@ void SimpleObjectQueryProcessor::handleProximitySubstreamRead(const HostedObject
 
 bool SimpleObjectQueryProcessor::handleProximityMessage(HostedObjectPtr self, const SpaceObjectReference& spaceobj, const std::string& payload)
 {
+    ObjectStatePtr obj_state = mObjectStateMap[spaceobj];
+
+    // Even if we asked for compact results, we can still get full ones,
+    // e.g. those sent before the space handled the request. Check the format
+    // first so full results don't pay for a failed compact parse.
     Sirikata::Protocol::Prox::ProximityResults contents;
-    bool parse_success = contents.ParseFromString(payload);
+    bool parse_success =
+        (mCompactResults && obj_state &&
+            CompactProximityDecoder::isCompact(payload) &&
+            obj_state->compactResults.decode(payload, &contents)) ||
+        contents.ParseFromString(payload);
     if (!parse_success)
         return false;
 
-    ObjectStatePtr obj_state = mObjectStateMap[spaceobj];
-
     ProxyManagerPtr proxy_manager = self->getProxyManager(spaceobj.space(), spaceobj.object());
     if (!proxy_manager) {
         SOQP_LOG(warn,"Hosted Object received a message for a presence without a proxy manager.");
@@ -161,8 +175,20 @@ bool SimpleObjectQueryProcessor::handleProximityMessage(HostedObjectPtr self, co
 
 
 void SimpleObjectQueryProcessor::updateQuery(HostedObjectPtr ho, const SpaceObjectReference& sporef, const String& new_query) {
+    String query = new_query;
+    // Servers which don't know about the compact encoding just ignore the
+    // extra parameter
+    if (mCompactResults) {
+        namespace json = json_spirit;
+        json::Value parsed;
+        if (json::read(new_query, parsed) && parsed.isObject()) {
+            parsed.put("encoding", String(PROX_COMPACT_ENCODING));
+            query = json::write(parsed);
+        }
+    }
+
     Protocol::Prox::QueryRequest request;
-    request.set_query_parameters(new_query);
+    request.set_query_parameters(query);
     std::string payload = serializePBJMessage(request);
 
     SSTStreamPtr spaceStream = mContext->objectHost->getSpaceStream(sporef.space(), sporef.object());
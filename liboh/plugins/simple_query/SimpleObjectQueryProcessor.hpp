@@ -8,6 +8,7 @@
 #include <sirikata/oh/ObjectQueryProcessor.hpp>
 
 #include <sirikata/pintoloc/OrphanLocUpdateManager.hpp>
+#include <sirikata/core/prox/CompactProximityResults.hpp>
 
 namespace Sirikata {
 namespace OH {
@@ -25,7 +26,7 @@ class SimpleObjectQueryProcessor :
 public:
     static SimpleObjectQueryProcessor* create(ObjectHostContext* ctx, const String& args);
 
-    SimpleObjectQueryProcessor(ObjectHostContext* ctx);
+    SimpleObjectQueryProcessor(ObjectHostContext* ctx, bool compact_results);
     virtual ~SimpleObjectQueryProcessor();
 
     virtual void start();
@@ -66,6 +67,8 @@ private:
 
 
     ObjectHostContext* mContext;
+    // Whether to ask the space for compact results
+    bool mCompactResults;
 
     // We resolve ordering issues here instead of leaving it up to the
     // object. To do so, we track a bit of state for each query -- the
@@ -94,6 +97,9 @@ private:
         HostedObjectWPtr ho;
         OrphanLocUpdateManager orphans;
         bool stopped;
+        // Compact results refer to earlier ones, so each result stream needs
+        // its own decoder
+        CompactProximityDecoder compactResults;
     };
     typedef std::tr1::shared_ptr<ObjectState> ObjectStatePtr;
     typedef std::tr1::unordered_map<SpaceObjectReference, ObjectStatePtr, SpaceObjectReference::Hasher> ObjectStateMap;
@@ -56,6 +56,9 @@ public:
         virtual void updatedSegmentation(CoordinateSegmentation* cseg, const std::vector<SegmentationInfo>& new_segmentation) = 0;
     }; // class Listener
 
+    typedef std::tr1::function<void(ServerID)> LookupCallback;
+    typedef std::tr1::function<void(const std::vector<ServerID>&)> LookupBoundingBoxCallback;
+
     CoordinateSegmentation(SpaceContext* ctx);
     virtual ~CoordinateSegmentation();
 
@@ -65,13 +68,24 @@ public:
     virtual uint32 numServers()  = 0;
     virtual std::vector<ServerID> lookupBoundingBox(const BoundingBox3f& bbox) = 0;
 
+    /** Non-blocking versions of lookup and lookupBoundingBox. The callback
+     *  may be invoked before these return or from another thread, so callers
+     *  should wrap it for the strand they want the result on. The default
+     *  implementations just invoke the blocking versions.
+     */
+    virtual void lookupAsync(const Vector3f& pos, const LookupCallback& cb);
+    virtual void lookupBoundingBoxAsync(const BoundingBox3f& bbox, const LookupBoundingBoxCallback& cb);
+
     void addListener(Listener* listener);
     void removeListener(Listener* listener);
 
     // Callback from MessageDispatcher
     virtual void receiveMessage(Message* msg) = 0;
 
-    virtual void reportLoad(ServerID sid, const BoundingBox3f& bbox, uint32 load) {  }
+    /** Report the number of objects in, and rate of object messages handled
+     *  for, a server's region so the segmentation can be rebalanced.
+     */
+    virtual void reportLoad(ServerID sid, const BoundingBox3f& bbox, uint32 load, uint32 messageRate) {  }
 
     virtual void migrationHint( std::vector<ServerLoadInfo>& svrLoadInfo ) {  }
 
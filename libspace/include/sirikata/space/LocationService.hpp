@@ -210,6 +210,11 @@ public:
     virtual uint64 epoch(const UUID& uuid) = 0;
     virtual TimedMotionVector3f location(const UUID& uuid) = 0;
     virtual Vector3f currentPosition(const UUID& uuid) = 0;
+    /** Get the current positions of count objects, storing them in out. This
+     *  is equivalent to calling currentPosition() for each one, but
+     *  implementations may be able to do it more efficiently.
+     */
+    virtual void currentPositions(const UUID* uuids, uint32 count, Vector3f* out);
     virtual TimedMotionQuaternion orientation(const UUID& uuid) = 0;
     virtual Quaternion currentOrientation(const UUID& uuid) = 0;
     virtual AggregateBoundingInfo bounds(const UUID& uuid) = 0;
@@ -48,6 +48,11 @@ namespace Sirikata
       virtual void insert(const UUID& uuid, const OSegEntry& sID) = 0;
       virtual const OSegEntry& get(const UUID& uuid)              = 0;
       virtual void remove(const UUID& uuid)                       = 0;
+
+      /** Append every entry which hasn't expired, e.g. to save them in a
+       *  snapshot. Caches that can't list their entries add nothing.
+       */
+      virtual void getEntries(OSegEntryList* entries) {}
   };
 
 }
@@ -84,6 +84,8 @@ public:
     }
 };
 
+typedef std::vector< std::pair<UUID, OSegEntry> > OSegEntryList;
+
 /* Listener interface for OSeg events.
  *
  * Note that these are likely to be called from another thread, so
@@ -173,6 +175,19 @@ public:
     virtual void removeObject(const UUID& obj_id) = 0;
     virtual bool clearToMigrate(const UUID& obj_id) = 0;
 
+    /** Append the objects this server currently owns, e.g. to save them in a
+     *  snapshot. Implementations that don't keep track of them locally add
+     *  nothing. Must be called from the main strand.
+     */
+    virtual void getLocalObjects(OSegEntryList* objects) {}
+
+    /** Objects this server owned when it saved a snapshot before it last
+     *  stopped. None of them are connected anymore, but the authoritative
+     *  record for some of them may still name this server. Called before
+     *  start().
+     */
+    virtual void restoreLocalObjects(const OSegEntryList& objects) {}
+
     virtual int getPushback()
     {
         return 0;
@@ -70,6 +70,9 @@ public:
     Message(ServerID src, uint16 src_port, ServerID dest, ServerID dest_port);
     Message(ServerID src, uint16 src_port, ServerID dest, uint16 dest_port, const std::string& pl);
     Message(ServerID src, uint16 src_port, ServerID dest, uint16 dest_port, const Sirikata::Protocol::Object::ObjectMessage* pl);
+    // Uses the already serialized ObjectMessage the envelope refers to as the
+    // payload, avoiding re-serialization when forwarding.
+    Message(ServerID src, uint16 src_port, ServerID dest, uint16 dest_port, const ObjectMessageEnvelope& pl);
 
     ServerID source_server() const { return mImpl.source_server(); }
     void set_source_server(const ServerID sid);
@@ -104,6 +107,7 @@ public:
     // Deprecated. Remains for backwards compatibility.
     bool serialize(Network::Chunk* result) const;
     static Message* deserialize(const Network::Chunk& wire);
+    static Message* deserialize(const MemoryReference& wire);
 
     // Deprecated. Remains for backwards compatibility.
     uint32 serializedSize() const;
@@ -91,8 +91,18 @@ public:
         virtual ~ReceiveStream() {}
 
         virtual ServerID id() const = 0;
-        virtual Chunk* front() = 0;
-        virtual Chunk* pop() = 0;
+        /** Get the next message without removing it.  The contents remain
+         *  valid until the next call to front() or pop().
+         *  \returns true if a message was available
+         */
+        virtual bool front(MemoryReference* msg) = 0;
+        /** Remove the next message, storing it in msg.  The contents remain
+         *  valid until the next call to front() or pop(). Messages are handed
+         *  out as views so that streams which receive several messages in one
+         *  buffer don't need to copy each one out.
+         *  \returns true if a message was available
+         */
+        virtual bool pop(MemoryReference* msg) = 0;
     };
 
     /** The Network::ReceiveListener interface should be implemented by the
@@ -32,6 +32,7 @@
 
 #include "LibproxProximity.hpp"
 #include "Options.hpp"
+#include "ObjectQueryShards.hpp"
 #include <sirikata/core/options/CommonOptions.hpp>
 
 #include <algorithm>
@@ -62,7 +63,7 @@ static uint32 NoUpdateMaxResults = ((uint32)INT_MAX)+1;
 
 namespace {
 
-bool parseQueryRequest(const String& query, SolidAngle* qangle_out, uint32* max_results_out) {
+bool parseQueryRequest(const String& query, SolidAngle* qangle_out, uint32* max_results_out, bool* compact_out) {
     if (query.empty())
         return false;
 
@@ -73,6 +74,7 @@ bool parseQueryRequest(const String& query, SolidAngle* qangle_out, uint32* max_
 
     *qangle_out = SolidAngle( parsed.getReal("angle", SolidAngle::Max.asFloat()) );
     *max_results_out = parsed.getInt("max_result", 0);
+    *compact_out = (parsed.getString("encoding", "") == PROX_COMPACT_ENCODING);
 
     return true;
 }
@@ -86,11 +88,10 @@ LibproxProximity::LibproxProximity(SpaceContext* ctx, LocationService* locservic
    mMaxMaxCount(1),
    mServerQueries(),
    mServerDistance(false),
-   mServerHandlerPoller(mProxStrand, std::tr1::bind(&LibproxProximity::tickQueryHandler, this, mServerQueryHandler), "LibproxProximity ServerHandler Poll", Duration::milliseconds((int64)100)),
-   mServerQueryBoundsPoller(mProxStrand, std::tr1::bind(&LibproxProximity::recomputeAggregateQueryBounds, this), "LibproxProximity Aggregate Query Bounds Poll", Duration::seconds((int64)1)),
-   mObjectQueries(),
+   mServerHandlerPoller(mProxStrand, std::tr1::bind(&LibproxProximity::tickServerQueryHandler, this), "LibproxProximity ServerHandler Poll", Duration::milliseconds((int64)100)),
+   mServerQueryBoundsPoller(ctx->mainStrand, std::tr1::bind(&LibproxProximity::recomputeAggregateQueryBounds, this), "LibproxProximity Aggregate Query Bounds Poll", Duration::seconds((int64)1)),
    mObjectDistance(false),
-   mObjectHandlerPoller(mProxStrand, std::tr1::bind(&LibproxProximity::tickQueryHandler, this, mObjectQueryHandler), "LibproxProximity ObjectHandler Poll", Duration::milliseconds((int64)100)),
+   mObjectCompactQuantum(GetOptionValue<float32>(OPT_PROX_OBJECT_COMPACT_QUANTUM)),
    mStaticRebuilderPoller(mProxStrand, std::tr1::bind(&LibproxProximity::rebuildHandler, this, OBJECT_CLASS_STATIC), "LibproxProximity Static Rebuilder Poll", Duration::seconds(172800.f)),
    mDynamicRebuilderPoller(mProxStrand, std::tr1::bind(&LibproxProximity::rebuildHandler, this, OBJECT_CLASS_DYNAMIC), "LibproxProximity Dynamic Rebuilder Poll", Duration::seconds(172800.f))
 {
@@ -125,28 +126,87 @@ LibproxProximity::LibproxProximity(SpaceContext* ctx, LocationService* locservic
     // Object Queries
     String object_handler_type = GetOptionValue<String>(OPT_PROX_OBJECT_QUERY_HANDLER_TYPE);
     String object_handler_options = GetOptionValue<String>(OPT_PROX_OBJECT_QUERY_HANDLER_OPTIONS);
-    for(int i = 0; i < NUM_OBJECT_CLASSES; i++) {
-        if (i >= mNumQueryHandlers) {
-            mObjectQueryHandler[i].handler = NULL;
-            continue;
+    uint32 requested_shards = GetOptionValue<uint32>(OPT_PROX_OBJECT_QUERY_SHARDS);
+    uint32 num_shards = objectQueryShardCount(object_handler_type, requested_shards);
+    if (num_shards < requested_shards)
+        PROXLOG(error, "Ignoring " << OPT_PROX_OBJECT_QUERY_SHARDS << "=" << requested_shards << ": object query handler type " << object_handler_type << " returns aggregates, which can only come from a single shard.");
+    for(uint32 s = 0; s < num_shards; s++) {
+        // The first shard shares the prox strand and location cache, so with a
+        // single shard everything runs on the prox strand as usual
+        ObjectQueryShard* shard = (s == 0) ?
+            new ObjectQueryShard(this, s, mProxStrand, mLocCache) :
+            new ObjectQueryShard(this, s, mContext->ioService->createStrand("LibproxProximity " + objectQueryShardName(s)), NULL);
+        if (shard->locCache == NULL)
+            shard->locCache = new CBRLocationServiceCache(shard->strand, locservice, true);
+        shard->poller = new PollerService(shard->strand, std::tr1::bind(&LibproxProximity::tickObjectQueryShard, this, shard), "LibproxProximity ObjectHandler Poll", Duration::milliseconds((int64)100));
+
+        for(int i = 0; i < NUM_OBJECT_CLASSES; i++) {
+            if (i >= mNumQueryHandlers) {
+                shard->handlers[i].handler = NULL;
+                continue;
+            }
+            shard->handlers[i].handler = QueryHandlerFactory<ObjectProxSimulationTraits>(object_handler_type, object_handler_options);
+            setObjectQueryShardAggregateListener(s, shard->handlers[i].handler, this); // *Must* be before handler->initialize
+            bool object_static_objects = (mSeparateDynamicObjects && i == OBJECT_CLASS_STATIC);
+            shard->handlers[i].handler->initialize(
+                shard->locCache, shard->locCache,
+                object_static_objects, false /* not replicated */,
+                std::tr1::bind(&LibproxProximity::handlerShouldHandleObject, this, object_static_objects, true, _1, _2, _3, _4, _5, _6)
+            );
         }
-        mObjectQueryHandler[i].handler = QueryHandlerFactory<ObjectProxSimulationTraits>(object_handler_type, object_handler_options);
-        mObjectQueryHandler[i].handler->setAggregateListener(this); // *Must* be before handler->initialize
-        bool object_static_objects = (mSeparateDynamicObjects && i == OBJECT_CLASS_STATIC);
-        mObjectQueryHandler[i].handler->initialize(
-            mLocCache, mLocCache,
-            object_static_objects, false /* not replicated */,
-            std::tr1::bind(&LibproxProximity::handlerShouldHandleObject, this, object_static_objects, true, _1, _2, _3, _4, _5, _6)
-        );
+        mObjectQueryShards.push_back(shard);
     }
     if (object_handler_type == "dist" || object_handler_type == "rtreedist") mObjectDistance = true;
 }
 
 LibproxProximity::~LibproxProximity() {
-    for(int i = 0; i < NUM_OBJECT_CLASSES; i++) {
-        delete mObjectQueryHandler[i].handler;
+    for(int i = 0; i < NUM_OBJECT_CLASSES; i++)
         delete mServerQueryHandler[i].handler;
+
+    for(uint32 s = 0; s < mObjectQueryShards.size(); s++) {
+        ObjectQueryShard* shard = mObjectQueryShards[s];
+        for(int i = 0; i < NUM_OBJECT_CLASSES; i++)
+            delete shard->handlers[i].handler;
+        delete shard->poller;
+        if (shard->strand != mProxStrand) {
+            delete shard->locCache;
+            delete shard->strand;
+        }
+        delete shard;
     }
+    mObjectQueryShards.clear();
+}
+
+LibproxProximity::ObjectQueryShard::ObjectQueryShard(LibproxProximity* _parent, uint32 _index, Network::IOStrand* _strand, CBRLocationServiceCache* _loc_cache)
+ : parent(_parent),
+   index(_index),
+   strand(_strand),
+   locCache(_loc_cache),
+   poller(NULL),
+   numQueries(0),
+   ticks(0),
+   tickTotalMicroseconds(0),
+   tickMaxMicroseconds(0),
+   tickLastMicroseconds(0)
+{
+}
+
+void LibproxProximity::ObjectQueryShard::queryHasEvents(Query* query) {
+    InstanceMethodNotReentrant nr(queryHasEventsNotReentrant);
+    parent->generateObjectQueryEvents(this, query);
+}
+
+LibproxProximity::ObjectQueryShard* LibproxProximity::objectQueryShard(const UUID& querier) {
+    if (mObjectQueryShards.size() == 1)
+        return mObjectQueryShards[0];
+    return mObjectQueryShards[ UUID::Hasher()(querier) % mObjectQueryShards.size() ];
+}
+
+String LibproxProximity::objectQueryShardName(uint32 idx) {
+    // The first shard keeps the name used before queries were sharded
+    if (idx == 0)
+        return "object-queries";
+    return "object-queries-" + boost::lexical_cast<String>(idx);
 }
 
 
@@ -201,7 +261,8 @@ void LibproxProximity::start() {
     LibproxProximityBase::start();
 
     mContext->add(&mServerHandlerPoller);
-    mContext->add(&mObjectHandlerPoller);
+    for(uint32 s = 0; s < mObjectQueryShards.size(); s++)
+        mContext->add(mObjectQueryShards[s]->poller);
     mContext->add(&mStaticRebuilderPoller);
     mContext->add(&mDynamicRebuilderPoller);
     mContext->add(&mServerQueryBoundsPoller);
@@ -230,9 +291,13 @@ void LibproxProximity::newSession(ObjectSession* session) {
 }
 
 void LibproxProximity::sessionClosed(ObjectSession* session) {
+    UUID objid = session->id().getAsUUID();
+    mObjectQuerierRegions.erase(objid);
+
     // Prox strand may  have some state to clean up
-    mProxStrand->post(
-        std::tr1::bind(&LibproxProximity::handleDisconnectedObject, this, session->id().getAsUUID()),
+    ObjectQueryShard* shard = objectQueryShard(objid);
+    shard->strand->post(
+        std::tr1::bind(&LibproxProximity::handleDisconnectedObject, this, shard, objid),
         "LibproxProximity::handleDisconnectedObject"
     );
 
@@ -259,8 +324,11 @@ void LibproxProximity::handleObjectProximityMessage(const UUID& objid, void* buf
     if (prox_update.has_query_parameters()) {
         SolidAngle sa;
         uint32 max_results;
-        if (parseQueryRequest(prox_update.query_parameters(), &sa, &max_results))
+        bool compact;
+        if (parseQueryRequest(prox_update.query_parameters(), &sa, &max_results, &compact)) {
+            updateQueryEncoding(objid, compact);
             updateQuery(objid, mLocService->location(objid), mLocService->bounds(objid).fullBounds(), sa, max_results);
+        }
     }
     else {
         if (!prox_update.has_query_angle()) return;
@@ -544,16 +612,20 @@ void LibproxProximity::addQuery(UUID obj, SolidAngle sa, uint32 max_results) {
 void LibproxProximity::addQuery(UUID obj, const String& params) {
     SolidAngle sa;
     uint32 max_results;
-    if (parseQueryRequest(params, &sa, &max_results))
+    bool compact;
+    if (parseQueryRequest(params, &sa, &max_results, &compact)) {
+        updateQueryEncoding(obj, compact);
         updateQuery(obj, mLocService->location(obj), mLocService->bounds(obj).fullBounds(), sa, max_results);
+    }
 }
 
 void LibproxProximity::updateQuery(UUID obj, const TimedMotionVector3f& loc, const BoundingSphere3f& bounds, SolidAngle sa, uint32 max_results) {
     SeqNoPtr obj_seqno = mContext->objectSessionManager()->getSession(ObjectReference(obj))->getSeqNoPtr();
 
     // Update the prox thread
-    mProxStrand->post(
-        std::tr1::bind(&LibproxProximity::handleUpdateObjectQuery, this, obj, loc, bounds, sa, max_results, obj_seqno),
+    ObjectQueryShard* shard = objectQueryShard(obj);
+    shard->strand->post(
+        std::tr1::bind(&LibproxProximity::handleUpdateObjectQuery, this, shard, obj, loc, bounds, sa, max_results, obj_seqno),
         "LibproxProximity::handleUpdateObjectQuery"
     );
 
@@ -580,20 +652,36 @@ void LibproxProximity::updateQuery(UUID obj, const TimedMotionVector3f& loc, con
         }
     }
 
+    if (mObjectQueryAngles.find(obj) != mObjectQueryAngles.end()) {
+        ObjectQuerierRegion& querier_region = mObjectQuerierRegions[obj];
+        querier_region.loc = loc;
+        querier_region.maxSize = bounds.radius();
+    }
+
     if (update_remote_queries)
         updateAggregateQuery();
 }
 
+void LibproxProximity::updateQueryEncoding(UUID obj, bool compact) {
+    ObjectQueryShard* shard = objectQueryShard(obj);
+    shard->strand->post(
+        std::tr1::bind(&LibproxProximity::handleUpdateObjectQueryEncoding, this, shard, obj, compact),
+        "LibproxProximity::handleUpdateObjectQueryEncoding"
+    );
+}
+
 void LibproxProximity::removeQuery(UUID obj) {
     // Update the main thread's record
     SolidAngle sa = mObjectQueryAngles[obj];
     mObjectQueryAngles.erase(obj);
     uint32 max_count = mObjectQueryMaxCounts[obj];
     mObjectQueryMaxCounts.erase(obj);
+    mObjectQuerierRegions.erase(obj);
 
     // Update the prox thread
-    mProxStrand->post(
-        std::tr1::bind(&LibproxProximity::handleRemoveObjectQuery, this, obj, true),
+    ObjectQueryShard* shard = objectQueryShard(obj);
+    shard->strand->post(
+        std::tr1::bind(&LibproxProximity::handleRemoveObjectQuery, this, shard, obj, true),
         "LibproxProximity::handleRemoveObjectQuery"
     );
 
@@ -623,7 +711,10 @@ void LibproxProximity::removeQuery(UUID obj) {
 
 
 int32 LibproxProximity::objectQueries() const {
-    return mObjectQueries[OBJECT_CLASS_STATIC].size();
+    int32 count = 0;
+    for(uint32 s = 0; s < mObjectQueryShards.size(); s++)
+        count += mObjectQueryShards[s]->numQueries.read();
+    return count;
 }
 
 int32 LibproxProximity::serverQueries() const {
@@ -665,13 +756,12 @@ void LibproxProximity::poll() {
 void LibproxProximity::queryHasEvents(Query* query) {
     InstanceMethodNotReentrant nr(mQueryHasEventsNotRentrant);
 
-    if (
+    // Object queries report to their shard instead
+    assert(
         query->handler() == mServerQueryHandler[OBJECT_CLASS_STATIC].handler ||
         query->handler() == mServerQueryHandler[OBJECT_CLASS_DYNAMIC].handler
-    )
-        generateServerQueryEvents(query);
-    else
-        generateObjectQueryEvents(query);
+    );
+    generateServerQueryEvents(query);
 }
 
 
@@ -707,14 +797,44 @@ void LibproxProximity::replicaLocationUpdated(const UUID& uuid, const TimedMotio
 }
 
 
-// PROX Thread: Everything after this should only be called from within the prox thread.
+// PROX Thread: Everything after this should only be called from within the
+// prox thread, or the strand of the object query shard being operated on.
 
-void LibproxProximity::tickQueryHandler(ProxQueryHandlerData qh[NUM_OBJECT_CLASSES]) {
+void LibproxProximity::tickServerQueryHandler() {
     // Not really any better place to do this. We'll call this more frequently
     // than necessary by putting it here, but hopefully it doesn't matter since
     // most of the time nothing will be done.
     processExpiredStaticObjectTimeouts();
 
+    tickQueryHandler(mServerQueryHandler);
+}
+
+void LibproxProximity::tickObjectQueryShard(ObjectQueryShard* shard) {
+    Time start = Timer::now();
+
+    tickQueryHandler(shard->handlers);
+
+    // We wait until the first full iteration is done for queries so we can
+    // coalesce their initial results, skipping intermediate refinement. Now's
+    // the time to mark them as having completed their first iteration and
+    // performing the coalescing.
+
+    // copied for safe iteration
+    FirstIterationObjectSet copied_first_its = shard->queriesFirstIteration;
+    for(FirstIterationObjectSet::const_iterator it = copied_first_its.begin(); it != copied_first_its.end(); it++)
+        generateObjectQueryEvents(shard, *it, true);
+    shard->queriesFirstIteration.clear();
+
+    uint64 tick_us = (uint64)(Timer::now() - start).toMicroseconds();
+    shard->ticks++;
+    shard->tickTotalMicroseconds += tick_us;
+    shard->tickLastMicroseconds = tick_us;
+    // Only written from this strand, so no need for compare and swap
+    if (tick_us > shard->tickMaxMicroseconds.read())
+        shard->tickMaxMicroseconds = tick_us;
+}
+
+void LibproxProximity::tickQueryHandler(ProxQueryHandlerData qh[NUM_OBJECT_CLASSES]) {
     // We need to actually swap any objects that the previous step
     // found. However, we need to be careful because just performing
     // the addObject() and removeObject() can result in incorrect
@@ -743,17 +863,6 @@ void LibproxProximity::tickQueryHandler(ProxQueryHandlerData qh[NUM_OBJECT_CLASS
             qh[i].additions.clear();
         }
     }
-
-    // We wait until the first full iteration is done for queries so we can
-    // coalesce their initial results, skipping intermediate refinement. Now's
-    // the time to mark them as having completed their first iteration and
-    // performing the coalescing.
-
-    // copied for safe iteration
-    FirstIterationObjectSet copied_first_its = mObjectQueriesFirstIteration;
-    for(FirstIterationObjectSet::const_iterator it = copied_first_its.begin(); it != copied_first_its.end(); it++)
-        generateObjectQueryEvents(*it, true);
-    mObjectQueriesFirstIteration.clear();
 }
 
 void LibproxProximity::rebuildHandlerType(ProxQueryHandlerData* handler, ObjectClass objtype) {
@@ -763,18 +872,30 @@ void LibproxProximity::rebuildHandlerType(ProxQueryHandlerData* handler, ObjectC
 
 void LibproxProximity::rebuildHandler(ObjectClass objtype) {
     rebuildHandlerType(mServerQueryHandler, objtype);
-    rebuildHandlerType(mObjectQueryHandler, objtype);
+    for(uint32 s = 0; s < mObjectQueryShards.size(); s++) {
+        ObjectQueryShard* shard = mObjectQueryShards[s];
+        if (shard->strand == mProxStrand) {
+            rebuildHandlerType(shard->handlers, objtype);
+            continue;
+        }
+        shard->strand->post(
+            std::tr1::bind(&LibproxProximity::rebuildHandlerType, this, shard->handlers, objtype),
+            "LibproxProximity::rebuildHandlerType"
+        );
+    }
 }
 
+// MAIN Thread: Aggregate query bounds are computed from the main thread's
+// copy of querier positions since queries may be spread across shards
 void LibproxProximity::recomputeAggregateQueryBounds() {
     Time t = mContext->simTime();
     AggregateBoundingInfo new_bnds;
 
-    for(ObjectQueryMap::iterator it = mObjectQueries[OBJECT_CLASS_STATIC].begin(); it != mObjectQueries[OBJECT_CLASS_STATIC].end(); it++) {
-        // We know that the query registration makes these individual objects,
-        // gives 0 size bounds and puts the object size in maxSize, so we can
-        // ignore query->region() and give 0 for the center bounds radius.
-        AggregateBoundingInfo querier_bnds(it->second->position(t), 0, it->second->maxSize());
+    for(ObjectQuerierRegionMap::iterator it = mObjectQuerierRegions.begin(); it != mObjectQuerierRegions.end(); it++) {
+        // Queries are registered as individual objects with 0 size bounds and
+        // the object size in maxSize, so we give 0 for the center bounds
+        // radius.
+        AggregateBoundingInfo querier_bnds(it->second.loc.position(t), 0, it->second.maxSize);
         new_bnds.mergeIn(querier_bnds);
     }
 
@@ -807,6 +928,7 @@ void LibproxProximity::commandProperties(const Command::Command& cmd, Command::C
     result.put("settings.dynamic_separate", mSeparateDynamicObjects);
     if (mSeparateDynamicObjects)
         result.put("settings.static_heuristic", mMoveToStaticDelay.toString());
+    result.put("settings.object_shards", (uint32)mObjectQueryShards.size());
 
     // Current state. Split into two high level parts, objects and servers, and
     // further split by properties of connected objects/servers and queries
@@ -815,16 +937,18 @@ void LibproxProximity::commandProperties(const Command::Command& cmd, Command::C
     // Properties of objects
     // We don't get this info from loc, we just figure it out based on what the
     // query processors report: server queries only have local objects, object
-    // queries have both
+    // queries have both. Every shard replicates all objects, so we only need
+    // to look at the first one, which lives on this strand.
+    ProxQueryHandlerData* object_handlers = mObjectQueryShards[0]->handlers;
     int32 server_query_objects = (mNumQueryHandlers == 2 ? (mServerQueryHandler[0].handler->numObjects() + mServerQueryHandler[1].handler->numObjects()) : mServerQueryHandler[0].handler->numObjects());
-    int32 object_query_objects = (mNumQueryHandlers == 2 ? (mObjectQueryHandler[0].handler->numObjects() + mObjectQueryHandler[1].handler->numObjects()) : mObjectQueryHandler[0].handler->numObjects());
+    int32 object_query_objects = (mNumQueryHandlers == 2 ? (object_handlers[0].handler->numObjects() + object_handlers[1].handler->numObjects()) : object_handlers[0].handler->numObjects());
     result.put("objects.properties.local_count", server_query_objects);
     result.put("objects.properties.remote_count", object_query_objects - server_query_objects);
     result.put("objects.properties.count", object_query_objects);
     result.put("objects.properties.max_size", mMaxObject);
 
     // Properties of queries from objects
-    result.put("queries.objects.count", mObjectQueries[0].size());
+    result.put("queries.objects.count", objectQueries());
     result.put("queries.objects.min_solid_angle", mMinObjectQueryAngle.asFloat());
     result.put("queries.objects.max_max_count", mMaxMaxCount);
     if (mObjectDistance)
@@ -850,15 +974,10 @@ void LibproxProximity::commandProperties(const Command::Command& cmd, Command::C
 }
 
 void LibproxProximity::commandListHandlers(const Command::Command& cmd, Command::Commander* cmdr, Command::CommandID cmdid) {
-    Command::Result result = Command::EmptyResult();
+    // Object query handlers are filled in by each shard, on its own strand
+    ShardedCommandResultPtr sharded_result(new ShardedCommandResult(cmdr, cmdid, mObjectQueryShards.size()));
+    Command::Result& result = sharded_result->result;
     for(int i = 0; i < NUM_OBJECT_CLASSES; i++) {
-        if (mObjectQueryHandler[i].handler != NULL) {
-            String key = String("handlers.object.") + ObjectClassToString((ObjectClass)i) + ".";
-            result.put(key + "name", String("object-queries.") + ObjectClassToString((ObjectClass)i) + "-objects");
-            result.put(key + "queries", mObjectQueryHandler[i].handler->numQueries());
-            result.put(key + "objects", mObjectQueryHandler[i].handler->numObjects());
-            result.put(key + "nodes", mObjectQueryHandler[i].handler->numNodes());
-        }
         if (mServerQueryHandler[i].handler != NULL) {
             String key = String("handlers.server.") + ObjectClassToString((ObjectClass)i) + ".";
             result.put(key + "name", String("server-queries.") + ObjectClassToString((ObjectClass)i) + "-objects");
@@ -867,62 +986,117 @@ void LibproxProximity::commandListHandlers(const Command::Command& cmd, Command:
             result.put(key + "nodes", mServerQueryHandler[i].handler->numNodes());
         }
     }
-    cmdr->result(cmdid, result);
+    runOnObjectQueryShards(
+        sharded_result,
+        std::tr1::bind(&LibproxProximity::listShardHandlers, this, std::tr1::placeholders::_1, std::tr1::placeholders::_2)
+    );
+}
+
+void LibproxProximity::listShardHandlers(ObjectQueryShard* shard, Command::Result& result) {
+    // The first shard keeps the keys used before queries were sharded
+    String shard_key = (shard->index == 0) ? String("handlers.object.") : ("handlers.object-" + boost::lexical_cast<String>(shard->index) + ".");
+    for(int i = 0; i < NUM_OBJECT_CLASSES; i++) {
+        if (shard->handlers[i].handler == NULL) continue;
+        String key = shard_key + ObjectClassToString((ObjectClass)i) + ".";
+        result.put(key + "name", objectQueryShardName(shard->index) + "." + ObjectClassToString((ObjectClass)i) + "-objects");
+        result.put(key + "queries", shard->handlers[i].handler->numQueries());
+        result.put(key + "objects", shard->handlers[i].handler->numObjects());
+        result.put(key + "nodes", shard->handlers[i].handler->numNodes());
+    }
 }
 
 void LibproxProximity::commandListQueriers(const Command::Command& cmd, Command::Commander* cmdr, Command::CommandID cmdid) {
-    Command::Result result = Command::EmptyResult();
+    // Object queriers are filled in by each shard, on its own strand
+    ShardedCommandResultPtr sharded_result(new ShardedCommandResult(cmdr, cmdid, mObjectQueryShards.size()));
+    Command::Result& result = sharded_result->result;
     // Organized as lists under queriers.type, each querier being a dict of query handlers -> stats
     result.put("queriers.object", Command::Object());
     result.put("queriers.oh", Command::Object());
     result.put("queriers.server", Command::Object());
-    Command::Result& object_queriers = result.get("queriers.object");
-    Command::Result& oh_queriers = result.get("queriers.oh");
     Command::Result& server_queriers = result.get("queriers.server");
 
     // Outer loops get our list of queriers
-    for(ObjectQueryMap::iterator qit = mObjectQueries[OBJECT_CLASS_STATIC].begin(); qit != mObjectQueries[OBJECT_CLASS_STATIC].end(); qit++) {
+    for(ServerQueryMap::iterator qit = mServerQueries[OBJECT_CLASS_STATIC].begin(); qit != mServerQueries[OBJECT_CLASS_STATIC].end(); qit++) {
         Command::Result data = Command::EmptyResult();
         for(int i = 0; i < NUM_OBJECT_CLASSES; i++) {
-            if (mObjectQueryHandler[i].handler == NULL) continue;
-            // Then we need to look up the per-object-class query for the querier
-            ObjectQueryMap::iterator qcit = mObjectQueries[i].find(qit->first);
-            if (qcit == mObjectQueries[i].end()) continue;
+            if (mServerQueryHandler[i].handler == NULL) continue;
+            ServerQueryMap::iterator qcit = mServerQueries[i].find(qit->first);
+            if (qcit == mServerQueries[i].end()) continue;
 
-            String path = String("object-queries_") + ObjectClassToString((ObjectClass)i) + "-objects";
+            String path = String("server-queries_") + ObjectClassToString((ObjectClass)i) + "-objects";
             data.put(path + ".results", qcit->second->numResults());
             data.put(path + ".size", qcit->second->size());
         }
-        object_queriers.put(qit->first.toString(), data);
+        server_queriers.put(boost::lexical_cast<String>(qit->first), data);
     }
-    for(ServerQueryMap::iterator qit = mServerQueries[OBJECT_CLASS_STATIC].begin(); qit != mServerQueries[OBJECT_CLASS_STATIC].end(); qit++) {
+    runOnObjectQueryShards(
+        sharded_result,
+        std::tr1::bind(&LibproxProximity::listShardQueriers, this, std::tr1::placeholders::_1, std::tr1::placeholders::_2)
+    );
+}
+
+void LibproxProximity::listShardQueriers(ObjectQueryShard* shard, Command::Result& result) {
+    Command::Result& object_queriers = result.get("queriers.object");
+    for(ObjectQueryMap::iterator qit = shard->queries[OBJECT_CLASS_STATIC].begin(); qit != shard->queries[OBJECT_CLASS_STATIC].end(); qit++) {
         Command::Result data = Command::EmptyResult();
         for(int i = 0; i < NUM_OBJECT_CLASSES; i++) {
-            if (mServerQueryHandler[i].handler == NULL) continue;
-            ServerQueryMap::iterator qcit = mServerQueries[i].find(qit->first);
-            if (qcit == mServerQueries[i].end()) continue;
+            if (shard->handlers[i].handler == NULL) continue;
+            // Then we need to look up the per-object-class query for the querier
+            ObjectQueryMap::iterator qcit = shard->queries[i].find(qit->first);
+            if (qcit == shard->queries[i].end()) continue;
 
-            String path = String("server-queries_") + ObjectClassToString((ObjectClass)i) + "-objects";
+            String path = objectQueryShardName(shard->index) + "_" + ObjectClassToString((ObjectClass)i) + "-objects";
             data.put(path + ".results", qcit->second->numResults());
             data.put(path + ".size", qcit->second->size());
         }
-        server_queriers.put(boost::lexical_cast<String>(qit->first), data);
+        object_queriers.put(qit->first.toString(), data);
     }
-    cmdr->result(cmdid, result);
 }
 
-bool LibproxProximity::parseHandlerName(const String& name, ProxQueryHandlerData** handlers_out, ObjectClass* class_out) {
+void LibproxProximity::runOnObjectQueryShards(ShardedCommandResultPtr sharded_result, ShardCommandFunction func) {
+    for(uint32 s = 0; s < mObjectQueryShards.size(); s++) {
+        ObjectQueryShard* shard = mObjectQueryShards[s];
+        if (shard->strand == mProxStrand) {
+            runOnObjectQueryShard(sharded_result, func, shard);
+            continue;
+        }
+        shard->strand->post(
+            std::tr1::bind(&LibproxProximity::runOnObjectQueryShard, this, sharded_result, func, shard),
+            "LibproxProximity::runOnObjectQueryShard"
+        );
+    }
+}
+
+void LibproxProximity::runOnObjectQueryShard(ShardedCommandResultPtr sharded_result, ShardCommandFunction func, ObjectQueryShard* shard) {
+    boost::lock_guard<boost::mutex> lck(sharded_result->mutex);
+    func(shard, sharded_result->result);
+    sharded_result->remaining--;
+    if (sharded_result->remaining == 0)
+        sharded_result->cmdr->result(sharded_result->cmdid, sharded_result->result);
+}
+
+bool LibproxProximity::parseHandlerName(const String& name, ProxQueryHandlerData** handlers_out, ObjectClass* class_out, Network::IOStrand** strand_out) {
     // Should be of the form xxx-queries.yyy-objects, containing only 1 .
     std::size_t dot_pos = name.find('.');
     if (dot_pos == String::npos || name.rfind('.') != dot_pos)
         return false;
 
     String handler_part = name.substr(0, dot_pos);
-    if (handler_part == "server-queries")
+    *handlers_out = NULL;
+    if (handler_part == "server-queries") {
         *handlers_out = mServerQueryHandler;
-    else if (handler_part == "object-queries")
-        *handlers_out = mObjectQueryHandler;
-    else
+        *strand_out = mProxStrand;
+    }
+    else {
+        for(uint32 s = 0; s < mObjectQueryShards.size(); s++) {
+            if (handler_part == objectQueryShardName(s)) {
+                *handlers_out = mObjectQueryShards[s]->handlers;
+                *strand_out = mObjectQueryShards[s]->strand;
+                break;
+            }
+        }
+    }
+    if (*handlers_out == NULL)
         return false;
 
     String class_part = name.substr(dot_pos+1);
@@ -941,14 +1115,27 @@ void LibproxProximity::commandForceRebuild(const Command::Command& cmd, Command:
 
     ProxQueryHandlerData* handlers = NULL;
     ObjectClass klass;
+    Network::IOStrand* strand = NULL;
     if (!cmd.contains("handler") ||
-        !parseHandlerName(cmd.getString("handler"), &handlers, &klass))
+        !parseHandlerName(cmd.getString("handler"), &handlers, &klass, &strand))
     {
         result.put("error", "Ill-formatted request: handler not specified or invalid.");
         cmdr->result(cmdid, result);
         return;
     }
 
+    if (strand == mProxStrand) {
+        forceRebuildHandler(handlers, klass, cmdr, cmdid);
+        return;
+    }
+    strand->post(
+        std::tr1::bind(&LibproxProximity::forceRebuildHandler, this, handlers, klass, cmdr, cmdid),
+        "LibproxProximity::forceRebuildHandler"
+    );
+}
+
+void LibproxProximity::forceRebuildHandler(ProxQueryHandlerData* handlers, ObjectClass klass, Command::Commander* cmdr, Command::CommandID cmdid) {
+    Command::Result result = Command::EmptyResult();
     rebuildHandlerType(handlers, klass);
     result.put("success", true);
     cmdr->result(cmdid, result);
@@ -959,14 +1146,28 @@ void LibproxProximity::commandListNodes(const Command::Command& cmd, Command::Co
 
     ProxQueryHandlerData* handlers = NULL;
     ObjectClass klass;
+    Network::IOStrand* strand = NULL;
     if (!cmd.contains("handler") ||
-        !parseHandlerName(cmd.getString("handler"), &handlers, &klass))
+        !parseHandlerName(cmd.getString("handler"), &handlers, &klass, &strand))
     {
         result.put("error", "Ill-formatted request: handler not specified or invalid.");
         cmdr->result(cmdid, result);
         return;
     }
 
+    if (strand == mProxStrand) {
+        listHandlerNodes(handlers, klass, cmdr, cmdid);
+        return;
+    }
+    strand->post(
+        std::tr1::bind(&LibproxProximity::listHandlerNodes, this, handlers, klass, cmdr, cmdid),
+        "LibproxProximity::listHandlerNodes"
+    );
+}
+
+void LibproxProximity::listHandlerNodes(ProxQueryHandlerData* handlers, ObjectClass klass, Command::Commander* cmdr, Command::CommandID cmdid) {
+    Command::Result result = Command::EmptyResult();
+
     result.put( String("nodes"), Command::Array());
     Command::Array& nodes_ary = result.getArray("nodes");
     for(ProxQueryHandler::NodeIterator nit = handlers[klass].handler->nodesBegin(); nit != handlers[klass].handler->nodesEnd(); nit++) {
@@ -984,6 +1185,26 @@ void LibproxProximity::commandListNodes(const Command::Command& cmd, Command::Co
     cmdr->result(cmdid, result);
 }
 
+void LibproxProximity::commandStats(const Command::Command& cmd, Command::Commander* cmdr, Command::CommandID cmdid) {
+    Command::Result result = Command::EmptyResult();
+    fillStats(result);
+
+    // Tick times for object query shards, in microseconds. These are only
+    // updated by each shard's strand and are safe to read from here.
+    for(uint32 s = 0; s < mObjectQueryShards.size(); s++) {
+        ObjectQueryShard* shard = mObjectQueryShards[s];
+        String key = "stats.shards." + objectQueryShardName(s) + ".";
+        uint32 ticks = shard->ticks.read();
+        result.put(key + "queries", shard->numQueries.read());
+        result.put(key + "ticks", ticks);
+        result.put(key + "tick_us.last", shard->tickLastMicroseconds.read());
+        result.put(key + "tick_us.max", shard->tickMaxMicroseconds.read());
+        result.put(key + "tick_us.average", (ticks > 0 ? shard->tickTotalMicroseconds.read() / ticks : 0));
+    }
+
+    cmdr->result(cmdid, result);
+}
+
 
 void LibproxProximity::generateServerQueryEvents(Query* query) {
     Time t = mContext->simTime();
@@ -1098,18 +1319,19 @@ void LibproxProximity::generateServerQueryEvents(Query* query) {
     }
 }
 
-void LibproxProximity::generateObjectQueryEvents(Query* query, bool do_first) {
+void LibproxProximity::generateObjectQueryEvents(ObjectQueryShard* shard, Query* query, bool do_first) {
     // If we're waiting for the first iteration to finish, we ignore the
     // notification, waiting until we get out of the first tick to manually
     // trigger updates.
-    bool is_first = (mObjectQueriesFirstIteration.find(query) != mObjectQueriesFirstIteration.end());
+    bool is_first = (shard->queriesFirstIteration.find(query) != shard->queriesFirstIteration.end());
     if (!do_first && is_first) return;
 
     uint32 max_count = GetOptionValue<uint32>(PROX_MAX_PER_RESULT);
+    CBRLocationServiceCache* loc_cache = shard->locCache;
 
-    assert(mInvertedObjectQueries.find(query) != mInvertedObjectQueries.end());
-    UUID query_id = mInvertedObjectQueries[query];
-    SeqNoPtr seqNoPtr = getSeqNoInfo(query_id);
+    assert(shard->invertedQueries.find(query) != shard->invertedQueries.end());
+    UUID query_id = shard->invertedQueries[query];
+    SeqNoPtr seqNoPtr = getSeqNoInfo(shard, query_id);
 
     QueryEventList evts;
     query->popEvents(evts);
@@ -1120,8 +1342,8 @@ void LibproxProximity::generateObjectQueryEvents(Query* query, bool do_first) {
     }
 
     if (is_first) {
-        coalesceEvents(evts, 10);
-        mObjectQueriesFirstIteration.erase(query);
+        coalesceEvents(evts, 10, loc_cache);
+        shard->queriesFirstIteration.erase(query);
     }
 
     while(!evts.empty()) {
@@ -1136,7 +1358,7 @@ void LibproxProximity::generateObjectQueryEvents(Query* query, bool do_first) {
             for(uint32 aidx = 0; aidx < evt.additions().size(); aidx++) {
                 ObjectReference oobjid = evt.additions()[aidx].id();
                 UUID objid = oobjid.getAsUUID();
-                assert(mLocCache->tracking(oobjid));
+                assert(loc_cache->tracking(oobjid));
                 count++;
 
                 mContext->mainStrand->post(
@@ -1152,7 +1374,7 @@ void LibproxProximity::generateObjectQueryEvents(Query* query, bool do_first) {
                 uint64 seqNo = (*seqNoPtr)++;
                 addition.set_seqno (seqNo);
 
-                if (mLocCache->isAggregate(oobjid)) {
+                if (loc_cache->isAggregate(oobjid)) {
                     addition.set_type(Sirikata::Protocol::Prox::ObjectAddition::Aggregate);
                 }
                 else {
@@ -1160,27 +1382,27 @@ void LibproxProximity::generateObjectQueryEvents(Query* query, bool do_first) {
                 }
 
                 Sirikata::Protocol::ITimedMotionVector motion = addition.mutable_location();
-                TimedMotionVector3f loc = mLocCache->location(oobjid);
+                TimedMotionVector3f loc = loc_cache->location(oobjid);
                 motion.set_t(loc.updateTime());
                 motion.set_position(loc.position());
                 motion.set_velocity(loc.velocity());
 
-                TimedMotionQuaternion orient = mLocCache->orientation(oobjid);
+                TimedMotionQuaternion orient = loc_cache->orientation(oobjid);
                 Sirikata::Protocol::ITimedMotionQuaternion msg_orient = addition.mutable_orientation();
                 msg_orient.set_t(orient.updateTime());
                 msg_orient.set_position(orient.position());
                 msg_orient.set_velocity(orient.velocity());
 
                 Sirikata::Protocol::IAggregateBoundingInfo msg_bounds = addition.mutable_aggregate_bounds();
-                AggregateBoundingInfo bnds = mLocCache->bounds(oobjid);
+                AggregateBoundingInfo bnds = loc_cache->bounds(oobjid);
                 msg_bounds.set_center_offset(bnds.centerOffset);
                 msg_bounds.set_center_bounds_radius(bnds.centerBoundsRadius);
                 msg_bounds.set_max_object_size(bnds.maxObjectRadius);
 
-                String mesh = mLocCache->mesh(oobjid).toString();
+                String mesh = loc_cache->mesh(oobjid).toString();
                 if (mesh.size() > 0)
                     addition.set_mesh(mesh);
-                const String& phy = mLocCache->physics(oobjid);
+                const String& phy = loc_cache->physics(oobjid);
                 if (phy.size() > 0)
                     addition.set_physics(phy);
             }
@@ -1221,11 +1443,25 @@ void LibproxProximity::generateObjectQueryEvents(Query* query, bool do_first) {
             evts.pop_front();
         }
 
+        String payload = serializePBJMessage(prox_results);
+        CompactProximityEncoderMap::iterator encoder_it = shard->compactEncoders.find(query_id);
+        if (encoder_it != shard->compactEncoders.end()) {
+            // Quantize relative to the querier since nearby objects are the
+            // most common results
+            String compact_payload;
+            encoder_it->second->encode(prox_results, query->position().position(prox_results.t()), &compact_payload);
+            mStats.objectCompactMessages++;
+            mStats.objectCompactUpdates += prox_results.update_size();
+            mStats.objectCompactFullBytes += payload.size();
+            mStats.objectCompactBytes += compact_payload.size();
+            payload.swap(compact_payload);
+        }
+
         Sirikata::Protocol::Object::ObjectMessage* obj_msg = createObjectMessage(
             mContext->id(),
             UUID::null(), OBJECT_PORT_PROXIMITY,
             query_id, OBJECT_PORT_PROXIMITY,
-            serializePBJMessage(prox_results)
+            payload
         );
         mObjectResults.push(obj_msg);
     }
@@ -1250,25 +1486,25 @@ void LibproxProximity::eraseSeqNoInfo(const ServerID server_id)
 }
 
 
-SeqNoPtr LibproxProximity::getSeqNoInfo(const UUID& obj_id)
+SeqNoPtr LibproxProximity::getSeqNoInfo(ObjectQueryShard* shard, const UUID& obj_id)
 {
     // obj_id == querier
-    ObjectSeqNoInfoMap::iterator proxSeqNoIt = mObjectSeqNos.find(obj_id);
+    ObjectSeqNoInfoMap::iterator proxSeqNoIt = shard->seqNos.find(obj_id);
     // If there is a forceful disconnection, we can end up having erased the
     // seqno ptr but still have some results to process. A null seqno ptr
     // indicates we should ignore the results.
-    if (proxSeqNoIt == mObjectSeqNos.end())
+    if (proxSeqNoIt == shard->seqNos.end())
         return SeqNoPtr();
-    assert(proxSeqNoIt != mObjectSeqNos.end());
+    assert(proxSeqNoIt != shard->seqNos.end());
     return proxSeqNoIt->second;
 }
 
-void LibproxProximity::eraseSeqNoInfo(const UUID& obj_id)
+void LibproxProximity::eraseSeqNoInfo(ObjectQueryShard* shard, const UUID& obj_id)
 {
     // obj_id == querier
-    ObjectSeqNoInfoMap::iterator proxSeqNoIt = mObjectSeqNos.find(obj_id);
-    if (proxSeqNoIt == mObjectSeqNos.end()) return;
-    mObjectSeqNos.erase(proxSeqNoIt);
+    ObjectSeqNoInfoMap::iterator proxSeqNoIt = shard->seqNos.find(obj_id);
+    if (proxSeqNoIt == shard->seqNos.end()) return;
+    shard->seqNos.erase(proxSeqNoIt);
 }
 
 
@@ -1364,7 +1600,7 @@ void LibproxProximity::handleDisconnectedServer(ServerID sid) {
         mLocService->removeReplicaObject(t, *it);
 }
 
-void LibproxProximity::handleUpdateObjectQuery(const UUID& object, const TimedMotionVector3f& loc, const BoundingSphere3f& bounds, const SolidAngle& angle, uint32 max_results, SeqNoPtr seqno) {
+void LibproxProximity::handleUpdateObjectQuery(ObjectQueryShard* shard, const UUID& object, const TimedMotionVector3f& loc, const BoundingSphere3f& bounds, const SolidAngle& angle, uint32 max_results, SeqNoPtr seqno) {
     BoundingSphere3f region(bounds.center(), 0);
     float ms = bounds.radius();
 
@@ -1374,13 +1610,13 @@ void LibproxProximity::handleUpdateObjectQuery(const UUID& object, const TimedMo
     // objects triggering movement.
     bool explicit_query_params_update = ((angle != NoUpdateSolidAngle) || (max_results != NoUpdateMaxResults));
 
-    if (mObjectSeqNos.find(object) == mObjectSeqNos.end()) {
+    if (shard->seqNos.find(object) == shard->seqNos.end()) {
         // If there's no existing query, so this was just because of a
         // location update -- don't record a query since it wouldn't
         // do anything anyway.
         if (!explicit_query_params_update) return;
 
-        mObjectSeqNos.insert( ObjectSeqNoInfoMap::value_type(object, seqno) );
+        shard->seqNos.insert( ObjectSeqNoInfoMap::value_type(object, seqno) );
     }
 
     // Log, but only if this isn't just due to object movement
@@ -1389,24 +1625,26 @@ void LibproxProximity::handleUpdateObjectQuery(const UUID& object, const TimedMo
 
 
     for(int i = 0; i < NUM_OBJECT_CLASSES; i++) {
-        if (mObjectQueryHandler[i].handler == NULL) continue;
+        if (shard->handlers[i].handler == NULL) continue;
 
-        ObjectQueryMap::iterator it = mObjectQueries[i].find(object);
+        ObjectQueryMap::iterator it = shard->queries[i].find(object);
 
-        if (it == mObjectQueries[i].end()) {
+        if (it == shard->queries[i].end()) {
             // We only add if we actually have all the necessary info, most importantly a real minimum angle.
             // This is necessary because we get this update for all location updates, even those for objects
             // which don't have subscriptions.
             if (angle != NoUpdateSolidAngle) {
                 Query* q = mObjectDistance ?
-                    mObjectQueryHandler[i].handler->registerQuery(loc, region, ms, SolidAngle::Min, mDistanceQueryDistance) :
-                    mObjectQueryHandler[i].handler->registerQuery(loc, region, ms, angle);
+                    shard->handlers[i].handler->registerQuery(loc, region, ms, SolidAngle::Min, mDistanceQueryDistance) :
+                    shard->handlers[i].handler->registerQuery(loc, region, ms, angle);
                 if (max_results != NoUpdateMaxResults && max_results > 0)
                     q->maxResults(max_results);
-                mObjectQueries[i][object] = q;
-                mInvertedObjectQueries[q] = object;
-                mObjectQueriesFirstIteration.insert(q);
-                q->setEventListener(this);
+                if (i == OBJECT_CLASS_STATIC)
+                    shard->numQueries++;
+                shard->queries[i][object] = q;
+                shard->invertedQueries[q] = object;
+                shard->queriesFirstIteration.insert(q);
+                q->setEventListener(shard);
             }
         }
         else {
@@ -1422,23 +1660,26 @@ void LibproxProximity::handleUpdateObjectQuery(const UUID& object, const TimedMo
     }
 }
 
-void LibproxProximity::handleRemoveObjectQuery(const UUID& object, bool notify_main_thread) {
+void LibproxProximity::handleRemoveObjectQuery(ObjectQueryShard* shard, const UUID& object, bool notify_main_thread) {
     // Clear out queries
     for(int i = 0; i < NUM_OBJECT_CLASSES; i++) {
-        if (mObjectQueryHandler[i].handler == NULL) continue;
+        if (shard->handlers[i].handler == NULL) continue;
 
-        ObjectQueryMap::iterator it = mObjectQueries[i].find(object);
-        if (it == mObjectQueries[i].end()) continue;
+        ObjectQueryMap::iterator it = shard->queries[i].find(object);
+        if (it == shard->queries[i].end()) continue;
 
         Query* q = it->second;
-        mObjectQueries[i].erase(it);
-        mInvertedObjectQueries.erase(q);
-        mObjectQueriesFirstIteration.erase(q);
+        if (i == OBJECT_CLASS_STATIC)
+            shard->numQueries--;
+        shard->queries[i].erase(it);
+        shard->invertedQueries.erase(q);
+        shard->queriesFirstIteration.erase(q);
         delete q; // Note: Deleting query notifies QueryHandler and unsubscribes.
     }
 
     // Clear out sequence numbers
-    eraseSeqNoInfo(object);
+    eraseSeqNoInfo(shard, object);
+    shard->compactEncoders.erase(object);
 
     // Optionally let the main thread know to clear its communication state
     if (notify_main_thread) {
@@ -1451,9 +1692,20 @@ void LibproxProximity::handleRemoveObjectQuery(const UUID& object, bool notify_m
     }
 }
 
-void LibproxProximity::handleDisconnectedObject(const UUID& object) {
+void LibproxProximity::handleDisconnectedObject(ObjectQueryShard* shard, const UUID& object) {
     // Clear out query state if it exists
-    handleRemoveObjectQuery(object, false);
+    handleRemoveObjectQuery(shard, object, false);
+}
+
+void LibproxProximity::handleUpdateObjectQueryEncoding(ObjectQueryShard* shard, const UUID& object, bool compact) {
+    CompactProximityEncoderMap::iterator it = shard->compactEncoders.find(object);
+    if (compact && it == shard->compactEncoders.end()) {
+        PROXLOG(detailed, "Sending compact results to " << object.toString());
+        shard->compactEncoders[object] = CompactProximityEncoderPtr(new CompactProximityEncoder(mObjectCompactQuantum));
+    }
+    else if (!compact && it != shard->compactEncoders.end()) {
+        shard->compactEncoders.erase(it);
+    }
 }
 
 bool LibproxProximity::handlerShouldHandleObject(bool is_static_handler, bool is_global_handler, const ObjectReference& obj_id, bool is_local, bool is_aggregate, const TimedMotionVector3f& pos, const BoundingSphere3f& region, float maxSize) {
@@ -1500,8 +1752,25 @@ void LibproxProximity::handleCheckObjectClassForHandlers(const ObjectReference&
     handlers[swap_in].additions.insert(objid);
 }
 
+void LibproxProximity::handleCheckObjectClassForShard(ObjectQueryShard* shard, const ObjectReference& objid, bool is_static) {
+    if (!shard->handlers[OBJECT_CLASS_STATIC].handler->containsObject(objid) &&
+        !shard->handlers[OBJECT_CLASS_DYNAMIC].handler->containsObject(objid))
+        return;
+    handleCheckObjectClassForHandlers(objid, is_static, shard->handlers);
+}
+
 void LibproxProximity::trySwapHandlers(bool is_local, const ObjectReference& objid, bool is_static) {
-    handleCheckObjectClassForHandlers(objid, is_static, mObjectQueryHandler);
+    for(uint32 s = 0; s < mObjectQueryShards.size(); s++) {
+        ObjectQueryShard* shard = mObjectQueryShards[s];
+        if (shard->strand == mProxStrand) {
+            handleCheckObjectClassForHandlers(objid, is_static, shard->handlers);
+            continue;
+        }
+        shard->strand->post(
+            std::tr1::bind(&LibproxProximity::handleCheckObjectClassForShard, this, shard, objid, is_static),
+            "LibproxProximity::handleCheckObjectClassForShard"
+        );
+    }
     if (is_local)
         handleCheckObjectClassForHandlers(objid, is_static, mServerQueryHandler);
 }
@@ -39,6 +39,7 @@
 #include <prox/base/AggregateListener.hpp>
 
 #include <sirikata/core/queue/ThreadSafeQueue.hpp>
+#include <sirikata/core/prox/CompactProximityResults.hpp>
 
 namespace Sirikata {
 
@@ -111,6 +112,7 @@ public:
 
 private:
     struct ProxQueryHandlerData;
+    struct ObjectQueryShard;
     typedef std::tr1::unordered_set<ServerID> ServerSet;
 
     void handleObjectProximityMessage(const UUID& objid, void* buffer, uint32 length);
@@ -143,6 +145,8 @@ private:
 
     // Object queries
     void updateQuery(UUID obj, const TimedMotionVector3f& loc, const BoundingSphere3f& bounds, SolidAngle sa, uint32 max_results);
+    // Switch the encoding of results sent to an object
+    void updateQueryEncoding(UUID obj, bool compact);
 
     // Send a query add/update request to any servers we've marked as needing an
     // update
@@ -159,18 +163,24 @@ private:
     virtual void handleConnectedServer(ServerID server);
     virtual void handleDisconnectedServer(ServerID server);
 
-    void handleUpdateObjectQuery(const UUID& object, const TimedMotionVector3f& loc, const BoundingSphere3f& bounds, const SolidAngle& angle, uint32 max_results, SeqNoPtr seqno);
-    void handleRemoveObjectQuery(const UUID& object, bool notify_main_thread);
-    void handleDisconnectedObject(const UUID& object);
+    // Object queries are handled in the shard that owns the querier, on that
+    // shard's strand
+    void handleUpdateObjectQuery(ObjectQueryShard* shard, const UUID& object, const TimedMotionVector3f& loc, const BoundingSphere3f& bounds, const SolidAngle& angle, uint32 max_results, SeqNoPtr seqno);
+    void handleRemoveObjectQuery(ObjectQueryShard* shard, const UUID& object, bool notify_main_thread);
+    void handleDisconnectedObject(ObjectQueryShard* shard, const UUID& object);
+    void handleUpdateObjectQueryEncoding(ObjectQueryShard* shard, const UUID& object, bool compact);
 
     // Generate query events based on results collected from query handlers
     void generateServerQueryEvents(Query* query);
-    void generateObjectQueryEvents(Query* query, bool do_first=false);
+    void generateObjectQueryEvents(ObjectQueryShard* shard, Query* query, bool do_first=false);
 
     // Decides whether a query handler should handle a particular object.
     bool handlerShouldHandleObject(bool is_static_handler, bool is_global_handler, const ObjectReference& obj_id, bool local, bool aggregate, const TimedMotionVector3f& pos, const BoundingSphere3f& region, float maxSize);
     // The real handler for moving objects between static/dynamic
     void handleCheckObjectClassForHandlers(const ObjectReference& objid, bool is_static, ProxQueryHandlerData handlers[NUM_OBJECT_CLASSES]);
+    // Same as above, for shards running on their own strand. Their replica
+    // may have already dropped the object, in which case this does nothing.
+    void handleCheckObjectClassForShard(ObjectQueryShard* shard, const ObjectReference& objid, bool is_static);
     virtual void trySwapHandlers(bool is_local, const ObjectReference& objid, bool is_static);
 
     /**
@@ -181,8 +191,8 @@ private:
      */
     SeqNoPtr getOrCreateSeqNoInfo(const ServerID server_id);
     void eraseSeqNoInfo(const ServerID server_id);
-    SeqNoPtr getSeqNoInfo(const UUID& obj_id);
-    void eraseSeqNoInfo(const UUID& obj_id);
+    SeqNoPtr getSeqNoInfo(ObjectQueryShard* shard, const UUID& obj_id);
+    void eraseSeqNoInfo(ObjectQueryShard* shard, const UUID& obj_id);
 
     typedef std::set<UUID> ObjectSet;
     typedef std::tr1::unordered_map<ServerID, Query*> ServerQueryMap;
@@ -220,6 +230,13 @@ private:
     ObjectQueryAngleMap mObjectQueryAngles;
     typedef std::map<UUID, uint32> ObjectQueryMaxCountMap;
     ObjectQueryMaxCountMap mObjectQueryMaxCounts;
+    // And their positions and sizes, used to compute aggregate querier bounds
+    struct ObjectQuerierRegion {
+        TimedMotionVector3f loc;
+        float32 maxSize;
+    };
+    typedef std::tr1::unordered_map<UUID, ObjectQuerierRegion, UUID::Hasher> ObjectQuerierRegionMap;
+    ObjectQuerierRegionMap mObjectQuerierRegions;
 
 
     // Aggregate query info. Aggregate object stats are managed by
@@ -241,21 +258,56 @@ private:
 
 
 
-    // PROX Thread - Should only be accessed in methods used by the prox thread
+    // MAIN Thread
+    void recomputeAggregateQueryBounds();
+
+    // Find the shard responsible for a querier
+    ObjectQueryShard* objectQueryShard(const UUID& querier);
+
+
+    // PROX Thread - Should only be accessed in methods used by the prox
+    // thread, except for the object query shards which are accessed on their
+    // own strands
 
+    void tickServerQueryHandler();
+    void tickObjectQueryShard(ObjectQueryShard* shard);
     void tickQueryHandler(ProxQueryHandlerData qh[NUM_OBJECT_CLASSES]);
     void rebuildHandlerType(ProxQueryHandlerData* handler, ObjectClass objtype);
     void rebuildHandler(ObjectClass objtype);
 
-    void recomputeAggregateQueryBounds();
-
     // Command handlers
     virtual void commandProperties(const Command::Command& cmd, Command::Commander* cmdr, Command::CommandID cmdid);
     virtual void commandListHandlers(const Command::Command& cmd, Command::Commander* cmdr, Command::CommandID cmdid);
-    bool parseHandlerName(const String& name, ProxQueryHandlerData** handlers_out, ObjectClass* class_out);
+    bool parseHandlerName(const String& name, ProxQueryHandlerData** handlers_out, ObjectClass* class_out, Network::IOStrand** strand_out);
     virtual void commandForceRebuild(const Command::Command& cmd, Command::Commander* cmdr, Command::CommandID cmdid);
     virtual void commandListNodes(const Command::Command& cmd, Command::Commander* cmdr, Command::CommandID cmdid);
     virtual void commandListQueriers(const Command::Command& cmd, Command::Commander* cmdr, Command::CommandID cmdid);
+    virtual void commandStats(const Command::Command& cmd, Command::Commander* cmdr, Command::CommandID cmdid);
+    // The parts of the above commands that must run on the strand owning the
+    // handler or shard
+    void listHandlerNodes(ProxQueryHandlerData* handlers, ObjectClass klass, Command::Commander* cmdr, Command::CommandID cmdid);
+    void forceRebuildHandler(ProxQueryHandlerData* handlers, ObjectClass klass, Command::Commander* cmdr, Command::CommandID cmdid);
+    void listShardHandlers(ObjectQueryShard* shard, Command::Result& result);
+    void listShardQueriers(ObjectQueryShard* shard, Command::Result& result);
+
+    // Collects part of a command's result from each object query shard, on the
+    // shard's strand, and sends the result once all have contributed.
+    struct ShardedCommandResult {
+        ShardedCommandResult(Command::Commander* _cmdr, Command::CommandID _cmdid, uint32 nshards)
+         : cmdr(_cmdr), cmdid(_cmdid), remaining(nshards), result(Command::EmptyResult())
+        {}
+        Command::Commander* cmdr;
+        Command::CommandID cmdid;
+        boost::mutex mutex;
+        uint32 remaining;
+        Command::Result result;
+    };
+    typedef std::tr1::shared_ptr<ShardedCommandResult> ShardedCommandResultPtr;
+    typedef std::tr1::function<void(ObjectQueryShard*, Command::Result&)> ShardCommandFunction;
+    void runOnObjectQueryShards(ShardedCommandResultPtr sharded_result, ShardCommandFunction func);
+    void runOnObjectQueryShard(ShardedCommandResultPtr sharded_result, ShardCommandFunction func, ObjectQueryShard* shard);
+
+    static String objectQueryShardName(uint32 idx);
 
     typedef std::tr1::unordered_set<ObjectReference, ObjectReference::Hasher> ObjectIDSet;
     struct ProxQueryHandlerData {
@@ -281,14 +333,9 @@ private:
     PollerService mServerHandlerPoller;
     PollerService mServerQueryBoundsPoller;
 
-    // These track all objects being reported to this server and
-    // answer queries for objects connected to this server.
-    ObjectQueryMap mObjectQueries[NUM_OBJECT_CLASSES];
-    InvertedObjectQueryMap mInvertedObjectQueries;
-    FirstIterationObjectSet mObjectQueriesFirstIteration;
-    ProxQueryHandlerData mObjectQueryHandler[NUM_OBJECT_CLASSES];
     bool mObjectDistance; // Using distance queries
-    PollerService mObjectHandlerPoller;
+    // Position precision for objects which requested compact results
+    float32 mObjectCompactQuantum;
 
     // Pollers that trigger rebuilding of query data structures
     PollerService mStaticRebuilderPoller;
@@ -298,7 +345,47 @@ private:
     typedef std::tr1::unordered_map<ServerID, SeqNoPtr> ServerSeqNoInfoMap;
     ServerSeqNoInfoMap mServerSeqNos;
     typedef std::tr1::unordered_map<UUID, SeqNoPtr, UUID::Hasher> ObjectSeqNoInfoMap;
-    ObjectSeqNoInfoMap mObjectSeqNos;
+    // Encoders for queriers which requested compact results. They hold the
+    // state for each querier's stream of results.
+    typedef std::tr1::shared_ptr<CompactProximityEncoder> CompactProximityEncoderPtr;
+    typedef std::tr1::unordered_map<UUID, CompactProximityEncoderPtr, UUID::Hasher> CompactProximityEncoderMap;
+
+    // These track all objects being reported to this server and answer
+    // queries for objects connected to this server. Queries can be split
+    // across several shards, each with its own strand, replica of the object
+    // query handlers and location cache. Queriers are assigned to shards by ID,
+    // so all events for a querier are generated in order by a single
+    // shard. The first shard shares the prox strand and mLocCache.
+    struct ObjectQueryShard : public Prox::QueryEventListener<ObjectProxSimulationTraits, Query> {
+        ObjectQueryShard(LibproxProximity* _parent, uint32 _index, Network::IOStrand* _strand, CBRLocationServiceCache* _loc_cache);
+
+        // QueryEventListener Interface
+        virtual void queryHasEvents(Query* query);
+
+        LibproxProximity* parent;
+        uint32 index;
+        Network::IOStrand* strand;
+        CBRLocationServiceCache* locCache;
+        PollerService* poller;
+
+        // Shard strand only
+        ProxQueryHandlerData handlers[NUM_OBJECT_CLASSES];
+        ObjectQueryMap queries[NUM_OBJECT_CLASSES];
+        InvertedObjectQueryMap invertedQueries;
+        FirstIterationObjectSet queriesFirstIteration;
+        ObjectSeqNoInfoMap seqNos;
+        CompactProximityEncoderMap compactEncoders;
+        InstanceMethodNotReentrant queryHasEventsNotReentrant;
+
+        // Thread safe stats
+        AtomicValue<uint32> numQueries;
+        AtomicValue<uint32> ticks;
+        AtomicValue<uint64> tickTotalMicroseconds;
+        AtomicValue<uint64> tickMaxMicroseconds;
+        AtomicValue<uint64> tickLastMicroseconds;
+    };
+    typedef std::vector<ObjectQueryShard*> ObjectQueryShardList;
+    ObjectQueryShardList mObjectQueryShards;
 
 
     // Threads: Thread-safe data used for exchange between threads
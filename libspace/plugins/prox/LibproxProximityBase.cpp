@@ -40,10 +40,11 @@ void LibproxProximityBase::ProxStreamInfo<EndpointType, StreamType>::handleRead(
     Ptr prox_stream = w_prox_stream.lock();
     if (!prox_stream) return;
 
-    prox_stream->partial_frame.append((const char*)data, size);
-    while(true) {
-        String parsed = Network::Frame::parse(prox_stream->partial_frame);
-        if (parsed.empty()) return;
+    prox_stream->frame_reader.append(data, size);
+    MemoryReference frame = MemoryReference::null();
+    while(prox_stream->frame_reader.next(&frame)) {
+        // Handlers may hop strands, so they get their own copy
+        String parsed((const char*)frame.data(), frame.size());
         prox_stream->read_frame_cb(parsed);
     }
 }
@@ -242,7 +243,7 @@ bool LibproxProximityBase::velocityIsStatic(const Vector3f& vel) {
 }
 
 
-void LibproxProximityBase::coalesceEvents(QueryEventList& evts, uint32 per_event) {
+void LibproxProximityBase::coalesceEvents(QueryEventList& evts, uint32 per_event, CBRLocationServiceCache* loc_cache) {
     if (evts.empty()) return;
 
     // We keep two maps from UUID to QueryEvent:
@@ -277,7 +278,7 @@ void LibproxProximityBase::coalesceEvents(QueryEventList& evts, uint32 per_event
         evts.pop_front();
     }
     // Now we just need to repack them.
-    QueryEvent next_evt(mLocCache, qhiid);
+    QueryEvent next_evt(loc_cache, qhiid);
     while(!additions.empty() || !removals.empty()) {
         // Get next addition or removal and remove it from our list
         if (!additions.empty()) {
@@ -294,7 +295,7 @@ void LibproxProximityBase::coalesceEvents(QueryEventList& evts, uint32 per_event
             (additions.empty() && removals.empty()))
         {
             evts.push_back(next_evt);
-            next_evt = QueryEvent(mLocCache, qhiid);
+            next_evt = QueryEvent(loc_cache, qhiid);
         }
     }
 }
@@ -770,7 +771,11 @@ void LibproxProximityBase::updateAggregateLoc(const ObjectReference& objid, cons
 
 void LibproxProximityBase::commandStats(const Command::Command& cmd, Command::Commander* cmdr, Command::CommandID cmdid) {
     Command::Result result = Command::EmptyResult();
+    fillStats(result);
+    cmdr->result(cmdid, result);
+}
 
+void LibproxProximityBase::fillStats(Command::Result& result) {
     result.put("stats.object.sent.bytes", mStats.objectSentBytes.read());
     result.put("stats.object.sent.messages", mStats.objectSentMessages.read());
     result.put("stats.object.received.bytes", mStats.objectReceivedBytes.read());
@@ -786,7 +791,13 @@ void LibproxProximityBase::commandStats(const Command::Command& cmd, Command::Co
     result.put("stats.space.received.bytes", mStats.spaceReceivedBytes.read());
     result.put("stats.space.received.messages", mStats.spaceReceivedMessages.read());
 
-    cmdr->result(cmdid, result);
+    uint32 compact_updates = mStats.objectCompactUpdates.read();
+    int64 compact_saved = (int64)mStats.objectCompactFullBytes.read() - (int64)mStats.objectCompactBytes.read();
+    result.put("stats.object.compact.messages", mStats.objectCompactMessages.read());
+    result.put("stats.object.compact.updates", compact_updates);
+    result.put("stats.object.compact.bytes", mStats.objectCompactBytes.read());
+    result.put("stats.object.compact.saved.bytes", compact_saved);
+    result.put("stats.object.compact.saved.bytes_per_update", (compact_updates > 0 ? (float64)compact_saved / compact_updates : 0.0));
 }
 
 } // namespace Sirikata
@@ -15,6 +15,7 @@
 #include <boost/multi_index/ordered_index.hpp>
 
 #include <sirikata/core/util/InstanceMethodNotReentrant.hpp>
+#include <sirikata/core/network/Frame.hpp>
 
 namespace Sirikata {
 
@@ -58,8 +59,9 @@ protected:
     //
     // per_event indicates how many additions/removals to put in each
     // event. Since they are no longer forced to be together to be atomic, we
-    // can pack them however we like.
-    void coalesceEvents(QueryEventList& evts, uint32 per_event);
+    // can pack them however we like. loc_cache must be the cache used by the
+    // query handler that generated the events.
+    void coalesceEvents(QueryEventList& evts, uint32 per_event, CBRLocationServiceCache* loc_cache);
 
     // BOTH Threads: These are read-only or lock protected.
 
@@ -76,7 +78,11 @@ protected:
            spaceSentBytes(0),
            spaceSentMessages(0),
            spaceReceivedBytes(0),
-           spaceReceivedMessages(0)
+           spaceReceivedMessages(0),
+           objectCompactMessages(0),
+           objectCompactUpdates(0),
+           objectCompactFullBytes(0),
+           objectCompactBytes(0)
         {}
 
         // Total number of bytes sent to objects
@@ -105,6 +111,15 @@ protected:
         AtomicValue<uint32> spaceReceivedBytes;
         // Total messages received from other space servers
         AtomicValue<uint32> spaceReceivedMessages;
+
+        // Result messages to objects which requested compact results
+        AtomicValue<uint32> objectCompactMessages;
+        // Updates contained in those messages
+        AtomicValue<uint32> objectCompactUpdates;
+        // Bytes those messages would have taken with the full encoding
+        AtomicValue<uint64> objectCompactFullBytes;
+        // Bytes those messages actually took
+        AtomicValue<uint64> objectCompactBytes;
     };
     Stats mStats;
 
@@ -216,7 +231,7 @@ protected:
         // Stored callback for reading frames
         FrameReceivedCallback read_frame_cb;
         // Backlog of data, i.e. incomplete frame
-        String partial_frame;
+        Network::FrameReader frame_reader;
 
         // Defined safely in cpp since these are only used from
         // LibproxProximityBase
@@ -367,6 +382,9 @@ protected:
     virtual void commandForceRebuild(const Command::Command& cmd, Command::Commander* cmdr, Command::CommandID cmdid) = 0;
     virtual void commandListNodes(const Command::Command& cmd, Command::Commander* cmdr, Command::CommandID cmdid) = 0;
     virtual void commandStats(const Command::Command& cmd, Command::Commander* cmdr, Command::CommandID cmdid);
+    // Fills in the stats reported by commandStats, for implementations that
+    // want to add their own
+    void fillStats(Command::Result& result);
 
 }; // class LibproxProximityBase
 
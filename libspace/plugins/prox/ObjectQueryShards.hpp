@@ -0,0 +1,49 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_SPACE_PROX_OBJECT_QUERY_SHARDS_HPP_
+#define _SIRIKATA_SPACE_PROX_OBJECT_QUERY_SHARDS_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+
+namespace Sirikata {
+
+/** Returns true if results from query handlers of the given type (see
+ *  QueryHandlerFactory) can include aggregates, i.e. internal nodes of the
+ *  handler's tree, instead of only the objects at its leaves.
+ */
+inline bool queryHandlerReturnsAggregates(const String& handler_type) {
+    return (handler_type == "rtreecut" || handler_type == "rtreecutagg" || handler_type == "level");
+}
+
+/** Returns the number of object query shards to use for handlers of the given
+ *  type when num_requested were asked for. Every shard builds its own trees
+ *  and aggregate IDs are random, so each shard names its aggregates
+ *  differently and only one shard's aggregates can be registered with the
+ *  LocationService and AggregateManager. Queriers on any other shard would be
+ *  sent aggregates nobody knows about, so handlers which return aggregates
+ *  only get a single shard.
+ */
+inline uint32 objectQueryShardCount(const String& handler_type, uint32 num_requested) {
+    if (num_requested < 1 || queryHandlerReturnsAggregates(handler_type))
+        return 1;
+    return num_requested;
+}
+
+/** Sets up aggregate reporting for one of the handlers of object query shard
+ *  number shard. Every shard's handlers index all the objects and differ only
+ *  in the queriers they hold, so they would all report the same aggregates.
+ *  Only the first shard's handlers report to listener, which then sees each
+ *  aggregate once however many shards there are. Must be called before the
+ *  handler is initialized.
+ */
+template<typename HandlerType, typename ListenerType>
+void setObjectQueryShardAggregateListener(uint32 shard, HandlerType* handler, ListenerType* listener) {
+    if (shard == 0)
+        handler->setAggregateListener(listener);
+}
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_SPACE_PROX_OBJECT_QUERY_SHARDS_HPP_
@@ -15,5 +15,7 @@
 #define OPT_PROX_SERVER_QUERY_HANDLER_OPTIONS      "prox.server.handler-options"
 #define OPT_PROX_OBJECT_QUERY_HANDLER_TYPE         "prox.object.handler"
 #define OPT_PROX_OBJECT_QUERY_HANDLER_OPTIONS      "prox.object.handler-options"
+#define OPT_PROX_OBJECT_QUERY_SHARDS               "prox.object.shards"
+#define OPT_PROX_OBJECT_COMPACT_QUANTUM            "prox.object.compact-quantum"
 
 #endif //_SIRIKATA_SPACE_PROX_OPTIONS_HPP_
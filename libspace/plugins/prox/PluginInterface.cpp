@@ -61,6 +61,8 @@ static void InitPluginOptions() {
 
         .addOption(new OptionValue(OPT_PROX_OBJECT_QUERY_HANDLER_TYPE, "rtreecut", Sirikata::OptionValueType<String>(), "Type of libprox query handler to use for queries from servers."))
         .addOption(new OptionValue(OPT_PROX_OBJECT_QUERY_HANDLER_OPTIONS, "", Sirikata::OptionValueType<String>(), "Options for the query handler."))
+        .addOption(new OptionValue(OPT_PROX_OBJECT_QUERY_SHARDS, "1", Sirikata::OptionValueType<uint32>(), "Number of strands to split queries from objects across. Each shard keeps its own copy of the object query handlers, so memory use grows with the number of shards. Handler types whose results include aggregates (rtreecut, rtreecutagg, level) always use a single shard."))
+        .addOption(new OptionValue(OPT_PROX_OBJECT_COMPACT_QUANTUM, "0.01", Sirikata::OptionValueType<float32>(), "Precision, in meters, of positions in compact results sent to objects which request them."))
 
         ;
 }
@@ -46,6 +46,8 @@ static void InitPluginOptions() {
         new OptionValue("prefix","",Sirikata::OptionValueType<String>(),"Prefix for redis keys, allowing you to provide 'namespaces' so multiple spaces can share the same redis database."),
         new OptionValue("ttl","60s",Sirikata::OptionValueType<Duration>(),"Duration for keys to remain valid in Redis before they are automatically removed in case of dead nodes. This is a tradeoff between having to refresh entries and how long it takes before an object identifier can be reclaimed after a server crashes."),
         new OptionValue("transactions","true",Sirikata::OptionValueType<bool>(),"If false, disables transactions. This isn't really safe as you can fail between commands and get keys stuck, but it allows running against older versions of Redis. Since this isn't safe, transactions are turned on by default."),
+        new OptionValue("lookup-batch-size","64",Sirikata::OptionValueType<uint32>(),"Maximum number of object lookups to send to Redis in a single MGET."),
+        new OptionValue("lookup-batch-window","1ms",Sirikata::OptionValueType<Duration>(),"How long to wait for more lookups before sending a batch that isn't full. 0 sends every lookup immediately."),
         NULL
     );
 }
@@ -59,8 +61,10 @@ static ObjectSegmentation* createRedisOSeg(SpaceContext* ctx, Network::IOStrand*
     String redis_prefix = optionsSet->referenceOption("prefix")->as<String>();
     Duration redis_ttl = optionsSet->referenceOption("ttl")->as<Duration>();
     bool redis_has_transactions = optionsSet->referenceOption("transactions")->as<bool>();
+    uint32 lookup_batch_size = optionsSet->referenceOption("lookup-batch-size")->as<uint32>();
+    Duration lookup_batch_window = optionsSet->referenceOption("lookup-batch-window")->as<Duration>();
 
-    return new RedisObjectSegmentation(ctx, oseg_strand, cseg, cache, redis_host, redis_port, redis_prefix, redis_ttl, redis_has_transactions);
+    return new RedisObjectSegmentation(ctx, oseg_strand, cseg, cache, redis_host, redis_port, redis_prefix, redis_ttl, redis_has_transactions, lookup_batch_size, lookup_batch_window);
 }
 
 } // namespace Sirikata
@@ -0,0 +1,54 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_REDIS_BATCH_READ_HPP_
+#define _SIRIKATA_REDIS_BATCH_READ_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/util/UUID.hpp>
+#include <hiredis/async.h>
+
+namespace Sirikata {
+
+/** Fans the reply to an MGET of objs out to handler, which gets
+ *  finishReadObject(obj, value) for each object that has a value and
+ *  failReadObject(obj) for every other one. Every object gets exactly one
+ *  call whatever the reply was, otherwise later lookups for the same objects
+ *  would wait on it forever. reply is NULL if the command failed outright.
+ */
+template<typename Handler>
+void dispatchMGetReply(const redisReply* reply, const std::vector<UUID>& objs, Handler* handler) {
+    if (reply == NULL) {
+        SILOG(redis_oseg, error, "Unknown redis error when reading " << objs.size() << " objects");
+        for(uint32 i = 0; i < objs.size(); i++)
+            handler->failReadObject(objs[i]);
+    }
+    else if (reply->type == REDIS_REPLY_ERROR) {
+        SILOG(redis_oseg, error, "Redis error when reading " << objs.size() << " objects: " << String(reply->str, reply->len));
+        for(uint32 i = 0; i < objs.size(); i++)
+            handler->failReadObject(objs[i]);
+    }
+    else if (reply->type == REDIS_REPLY_ARRAY && reply->elements == objs.size()) {
+        for(uint32 i = 0; i < objs.size(); i++) {
+            const redisReply* elem = reply->element[i];
+            if (elem->type == REDIS_REPLY_STRING) {
+                handler->finishReadObject(objs[i], String(elem->str, elem->len));
+            }
+            else {
+                if (elem->type != REDIS_REPLY_NIL)
+                    SILOG(redis_oseg, error, "Unexpected redis reply type when reading object " << objs[i].toString() << ": " << elem->type);
+                handler->failReadObject(objs[i]);
+            }
+        }
+    }
+    else {
+        SILOG(redis_oseg, error, "Unexpected redis reply when reading " << objs.size() << " objects, type " << reply->type);
+        for(uint32 i = 0; i < objs.size(); i++)
+            handler->failReadObject(objs[i]);
+    }
+}
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_REDIS_BATCH_READ_HPP_
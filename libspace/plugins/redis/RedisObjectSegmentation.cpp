@@ -31,6 +31,7 @@
  */
 
 #include "RedisObjectSegmentation.hpp"
+#include "RedisBatchRead.hpp"
 #include <boost/algorithm/string.hpp>
 #include <boost/lambda/lambda.hpp>
 #include <boost/lexical_cast.hpp>
@@ -114,29 +115,45 @@ struct RedisObjectMigratedOperationInfo {
     uint8 refcount;
 };
 
-void globalRedisLookupObjectReadFinished(redisAsyncContext* c, void* _reply, void* privdata) {
+// State tracking for a batch of lookups sent as one MGET
+struct RedisObjectBatchOperationInfo {
+    RedisObjectBatchOperationInfo(RedisObjectSegmentation* _oseg)
+     : oseg(_oseg)
+    {}
+
+    RedisObjectSegmentation* oseg;
+    std::vector<UUID> objs;
+};
+
+void globalRedisLookupObjectsReadFinished(redisAsyncContext* c, void* _reply, void* privdata) {
     redisReply *reply = (redisReply*)_reply;
-    RedisObjectOperationInfo* wi = (RedisObjectOperationInfo*)privdata;
+    RedisObjectBatchOperationInfo* bi = (RedisObjectBatchOperationInfo*)privdata;
 
-    if (reply == NULL) {
-        REDISOSEG_LOG(error, "Unknown redis error when reading object " << wi->obj.toString());
-    }
-    else if (reply->type == REDIS_REPLY_ERROR) {
-        REDISOSEG_LOG(error, "Redis error when reading object " << wi->obj.toString() << ": " << String(reply->str, reply->len));
-        wi->oseg->failReadObject(wi->obj);
-    }
-    else if (reply->type == REDIS_REPLY_NIL) {
-        REDISOSEG_LOG(error, "Redis got nil when reading object.");
-        wi->oseg->failReadObject(wi->obj);
-    }
-    else if (reply->type == REDIS_REPLY_STRING) {
-        wi->oseg->finishReadObject(wi->obj, String(reply->str, reply->len));
+    dispatchMGetReply(reply, bi->objs, bi->oseg);
+
+    delete bi;
+}
+
+
+void globalRedisRestoredObjectsReadFinished(redisAsyncContext* c, void* _reply, void* privdata) {
+    redisReply *reply = (redisReply*)_reply;
+    RedisObjectBatchOperationInfo* bi = (RedisObjectBatchOperationInfo*)privdata;
+
+    // Failures aren't retried, the records will expire on their own anyway
+    if (reply == NULL || reply->type != REDIS_REPLY_ARRAY || reply->elements != bi->objs.size()) {
+        REDISOSEG_LOG(error, "Redis error when reading " << bi->objs.size() << " objects restored from snapshot");
     }
     else {
-        REDISOSEG_LOG(error, "Unexpected redis reply type when reading object " << wi->obj.toString() << ": " << reply->type);
+        std::vector<String> data(bi->objs.size());
+        for(uint32 i = 0; i < bi->objs.size(); i++) {
+            redisReply* elem = reply->element[i];
+            if (elem->type == REDIS_REPLY_STRING)
+                data[i] = String(elem->str, elem->len);
+        }
+        bi->oseg->finishReadRestoredObjects(bi->objs, data);
     }
 
-    delete wi;
+    delete bi;
 }
 
 
@@ -351,6 +368,28 @@ void globalRedisDeleteFinished(redisAsyncContext* c, void* _reply, void* privdat
     delete wi;
 }
 
+void globalRedisReleaseFinished(redisAsyncContext* c, void* _reply, void* privdata) {
+    redisReply *reply = (redisReply*)_reply;
+    RedisObjectOperationInfo* wi = (RedisObjectOperationInfo*)privdata;
+
+    // Failures just leave the record to expire on its own
+    if (reply == NULL) {
+        REDISOSEG_LOG(error, "Unknown redis error when releasing object " << wi->obj.toString());
+    }
+    else if (reply->type == REDIS_REPLY_ERROR) {
+        REDISOSEG_LOG(error, "Redis error when releasing object " << wi->obj.toString() << ": " << String(reply->str, reply->len));
+    }
+    else if (reply->type == REDIS_REPLY_INTEGER) {
+        if (reply->integer == 0)
+            REDISOSEG_LOG(detailed, "Not releasing object " << wi->obj.toString() << ", its record changed since it was read");
+    }
+    else {
+        REDISOSEG_LOG(error, "Unexpected redis reply type when releasing object " << wi->obj.toString() << ": " << reply->type);
+    }
+
+    delete wi;
+}
+
 void globalRedisRefreshObjectTimeoutWriteFinished(redisAsyncContext* c, void* _reply, void* privdata) {
     redisReply *reply = (redisReply*)_reply;
     RedisObjectOperationInfo* wi = (RedisObjectOperationInfo*)privdata;
@@ -400,7 +439,7 @@ void globalRedisRefreshObjectTimeoutWriteFinished(redisAsyncContext* c, void* _r
 
 } // namespace
 
-RedisObjectSegmentation::RedisObjectSegmentation(SpaceContext* con, Network::IOStrand* o_strand, CoordinateSegmentation* cseg, OSegCache* cache, const String& redis_host, uint32 redis_port, const String& redis_prefix, Duration key_ttl, bool redis_has_transactions)
+RedisObjectSegmentation::RedisObjectSegmentation(SpaceContext* con, Network::IOStrand* o_strand, CoordinateSegmentation* cseg, OSegCache* cache, const String& redis_host, uint32 redis_port, const String& redis_prefix, Duration key_ttl, bool redis_has_transactions, uint32 lookup_batch_size, Duration lookup_batch_window)
  : ObjectSegmentation(con, o_strand),
    mCSeg(cseg),
    mCache(cache),
@@ -413,6 +452,14 @@ RedisObjectSegmentation::RedisObjectSegmentation(SpaceContext* con, Network::IOS
    mRedisFD(NULL),
    mReading(false),
    mWriting(false),
+   mLookupBatcher(lookup_batch_size),
+   mLookupBatchWindow(lookup_batch_window),
+   mLookupBatchTimer(
+       Network::IOTimer::create(
+           o_strand,
+           std::tr1::bind(&RedisObjectSegmentation::flushLookups, this)
+       )
+   ),
    mExpiryTimer(
        Network::IOTimer::create(
            con->mainStrand,
@@ -429,10 +476,13 @@ RedisObjectSegmentation::~RedisObjectSegmentation() {
 void RedisObjectSegmentation::start() {
     ObjectSegmentation::start();
     connect();
+    validateRestoredObjects();
 }
 
 void RedisObjectSegmentation::stop() {
     mExpiryTimer->cancel();
+    mLookupBatchTimer->cancel();
+    reportLookupStats();
     ObjectSegmentation::stop();
 }
 
@@ -444,9 +494,9 @@ void RedisObjectSegmentation::connect() {
         REDISOSEG_LOG(error, "Failed to connect to redis: " << mRedisContext->errstr);
         redisAsyncDisconnect(mRedisContext);
         mRedisContext = NULL;
-    } else {
-        REDISOSEG_LOG(insane, "Optimistically connected to redis.");
+        return;
     }
+    REDISOSEG_LOG(insane, "Optimistically connected to redis.");
 
     // This appears to be the only way to get a non-static 'argument' to the
     // connect and disconnect callbacks.
@@ -584,21 +634,90 @@ OSegEntry RedisObjectSegmentation::lookup(const UUID& obj_id) {
     OSegMap::const_iterator it = mOSeg.find(obj_id);
     if (it != mOSeg.end()) return it->second;
 
-    // Otherwise, kick off the lookup process and return null
+    // Otherwise, kick off the lookup process and return null. The lookup is
+    // sent along with any others requested within the batching window.
     if (mStopping) return OSegEntry::null();
-    RedisObjectOperationInfo* ri = new RedisObjectOperationInfo(this, obj_id);
     ensureConnected();
     {
         Lock lck(mMutex);
-        redisAsyncCommand(mRedisContext, globalRedisLookupObjectReadFinished, ri, "GET %s%s", mRedisPrefix.c_str(), obj_id.toString().c_str());
+        bool started_batch = mLookupBatcher.add(obj_id, mContext->simTime());
+        if (mLookupBatcher.full() || mLookupBatchWindow == Duration::zero())
+            flushLookups();
+        else if (started_batch)
+            mLookupBatchTimer->wait(mLookupBatchWindow);
     }
     return OSegEntry::null();
 }
 
+void RedisObjectSegmentation::flushLookups() {
+    Lock lck(mMutex);
+    if (mStopping) return;
+
+    while(!mLookupBatcher.empty()) {
+        RedisObjectBatchOperationInfo* bi = new RedisObjectBatchOperationInfo(this);
+        mLookupBatcher.take(&bi->objs);
+        if (!sendMGet(bi->objs, globalRedisLookupObjectsReadFinished, bi)) {
+            // Nothing will ever answer these, so fail them now rather than
+            // leaving later lookups for the same objects waiting on them
+            for(uint32 i = 0; i < bi->objs.size(); i++)
+                failReadObject(bi->objs[i]);
+            delete bi;
+        }
+    }
+}
+
+bool RedisObjectSegmentation::sendMGet(const std::vector<UUID>& objs, redisCallbackFn* cb, void* privdata) {
+    // The connection may have been lost since the lookups were queued
+    ensureConnected();
+    if (mRedisContext == NULL) {
+        REDISOSEG_LOG(error, "Not connected to redis, can't read " << objs.size() << " objects");
+        return false;
+    }
+
+    // MGET is available in all versions of Redis, so this stays
+    // compatible with 1.2
+    uint32 argc = objs.size() + 1;
+    std::vector<String> keys(objs.size());
+    std::vector<const char*> argv(argc);
+    std::vector<size_t> argvlen(argc);
+    argv[0] = "MGET";
+    argvlen[0] = 4;
+    for(uint32 i = 0; i < objs.size(); i++) {
+        keys[i] = mRedisPrefix + objs[i].toString();
+        argv[i+1] = keys[i].c_str();
+        argvlen[i+1] = keys[i].size();
+    }
+    REDISOSEG_LOG(insane, "MGET " << objs.size() << " objects");
+    return (redisAsyncCommandArgv(mRedisContext, cb, privdata, argc, &argv[0], &argvlen[0]) == REDIS_OK);
+}
+
+void RedisObjectSegmentation::reportLookupStats() {
+    Lock lck(mMutex);
+
+    const Trace::LatencyHistogram& latency = mLookupBatcher.latency();
+    REDISOSEG_LOG(info,
+        latency.count() << " lookups in " << mLookupBatcher.batches() << " batches, batch size avg "
+        << mLookupBatcher.averageBatchSize() << ", p50 " << mLookupBatcher.batchSizePercentile(0.5)
+        << ", p99 " << mLookupBatcher.batchSizePercentile(0.99));
+    REDISOSEG_LOG(info,
+        "Lookup latency p50 " << latency.percentile(0.5) << ", p90 " << latency.percentile(0.9)
+        << ", p99 " << latency.percentile(0.99) << ", max " << latency.max());
+}
+
 void RedisObjectSegmentation::finishReadObject(const UUID& obj_id, const String& data_str) {
     REDISOSEG_LOG(detailed, "Finished reading OSEG entry for object " << obj_id.toString());
+    {
+        Lock lck(mMutex);
+        mLookupBatcher.complete(obj_id, mContext->simTime());
+    }
     if (mStopping) return;
 
+    OSegEntry data = parseEntry(data_str);
+    if (!data.isNull()) mCache->insert(obj_id, data);
+    mLookupListener->osegLookupCompleted(obj_id, data);
+}
+
+OSegEntry RedisObjectSegmentation::parseEntry(const String& data_str) {
     OSegEntry data(OSegEntry::null());
 
     std::vector<String> parts;
@@ -613,13 +732,15 @@ void RedisObjectSegmentation::finishReadObject(const UUID& obj_id, const String&
         iss >> new_rad;
         data.setRadius(new_rad);
     }
-
-    if (!data.isNull()) mCache->insert(obj_id, data);
-    mLookupListener->osegLookupCompleted(obj_id, data);
+    return data;
 }
 
 void RedisObjectSegmentation::failReadObject(const UUID& obj_id) {
     REDISOSEG_LOG(error, "Failed to read OSEG entry for object " << obj_id.toString());
+    {
+        Lock lck(mMutex);
+        mLookupBatcher.complete(obj_id, mContext->simTime());
+    }
     if (mStopping) return;
     mLookupListener->osegLookupCompleted(obj_id, OSegEntry::null());
 }
@@ -755,6 +876,85 @@ void RedisObjectSegmentation::removeObject(const UUID& obj_id) {
     }
 }
 
+void RedisObjectSegmentation::getLocalObjects(OSegEntryList* objects) {
+    for(OSegMap::const_iterator it = mOSeg.begin(); it != mOSeg.end(); it++)
+        objects->push_back(*it);
+}
+
+void RedisObjectSegmentation::restoreLocalObjects(const OSegEntryList& objects) {
+    for(uint32 i = 0; i < objects.size(); i++)
+        mRestoredObjects.push_back(objects[i].first);
+}
+
+void RedisObjectSegmentation::validateRestoredObjects() {
+    if (mRestoredObjects.empty()) return;
+
+    Lock lck(mMutex);
+    if (mRedisContext == NULL) return;
+
+    // Read in the same size batches as lookups, but the results only decide
+    // which records to release so they don't go through the lookup batcher
+    uint32 max_batch = mLookupBatcher.maxBatch();
+    for(uint32 start = 0; start < mRestoredObjects.size(); start += max_batch) {
+        uint32 end = std::min((uint32)mRestoredObjects.size(), start + max_batch);
+        RedisObjectBatchOperationInfo* bi = new RedisObjectBatchOperationInfo(this);
+        bi->objs.assign(mRestoredObjects.begin() + start, mRestoredObjects.begin() + end);
+        if (!sendMGet(bi->objs, globalRedisRestoredObjectsReadFinished, bi))
+            delete bi;
+    }
+    REDISOSEG_LOG(detailed, "Validating " << mRestoredObjects.size() << " objects owned before restarting");
+    mRestoredObjects.clear();
+}
+
+void RedisObjectSegmentation::finishReadRestoredObjects(const std::vector<UUID>& objs, const std::vector<String>& data) {
+    if (mStopping) return;
+
+    std::vector<UUID> stale;
+    std::vector<String> stale_values;
+    for(uint32 i = 0; i < objs.size(); i++) {
+        if (parseEntry(data[i]).server() == mContext->id()) {
+            stale.push_back(objs[i]);
+            stale_values.push_back(data[i]);
+        }
+    }
+    if (stale.empty()) return;
+
+    // Whether they've registered again can only be checked from the main
+    // strand, where mOSeg is managed
+    mContext->mainStrand->post(
+        std::tr1::bind(&RedisObjectSegmentation::releaseRestoredObjects, this, stale, stale_values)
+    );
+}
+
+void RedisObjectSegmentation::releaseRestoredObjects(const std::vector<UUID>& objs, const std::vector<String>& values) {
+    if (mStopping) return;
+    // Deleting safely needs scripting (Redis 2.6). Servers too old for
+    // transactions certainly don't have it, and ones without it reject the
+    // EVAL. Either way the records just expire on their own.
+    if (!mRedisHasTransactions) return;
+
+    // The object may have migrated here or elsewhere since its record was
+    // read, so only delete the record if it still holds the value we read
+    static const char* CompareAndDelete =
+        "if redis.call('GET', KEYS[1]) == ARGV[1] then return redis.call('DEL', KEYS[1]) else return 0 end";
+
+    uint32 released = 0;
+    ensureConnected();
+    {
+        Lock lck(mMutex);
+        if (mRedisContext == NULL) return;
+        for(uint32 i = 0; i < objs.size(); i++) {
+            // Reconnected since the restart, so the record is live again
+            if (mOSeg.find(objs[i]) != mOSeg.end()) continue;
+
+            RedisObjectOperationInfo* wi = new RedisObjectOperationInfo(this, objs[i]);
+            redisAsyncCommand(mRedisContext, globalRedisReleaseFinished, wi, "EVAL %s 1 %s%s %b", CompareAndDelete, mRedisPrefix.c_str(), objs[i].toString().c_str(), values[i].c_str(), values[i].size());
+            released++;
+        }
+    }
+    REDISOSEG_LOG(info, "Releasing " << released << " stale records for objects owned before restarting");
+}
+
 bool RedisObjectSegmentation::clearToMigrate(const UUID& obj_id) {
     if (mStopping) return false;
 
@@ -34,6 +34,7 @@
 #define _SIRIKATA_REDIS_OBJECT_SEGMENTATION_HPP_
 
 #include <sirikata/space/ObjectSegmentation.hpp>
+#include <sirikata/core/queue/LookupBatcher.hpp>
 #include <hiredis/async.h>
 
 #include <boost/multi_index_container.hpp>
@@ -47,7 +48,7 @@ namespace Sirikata {
 
 class RedisObjectSegmentation : public ObjectSegmentation {
 public:
-    RedisObjectSegmentation(SpaceContext* con, Network::IOStrand* o_strand, CoordinateSegmentation* cseg, OSegCache* cache, const String& redis_host, uint32 redis_port, const String& redis_prefix, Duration redis_ttl, bool redis_has_transactions);
+    RedisObjectSegmentation(SpaceContext* con, Network::IOStrand* o_strand, CoordinateSegmentation* cseg, OSegCache* cache, const String& redis_host, uint32 redis_port, const String& redis_prefix, Duration redis_ttl, bool redis_has_transactions, uint32 lookup_batch_size, Duration lookup_batch_window);
     ~RedisObjectSegmentation();
 
     virtual void start();
@@ -63,6 +64,9 @@ public:
     virtual bool clearToMigrate(const UUID& obj_id);
     virtual void migrateObject(const UUID& obj_id, const OSegEntry& new_server_id);
 
+    virtual void getLocalObjects(OSegEntryList* objects);
+    virtual void restoreLocalObjects(const OSegEntryList& objects);
+
     virtual void handleMigrateMessageAck(const Sirikata::Protocol::OSeg::MigrateMessageAcknowledge& msg);
     virtual void handleUpdateOSegMessage(const Sirikata::Protocol::OSeg::UpdateOSegMessage& update_oseg_msg);
 
@@ -81,6 +85,7 @@ public:
     void failReadObject(const UUID& obj_id);
     void finishWriteNewObject(const UUID& obj_id, OSegWriteListener::OSegAddNewStatus);
     void finishWriteMigratedObject(const UUID& obj_id, ServerID ackTo);
+    void finishReadRestoredObjects(const std::vector<UUID>& objs, const std::vector<String>& data);
 
 private:
     void connect();
@@ -90,12 +95,28 @@ private:
     void startRead();
     void startWrite();
 
+    // Sends all queued lookups, as MGETs of up to the maximum batch size
+    void flushLookups();
+    // Returns false if the MGET couldn't be sent, in which case cb won't be
+    // invoked
+    bool sendMGet(const std::vector<UUID>& objs, redisCallbackFn* cb, void* privdata);
+    // Parses a stored "server:radius" value, null if it's malformed
+    static OSegEntry parseEntry(const String& data_str);
+    void reportLookupStats();
+
     void readHandler(const boost::system::error_code& ec);
     void writeHandler(const boost::system::error_code& ec);
 
     void cacheAndNotifyNewObject(const UUID& obj_id, OSegWriteListener::OSegAddNewStatus);
     void cacheAndAckMigration(const UUID& obj_id, ServerID ackTo);
 
+    // Objects owned before a restart may still have records naming this
+    // server, which would stop them from registering again until the records
+    // expire. These check which ones do and delete them, as long as they
+    // still hold the values that were read.
+    void validateRestoredObjects();
+    void releaseRestoredObjects(const std::vector<UUID>& objs, const std::vector<String>& values);
+
     // Schedule an object to be refreshed in .5 TTL to keep it's key alive
     void scheduleObjectRefresh(const UUID& obj_id);
     void startTimeoutHandler();
@@ -107,6 +128,8 @@ private:
 
     typedef std::tr1::unordered_map<UUID, OSegEntry, UUID::Hasher> OSegMap;
     OSegMap mOSeg;
+    // Owned when the last snapshot was saved, waiting to be validated
+    std::vector<UUID> mRestoredObjects;
 
     String mRedisHost;
     uint16 mRedisPort;
@@ -129,6 +152,13 @@ private:
     typedef boost::lock_guard<Mutex> Lock;
     Mutex mMutex;
 
+    // Lookups are collected for a short window and sent together. Only
+    // accessed with mMutex held since lookups complete from the redis read
+    // handler
+    LookupBatcher<UUID, UUID::Hasher> mLookupBatcher;
+    Duration mLookupBatchWindow;
+    Network::IOTimerPtr mLookupBatchTimer;
+
 
     // Track objects that need timeouts refreshed in redis
     struct ObjectTimeout {
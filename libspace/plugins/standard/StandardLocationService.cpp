@@ -51,7 +51,7 @@ bool StandardLocationService::isLocal(const UUID& uuid) const {
     LocationMap::const_iterator it = mLocations.find(uuid);
     if (it == mLocations.end())
         return false;
-    return it->second.local;
+    return mInfo[it->second].local;
 }
 
 void StandardLocationService::service() {
@@ -62,7 +62,7 @@ uint64 StandardLocationService::epoch(const UUID& uuid) {
     LocationMap::iterator it = mLocations.find(uuid);
     assert(it != mLocations.end());
 
-    LocationInfo locinfo = it->second;
+    const LocationInfo& locinfo = mInfo[it->second];
     return locinfo.props.maxSeqNo();
 }
 
@@ -70,21 +70,33 @@ TimedMotionVector3f StandardLocationService::location(const UUID& uuid) {
     LocationMap::iterator it = mLocations.find(uuid);
     assert(it != mLocations.end());
 
-    LocationInfo locinfo = it->second;
+    const LocationInfo& locinfo = mInfo[it->second];
     return locinfo.props.location();
 }
 
 Vector3f StandardLocationService::currentPosition(const UUID& uuid) {
-    TimedMotionVector3f loc = location(uuid);
-    Vector3f returner = loc.extrapolate(mContext->simTime()).position();
-    return returner;
+    LocationMap::iterator it = mLocations.find(uuid);
+    assert(it != mLocations.end());
+
+    return mPositions.extrapolate(mContext->simTime(), it->second);
+}
+
+void StandardLocationService::currentPositions(const UUID* uuids, uint32 count, Vector3f* out) {
+    mSlotScratch.resize(count);
+    for(uint32 i = 0; i < count; i++) {
+        LocationMap::iterator it = mLocations.find(uuids[i]);
+        assert(it != mLocations.end());
+        mSlotScratch[i] = it->second;
+    }
+    if (count > 0)
+        mPositions.extrapolate(mContext->simTime(), &mSlotScratch[0], count, out);
 }
 
 TimedMotionQuaternion StandardLocationService::orientation(const UUID& uuid) {
     LocationMap::iterator it = mLocations.find(uuid);
     assert(it != mLocations.end());
 
-    LocationInfo locinfo = it->second;
+    const LocationInfo& locinfo = mInfo[it->second];
     return locinfo.props.orientation();
 }
 
@@ -97,7 +109,7 @@ AggregateBoundingInfo StandardLocationService::bounds(const UUID& uuid) {
     LocationMap::iterator it = mLocations.find(uuid);
     assert(it != mLocations.end());
 
-    LocationInfo locinfo = it->second;
+    const LocationInfo& locinfo = mInfo[it->second];
     return locinfo.props.bounds();
 }
 
@@ -105,7 +117,7 @@ const String& StandardLocationService::mesh(const UUID& uuid) {
     LocationMap::iterator it = mLocations.find(uuid);
     assert(it != mLocations.end());
 
-    LocationInfo& locinfo = it->second;
+    LocationInfo& locinfo = mInfo[it->second];
     locinfo.mesh_copied_str = locinfo.props.mesh().toString();
     return locinfo.mesh_copied_str;
 }
@@ -114,7 +126,7 @@ const String& StandardLocationService::physics(const UUID& uuid) {
     LocationMap::iterator it = mLocations.find(uuid);
     assert(it != mLocations.end());
 
-    LocationInfo& locinfo = it->second;
+    LocationInfo& locinfo = mInfo[it->second];
     locinfo.physics_copied_str = locinfo.props.physics();
     return locinfo.physics_copied_str;
 }
@@ -124,16 +136,15 @@ const String& StandardLocationService::physics(const UUID& uuid) {
 
     // Add or update the information to the cache
     if (it == mLocations.end()) {
-        mLocations[uuid] = LocationInfo();
-        it = mLocations.find(uuid);
+        it = addSlot(uuid, loc);
     } else {
         // It was already in there as a replica, notify its removal
-        assert(it->second.local == false);
+        assert(mInfo[it->second].local == false);
         CONTEXT_SPACETRACE(serverObjectEvent, 0, mContext->id(), uuid, false, TimedMotionVector3f()); // FIXME remote server ID
         notifyReplicaObjectRemoved(uuid);
     }
 
-    LocationInfo& locinfo = it->second;
+    LocationInfo& locinfo = mInfo[it->second];
     locinfo.props.reset();
     locinfo.props.setLocation(loc, 0);
     locinfo.props.setOrientation(orient, 0);
@@ -142,6 +153,7 @@ const String& StandardLocationService::physics(const UUID& uuid) {
     locinfo.props.setPhysics(phy, 0);
     locinfo.local = true;
     locinfo.aggregate = false;
+    syncPosition(it->second);
 
     // FIXME: we might want to verify that location(uuid) and bounds(uuid) are
     // reasonable compared to the loc and bounds passed in
@@ -153,10 +165,11 @@ const String& StandardLocationService::physics(const UUID& uuid) {
 
 void StandardLocationService::removeLocalObject(const UUID& uuid) {
     // Remove from mLocations, but save the cached state
-    assert( mLocations.find(uuid) != mLocations.end() );
-    assert( mLocations[uuid].local == true );
-    assert( mLocations[uuid].aggregate == false );
-    mLocations.erase(uuid);
+    LocationMap::iterator it = mLocations.find(uuid);
+    assert( it != mLocations.end() );
+    assert( mInfo[it->second].local == true );
+    assert( mInfo[it->second].aggregate == false );
+    removeSlot(it);
 
     // Remove from the list of local objects
     CONTEXT_SPACETRACE(serverObjectEvent, mContext->id(), mContext->id(), uuid, false, TimedMotionVector3f());
@@ -174,10 +187,9 @@ void StandardLocationService::addLocalAggregateObject(const UUID& uuid, const Ti
     // handler) screwed up.
     assert(mLocations.find(uuid) == mLocations.end());
 
-    mLocations[uuid] = LocationInfo();
-    LocationMap::iterator it = mLocations.find(uuid);
+    LocationMap::iterator it = addSlot(uuid, loc);
 
-    LocationInfo& locinfo = it->second;
+    LocationInfo& locinfo = mInfo[it->second];
     locinfo.props.reset();
     locinfo.props.setLocation(loc, 0);
     locinfo.props.setOrientation(orient, 0);
@@ -187,6 +199,7 @@ void StandardLocationService::addLocalAggregateObject(const UUID& uuid, const Ti
 
     locinfo.local = true;
     locinfo.aggregate = true;
+    syncPosition(it->second);
 
     // Add to the list of local objects
     notifyLocalObjectAdded(uuid, true, location(uuid), orientation(uuid), bounds(uuid), mesh(uuid), physics(uuid), "");
@@ -194,10 +207,11 @@ void StandardLocationService::addLocalAggregateObject(const UUID& uuid, const Ti
 
 void StandardLocationService::removeLocalAggregateObject(const UUID& uuid) {
     // Remove from mLocations, but save the cached state
-    assert( mLocations.find(uuid) != mLocations.end() );
-    assert( mLocations[uuid].local == true );
-    assert( mLocations[uuid].aggregate == true );
-    mLocations.erase(uuid);
+    LocationMap::iterator it = mLocations.find(uuid);
+    assert( it != mLocations.end() );
+    assert( mInfo[it->second].local == true );
+    assert( mInfo[it->second].aggregate == true );
+    removeSlot(it);
 
     notifyLocalObjectRemoved(uuid, true);
 }
@@ -205,36 +219,37 @@ void StandardLocationService::removeLocalAggregateObject(const UUID& uuid) {
 void StandardLocationService::updateLocalAggregateLocation(const UUID& uuid, const TimedMotionVector3f& newval) {
     LocationMap::iterator loc_it = mLocations.find(uuid);
     assert(loc_it != mLocations.end());
-    assert(loc_it->second.aggregate == true);
-    loc_it->second.props.setLocation(newval, 0);
+    assert(mInfo[loc_it->second].aggregate == true);
+    mInfo[loc_it->second].props.setLocation(newval, 0);
+    syncPosition(loc_it->second);
     notifyLocalLocationUpdated( uuid, true, newval );
 }
 void StandardLocationService::updateLocalAggregateOrientation(const UUID& uuid, const TimedMotionQuaternion& newval) {
     LocationMap::iterator loc_it = mLocations.find(uuid);
     assert(loc_it != mLocations.end());
-    assert(loc_it->second.aggregate == true);
-    loc_it->second.props.setOrientation(newval, 0);
+    assert(mInfo[loc_it->second].aggregate == true);
+    mInfo[loc_it->second].props.setOrientation(newval, 0);
     notifyLocalOrientationUpdated( uuid, true, newval );
 }
 void StandardLocationService::updateLocalAggregateBounds(const UUID& uuid, const AggregateBoundingInfo& newval) {
     LocationMap::iterator loc_it = mLocations.find(uuid);
     assert(loc_it != mLocations.end());
-    assert(loc_it->second.aggregate == true);
-    loc_it->second.props.setBounds(newval);
+    assert(mInfo[loc_it->second].aggregate == true);
+    mInfo[loc_it->second].props.setBounds(newval);
     notifyLocalBoundsUpdated( uuid, true, newval );
 }
 void StandardLocationService::updateLocalAggregateMesh(const UUID& uuid, const String& newval) {
     LocationMap::iterator loc_it = mLocations.find(uuid);
     assert(loc_it != mLocations.end());
-    assert(loc_it->second.aggregate == true);
-    loc_it->second.props.setMesh(Transfer::URI(newval));
+    assert(mInfo[loc_it->second].aggregate == true);
+    mInfo[loc_it->second].props.setMesh(Transfer::URI(newval));
     notifyLocalMeshUpdated( uuid, true, newval );
 }
 void StandardLocationService::updateLocalAggregatePhysics(const UUID& uuid, const String& newval) {
     LocationMap::iterator loc_it = mLocations.find(uuid);
     assert(loc_it != mLocations.end());
-    assert(loc_it->second.aggregate == true);
-    loc_it->second.props.setPhysics(newval, 0);
+    assert(mInfo[loc_it->second].aggregate == true);
+    mInfo[loc_it->second].props.setPhysics(newval, 0);
     notifyLocalPhysicsUpdated( uuid, true, newval );
 }
 
@@ -244,7 +259,7 @@ void StandardLocationService::addReplicaObject(const Time& t, const UUID& uuid,
 
     if (it != mLocations.end()) {
         // It already exists. If its local, ignore the update. If its another replica, somethings out of sync, but perform the update anyway
-        LocationInfo& locinfo = it->second;
+        LocationInfo& locinfo = mInfo[it->second];
         if (!locinfo.local) {
             locinfo.props.reset();
             locinfo.props.setLocation(loc, 0);
@@ -252,6 +267,7 @@ void StandardLocationService::addReplicaObject(const Time& t, const UUID& uuid,
             locinfo.props.setBounds(bnds, 0);
             locinfo.props.setMesh(Transfer::URI(msh), 0);
             locinfo.props.setPhysics(phy, 0);
+            syncPosition(it->second);
 
             //local = false
             // FIXME should we notify location and bounds updated info?
@@ -260,7 +276,8 @@ void StandardLocationService::addReplicaObject(const Time& t, const UUID& uuid,
     }
     else {
         // Its a new replica, just insert it
-        LocationInfo locinfo;
+        it = addSlot(uuid, loc);
+        LocationInfo& locinfo = mInfo[it->second];
         locinfo.props.reset();
         locinfo.props.setLocation(loc, 0);
         locinfo.props.setOrientation(orient, 0);
@@ -269,7 +286,7 @@ void StandardLocationService::addReplicaObject(const Time& t, const UUID& uuid,
         locinfo.props.setPhysics(phy, 0);
         locinfo.local = false;
         locinfo.aggregate = agg;
-        mLocations[uuid] = locinfo;
+        syncPosition(it->second);
 
         // We only run this notification when the object actually is new
         CONTEXT_SPACETRACE(serverObjectEvent, 0, mContext->id(), uuid, true, loc); // FIXME add remote server ID
@@ -285,12 +302,12 @@ void StandardLocationService::removeReplicaObject(const Time& t, const UUID& uui
         return;
 
     // If the object is marked as local, this is out of date information.  Just ignore it.
-    LocationInfo& locinfo = it->second;
+    LocationInfo& locinfo = mInfo[it->second];
     if (locinfo.local)
         return;
 
     // Otherwise, remove and notify
-    mLocations.erase(uuid);
+    removeSlot(it);
     CONTEXT_SPACETRACE(serverObjectEvent, 0, mContext->id(), uuid, false, TimedMotionVector3f()); // FIXME add remote server ID
     notifyReplicaObjectRemoved(uuid);
 }
@@ -331,10 +348,11 @@ void StandardLocationService::receiveMessage(Message* msg) {
                     update.location().t(),
                     MotionVector3f( update.location().position(), update.location().velocity() )
                 );
-                loc_it->second.props.setLocation(newloc, epoch);
-                notifyReplicaLocationUpdated( update.object(), loc_it->second.props.location() );
+                mInfo[loc_it->second].props.setLocation(newloc, epoch);
+                syncPosition(loc_it->second);
+                notifyReplicaLocationUpdated( update.object(), mInfo[loc_it->second].props.location() );
 
-                CONTEXT_SPACETRACE(serverLoc, msg->source_server(), mContext->id(), update.object(), loc_it->second.props.location() );
+                CONTEXT_SPACETRACE(serverLoc, msg->source_server(), mContext->id(), update.object(), mInfo[loc_it->second].props.location() );
             }
 
             if (update.has_orientation()) {
@@ -342,8 +360,8 @@ void StandardLocationService::receiveMessage(Message* msg) {
                     update.orientation().t(),
                     MotionQuaternion( update.orientation().position(), update.orientation().velocity() )
                 );
-                loc_it->second.props.setOrientation(neworient, epoch);
-                notifyReplicaOrientationUpdated( update.object(), loc_it->second.props.orientation() );
+                mInfo[loc_it->second].props.setOrientation(neworient, epoch);
+                notifyReplicaOrientationUpdated( update.object(), mInfo[loc_it->second].props.orientation() );
             }
 
             if (update.has_aggregate_bounds()) {
@@ -352,20 +370,20 @@ void StandardLocationService::receiveMessage(Message* msg) {
                 float32 max_object_size = update.aggregate_bounds().has_max_object_size() ? update.aggregate_bounds().max_object_size() : 0.f;
 
                 AggregateBoundingInfo newbounds(center, center_rad, max_object_size);
-                loc_it->second.props.setBounds(newbounds, epoch);
-                notifyReplicaBoundsUpdated( update.object(), loc_it->second.props.bounds() );
+                mInfo[loc_it->second].props.setBounds(newbounds, epoch);
+                notifyReplicaBoundsUpdated( update.object(), mInfo[loc_it->second].props.bounds() );
             }
 
             if (update.has_mesh()) {
                 String newmesh = update.mesh();
-                loc_it->second.props.setMesh(Transfer::URI(newmesh), epoch);
-                notifyReplicaMeshUpdated( update.object(), loc_it->second.props.mesh().toString() );
+                mInfo[loc_it->second].props.setMesh(Transfer::URI(newmesh), epoch);
+                notifyReplicaMeshUpdated( update.object(), mInfo[loc_it->second].props.mesh().toString() );
             }
 
             if (update.has_physics()) {
                 String newphy = update.physics();
-                loc_it->second.props.setPhysics(newphy, epoch);
-                notifyReplicaPhysicsUpdated( update.object(), loc_it->second.props.physics() );
+                mInfo[loc_it->second].props.setPhysics(newphy, epoch);
+                notifyReplicaPhysicsUpdated( update.object(), mInfo[loc_it->second].props.physics() );
             }
         }
     }
@@ -397,10 +415,11 @@ bool StandardLocationService::locationUpdate(UUID source, void* buffer, uint32 l
                     request.location().t(),
                     MotionVector3f( request.location().position(), request.location().velocity() )
                 );
-                loc_it->second.props.setLocation(newloc, epoch);
-                notifyLocalLocationUpdated( source, loc_it->second.aggregate, loc_it->second.props.location() );
+                mInfo[loc_it->second].props.setLocation(newloc, epoch);
+                syncPosition(loc_it->second);
+                notifyLocalLocationUpdated( source, mInfo[loc_it->second].aggregate, mInfo[loc_it->second].props.location() );
 
-                CONTEXT_SPACETRACE(serverLoc, mContext->id(), mContext->id(), source, loc_it->second.props.location() );
+                CONTEXT_SPACETRACE(serverLoc, mContext->id(), mContext->id(), source, mInfo[loc_it->second].props.location() );
             }
 
             if (request.has_orientation()) {
@@ -408,26 +427,26 @@ bool StandardLocationService::locationUpdate(UUID source, void* buffer, uint32 l
                     request.orientation().t(),
                     MotionQuaternion( request.orientation().position(), request.orientation().velocity() )
                 );
-                loc_it->second.props.setOrientation(neworient, epoch);
-                notifyLocalOrientationUpdated( source, loc_it->second.aggregate, loc_it->second.props.orientation() );
+                mInfo[loc_it->second].props.setOrientation(neworient, epoch);
+                notifyLocalOrientationUpdated( source, mInfo[loc_it->second].aggregate, mInfo[loc_it->second].props.orientation() );
             }
 
             if (request.has_bounds()) {
                 AggregateBoundingInfo newbounds(request.bounds());
-                loc_it->second.props.setBounds(newbounds, epoch);
-                notifyLocalBoundsUpdated( source, loc_it->second.aggregate, loc_it->second.props.bounds() );
+                mInfo[loc_it->second].props.setBounds(newbounds, epoch);
+                notifyLocalBoundsUpdated( source, mInfo[loc_it->second].aggregate, mInfo[loc_it->second].props.bounds() );
             }
 
             if (request.has_mesh()) {
                 String newmesh = request.mesh();
-                loc_it->second.props.setMesh(Transfer::URI(newmesh), epoch);
-                notifyLocalMeshUpdated( source, loc_it->second.aggregate, loc_it->second.props.mesh().toString() );
+                mInfo[loc_it->second].props.setMesh(Transfer::URI(newmesh), epoch);
+                notifyLocalMeshUpdated( source, mInfo[loc_it->second].aggregate, mInfo[loc_it->second].props.mesh().toString() );
             }
 
             if (request.has_physics()) {
                 String newphy = request.physics();
-                loc_it->second.props.setPhysics(newphy, epoch);
-                notifyLocalPhysicsUpdated( source, loc_it->second.aggregate, loc_it->second.props.physics() );
+                mInfo[loc_it->second].props.setPhysics(newphy, epoch);
+                notifyLocalPhysicsUpdated( source, mInfo[loc_it->second].aggregate, mInfo[loc_it->second].props.physics() );
             }
 
         }
@@ -439,6 +458,24 @@ bool StandardLocationService::locationUpdate(UUID source, void* buffer, uint32 l
 }
 
 
+StandardLocationService::LocationMap::iterator StandardLocationService::addSlot(const UUID& uuid, const TimedMotionVector3f& loc) {
+    Slot slot = mPositions.add(loc);
+    if (slot >= mInfo.size())
+        mInfo.resize(slot+1);
+    mInfo[slot] = LocationInfo();
+    return mLocations.insert( LocationMap::value_type(uuid, slot) ).first;
+}
+
+void StandardLocationService::removeSlot(LocationMap::iterator it) {
+    Slot slot = it->second;
+    mLocations.erase(it);
+    mPositions.remove(slot);
+    mInfo[slot] = LocationInfo();
+}
+
+void StandardLocationService::syncPosition(Slot slot) {
+    mPositions.set(slot, mInfo[slot].props.location());
+}
 
 
 // Command handlers
@@ -452,9 +489,10 @@ void StandardLocationService::commandProperties(const Command::Command& cmd, Com
     // to compute
     uint32 local_count = 0, aggregate_count = 0, local_aggregate_count = 0;
     for(LocationMap::iterator it = mLocations.begin(); it != mLocations.end(); it++) {
-        if (it->second.local) local_count++;
-        if (it->second.aggregate) aggregate_count++;
-        if (it->second.local && it->second.aggregate) local_aggregate_count++;
+        const LocationInfo& locinfo = mInfo[it->second];
+        if (locinfo.local) local_count++;
+        if (locinfo.aggregate) aggregate_count++;
+        if (locinfo.local && locinfo.aggregate) local_aggregate_count++;
     }
     result.put("objects.count", mLocations.size());
     result.put("objects.local_count", local_count);
@@ -481,9 +519,10 @@ void StandardLocationService::commandObjectProperties(const Command::Command& cm
         cmdr->result(cmdid, result);
         return;
     }
+    const LocationInfo& locinfo = mInfo[it->second];
 
     Time t = mContext->recentSimTime();
-    TimedMotionVector3f pos(t, it->second.props.location().extrapolate(t));
+    TimedMotionVector3f pos(t, locinfo.props.location().extrapolate(t));
     result.put("properties.location.position.x", pos.position().x);
     result.put("properties.location.position.y", pos.position().y);
     result.put("properties.location.position.z", pos.position().z);
@@ -492,7 +531,7 @@ void StandardLocationService::commandObjectProperties(const Command::Command& cm
     result.put("properties.location.velocity.z", pos.velocity().z);
     result.put("properties.location.time", pos.updateTime().raw());
 
-    TimedMotionQuaternion orient(t, it->second.props.orientation().extrapolate(t));
+    TimedMotionQuaternion orient(t, locinfo.props.orientation().extrapolate(t));
     result.put("properties.orientation.position.x", orient.position().x);
     result.put("properties.orientation.position.y", orient.position().y);
     result.put("properties.orientation.position.z", orient.position().z);
@@ -505,21 +544,21 @@ void StandardLocationService::commandObjectProperties(const Command::Command& cm
 
     // Present the bounds info in a way the consumer can easily draw a bounding
     // sphere, especially for single objects
-    result.put("properties.bounds.center.x", it->second.props.bounds().centerOffset.x);
-    result.put("properties.bounds.center.y", it->second.props.bounds().centerOffset.y);
-    result.put("properties.bounds.center.z", it->second.props.bounds().centerOffset.z);
-    result.put("properties.bounds.radius", it->second.props.bounds().fullRadius());
+    result.put("properties.bounds.center.x", locinfo.props.bounds().centerOffset.x);
+    result.put("properties.bounds.center.y", locinfo.props.bounds().centerOffset.y);
+    result.put("properties.bounds.center.z", locinfo.props.bounds().centerOffset.z);
+    result.put("properties.bounds.radius", locinfo.props.bounds().fullRadius());
     // But also provide the other info so a correct view of
     // aggregates. Technically we only need one of these since fullRadius is the
     // sum of the two, but this is clearer.
-    result.put("properties.bounds.centerBoundsRadius", it->second.props.bounds().centerBoundsRadius);
-    result.put("properties.bounds.maxObjectRadius", it->second.props.bounds().maxObjectRadius);
+    result.put("properties.bounds.centerBoundsRadius", locinfo.props.bounds().centerBoundsRadius);
+    result.put("properties.bounds.maxObjectRadius", locinfo.props.bounds().maxObjectRadius);
 
-    result.put("properties.mesh", it->second.props.mesh().toString());
-    result.put("properties.physics", it->second.props.physics());
+    result.put("properties.mesh", locinfo.props.mesh().toString());
+    result.put("properties.physics", locinfo.props.physics());
 
-    result.put("properties.local", it->second.local);
-    result.put("properties.aggregate", it->second.aggregate);
+    result.put("properties.local", locinfo.local);
+    result.put("properties.aggregate", locinfo.aggregate);
 
     result.put("success", true);
     cmdr->result(cmdid, result);
@@ -35,6 +35,7 @@
 
 #include <sirikata/space/LocationService.hpp>
 #include <sirikata/core/util/PresenceProperties.hpp>
+#include <sirikata/core/util/MotionVectorStore.hpp>
 
 namespace Sirikata {
 
@@ -55,6 +56,7 @@ public:
     virtual uint64 epoch(const UUID& uuid);
     virtual TimedMotionVector3f location(const UUID& uuid);
     virtual Vector3f currentPosition(const UUID& uuid);
+    virtual void currentPositions(const UUID* uuids, uint32 count, Vector3f* out);
     virtual TimedMotionQuaternion orientation(const UUID& uuid);
     virtual Quaternion currentOrientation(const UUID& uuid);
     virtual AggregateBoundingInfo bounds(const UUID& uuid);
@@ -87,6 +89,8 @@ public:
     virtual void commandObjectProperties(const Command::Command& cmd, Command::Commander* cmdr, Command::CommandID cmdid);
 
 private:
+    typedef MotionVectorStore::Slot Slot;
+
     struct LocationInfo {
         // Regular location info that we need to maintain for all objects
         SequencedPresenceProperties props;
@@ -99,9 +103,20 @@ private:
         bool local;
         bool aggregate;
     };
-    typedef std::tr1::unordered_map<UUID, LocationInfo, UUID::Hasher> LocationMap;
+    // Objects are assigned a slot which indexes both their LocationInfo and
+    // their entry in mPositions, which mirrors props.location() in a form that
+    // can be extrapolated in bulk.
+    typedef std::tr1::unordered_map<UUID, Slot, UUID::Hasher> LocationMap;
+
+    LocationMap::iterator addSlot(const UUID& uuid, const TimedMotionVector3f& loc);
+    void removeSlot(LocationMap::iterator it);
+    // Must be called whenever props.location() may have changed
+    void syncPosition(Slot slot);
 
     LocationMap mLocations;
+    std::vector<LocationInfo> mInfo;
+    MotionVectorStore mPositions;
+    std::vector<Slot> mSlotScratch;
 }; // class StandardLocationService
 
 } // namespace Sirikata
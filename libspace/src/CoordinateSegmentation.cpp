@@ -46,6 +46,14 @@ CoordinateSegmentation::~CoordinateSegmentation() {
     delete mServiceStage;
 }
 
+void CoordinateSegmentation::lookupAsync(const Vector3f& pos, const LookupCallback& cb) {
+    cb(lookup(pos));
+}
+
+void CoordinateSegmentation::lookupBoundingBoxAsync(const BoundingBox3f& bbox, const LookupBoundingBoxCallback& cb) {
+    cb(lookupBoundingBox(bbox));
+}
+
 void CoordinateSegmentation::addListener(Listener* listener) {
     assert (mListeners.find(listener) == mListeners.end());
     mListeners.insert(listener);
@@ -94,6 +94,11 @@ LocationService::~LocationService() {
     mContext->objectSessionManager()->removeListener(this);
 }
 
+void LocationService::currentPositions(const UUID* uuids, uint32 count, Vector3f* out) {
+    for(uint32 i = 0; i < count; i++)
+        out[i] = currentPosition(uuids[i]);
+}
+
 void LocationService::newSession(ObjectSession* session) {
     using std::tr1::placeholders::_1;
     using std::tr1::placeholders::_2;
@@ -79,6 +79,14 @@ Message::Message(ServerID src, uint16 src_port, ServerID dest, uint16 dest_port,
     set_payload_id(pl->unique());
 }
 
+Message::Message(ServerID src, uint16 src_port, ServerID dest, uint16 dest_port, const ObjectMessageEnvelope& pl)
+ : mCachedSize(0)
+{
+    MemoryReference serialized = pl.serialized();
+    fillMessage(src, src_port, dest, dest_port, std::string((const char*)serialized.data(), serialized.size()));
+    set_payload_id(pl.unique());
+}
+
 void Message::set_source_server(const ServerID sid) {
     mImpl.set_source_server(sid);
     set_id( GenerateUniqueID(sid) );
@@ -97,19 +105,24 @@ static char toHex(unsigned char u) {
     if (u<=9) return '0'+u;
     return 'A'+(u-10);
 }
-static void hexPrint(const char *name, const Network::Chunk&data) {
+static void hexPrint(const char *name, const MemoryReference& data) {
+    const uint8* bytes = (const uint8*)data.data();
     std::string str;
     str.resize(data.size()*2);
     for (size_t i=0;i<data.size();++i) {
-        str[i*2]=toHex(data[i]%16);
-        str[i*2+1]=toHex(data[i]/16);
+        str[i*2]=toHex(bytes[i]%16);
+        str[i*2+1]=toHex(bytes[i]/16);
     }
     std::cout<< name<<' '<<str<<'\n';
 }
 
 Message* Message::deserialize(const Network::Chunk& wire) {
+    return deserialize(MemoryReference(wire));
+}
+
+Message* Message::deserialize(const MemoryReference& wire) {
     Message* result = new Message();
-    bool parsed = result->ParseFromArray( &(wire[0]), wire.size() );
+    bool parsed = result->ParseFromArray( wire.data(), wire.size() );
     if (!parsed) {
         hexPrint("Fail",wire);
         SILOG(msg,warning,"Couldn't parse message.");
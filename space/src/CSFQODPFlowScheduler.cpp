@@ -91,6 +91,15 @@ CSFQODPFlowScheduler::~CSFQODPFlowScheduler() {
 
 // ODP push interface
 bool CSFQODPFlowScheduler::push(Sirikata::Protocol::Object::ObjectMessage* msg, const OSegEntry&source_entry, const OSegEntry& dest_entry) {
+    return pushODPMessage(msg, source_entry, dest_entry);
+}
+
+bool CSFQODPFlowScheduler::push(const ObjectMessageEnvelope& msg, const OSegEntry&source_entry, const OSegEntry& dest_entry) {
+    return pushODPMessage(&msg, source_entry, dest_entry);
+}
+
+template<typename ODPMessageType>
+bool CSFQODPFlowScheduler::pushODPMessage(ODPMessageType* msg, const OSegEntry&source_entry, const OSegEntry& dest_entry) {
     boost::lock_guard<boost::mutex> lck(mPushMutex); // FIXME
 
     ObjectPair op(msg->source_object(), msg->dest_object());
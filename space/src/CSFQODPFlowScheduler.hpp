@@ -61,6 +61,7 @@ public:
 
     // ODP push interface
     virtual bool push(Sirikata::Protocol::Object::ObjectMessage* msg, const OSegEntry&, const OSegEntry&);
+    virtual bool push(const ObjectMessageEnvelope& msg, const OSegEntry&, const OSegEntry&);
     // Get the sum of the weights of active queues.
     virtual float totalActiveWeight();
     // Get the total used weight of active queues.  If all flows are saturating,
@@ -70,6 +71,9 @@ public:
     // this should equal totalActiveWeights, otherwise it will be smaller.
     virtual float totalReceiverUsedWeight();
 private:
+    // Shared implementation of push for parsed and serialized messages
+    template<typename ODPMessageType>
+    bool pushODPMessage(ODPMessageType* msg, const OSegEntry& source_entry, const OSegEntry& dest_entry);
 
     enum {
         SENDER = 0,
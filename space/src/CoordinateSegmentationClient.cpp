@@ -68,7 +68,8 @@ using Sirikata::Network::TCPSocket;
 using Sirikata::Network::TCPListener;
 
 CoordinateSegmentationClient::CoordinateSegmentationClient(SpaceContext* ctx, const BoundingBox3f& region, const Vector3ui32& perdim, ServerIDMap* sidmap)
-  : CoordinateSegmentation(ctx),  mBSPTreeValid(false),
+  : CoordinateSegmentation(ctx),
+    mSegmentationVersion(0),
     mAvailableServersCount(0), mTopLevelRegion(NULL),
     mIOService(new Network::IOService("CoordinationSegmentationClient")),
     mSidMap(sidmap), mLeaseExpiryTime(Timer::now() + Duration::milliseconds(60000.0))
@@ -77,6 +78,13 @@ CoordinateSegmentationClient::CoordinateSegmentationClient(SpaceContext* ctx, co
   mCSEGHost = GetOptionValue<String>("cseg-service-host");
   mCSEGPort = GetOptionValue<String>("cseg-service-tcp-port");
 
+  mLookupService = new Network::IOService("CoordinateSegmentationClient Lookups");
+  mLookupWork = new Network::IOWork(mLookupService, "CoordinateSegmentationClient Lookups");
+  mLookupThread = new Thread(
+      "CoordinateSegmentationClient Lookups",
+      std::tr1::bind(&Network::IOService::runNoReturn, mLookupService)
+  );
+
   if (mSidMap != NULL) {
     mSidMap->lookupExternal(
       mContext->id(),
@@ -95,6 +103,13 @@ void CoordinateSegmentationClient::handleSelfLookup(ServerID my_sid, Address4 my
 
     startAccepting();
     sendSegmentationListenMessage(my_addr);
+
+    // Changes only arrive after we've subscribed, so fetch the current
+    // segmentation to get a replica to answer lookups from in the meantime
+    mLookupService->post(
+        std::tr1::bind(&CoordinateSegmentationClient::downloadUpdatedBSPTree, this),
+        "CoordinateSegmentationClient::downloadUpdatedBSPTree"
+    );
 }
 
 void CoordinateSegmentationClient::startAccepting() {
@@ -109,12 +124,6 @@ void CoordinateSegmentationClient::accept_handler() {
 
   mSocket->close();
 
-  boost::mutex::scoped_lock lock(mCacheMutex);
-  mLookupCache.clear();
-  mTopLevelRegion.destroy();
-  mServerRegionCache.clear();
-  lock.unlock();
-
   std::map<ServerID, SegmentationInfo> segmentationInfoMap;
 
   for (int i=0; i < csegMessage.change_message().region_size(); i++) {
@@ -134,13 +143,69 @@ void CoordinateSegmentationClient::accept_handler() {
     segInfoVector.push_back(it->second);
   }
 
+  boost::mutex::scoped_lock lock(mCacheMutex);
+  mSegmentationVersion++;
+  if (mReplica.valid()) {
+    SegmentationReplica::LeafList changed;
+    for (uint32 i = 0; i < segInfoVector.size(); i++) {
+      for (uint32 j = 0; j < segInfoVector[i].region.size(); j++)
+        changed.push_back(SegmentationReplica::Leaf(segInfoVector[i].server, segInfoVector[i].region[j]));
+    }
+    mReplica.applyChange(changed);
+    replicaChanged();
+  }
+  else {
+    // Nothing to apply the change to, fetch the whole segmentation instead
+    mLookupCache.clear();
+    mServerRegionCache.clear();
+    mLookupService->post(
+        std::tr1::bind(&CoordinateSegmentationClient::downloadUpdatedBSPTree, this),
+        "CoordinateSegmentationClient::downloadUpdatedBSPTree"
+    );
+  }
+  lock.unlock();
+
   notifyListeners(segInfoVector);
 
   startAccepting();
 }
 
 CoordinateSegmentationClient::~CoordinateSegmentationClient() {
+  // Let any outstanding lookup finish, drop the rest
+  delete mLookupWork;
+  mLookupService->stop();
+  mLookupThread->join();
+  delete mLookupThread;
+  delete mLookupService;
+}
 
+void CoordinateSegmentationClient::replicaChanged() {
+  // Everything else we cache can be answered by the replica now
+  mServerRegionCache.clear();
+  mLookupCache.clear();
+  const SegmentationReplica::LeafList& leaves = mReplica.leaves();
+  for (SegmentationReplica::LeafList::const_iterator it = leaves.begin(); it != leaves.end(); it++)
+    mServerRegionCache[it->server].push_back(it->bbox);
+  if (mReplica.valid())
+    mTopLevelRegion.mBoundingBox = mReplica.bounds();
+}
+
+bool CoordinateSegmentationClient::lookupLocal(const Vector3f& pos, ServerID* result) {
+  boost::mutex::scoped_lock cachelock(mCacheMutex);
+
+  if (mReplica.valid()) {
+    *result = mReplica.lookup(pos);
+    return true;
+  }
+
+  for (uint32 i=0 ; i<mLookupCache.size(); i++) {
+    if (mLookupCache[i].bbox.contains(pos)) {
+      *result = mLookupCache[i].sid;
+      return true;
+    }
+  }
+
+  return false;
 }
 
 void CoordinateSegmentationClient::sendSegmentationListenMessage(const Address4& my_addr) {
@@ -166,12 +231,21 @@ void CoordinateSegmentationClient::sendSegmentationListenMessage(const Address4&
   writeCSEGMessage(socket, csegMessage);
 }
 
-void CoordinateSegmentationClient::reportLoad(ServerID sid, const BoundingBox3f& bbox, uint32 load) {
+void CoordinateSegmentationClient::reportLoad(ServerID sid, const BoundingBox3f& bbox, uint32 load, uint32 messageRate) {
+  // Reports wait for an ack, so keep them off the caller's thread
+  mLookupService->post(
+      std::tr1::bind(&CoordinateSegmentationClient::sendLoadReport, this, sid, bbox, load, messageRate),
+      "CoordinateSegmentationClient::sendLoadReport"
+  );
+}
+
+void CoordinateSegmentationClient::sendLoadReport(ServerID sid, BoundingBox3f bbox, uint32 load, uint32 messageRate) {
   Sirikata::Protocol::CSeg::CSegMessage csegMessage;
 
   csegMessage.mutable_load_report_message().set_load_value(load);
   csegMessage.mutable_load_report_message().set_bbox(bbox);
   csegMessage.mutable_load_report_message().set_server(sid);
+  csegMessage.mutable_load_report_message().set_message_rate(messageRate);
 
   boost::mutex::scoped_lock scopedLock(mMutex);
   boost::shared_ptr<TCPSocket> socket = getLeasedSocket();
@@ -223,21 +297,9 @@ boost::shared_ptr<TCPSocket> CoordinateSegmentationClient::getLeasedSocket() {
 }
 
 ServerID CoordinateSegmentationClient::lookup(const Vector3f& pos)  {
-  {
-    boost::mutex::scoped_lock cachelock(mCacheMutex);
-
-    for (uint32 i=0 ; i<mLookupCache.size(); i++) {
-      if (mLookupCache[i].bbox.contains(pos)) {
-
-        assert(mLookupCache[i].sid >= 1 && mLookupCache[i].sid <= 5);
-
-        //std::cout << "pos=" << pos   <<" , mLookupCache[i].sid: " << mLookupCache[i].sid << "\n";
-        //fflush(stdout);
-
-        return mLookupCache[i].sid;
-      }
-    }
-  }
+  ServerID local_result;
+  if (lookupLocal(pos, &local_result))
+    return local_result;
 
 
   Sirikata::Protocol::CSeg::CSegMessage csegMessage;
@@ -396,9 +458,96 @@ uint32 CoordinateSegmentationClient::numServers()  {
   return retval;
 }
 
+void CoordinateSegmentationClient::lookupAsync(const Vector3f& pos, const LookupCallback& cb) {
+  ServerID local_result;
+  if (lookupLocal(pos, &local_result)) {
+    cb(local_result);
+    return;
+  }
+
+  {
+    boost::mutex::scoped_lock pendinglock(mPendingMutex);
+    for (PendingLookupList::iterator it = mPendingLookups.begin(); it != mPendingLookups.end(); it++) {
+      if (it->pos == pos) {
+        it->callbacks.push_back(cb);
+        return;
+      }
+    }
+    mPendingLookups.push_back(PendingLookup(pos, cb));
+  }
+
+  mLookupService->post(
+      std::tr1::bind(&CoordinateSegmentationClient::networkLookup, this, pos),
+      "CoordinateSegmentationClient::networkLookup"
+  );
+}
+
+void CoordinateSegmentationClient::networkLookup(Vector3f pos) {
+  {
+    // May already have been answered along with another lookup
+    boost::mutex::scoped_lock pendinglock(mPendingMutex);
+    bool still_pending = false;
+    for (PendingLookupList::iterator it = mPendingLookups.begin(); it != mPendingLookups.end(); it++)
+      if (it->pos == pos) still_pending = true;
+    if (!still_pending)
+      return;
+  }
+
+  ServerID result = lookup(pos);
+
+  // Collect everything this answered, either directly or because the
+  // response filled in the region other pending lookups land in
+  typedef std::vector< std::pair<LookupCallback, ServerID> > AnsweredList;
+  AnsweredList answered;
+  {
+    boost::mutex::scoped_lock pendinglock(mPendingMutex);
+    PendingLookupList::iterator it = mPendingLookups.begin();
+    while (it != mPendingLookups.end()) {
+      ServerID it_result = result;
+      if (it->pos == pos || lookupLocal(it->pos, &it_result)) {
+        for (uint32 i = 0; i < it->callbacks.size(); i++)
+          answered.push_back(std::make_pair(it->callbacks[i], it_result));
+        it = mPendingLookups.erase(it);
+      }
+      else {
+        it++;
+      }
+    }
+  }
+
+  for (AnsweredList::iterator it = answered.begin(); it != answered.end(); it++)
+    it->first(it->second);
+}
+
+void CoordinateSegmentationClient::lookupBoundingBoxAsync(const BoundingBox3f& bbox, const LookupBoundingBoxCallback& cb) {
+  {
+    boost::mutex::scoped_lock cachelock(mCacheMutex);
+    if (mReplica.valid()) {
+      cachelock.unlock();
+      cb(lookupBoundingBox(bbox));
+      return;
+    }
+  }
+
+  mLookupService->post(
+      std::tr1::bind(&CoordinateSegmentationClient::networkLookupBoundingBox, this, bbox, cb),
+      "CoordinateSegmentationClient::networkLookupBoundingBox"
+  );
+}
+
+void CoordinateSegmentationClient::networkLookupBoundingBox(BoundingBox3f bbox, LookupBoundingBoxCallback cb) {
+  cb(lookupBoundingBox(bbox));
+}
+
 std::vector<ServerID> CoordinateSegmentationClient::lookupBoundingBox(const BoundingBox3f& bbox) {
   std::vector<ServerID> serverList;
 
+  {
+    boost::mutex::scoped_lock cachelock(mCacheMutex);
+    if (mReplica.valid())
+      return mReplica.lookupBoundingBox(bbox);
+  }
+
   //Serialize and send out the message.
   Sirikata::Protocol::CSeg::CSegMessage csegMessage;
   csegMessage.mutable_lookup_bbox_request_message().set_bbox(bbox);
@@ -446,6 +595,29 @@ void CoordinateSegmentationClient::migrationHint( std::vector<ServerLoadInfo>& s
 }
 
 void CoordinateSegmentationClient::downloadUpdatedBSPTree() {
+  uint32 version;
+  {
+    boost::mutex::scoped_lock cachelock(mCacheMutex);
+    version = mSegmentationVersion;
+  }
+
+  SegmentationReplica::LeafList leaves;
+  uint32 nservers = numServers();
+  for (ServerID server = 1; server <= nservers; server++) {
+    BoundingBoxList regions = serverRegion(server);
+    for (uint32 i = 0; i < regions.size(); i++)
+      leaves.push_back(SegmentationReplica::Leaf(server, regions[i]));
+  }
+
+  boost::mutex::scoped_lock cachelock(mCacheMutex);
+  if (version != mSegmentationVersion) {
+    // A change arrived while we were downloading and already installed a
+    // newer replica
+    return;
+  }
+  mReplica.install(leaves);
+  replicaChanged();
+  CSEG_LOG(info, "Installed replica of segmentation with " << mReplica.leaves().size() << " regions");
 }
 
 void CoordinateSegmentationClient::writeCSEGMessage(boost::shared_ptr<tcp::socket> socket,
@@ -40,8 +40,11 @@
 #include <sirikata/core/network/Address4.hpp>
 #include <sirikata/space/CoordinateSegmentation.hpp>
 #include <sirikata/space/SegmentedRegion.hpp>
+#include <sirikata/core/network/IOWork.hpp>
+#include <sirikata/core/util/Thread.hpp>
 
 #include "Protocol_CSeg.pbj.hpp"
+#include "SegmentationReplica.hpp"
 
 
 namespace Sirikata {
@@ -63,10 +66,13 @@ public:
     virtual uint32 numServers() ;
     virtual std::vector<ServerID> lookupBoundingBox(const BoundingBox3f& bbox);
 
+    virtual void lookupAsync(const Vector3f& pos, const LookupCallback& cb);
+    virtual void lookupBoundingBoxAsync(const BoundingBox3f& bbox, const LookupBoundingBoxCallback& cb);
+
     // From MessageRecipient
     virtual void receiveMessage(Message* msg);
 
-    virtual void reportLoad(ServerID, const BoundingBox3f& bbox, uint32 loadValue);
+    virtual void reportLoad(ServerID, const BoundingBox3f& bbox, uint32 loadValue, uint32 messageRate);
 
     virtual void migrationHint( std::vector<ServerLoadInfo>& svrLoadInfo );
 
@@ -77,8 +83,6 @@ private:
 
     void downloadUpdatedBSPTree();
 
-    bool mBSPTreeValid;
-
     Trace::Trace* mTrace;
 
     typedef struct LookupCacheEntry {
@@ -92,11 +96,27 @@ private:
 
     } LookupCacheEntry;
 
+    // Refresh everything cached alongside mReplica after it changes. Must
+    // hold mCacheMutex.
+    void replicaChanged();
+    // Try to answer a lookup from the replica or lookup cache, without
+    // going to the CSEG server
+    bool lookupLocal(const Vector3f& pos, ServerID* result);
+
+    // Requests which need the CSEG server run on mLookupThread
+    void networkLookup(Vector3f pos);
+    void networkLookupBoundingBox(BoundingBox3f bbox, LookupBoundingBoxCallback cb);
+    void sendLoadReport(ServerID sid, BoundingBox3f bbox, uint32 loadValue, uint32 messageRate);
+
     boost::mutex mCacheMutex;
     std::vector<LookupCacheEntry> mLookupCache;
+    // Incremented every time the segmentation changes, so a replica
+    // downloaded in the meantime isn't installed over a newer one
+    uint32 mSegmentationVersion;
     uint16 mAvailableServersCount;
     std::map<ServerID, BoundingBoxList> mServerRegionCache;
     SegmentedRegion mTopLevelRegion;
+    SegmentationReplica mReplica;
 
     Network::IOService* mIOService;  //creates an io service
     boost::shared_ptr<Network::TCPListener> mAcceptor;
@@ -111,6 +131,27 @@ private:
     String mCSEGHost;
     String mCSEGPort;
 
+    Network::IOService* mLookupService;
+    Network::IOWork* mLookupWork;
+    Thread* mLookupThread;
+
+    // In flight asynchronous lookups. Lookups for the same position share
+    // one request, and any others that land in the region returned for one
+    // request are answered along with it.
+    struct PendingLookup {
+      PendingLookup(const Vector3f& _pos, const LookupCallback& cb)
+       : pos(_pos)
+      {
+        callbacks.push_back(cb);
+      }
+
+      Vector3f pos;
+      std::vector<LookupCallback> callbacks;
+    };
+    typedef std::vector<PendingLookup> PendingLookupList;
+    boost::mutex mPendingMutex;
+    PendingLookupList mPendingLookups;
+
     void handleSelfLookup(ServerID my_sid, Address4 my_addr);
 
     void startAccepting();
@@ -50,7 +50,9 @@ protected:
         Message* mFront;
     };
 
-    typedef FairQueue<Message, ServerID, SenderAdapterQueue> FairSendQueue;
+    // Consulted for every outgoing datagram, so use the heap index which
+    // reindexes without allocating.
+    typedef FairQueue<Message, ServerID, SenderAdapterQueue, FairQueueHeapIndex> FairSendQueue;
     FairSendQueue mServerQueues;
 
     Sirikata::AtomicValue<bool> mServiceScheduled;
@@ -110,6 +110,7 @@ Forwarder::Forwarder(SpaceContext* ctx)
              mOSegLookups(NULL),
              mUniqueConnIDs(0),
              mServiceIDSource(0),
+             mODPRouters(new ODPRouterMap()),
              mServerWeightPoller(
                  ctx->mainStrand,
                  std::tr1::bind(&Forwarder::updateServerWeights, this),
@@ -125,7 +126,9 @@ Forwarder::Forwarder(SpaceContext* ctx)
              mTimeSeriesForwardedPerSecondName(String("space.server") + boost::lexical_cast<String>(ctx->id()) + ".forwarded.remote"),
              mForwardedPerSecond(0),
              mTimeSeriesDroppedPerSecondName(String("space.server") + boost::lexical_cast<String>(ctx->id()) + ".dropped.forwarder"),
-             mDroppedPerSecond(0)
+             mDroppedPerSecond(0),
+             mTimeSeriesRouterContentionName(String("space.server") + boost::lexical_cast<String>(ctx->id()) + ".forwarder.router_contention"),
+             mRouterContention(0)
 {
     mNullServerIDOSegCallback=std::tr1::bind(&Forwarder::routeObjectMessageToServerNoReturn, this, std::tr1::placeholders::_1, std::tr1::placeholders::_2,std::tr1::placeholders:: _3, NullServerID);
     mOutgoingMessages = new ForwarderServiceQueue(mContext->id(), GetOptionValue<uint32>(FORWARDER_SEND_QUEUE_SIZE), (ForwarderServiceQueue::Listener*)this);
@@ -145,9 +148,13 @@ Forwarder::Forwarder(SpaceContext* ctx)
   //Don't need to do anything special for destructor
   Forwarder::~Forwarder()
   {
-      // We don't need to delete these because they are added to
-      // mOutgoingMessages as a service queue, so they will be deleted there.
-      mODPRouters.clear();
+      // We don't need to delete the ODPFlowSchedulers because they are added
+      // to mOutgoingMessages as a service queue, so they will be deleted
+      // there. We just clean up the tables.
+      delete mODPRouters.read();
+      for(uint32 i = 0; i < mRetiredODPRouters.size(); i++)
+          delete mRetiredODPRouters[i];
+      mRetiredODPRouters.clear();
 
       delete mOSegCacheUpdateRouter;
       delete mForwarderWeightRouter;
@@ -218,6 +225,37 @@ void Forwarder::reportStats() {
         mDroppedPerSecond.read() / since_last_seconds
     );
     mDroppedPerSecond = 0;
+    mContext->timeSeries->report(
+        mTimeSeriesRouterContentionName,
+        mRouterContention.read() / since_last_seconds
+    );
+    mRouterContention = 0;
+}
+
+ODPFlowScheduler* Forwarder::lookupODPFlowScheduler(ServerID server) const {
+    const ODPRouterMap* routers = mODPRouters.read();
+    ODPRouterMap::const_iterator it = routers->find(server);
+    return (it == routers->end()) ? NULL : it->second;
+}
+
+ODPFlowScheduler* Forwarder::getODPFlowScheduler(ServerID server) {
+    // We try to look up the ODPFlowScheduler without locking first, and only
+    // take the lock to prePush if we fail to find it, i.e. for the first
+    // message to a server.
+    ODPFlowScheduler* flow_sched = lookupODPFlowScheduler(server);
+    if (flow_sched != NULL)
+        return flow_sched;
+
+    // Will force allocation of ODPFlowScheduler if its not there already
+    boost::unique_lock<boost::recursive_mutex> lck(mODPRouterMapMutex, boost::try_to_lock);
+    if (!lck.owns_lock()) {
+        mRouterContention++;
+        lck.lock();
+    }
+    mOutgoingMessages->prePush(server);
+    flow_sched = lookupODPFlowScheduler(server);
+    assert(flow_sched != NULL);
+    return flow_sched;
 }
 
 // -- Object Connection Management - Object connections are available locally,
@@ -304,15 +342,20 @@ ODPFlowScheduler* Forwarder::createODPFlowScheduler(LocationService* loc, Server
 
     {
         boost::lock_guard<boost::recursive_mutex> lck(mODPRouterMapMutex);
-        mODPRouters[remote_server] = new_flow_scheduler;
+        const ODPRouterMap* old_routers = mODPRouters.read();
+        ODPRouterMap* new_routers = new ODPRouterMap(*old_routers);
+        (*new_routers)[remote_server] = new_flow_scheduler;
+        // The copy must be complete before readers can see it
+        memory_barrier();
+        mODPRouters = new_routers;
+        mRetiredODPRouters.push_back(old_routers);
     }
     return new_flow_scheduler;
 }
 
 void Forwarder::updateServerWeights() {
-    boost::lock_guard<boost::recursive_mutex> lck(mODPRouterMapMutex);
-
-    for(ODPRouterMap::iterator it = mODPRouters.begin(); it != mODPRouters.end(); it++) {
+    const ODPRouterMap* routers = mODPRouters.read();
+    for(ODPRouterMap::const_iterator it = routers->begin(); it != routers->end(); it++) {
         ServerID serv_id = it->first;
         ODPFlowScheduler* serv_flow_sched = it->second;
 
@@ -476,13 +519,7 @@ void Forwarder::receiveWeightUpdateMessage(Message* msg) {
         weight_update.server_pair_used_weight()
     );
 
-    ODPFlowScheduler* serv_flow_sched = NULL;
-    {
-        boost::lock_guard<boost::recursive_mutex> lck(mODPRouterMapMutex);
-        ODPRouterMap::iterator flow_sched_it = mODPRouters.find(source);
-        if (flow_sched_it != mODPRouters.end())
-            serv_flow_sched = flow_sched_it->second;
-    }
+    ODPFlowScheduler* serv_flow_sched = lookupODPFlowScheduler(source);
     if (serv_flow_sched != NULL) {
         // Update with receiver stats from this remote server.
         serv_flow_sched->updateReceiverStats(
@@ -543,6 +580,23 @@ bool Forwarder::tryCacheForward(Sirikata::Protocol::Object::ObjectMessage* msg)
     return true; // If we got here, the cache was successful, we just dropped it.
 }
 
+WARN_UNUSED
+bool Forwarder::tryCacheForward(const ObjectMessageEnvelope& msg) {
+    TIMESTAMP_START(tstamp, (&msg));
+
+    TIMESTAMP_END(tstamp, Trace::OSEG_CACHE_CHECK_STARTED);
+    OSegEntry destserver = mOSegLookups->cacheLookup(msg.dest_object());
+    TIMESTAMP_END(tstamp, Trace::OSEG_CACHE_CHECK_FINISHED);
+    if (destserver.isNull())
+        return false;
+
+    if (destserver.server() == mContext->id())
+        return false;
+
+    bool send_success = routeObjectMessageToServer(msg, destserver);
+    return true; // If we got here, the cache was successful, we just dropped it.
+}
+
 void Forwarder::routeObjectMessageToServerNoReturn(Sirikata::Protocol::Object::ObjectMessage* obj_msg, const OSegEntry &dest_serv, OSegLookupQueue::ResolvedFrom resolved_from, ServerID forwardFrom) {
     (void) routeObjectMessageToServer(obj_msg, dest_serv, resolved_from, forwardFrom);
 }
@@ -573,23 +627,7 @@ bool Forwarder::routeObjectMessageToServer(Sirikata::Protocol::Object::ObjectMes
   TIMESTAMP(obj_msg, Trace::SPACE_TO_SPACE_ENQUEUED);
 
   // And then we can actually push
-  // We try to look up the ODPFlowScheduler efficiently first, and only prePush
-  // if we fail to find it.
-  ODPFlowScheduler* flow_sched = NULL;
-  {
-      boost::lock_guard<boost::recursive_mutex> lck(mODPRouterMapMutex);
-      ODPRouterMap::iterator odp_it = mODPRouters.find(dest_serv.server());
-      if (odp_it != mODPRouters.end())
-          flow_sched = odp_it->second;
-  }
-  if (flow_sched == NULL) {
-      // Will force allocation of ODPFlowScheduler if its not there already
-      {
-          boost::lock_guard<boost::recursive_mutex> lck(mODPRouterMapMutex);
-          mOutgoingMessages->prePush(dest_serv.server());
-          flow_sched = mODPRouters[dest_serv.server()];
-      }
-  }
+  ODPFlowScheduler* flow_sched = getODPFlowScheduler(dest_serv.server());
 
   OSegEntry source_object_data(OSegEntry::null());//FIXME: do we want mandatory lookup for nonlocal guys?! = mOSegLookups->cacheLookup(obj_msg->source_object());
   if (source_object_data.isNull()) {
@@ -635,6 +673,27 @@ bool Forwarder::routeObjectMessageToServer(Sirikata::Protocol::Object::ObjectMes
   return send_success;
 }
 
+bool Forwarder::routeObjectMessageToServer(const ObjectMessageEnvelope& msg, const OSegEntry& dest_serv) {
+    TIMESTAMP((&msg), Trace::OSEG_CACHE_LOOKUP_FINISHED);
+    TIMESTAMP((&msg), Trace::OSEG_LOOKUP_FINISHED);
+    TIMESTAMP((&msg), Trace::SPACE_TO_SPACE_ENQUEUED);
+
+    ODPFlowScheduler* flow_sched = getODPFlowScheduler(dest_serv.server());
+
+    // See routeObjectMessageToServer above for the source default
+    OSegEntry source_object_data(mContext->id(), 1.0);
+    bool send_success = flow_sched->push(msg, source_object_data, dest_serv);
+    if (!send_success) {
+        mDroppedPerSecond++;
+        TIMESTAMP((&msg), Trace::DROPPED_AT_SPACE_ENQUEUED);
+        TRACE_DROP(DROPPED_AT_SPACE_ENQUEUED);
+    }
+    else {
+        mForwardedPerSecond++;
+    }
+    return send_success;
+}
+
 Message* Forwarder::serverMessagePull(ServerID dest) {
     Message* next_msg = mOutgoingMessages->pop(dest);
     if (next_msg == NULL)
@@ -665,35 +724,45 @@ void Forwarder::serverMessageReceived(Message* msg) {
 
     // Routing, check if we can route immediately.
     if (msg->dest_port() == SERVER_PORT_OBJECT_MESSAGE_ROUTING) {
-        Sirikata::Protocol::Object::ObjectMessage* obj_msg = new Sirikata::Protocol::Object::ObjectMessage();
-        bool parsed = parsePBJMessage(obj_msg, msg->payload());
-        if (!parsed) {
-            LOG_INVALID_MESSAGE(forwarder, error, msg->payload());
-            delete obj_msg;
-            delete msg;
-            return;
-        }
-
-        // This process is very similar to the one followed in Server for
-        // handling OH messages.  We should probably merge them....
-
-        // Local
-        if (mLocalForwarder->tryForward(obj_msg)) {
-            delete msg;
-            return;
-        }
-
-        // OSeg Cache
-        // 4. Try to shortcut them main thread. Use forwarder to try to forward
-        // using the cache. FIXME when we do this, we skip over some checks that
-        // happen during the full forwarding
-        if (tryCacheForward(obj_msg)) {
-            delete msg;
-            return;
+        // Only the envelope is parsed unless the message is for a local
+        // object, so messages which are just passing through are forwarded
+        // without being parsed or re-serialized. If the envelope can't be
+        // read, the main strand will parse (and validate) the full message.
+        std::string payload = msg->payload();
+        ObjectMessageEnvelope envelope;
+        if (envelope.parse(payload)) {
+            // This process is very similar to the one followed in Server for
+            // handling OH messages.  We should probably merge them....
+
+            // Local
+            if (mLocalForwarder->hasActiveConnection(envelope.dest_object())) {
+                Sirikata::Protocol::Object::ObjectMessage* obj_msg = new Sirikata::Protocol::Object::ObjectMessage();
+                bool parsed = parsePBJMessage(obj_msg, payload);
+                if (!parsed) {
+                    LOG_INVALID_MESSAGE(forwarder, error, payload);
+                    delete obj_msg;
+                    delete msg;
+                    return;
+                }
+                if (mLocalForwarder->tryForward(obj_msg)) {
+                    delete msg;
+                    return;
+                }
+                delete obj_msg;
+            }
+            else {
+                // OSeg Cache
+                // 4. Try to shortcut them main thread. Use forwarder to try to forward
+                // using the cache. FIXME when we do this, we skip over some checks that
+                // happen during the full forwarding
+                if (tryCacheForward(envelope)) {
+                    delete msg;
+                    return;
+                }
+            }
         }
 
         // Couldn't get rid of it, forward normally.
-        delete obj_msg;
     }
 
     bool got_empty;
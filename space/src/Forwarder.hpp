@@ -122,8 +122,16 @@ private:
     Router<Message*>* mOSegCacheUpdateRouter;
     Router<Message*>* mForwarderWeightRouter;
     typedef std::tr1::unordered_map<ServerID, ODPFlowScheduler*> ODPRouterMap;
+    // The ODPFlowScheduler table is read for every forwarded message, from
+    // both the main strand and OH networking threads, but only changes when a
+    // new server connection is made. Readers load the current snapshot
+    // without locking. Writers hold mODPRouterMapMutex, copy the snapshot, add
+    // to the copy and publish it. Replaced snapshots may still be in use by
+    // readers and there's at most one per remote server, so they're only
+    // freed when the Forwarder is destroyed.
     boost::recursive_mutex mODPRouterMapMutex;
-    ODPRouterMap mODPRouters;
+    AtomicValue<const ODPRouterMap*> mODPRouters;
+    std::vector<const ODPRouterMap*> mRetiredODPRouters;
     Poller mServerWeightPoller; // For updating ServerMessageQueue, remote
                                 // ServerMessageReceiver with per-server weights
 
@@ -139,6 +147,9 @@ private:
     AtomicValue<uint32> mForwardedPerSecond;
     const String mTimeSeriesDroppedPerSecondName;
     AtomicValue<uint32> mDroppedPerSecond;
+    // Times the forwarding path had to wait for mODPRouterMapMutex
+    const String mTimeSeriesRouterContentionName;
+    AtomicValue<uint32> mRouterContention;
 
     // -- Boiler plate stuff - initialization, destruction, methods to satisfy interfaces
   public:
@@ -157,6 +168,12 @@ private:
   private:
     void reportStats();
 
+    // Lock free lookup of the ODPFlowScheduler for a server, or NULL if
+    // there isn't one yet.
+    ODPFlowScheduler* lookupODPFlowScheduler(ServerID server) const;
+    // Gets the ODPFlowScheduler for a server, creating it if necessary.
+    ODPFlowScheduler* getODPFlowScheduler(ServerID server);
+
     // Init method: adds an odp routing service to the ForwarderServiceQueue and
     // sets up the callback used to create new ODP input queues.
     void addODPServerMessageService(LocationService* loc);
@@ -179,6 +196,10 @@ private:
     // cache.
     WARN_UNUSED
     bool tryCacheForward(Sirikata::Protocol::Object::ObjectMessage* msg);
+    // Same as above, but for a message we only have the serialized form of. If
+    // it returns true the message has been copied and sent or dropped.
+    WARN_UNUSED
+    bool tryCacheForward(const ObjectMessageEnvelope& msg);
 
     // -- Real routing interface + implementation
 
@@ -209,6 +230,10 @@ private:
     void routeObjectMessageToServerNoReturn(Sirikata::Protocol::Object::ObjectMessage* msg, const OSegEntry& dest_serv, OSegLookupQueue::ResolvedFrom resolved_from, ServerID forwardFrom = NullServerID);
     WARN_UNUSED
     bool routeObjectMessageToServer(Sirikata::Protocol::Object::ObjectMessage* msg, const OSegEntry& dest_serv, OSegLookupQueue::ResolvedFrom resolved_from, ServerID forwardFrom = NullServerID);
+    // Forwards a serialized message without parsing it. Only used for cache
+    // hits from the networking thread, so there's no forwardFrom to update.
+    WARN_UNUSED
+    bool routeObjectMessageToServer(const ObjectMessageEnvelope& msg, const OSegEntry& dest_serv);
 
     // Dispatches a message destined for the space server itself
     void dispatchMessage(Sirikata::Protocol::Object::ObjectMessage* msg) const;
@@ -0,0 +1,169 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "KineticBoundaryQueue.hpp"
+
+namespace Sirikata {
+
+namespace {
+// Certificates that would never fail (static objects, objects in a region
+// covering everything) are still renewed after this long, matching the
+// MigrationMonitor's original handling of static objects.
+const float64 NoEventHorizon = 100.0;
+// Velocities below this are treated as zero along that axis
+const float64 MinVelocity = 0.00001;
+
+// Seconds until pos, moving at vel, leaves bb. pos must be inside bb.
+float64 timeToExit(const BoundingBox3f& bb, const Vector3f& pos, const Vector3f& vel) {
+    float64 result = NoEventHorizon;
+    for(uint32 axis = 0; axis < 3; axis++) {
+        float64 v = vel[axis];
+        if (fabs(v) < MinVelocity) continue;
+        float64 bound = (v > 0) ? bb.max()[axis] : bb.min()[axis];
+        float64 dt = (bound - pos[axis]) / v;
+        if (dt < 0) dt = 0;
+        if (dt < result) result = dt;
+    }
+    return result;
+}
+} // namespace
+
+KineticBoundaryQueue::KineticBoundaryQueue(const Duration& retry)
+ : mRetry(retry),
+   mCertificatesComputed(0)
+{
+}
+
+uint32 KineticBoundaryQueue::setRegions(const BoundingBoxList& regions, const Time& t) {
+    // Map old region indices to the same region in the new list, if it
+    // survived. Regions don't overlap, so a certificate for a region that is
+    // unchanged is still valid no matter what happened to the others.
+    std::vector<int32> remap(mRegions.size(), -1);
+    for(uint32 i = 0; i < mRegions.size(); i++) {
+        for(uint32 j = 0; j < regions.size(); j++) {
+            if (mRegions[i] == regions[j]) {
+                remap[i] = (int32)j;
+                break;
+            }
+        }
+    }
+    mRegions = regions;
+
+    uint32 recomputed = 0;
+    for(ObjectIndex::iterator it = mObjectIndex.begin(); it != mObjectIndex.end(); it++) {
+        ObjectState& obj = mObjects[it->second];
+        // Objects outside all regions might be inside one of the new ones
+        if (obj.region >= 0 && remap[obj.region] >= 0) {
+            obj.region = remap[obj.region];
+            continue;
+        }
+        mEvents.update(obj.event, computeCertificate(obj, t));
+        recomputed++;
+    }
+    return recomputed;
+}
+
+bool KineticBoundaryQueue::inRegion(const Vector3f& pos) const {
+    for(BoundingBoxList::const_iterator it = mRegions.begin(); it != mRegions.end(); it++) {
+        if (it->degenerate()) return true;
+        if (it->contains(pos, 0.0f)) return true;
+    }
+    return false;
+}
+
+Time KineticBoundaryQueue::computeCertificate(ObjectState& obj, const Time& t) {
+    mCertificatesComputed++;
+
+    Vector3f pos = obj.motion.position(t);
+    Vector3f vel = obj.motion.velocity();
+
+    // An object on the boundary between two of our regions is contained by
+    // both, so use the one it will stay in longest.
+    int32 best = -1;
+    float64 best_exit = -1;
+    for(uint32 i = 0; i < mRegions.size(); i++) {
+        const BoundingBox3f& bb = mRegions[i];
+        if (bb.degenerate()) {
+            // Covers the whole world
+            obj.region = (int32)i;
+            return t + Duration::seconds(NoEventHorizon);
+        }
+        if (!bb.contains(pos, 0.0f)) continue;
+
+        float64 exit = timeToExit(bb, pos, vel);
+        if (exit > best_exit) {
+            best = (int32)i;
+            best_exit = exit;
+        }
+    }
+
+    // On the boundary of every region containing it and heading out, it's
+    // already leaving. Treating it as inside would just mean failing the
+    // certificate again immediately.
+    Duration exit_after = Duration::seconds(best_exit);
+    if (best < 0 || exit_after <= Duration::zero()) {
+        obj.region = -1;
+        return t;
+    }
+    obj.region = best;
+    return t + exit_after;
+}
+
+void KineticBoundaryQueue::add(const UUID& id, const TimedMotionVector3f& motion, const Time& t) {
+    assert(mObjectIndex.find(id) == mObjectIndex.end());
+
+    uint32 idx;
+    if (mFreeObjects.empty()) {
+        idx = (uint32)mObjects.size();
+        mObjects.push_back(ObjectState());
+    }
+    else {
+        idx = mFreeObjects.back();
+        mFreeObjects.pop_back();
+    }
+
+    ObjectState& obj = mObjects[idx];
+    obj.id = id;
+    obj.motion = motion;
+    obj.event = mEvents.push(computeCertificate(obj, t), idx);
+    mObjectIndex[id] = idx;
+}
+
+void KineticBoundaryQueue::update(const UUID& id, const TimedMotionVector3f& motion, const Time& t) {
+    ObjectIndex::iterator it = mObjectIndex.find(id);
+    assert(it != mObjectIndex.end());
+
+    ObjectState& obj = mObjects[it->second];
+    obj.motion = motion;
+    mEvents.update(obj.event, computeCertificate(obj, t));
+}
+
+void KineticBoundaryQueue::remove(const UUID& id) {
+    ObjectIndex::iterator it = mObjectIndex.find(id);
+    if (it == mObjectIndex.end())
+        return;
+
+    mEvents.erase(mObjects[it->second].event);
+    mFreeObjects.push_back(it->second);
+    mObjectIndex.erase(it);
+}
+
+bool KineticBoundaryQueue::contains(const UUID& id) const {
+    return (mObjectIndex.find(id) != mObjectIndex.end());
+}
+
+void KineticBoundaryQueue::expire(const Time& t, std::vector<UUID>* leaving) {
+    while(!mEvents.empty() && mEvents.topKey() <= t) {
+        ObjectState& obj = mObjects[mEvents.topValue()];
+
+        Time next = computeCertificate(obj, t);
+        if (obj.region < 0) {
+            leaving->push_back(obj.id);
+            next = t + mRetry;
+        }
+        mEvents.update(obj.event, next);
+    }
+}
+
+} // namespace Sirikata
@@ -0,0 +1,97 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_KINETIC_BOUNDARY_QUEUE_HPP_
+#define _SIRIKATA_KINETIC_BOUNDARY_QUEUE_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/util/UUID.hpp>
+#include <sirikata/core/util/MotionVector.hpp>
+#include <sirikata/core/util/BoundingBox.hpp>
+#include <sirikata/core/queue/PairingHeap.hpp>
+
+namespace Sirikata {
+
+/** KineticBoundaryQueue tracks when moving objects cross the boundaries of a
+ *  set of regions, in the style of a kinetic data structure. Each object
+ *  holds a certificate, "stays inside region i", and the analytic time that
+ *  certificate fails is computed once from the object's motion and kept in a
+ *  PairingHeap. Nothing is recomputed until a certificate fails, the object's
+ *  motion changes, or the region the certificate refers to changes.
+ *
+ *  When a certificate fails the object is either inside another region, in
+ *  which case it just gets a new certificate, or has left all the regions and
+ *  is reported as leaving. Leaving objects are reported again every retry
+ *  period until they are removed, since whoever handles them may decline to
+ *  act immediately.
+ */
+class KineticBoundaryQueue {
+public:
+    KineticBoundaryQueue(const Duration& retry);
+
+    /** Replace the set of regions. Objects whose certificate refers to a
+     *  region that is still present keep their certificate, only the others
+     *  are recomputed.
+     *  \returns the number of certificates that were recomputed
+     */
+    uint32 setRegions(const BoundingBoxList& regions, const Time& t);
+    const BoundingBoxList& regions() const { return mRegions; }
+
+    bool inRegion(const Vector3f& pos) const;
+
+    void add(const UUID& id, const TimedMotionVector3f& motion, const Time& t);
+    void update(const UUID& id, const TimedMotionVector3f& motion, const Time& t);
+    void remove(const UUID& id);
+    bool contains(const UUID& id) const;
+
+    uint32 size() const { return mEvents.size(); }
+    bool empty() const { return mEvents.empty(); }
+
+    /** Time the earliest certificate fails. Must not be empty. */
+    const Time& nextEventTime() const { return mEvents.topKey(); }
+
+    /** Process all certificates that fail at or before t, appending the
+     *  objects that have left all the regions to leaving.
+     */
+    void expire(const Time& t, std::vector<UUID>* leaving);
+
+    /** Total number of certificates computed, for measuring how much work
+     *  the structure is doing.
+     */
+    uint64 certificatesComputed() const { return mCertificatesComputed; }
+
+private:
+    struct ObjectState {
+        UUID id;
+        TimedMotionVector3f motion;
+        // Index into mRegions of the region the certificate is for, or -1 if
+        // the object isn't in any region
+        int32 region;
+        uint32 event;
+    };
+    typedef PairingHeap<Time, uint32> EventHeap;
+    typedef std::tr1::unordered_map<UUID, uint32, UUID::Hasher> ObjectIndex;
+
+    // Finds the region the object is in at time t and computes when it will
+    // leave it, storing the region in obj. If it isn't in any region, or is
+    // on the boundary of all the regions it's in and heading out, returns t
+    // so it is handled immediately.
+    Time computeCertificate(ObjectState& obj, const Time& t);
+
+    BoundingBoxList mRegions;
+    Duration mRetry;
+
+    // Objects are stored densely and refer to each other by index, the heap
+    // values are indices into mObjects
+    std::vector<ObjectState> mObjects;
+    std::vector<uint32> mFreeObjects;
+    ObjectIndex mObjectIndex;
+    EventHeap mEvents;
+
+    uint64 mCertificatesComputed;
+}; // class KineticBoundaryQueue
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_KINETIC_BOUNDARY_QUEUE_HPP_
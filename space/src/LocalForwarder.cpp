@@ -67,6 +67,11 @@ void LocalForwarder::removeActiveConnection(const UUID& objid) {
     mActiveConnections.erase(it);
 }
 
+bool LocalForwarder::hasActiveConnection(const UUID& objid) {
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    return (mActiveConnections.find(objid) != mActiveConnections.end());
+}
+
 bool LocalForwarder::tryForward(Sirikata::Protocol::Object::ObjectMessage* msg) {
     ObjectConnection* conn = NULL;
     {
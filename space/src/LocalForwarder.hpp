@@ -71,6 +71,11 @@ class LocalForwarder : public PollingService {
      *  \returns true if the message was forwarded, false otherwise
      */
     bool tryForward(Sirikata::Protocol::Object::ObjectMessage* msg);
+
+    /** Check whether an object is directly connected, i.e. whether a message
+     *  to it might be handled by tryForward.
+     */
+    bool hasActiveConnection(const UUID& objid);
   private:
 
     virtual void poll();
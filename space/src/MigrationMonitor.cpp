@@ -34,10 +34,11 @@
 
 namespace Sirikata {
 
-MigrationMonitor::MigrationMonitor(SpaceContext* ctx, LocationService* locservice, CoordinateSegmentation* cseg, MigrationCallback cb)
+MigrationMonitor::MigrationMonitor(SpaceContext* ctx, LocationService* locservice, CoordinateSegmentation* cseg, MigrationCallback cb, bool kinetic)
  : mContext(ctx),
    mLocService(locservice),
    mCSeg(cseg),
+   mKinetic(NULL),
    mStrand(ctx->mainStrand), // NOTE: All uses of Loc, CSeg, and mBoundingRegions need to be thread safe before this is its own strand
    mTimer(
        Network::IOTimer::create(
@@ -52,24 +53,39 @@ MigrationMonitor::MigrationMonitor(SpaceContext* ctx, LocationService* locservic
     mCSeg->addListener(this);
 
     mBoundingRegions = mCSeg->serverRegion( mLocService->context()->id() );
+
+    if (kinetic) {
+        // Objects the Server declines to migrate are reported again after
+        // this long
+        mKinetic = new KineticBoundaryQueue(Duration::milliseconds(100.0));
+        mKinetic->setRegions(mBoundingRegions, mContext->simTime());
+    }
 }
 
 MigrationMonitor::~MigrationMonitor() {
     mCSeg->removeListener(this);
     mLocService->removeListener(this);
+
+    delete mKinetic;
 }
 
 void MigrationMonitor::waitForNextEvent() {
-    if (mObjectInfo.empty())
-        return;
-
-    ObjectInfoByNextEvent::iterator first_it = mObjectInfo.get<nextevent>().begin();
-    const ObjectInfo& earliest_event = *first_it;
+    Time earliest_event = Time::null();
+    if (mKinetic != NULL) {
+        if (mKinetic->empty())
+            return;
+        earliest_event = mKinetic->nextEventTime();
+    }
+    else {
+        if (mObjectInfo.empty())
+            return;
+        earliest_event = mObjectInfo.get<nextevent>().begin()->nextEvent;
+    }
 
-    if (earliest_event.nextEvent == mMinEventTime)
+    if (earliest_event == mMinEventTime)
         return;
 
-    mMinEventTime = earliest_event.nextEvent;
+    mMinEventTime = earliest_event;
 
     Time now = mContext->simTime();
     Duration tdiff =
@@ -79,6 +95,11 @@ void MigrationMonitor::waitForNextEvent() {
 }
 
 void MigrationMonitor::service() {
+    if (mKinetic != NULL) {
+        serviceKinetic();
+        return;
+    }
+
     std::set<UUID> considered;
 
     Time curt = mLocService->context()->simTime();
@@ -126,6 +147,30 @@ void MigrationMonitor::service() {
     waitForNextEvent();
 }
 
+void MigrationMonitor::serviceKinetic() {
+    Time curt = mLocService->context()->simTime();
+
+    std::vector<UUID> leaving;
+    mKinetic->expire(curt, &leaving);
+
+    for(std::vector<UUID>::iterator it = leaving.begin(); it != leaving.end(); it++) {
+        // Removals posted by a location update might not have been processed yet.
+        if (!mLocService->contains(*it))
+            continue;
+
+        // Same secondary check as service(), the object has to have moved
+        // into some other server's region, not just out of ours
+        Vector3f obj_pos = mLocService->currentPosition(*it);
+        if (!mCSeg->region().degenerate() && mCSeg->region().contains(obj_pos, 0.0f))
+            mCB(*it);
+    }
+
+    // mCB may have migrated objects, but their removal is posted to our
+    // strand, so they stay in mKinetic until then and the earliest event is
+    // still valid
+    waitForNextEvent();
+}
+
 bool MigrationMonitor::onThisServer(const Vector3f& pos) const {
     return inRegion(pos);
 }
@@ -225,6 +270,12 @@ void MigrationMonitor::changeNextEventTime(ObjectInfo& objinfo, const Time& newt
 }
 
 void MigrationMonitor::handleLocalObjectAdded(const UUID& uuid, const TimedMotionVector3f& loc, const AggregateBoundingInfo& bounds) {
+    if (mKinetic != NULL) {
+        mKinetic->add(uuid, loc, mContext->simTime());
+        waitForNextEvent();
+        return;
+    }
+
     assert( mObjectInfo.get<objid>().find(uuid) == mObjectInfo.get<objid>().end());
 
     mObjectInfo.insert( ObjectInfo(uuid, computeNextEventTime(uuid, loc)) );
@@ -239,7 +290,10 @@ void MigrationMonitor::localObjectRemoved(const UUID& uuid, bool agg) {
 }
 
 void MigrationMonitor::handleLocalObjectRemoved(const UUID& uuid) {
-    mObjectInfo.get<objid>().erase(uuid);
+    if (mKinetic != NULL)
+        mKinetic->remove(uuid);
+    else
+        mObjectInfo.get<objid>().erase(uuid);
     waitForNextEvent();
 }
 
@@ -251,6 +305,12 @@ void MigrationMonitor::localLocationUpdated(const UUID& uuid, bool agg, const Ti
 }
 
 void MigrationMonitor::handleLocalLocationUpdated(const UUID& uuid, const TimedMotionVector3f& newval) {
+    if (mKinetic != NULL) {
+        mKinetic->update(uuid, newval, mContext->simTime());
+        waitForNextEvent();
+        return;
+    }
+
     assert( mObjectInfo.get<objid>().find(uuid) != mObjectInfo.get<objid>().end());
 
     ObjectInfoByID& by_id = mObjectInfo.get<objid>();
@@ -276,6 +336,13 @@ void MigrationMonitor::handleUpdatedSegmentation(CoordinateSegmentation* cseg, c
         if (it->server == mLocService->context()->id()) {
             mBoundingRegions = it->region;
 
+            if (mKinetic != NULL) {
+                // Only objects in regions that changed need new certificates
+                mKinetic->setRegions(mBoundingRegions, mContext->simTime());
+                waitForNextEvent();
+                return;
+            }
+
             // Recalculate *all* object potential update times
             ObjectInfoByID& by_id = mObjectInfo.get<objid>();
             for(ObjectInfoByID::iterator obj_it = by_id.begin(); obj_it != by_id.end(); obj_it++) {
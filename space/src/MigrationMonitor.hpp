@@ -36,6 +36,7 @@
 #include <sirikata/core/util/Platform.hpp>
 #include <sirikata/space/LocationService.hpp>
 #include <sirikata/space/CoordinateSegmentation.hpp>
+#include "KineticBoundaryQueue.hpp"
 
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/member.hpp>
@@ -58,13 +59,20 @@ public:
      *  \param locservice location service for this server
      *  \param cseg coordinate segmentation used for this server
      *  \param cb callback to be invoked when a migration is detected
+     *  \param kinetic if true, track region crossings with a
+     *         KineticBoundaryQueue and only report objects which have left
+     *         this server's regions, instead of re-checking every object
+     *         whose estimated crossing time has passed
      */
-    MigrationMonitor(SpaceContext* ctx, LocationService* locservice, CoordinateSegmentation* cseg, MigrationCallback cb);
+    MigrationMonitor(SpaceContext* ctx, LocationService* locservice, CoordinateSegmentation* cseg, MigrationCallback cb, bool kinetic = false);
     ~MigrationMonitor();
 
     // Indicates whether the given position is on this server, useful to check if object should be
     // permitted to join this server.
     bool onThisServer(const Vector3f& pos) const;
+    // This server's regions as of the last segmentation change. A server
+    // without a region has a single degenerate one.
+    const BoundingBoxList& regions() const { return mBoundingRegions; }
 
 private:
 
@@ -88,6 +96,9 @@ private:
 
     // Service the migration monitor, return a set of objects for which migrations should be started
     void service();
+    // service() for kinetic mode, only handles objects mKinetic reports as
+    // having left this server's regions
+    void serviceKinetic();
 
     bool inRegion(const Vector3f& pos) const;
 
@@ -127,6 +138,9 @@ private:
 
     ObjectInfoSet mObjectInfo;
 
+    // Used instead of mObjectInfo when running in kinetic mode, NULL otherwise
+    KineticBoundaryQueue* mKinetic;
+
     Network::IOStrand* mStrand;
     Network::IOTimerPtr mTimer;
 
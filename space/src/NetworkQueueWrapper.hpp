@@ -43,10 +43,9 @@ class NetworkQueueWrapper {
     SpaceNetwork::ReceiveStream* mReceiveStream;
     Message* mFront;
     Trace::MessagePath mPathTag;
-    typedef Network::Chunk Chunk;
 
-    Message* parse(Chunk* c) {
-        Message* msg = Message::deserialize(*c);
+    Message* parse(const MemoryReference& c) {
+        Message* msg = Message::deserialize(c);
 
         if (msg == NULL) {
             // FIXME if this happens we're probably going to never remove the chunk from the network...
@@ -83,8 +82,8 @@ public:
 
     Message* front() {
         if (mFront == NULL) {
-            Chunk* c = mReceiveStream->front();
-            if (c != NULL)
+            MemoryReference c = MemoryReference::null();
+            if (mReceiveStream->front(&c))
                 mFront = parse(c);
         }
 
@@ -92,9 +91,8 @@ public:
     }
 
     Message* pop(){
-        Chunk* c = mReceiveStream->pop();
-
-        if (c == NULL) {
+        MemoryReference c = MemoryReference::null();
+        if (!mReceiveStream->pop(&c)) {
             assert(mFront == NULL);
             return NULL;
         }
@@ -108,12 +106,12 @@ public:
             result = parse(c);
         }
 
-        delete c;
         return result;
     }
 
     bool empty() const {
-        return mFront == NULL && mReceiveStream->front() == NULL;
+        MemoryReference c = MemoryReference::null();
+        return mFront == NULL && !mReceiveStream->front(&c);
     }
 };
 }
@@ -92,6 +92,9 @@ public:
 
     // ODP push interface. Note: Must be thread safe!
     virtual bool push(Sirikata::Protocol::Object::ObjectMessage* msg, const OSegEntry& sourceObjectData, const OSegEntry& dstObjectData) = 0;
+    // Push an already serialized message, e.g. one being forwarded, without
+    // parsing it. The serialized data is copied, so the caller keeps ownership.
+    virtual bool push(const ObjectMessageEnvelope& msg, const OSegEntry& sourceObjectData, const OSegEntry& dstObjectData) = 0;
 
     // Get the sum of the weights of active queues.
     virtual float totalActiveWeight() = 0;
@@ -136,6 +139,15 @@ protected:
         );
         return svr_obj_msg;
     }
+    Message* createMessageFromODP(const ObjectMessageEnvelope* obj_msg, ServerID dest_serv) {
+        return new Message(
+            mContext->id(),
+            SERVER_PORT_OBJECT_MESSAGE_ROUTING,
+            dest_serv,
+            SERVER_PORT_OBJECT_MESSAGE_ROUTING,
+            *obj_msg
+        );
+    }
 
     SpaceContext* mContext;
     ForwarderServiceQueue* mParent;
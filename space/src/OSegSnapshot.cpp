@@ -0,0 +1,296 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "OSegSnapshot.hpp"
+#include <sirikata/core/util/Timer.hpp>
+#include <cstdio>
+
+#if SIRIKATA_PLATFORM == SIRIKATA_PLATFORM_WINDOWS
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#define OSEGSNAPSHOT_LOG(lvl,msg) SILOG(oseg_snapshot, lvl, msg)
+
+#define OSEG_SNAPSHOT_VERSION 1
+
+namespace Sirikata {
+
+namespace {
+
+const char SnapshotMagic[8] = { 'S', 'I', 'R', 'I', 'O', 'S', 'E', 'G' };
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32 version;
+    uint32 server;
+    // Microseconds since the epoch
+    int64 saved;
+    uint32 numCacheEntries;
+    uint32 numLocalObjects;
+    // Over the header, with this field zeroed, and all the records
+    uint32 checksum;
+    uint32 reserved;
+};
+
+struct SnapshotRecord {
+    UUID::byte id[UUID::static_size];
+    uint32 server;
+    float32 radius;
+};
+
+// FNV-1a
+uint32 checksum(uint32 hash, const void* data, size_t len) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for(size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint32 checksum(const SnapshotHeader& header, const std::vector<SnapshotRecord>& records) {
+    SnapshotHeader zeroed = header;
+    zeroed.checksum = 0;
+    uint32 hash = checksum(2166136261u, &zeroed, sizeof(zeroed));
+    if (!records.empty())
+        hash = checksum(hash, &records[0], records.size() * sizeof(SnapshotRecord));
+    return hash;
+}
+
+void appendRecords(const OSegEntryList& entries, std::vector<SnapshotRecord>* records) {
+    for(uint32 i = 0; i < entries.size(); i++) {
+        SnapshotRecord rec;
+        memcpy(rec.id, entries[i].first.getArray().data(), UUID::static_size);
+        rec.server = entries[i].second.server();
+        rec.radius = entries[i].second.radius();
+        records->push_back(rec);
+    }
+}
+
+void extractRecords(const std::vector<SnapshotRecord>& records, uint32 start, uint32 count, OSegEntryList* entries) {
+    entries->reserve(count);
+    for(uint32 i = start; i < start + count; i++) {
+        const SnapshotRecord& rec = records[i];
+        entries->push_back(std::make_pair(UUID(rec.id, UUID::static_size), OSegEntry(rec.server, rec.radius)));
+    }
+}
+
+bool syncAndClose(FILE* fp) {
+    bool ok = (fflush(fp) == 0);
+#if SIRIKATA_PLATFORM == SIRIKATA_PLATFORM_WINDOWS
+    ok = ok && FlushFileBuffers((HANDLE) _get_osfhandle(_fileno(fp)));
+#else
+    ok = ok && (fsync(fileno(fp)) == 0);
+#endif
+    return (fclose(fp) == 0) && ok;
+}
+
+bool replaceFile(const String& from, const String& to) {
+#if SIRIKATA_PLATFORM == SIRIKATA_PLATFORM_WINDOWS
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    // rename() replaces the target atomically
+    return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+} // namespace
+
+OSegSnapshot::Contents::Contents()
+ : server(NullServerID),
+   saved(Time::null())
+{
+}
+
+uint64 OSegSnapshot::save(const String& filename, const Contents& contents) {
+    std::vector<SnapshotRecord> records;
+    records.reserve(contents.cacheEntries.size() + contents.localObjects.size());
+    appendRecords(contents.cacheEntries, &records);
+    appendRecords(contents.localObjects, &records);
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SnapshotMagic, sizeof(SnapshotMagic));
+    header.version = OSEG_SNAPSHOT_VERSION;
+    header.server = contents.server;
+    header.saved = (int64)contents.saved.raw();
+    header.numCacheEntries = contents.cacheEntries.size();
+    header.numLocalObjects = contents.localObjects.size();
+    header.checksum = checksum(header, records);
+
+    String tmp_filename = filename + ".tmp";
+    FILE* fp = fopen(tmp_filename.c_str(), "wb");
+    if (fp == NULL) {
+        OSEGSNAPSHOT_LOG(error, "Couldn't open " << tmp_filename << " to save OSeg snapshot");
+        return 0;
+    }
+
+    bool ok = (fwrite(&header, sizeof(header), 1, fp) == 1);
+    if (ok && !records.empty())
+        ok = (fwrite(&records[0], sizeof(SnapshotRecord), records.size(), fp) == records.size());
+    // The data has to be on disk before the rename, otherwise a crash could
+    // leave the new name pointing at an incomplete file
+    ok = syncAndClose(fp) && ok;
+
+    if (!ok || !replaceFile(tmp_filename, filename)) {
+        OSEGSNAPSHOT_LOG(error, "Failed to save OSeg snapshot to " << filename);
+        remove(tmp_filename.c_str());
+        return 0;
+    }
+
+    return sizeof(header) + records.size() * sizeof(SnapshotRecord);
+}
+
+bool OSegSnapshot::load(const String& filename, Contents* contents_out) {
+    FILE* fp = fopen(filename.c_str(), "rb");
+    if (fp == NULL) {
+        OSEGSNAPSHOT_LOG(info, "No OSeg snapshot at " << filename);
+        return false;
+    }
+
+    SnapshotHeader header;
+    std::vector<SnapshotRecord> records;
+    bool ok = (fread(&header, sizeof(header), 1, fp) == 1) &&
+        (memcmp(header.magic, SnapshotMagic, sizeof(SnapshotMagic)) == 0) &&
+        header.version == OSEG_SNAPSHOT_VERSION;
+    if (ok) {
+        records.resize((size_t)header.numCacheEntries + header.numLocalObjects);
+        if (!records.empty())
+            ok = (fread(&records[0], sizeof(SnapshotRecord), records.size(), fp) == records.size());
+        // Trailing data means the header doesn't describe this file
+        ok = ok && (fgetc(fp) == EOF);
+    }
+    fclose(fp);
+
+    if (!ok || checksum(header, records) != header.checksum) {
+        OSEGSNAPSHOT_LOG(error, "Ignoring invalid OSeg snapshot " << filename);
+        return false;
+    }
+
+    contents_out->server = header.server;
+    contents_out->saved = Time::microseconds(header.saved);
+    contents_out->cacheEntries.clear();
+    contents_out->localObjects.clear();
+    extractRecords(records, 0, header.numCacheEntries, &contents_out->cacheEntries);
+    extractRecords(records, header.numCacheEntries, header.numLocalObjects, &contents_out->localObjects);
+    return true;
+}
+
+
+OSegSnapshotter::OSegSnapshotter(SpaceContext* ctx, const String& filename, const Duration& interval, OSegCache* cache, ObjectSegmentation* oseg)
+ : mContext(ctx),
+   mFilename(filename),
+   mInterval(interval),
+   mCache(cache),
+   mOSeg(oseg),
+   mTimer(
+       Network::IOTimer::create(
+           ctx->mainStrand,
+           std::tr1::bind(&OSegSnapshotter::handleTimer, this)
+       )
+   ),
+   mStopped(false),
+   mWriteService(new Network::IOService("OSegSnapshotter")),
+   mWriteWork(NULL),
+   mWriteThread(NULL),
+   mPendingWrites(0)
+{
+}
+
+OSegSnapshotter::~OSegSnapshotter() {
+    delete mWriteService;
+}
+
+void OSegSnapshotter::restore(const Duration& max_age) {
+    Time start = Timer::now();
+
+    OSegSnapshot::Contents contents;
+    if (!OSegSnapshot::load(mFilename, &contents))
+        return;
+
+    if (contents.server != mContext->id()) {
+        OSEGSNAPSHOT_LOG(warn, "Ignoring OSeg snapshot " << mFilename << " saved by server " << contents.server);
+        return;
+    }
+    Duration age = start - contents.saved;
+    if (age > max_age) {
+        OSEGSNAPSHOT_LOG(info, "Ignoring OSeg snapshot " << mFilename << " saved " << age << " ago");
+        return;
+    }
+
+    // None of this server's objects are connected yet, so entries pointing
+    // back here would only direct messages to objects that aren't here
+    uint32 preloaded = 0;
+    for(uint32 i = 0; i < contents.cacheEntries.size(); i++) {
+        if (contents.cacheEntries[i].second.server() == mContext->id()) continue;
+        mCache->insert(contents.cacheEntries[i].first, contents.cacheEntries[i].second);
+        preloaded++;
+    }
+    mOSeg->restoreLocalObjects(contents.localObjects);
+
+    OSEGSNAPSHOT_LOG(info,
+        "Preloaded " << preloaded << " OSeg cache entries and " << contents.localObjects.size()
+        << " previously owned objects from snapshot saved " << age << " ago in " << (Timer::now() - start));
+}
+
+void OSegSnapshotter::start() {
+    mWriteWork = new Network::IOWork(mWriteService, "OSegSnapshotter");
+    mWriteThread = new Thread(
+        "OSegSnapshotter",
+        std::tr1::bind(&Network::IOService::runNoReturn, mWriteService)
+    );
+    mTimer->wait(mInterval);
+}
+
+void OSegSnapshotter::stop() {
+    mStopped = true;
+    mTimer->cancel();
+    // A clean shutdown leaves the most up to date snapshot possible
+    snapshot();
+
+    // Finish writing it before we let the server exit
+    delete mWriteWork;
+    mWriteWork = NULL;
+    mWriteThread->join();
+    delete mWriteThread;
+    mWriteThread = NULL;
+}
+
+void OSegSnapshotter::snapshot() {
+    Time start = Timer::now();
+
+    ContentsPtr contents(new OSegSnapshot::Contents());
+    contents->server = mContext->id();
+    contents->saved = start;
+    mCache->getEntries(&contents->cacheEntries);
+    mOSeg->getLocalObjects(&contents->localObjects);
+
+    mPendingWrites++;
+    mWriteService->post(
+        std::tr1::bind(&OSegSnapshotter::write, this, contents, start),
+        "OSegSnapshotter::write"
+    );
+}
+
+void OSegSnapshotter::write(ContentsPtr contents, Time start) {
+    uint64 bytes = OSegSnapshot::save(mFilename, *contents);
+    if (bytes > 0)
+        OSEGSNAPSHOT_LOG(detailed,
+            "Saved " << contents->cacheEntries.size() << " cache entries and " << contents->localObjects.size()
+            << " owned objects (" << bytes << " bytes) in " << (Timer::now() - start));
+    mPendingWrites--;
+}
+
+void OSegSnapshotter::handleTimer() {
+    if (mStopped) return;
+    // If the disk can't keep up, skip this one rather than queueing up
+    // snapshots which would be out of date by the time they're written
+    if (mPendingWrites == 0)
+        snapshot();
+    mTimer->wait(mInterval);
+}
+
+} // namespace Sirikata
@@ -0,0 +1,95 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_OSEG_SNAPSHOT_HPP_
+#define _SIRIKATA_OSEG_SNAPSHOT_HPP_
+
+#include <sirikata/space/SpaceContext.hpp>
+#include <sirikata/space/ObjectSegmentation.hpp>
+#include <sirikata/core/service/Service.hpp>
+#include <sirikata/core/network/IOTimer.hpp>
+#include <sirikata/core/network/IOWork.hpp>
+#include <sirikata/core/util/Thread.hpp>
+
+namespace Sirikata {
+
+/** OSegSnapshot saves the contents of a space server's OSeg cache, along with
+ *  the objects it owns, so that after a restart the server can preload them
+ *  instead of starting cold and paying a remote lookup for every destination
+ *  until the cache warms up again.
+ *
+ *  The file is a fixed size header followed by fixed size records, cache
+ *  entries first and then owned objects, in native byte order, so it can be
+ *  read in a single pass or mapped directly. Snapshots are written to a
+ *  temporary file which is synced and then renamed over the previous one, so
+ *  a crash leaves either the old or the new snapshot, never a partial one. A
+ *  checksum over the contents catches anything else.
+ */
+class OSegSnapshot {
+public:
+    struct Contents {
+        Contents();
+
+        ServerID server;
+        // Wall clock time it was saved, since sim time restarts with the server
+        Time saved;
+        OSegEntryList cacheEntries;
+        OSegEntryList localObjects;
+    };
+
+    /** \returns the number of bytes written, or 0 if it couldn't be saved */
+    static uint64 save(const String& filename, const Contents& contents);
+    /** \returns false if the file is missing, truncated or corrupt */
+    static bool load(const String& filename, Contents* contents_out);
+};
+
+/** OSegSnapshotter saves an OSegSnapshot of an OSegCache and the objects owned
+ *  by an ObjectSegmentation periodically, and once more when it stops. The
+ *  entries are collected on the main strand since that's where the OSeg
+ *  manages its objects, but the file is written, synced and renamed on a
+ *  thread of its own so the main strand never waits on the disk.
+ */
+class OSegSnapshotter : public Service {
+public:
+    OSegSnapshotter(SpaceContext* ctx, const String& filename, const Duration& interval, OSegCache* cache, ObjectSegmentation* oseg);
+    ~OSegSnapshotter();
+
+    /** Preload the cache from the last snapshot, if there is one that is no
+     *  older than max_age, and hand the OSeg the objects it owned. Preloaded
+     *  entries are only hints, just like other cache entries: one that has
+     *  gone stale is corrected the first time it is used, when the server it
+     *  names forwards the message and sends back an OSeg update. Must be
+     *  called before the OSeg is started.
+     */
+    void restore(const Duration& max_age);
+
+    virtual void start();
+    virtual void stop();
+
+private:
+    typedef std::tr1::shared_ptr<OSegSnapshot::Contents> ContentsPtr;
+
+    void snapshot();
+    void handleTimer();
+    // Runs on mWriteThread
+    void write(ContentsPtr contents, Time start);
+
+    SpaceContext* mContext;
+    String mFilename;
+    Duration mInterval;
+    OSegCache* mCache;
+    ObjectSegmentation* mOSeg;
+    Network::IOTimerPtr mTimer;
+    bool mStopped;
+
+    Network::IOService* mWriteService;
+    Network::IOWork* mWriteWork;
+    Thread* mWriteThread;
+    // Snapshots collected but not written yet
+    AtomicValue<uint32> mPendingWrites;
+}; // class OSegSnapshotter
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_OSEG_SNAPSHOT_HPP_
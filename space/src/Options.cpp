@@ -62,9 +62,15 @@ void InitSpaceOptions() {
         .addOption(new OptionValue(SERVER_RECEIVER, "fair", Sirikata::OptionValueType<String>(), "The type of ServerMessageReceiver to use for routing."))
         .addOption(new OptionValue(SERVER_ODP_FLOW_SCHEDULER, "region", Sirikata::OptionValueType<String>(), "The type of ODPFlowScheduler to use for routing."))
         .addOption(new OptionValue(FORWARDER_RECEIVE_QUEUE_SIZE, "16384", Sirikata::OptionValueType<uint32>(), "The type of ODPFlowScheduler to use for routing."))
+
+        .addOption(new OptionValue(OPT_IOSERVICE_RUN_QUEUES, "1", Sirikata::OptionValueType<uint32>(), "Number of run queues the main IOService spreads strands across. 1 uses a single queue shared by all threads, otherwise each strand is pinned to a queue and idle threads steal work from other queues. Usually 1 or the number of threads running the space server."))
         .addOption(new OptionValue(FORWARDER_SEND_QUEUE_SIZE, "65536", Sirikata::OptionValueType<uint32>(), "The type of ODPFlowScheduler to use for routing."))
+        .addOption(new OptionValue(OPT_CSEG_LOAD_REPORT_INTERVAL, "0s", Sirikata::OptionValueType<Duration>(), "How often to report this server's object count and object message rate to CSeg, which uses them to rebalance the segmentation. 0 only reports when objects connect, which is all the threshold load balancer needs. Set this, e.g. to 5s, when CSeg runs with --cseg-load-balancer=cost."))
+        .addOption(new OptionValue(OPT_MIGRATION_MONITOR_KINETIC, "false", Sirikata::OptionValueType<bool>(), "If true, the MigrationMonitor precomputes when each object will cross its server region's boundaries and only wakes up for objects that have left the server's region."))
 
         .addOption(new OptionValue(NETWORK_TYPE, "tcp", Sirikata::OptionValueType<String>(), "The networking subsystem to use."))
+        .addOption(new OptionValue(NETWORK_BATCH_BYTES, "0", Sirikata::OptionValueType<uint32>(), "Maximum number of bytes of server messages to coalesce into a single write to another space server, or 0 to send each message separately. All space servers must use the same setting."))
+        .addOption(new OptionValue(NETWORK_BATCH_LINGER, "1ms", Sirikata::OptionValueType<Duration>(), "Maximum time a server message may wait for more messages to batch with."))
 
         .addOption(new OptionValue(OSEG,"local",Sirikata::OptionValueType<String>(),"Specifies which type of oseg to use."))
         .addOption(new OptionValue(OSEG_OPTIONS,"",Sirikata::OptionValueType<String>(),"Specifies arguments to OSeg."))
@@ -73,13 +79,16 @@ void InitSpaceOptions() {
 
         .addOption(new OptionValue(OSEG_CACHE_SIZE, "200", Sirikata::OptionValueType<uint32>(), "Maximum number of entries in the OSeg cache."))
 
-        .addOption(new OptionValue(CACHE_SELECTOR,CACHE_TYPE_ORIGINAL_LRU,Sirikata::OptionValueType<String>(),"Which caching algorithm to use."))
+        .addOption(new OptionValue(CACHE_SELECTOR,CACHE_TYPE_ORIGINAL_LRU,Sirikata::OptionValueType<String>(),"Which caching algorithm to use: " CACHE_TYPE_ORIGINAL_LRU ", " CACHE_TYPE_CLOCK " or " CACHE_TYPE_COMMUNICATION "."))
 
          .addOption(new OptionValue(CACHE_COMM_SCALING,"1.0",Sirikata::OptionValueType<double>(),"What the communication falloff function scaling factor is."))
          .addOption(new OptionValue("send-capacity-overestimate","80000",Sirikata::OptionValueType<double>(),"How much to overestimate send capacity when queue is not blocked."))
          .addOption(new OptionValue("receive-capacity-overestimate","1",Sirikata::OptionValueType<double>(),"How much to overestimate recv capacity when queue is not blocked."))
         .addOption(new OptionValue(OSEG_CACHE_CLEAN_GROUP_SIZE, "25", Sirikata::OptionValueType<uint32>(), "Number of items to remove from the OSeg cache when it reaches the maximum size."))
         .addOption(new OptionValue(OSEG_CACHE_ENTRY_LIFETIME, "8s", Sirikata::OptionValueType<Duration>(), "Maximum lifetime for an OSeg cache entry."))
+        .addOption(new OptionValue(OSEG_SNAPSHOT, "", Sirikata::OptionValueType<String>(), "File to periodically save the OSeg cache and locally owned objects to, and to preload them from on startup. Empty disables snapshots."))
+        .addOption(new OptionValue(OSEG_SNAPSHOT_INTERVAL, "10s", Sirikata::OptionValueType<Duration>(), "How often to save an OSeg snapshot."))
+        .addOption(new OptionValue(OSEG_SNAPSHOT_MAX_AGE, "600s", Sirikata::OptionValueType<Duration>(), "Oldest OSeg snapshot to preload on startup."))
 
         .addOption(new OptionValue(CSEG, "uniform", Sirikata::OptionValueType<String>(), "Type of Coordinate Segmentation implementation to use."))
         .addOption(new OptionValue("cseg-service-host", "meru00", Sirikata::OptionValueType<String>(), "Hostname of machine running the CSEG service (running with --cseg=distributed)"))
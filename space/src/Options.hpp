@@ -44,6 +44,8 @@
 #define SERVER_ODP_FLOW_SCHEDULER   "server.odp.flowsched"
 
 #define NETWORK_TYPE         "net"
+#define NETWORK_BATCH_BYTES  "net.batch-bytes"
+#define NETWORK_BATCH_LINGER "net.batch-linger"
 
 #define CSEG                "cseg"
 
@@ -60,10 +62,14 @@
 #define OSEG_CACHE_SIZE              "oseg-cache-size"
 #define OSEG_CACHE_CLEAN_GROUP_SIZE  "oseg-cache-clean-group-size"
 #define OSEG_CACHE_ENTRY_LIFETIME    "oseg-cache-entry-lifetime"
+#define OSEG_SNAPSHOT                "oseg-snapshot"
+#define OSEG_SNAPSHOT_INTERVAL       "oseg-snapshot-interval"
+#define OSEG_SNAPSHOT_MAX_AGE        "oseg-snapshot-max-age"
 
 #define CACHE_SELECTOR              "oseg-cache-selector"
 #define CACHE_TYPE_COMMUNICATION    "cache_communication"
 #define CACHE_TYPE_ORIGINAL_LRU     "cache_originallru"
+#define CACHE_TYPE_CLOCK            "cache_clock"
 
 
 #define CACHE_COMM_SCALING          "oseg-cache-scaling"
@@ -71,6 +77,12 @@
 #define FORWARDER_SEND_QUEUE_SIZE "forwarder.send-queue-size"
 #define FORWARDER_RECEIVE_QUEUE_SIZE "forwarder.receive-queue-size"
 
+#define OPT_IOSERVICE_RUN_QUEUES "ioservice.run-queues"
+
+#define OPT_MIGRATION_MONITOR_KINETIC "migration-monitor.kinetic"
+
+#define OPT_CSEG_LOAD_REPORT_INTERVAL "cseg-load-report-interval"
+
 #define OSEG_LOOKUP_QUEUE_SIZE     "oseg_lookup_queue_size"
 
 #define OPT_PROX                   "prox"
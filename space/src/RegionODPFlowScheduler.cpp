@@ -48,7 +48,14 @@ RegionODPFlowScheduler::~RegionODPFlowScheduler() {
 
 // ODP push interface
 bool RegionODPFlowScheduler::push(Sirikata::Protocol::Object::ObjectMessage* msg, const OSegEntry&, const OSegEntry&) {
-    Message* serv_msg = createMessageFromODP(msg, mDestServer);
+    return push(createMessageFromODP(msg, mDestServer));
+}
+
+bool RegionODPFlowScheduler::push(const ObjectMessageEnvelope& msg, const OSegEntry&, const OSegEntry&) {
+    return push(createMessageFromODP(&msg, mDestServer));
+}
+
+bool RegionODPFlowScheduler::push(Message* serv_msg) {
     if (!mQueue.push(serv_msg, false)) {
         delete serv_msg;
         return false;
@@ -57,6 +57,7 @@ public:
 
     // ODP push interface
     virtual bool push(Sirikata::Protocol::Object::ObjectMessage* msg, const OSegEntry&, const OSegEntry&);
+    virtual bool push(const ObjectMessageEnvelope& msg, const OSegEntry&, const OSegEntry&);
     // Get the sum of the weights of active queues.
     virtual float totalActiveWeight();
     // Get the total used weight of active queues.  If all flows are saturating,
@@ -66,6 +67,8 @@ public:
     // this should equal totalActiveWeights, otherwise it will be smaller.
     virtual float totalReceiverUsedWeight();
 private:
+    bool push(Message* serv_msg);
+
     // Note: unfortunately we need to mark these as mutable because a)
     // SizedThreadSafeQueue doesn't have methods marked properly as const and b)
     // ThreadSafeQueue doesn't provide a front() method.
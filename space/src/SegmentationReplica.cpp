@@ -0,0 +1,117 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "SegmentationReplica.hpp"
+#include <algorithm>
+#include <set>
+
+namespace Sirikata {
+
+namespace {
+// Orders leaves by the center of their region along one axis
+struct LeafCenterLess {
+    LeafCenterLess(uint32 _axis) : axis(_axis) {}
+
+    bool operator()(const SegmentationReplica::Leaf& lhs, const SegmentationReplica::Leaf& rhs) const {
+        return lhs.bbox.center()[axis] < rhs.bbox.center()[axis];
+    }
+
+    uint32 axis;
+};
+} // namespace
+
+SegmentationReplica::SegmentationReplica()
+ : mRoot(NULL),
+   mValid(false)
+{
+}
+
+SegmentationReplica::~SegmentationReplica() {
+    mRoot.destroy();
+}
+
+void SegmentationReplica::install(const LeafList& leaves) {
+    clear();
+    for(LeafList::const_iterator it = leaves.begin(); it != leaves.end(); it++) {
+        if (!it->bbox.degenerate())
+            mLeaves.push_back(*it);
+    }
+    if (mLeaves.empty())
+        return;
+
+    // Building the tree reorders the leaves
+    LeafList tree_leaves(mLeaves);
+    buildTree(&mRoot, tree_leaves.begin(), tree_leaves.end());
+    mValid = true;
+}
+
+void SegmentationReplica::applyChange(const LeafList& changed) {
+    std::set<ServerID> changed_servers;
+    for(LeafList::const_iterator it = changed.begin(); it != changed.end(); it++)
+        changed_servers.insert(it->server);
+
+    LeafList leaves;
+    for(LeafList::iterator it = mLeaves.begin(); it != mLeaves.end(); it++) {
+        if (changed_servers.find(it->server) == changed_servers.end())
+            leaves.push_back(*it);
+    }
+    leaves.insert(leaves.end(), changed.begin(), changed.end());
+    install(leaves);
+}
+
+void SegmentationReplica::clear() {
+    mRoot.destroy();
+    mLeaves.clear();
+    mValid = false;
+}
+
+void SegmentationReplica::buildTree(SegmentedRegion* node, LeafList::iterator begin, LeafList::iterator end) {
+    node->mLeafCount = (uint32)(end - begin);
+    node->mBoundingBox = begin->bbox;
+    BoundingBox3f centers(begin->bbox.center(), begin->bbox.center());
+    for(LeafList::iterator it = begin + 1; it != end; it++) {
+        node->mBoundingBox.mergeIn(it->bbox);
+        centers = centers.merge(it->bbox.center());
+    }
+
+    if (end - begin == 1) {
+        node->mServer = begin->server;
+        return;
+    }
+
+    // Split at the median center along the axis the centers are most spread
+    // out on, which keeps the tree balanced so lookups take O(log #regions)
+    Vector3f spread = centers.max() - centers.min();
+    uint32 axis = 0;
+    if (spread.y > spread[axis]) axis = 1;
+    if (spread.z > spread[axis]) axis = 2;
+    node->mSplitAxis = (SegmentedRegion::SplitAxis)axis;
+
+    LeafList::iterator mid = begin + (end - begin) / 2;
+    std::nth_element(begin, mid, end, LeafCenterLess(axis));
+
+    node->mLeftChild = new SegmentedRegion(node);
+    buildTree(node->mLeftChild, begin, mid);
+    node->mRightChild = new SegmentedRegion(node);
+    buildTree(node->mRightChild, mid, end);
+}
+
+ServerID SegmentationReplica::lookup(const Vector3f& pos) const {
+    assert(mValid);
+    SegmentedRegion* region = mRoot.lookup(pos);
+    return (region != NULL) ? region->mServer : NullServerID;
+}
+
+std::vector<ServerID> SegmentationReplica::lookupBoundingBox(const BoundingBox3f& bbox) {
+    assert(mValid);
+    std::vector<SegmentedRegion*> regions;
+    mRoot.lookupBoundingBox(bbox, regions);
+
+    std::set<ServerID> servers;
+    for(uint32 i = 0; i < regions.size(); i++)
+        servers.insert(regions[i]->mServer);
+    return std::vector<ServerID>(servers.begin(), servers.end());
+}
+
+} // namespace Sirikata
@@ -0,0 +1,77 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_SEGMENTATION_REPLICA_HPP_
+#define _SIRIKATA_SEGMENTATION_REPLICA_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/space/SegmentedRegion.hpp>
+
+namespace Sirikata {
+
+/** SegmentationReplica is a local copy of the coordinate segmentation which
+ *  can answer lookups without going to the CSEG server. The CSEG server
+ *  doesn't send its BSP tree to clients, only the leaf regions assigned to
+ *  each server, so the replica builds its own balanced tree over them. It
+ *  isn't thread safe.
+ */
+class SegmentationReplica {
+public:
+    struct Leaf {
+        Leaf(ServerID _server, const BoundingBox3f& _bbox)
+         : server(_server), bbox(_bbox)
+        {}
+
+        ServerID server;
+        BoundingBox3f bbox;
+    };
+    typedef std::vector<Leaf> LeafList;
+
+    SegmentationReplica();
+    ~SegmentationReplica();
+
+    /** Whether there is a replica to answer lookups from. */
+    bool valid() const {
+        return mValid;
+    }
+
+    /** Replace the replica with one built from the given leaves. Degenerate
+     *  regions, which servers without a region are given, are left out.
+     */
+    void install(const LeafList& leaves);
+    /** Apply a change to the segmentation. Changes only list the servers
+     *  whose regions changed, so every other server keeps the regions it had.
+     */
+    void applyChange(const LeafList& changed);
+    void clear();
+
+    /** The leaves the replica was built from. */
+    const LeafList& leaves() const {
+        return mLeaves;
+    }
+    /** Bounds of the whole segmentation. Only meaningful if valid(). */
+    const BoundingBox3f& bounds() const {
+        return mRoot.mBoundingBox;
+    }
+
+    /** \returns the server whose region contains pos, or NullServerID if it's
+     *  outside the segmentation. Must be valid().
+     */
+    ServerID lookup(const Vector3f& pos) const;
+    /** \returns the servers whose regions intersect bbox, without duplicates.
+     *  Must be valid().
+     */
+    std::vector<ServerID> lookupBoundingBox(const BoundingBox3f& bbox);
+
+private:
+    static void buildTree(SegmentedRegion* node, LeafList::iterator begin, LeafList::iterator end);
+
+    SegmentedRegion mRoot;
+    LeafList mLeaves;
+    bool mValid;
+}; // class SegmentationReplica
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_SEGMENTATION_REPLICA_HPP_
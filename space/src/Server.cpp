@@ -41,6 +41,7 @@
 #include "Forwarder.hpp"
 #include "LocalForwarder.hpp"
 #include "MigrationMonitor.hpp"
+#include "Options.hpp"
 
 #include <sirikata/space/ObjectSegmentation.hpp>
 
@@ -93,6 +94,11 @@ Server::Server(SpaceContext* ctx, Authenticator* auth, Forwarder* forwarder, Loc
    mObjectSessionManager(obj_sess_mgr),
    mMigrationSendRunning(false),
    mShutdownRequested(false),
+   mLoadReportInterval(GetOptionValue<Duration>(OPT_CSEG_LOAD_REPORT_INTERVAL)),
+   mObjectMessagesReceived(0),
+   mLastReportMessages(0),
+   mLastReportTime(Time::null()),
+   mMessageRate(0),
    mObjectHostConnectionManager(NULL),
    mRouteObjectMessage(Sirikata::SizedResourceMonitor(GetOptionValue<size_t>("route-object-message-buffer"))),
    mTimeSeriesObjects(String("space.server") + boost::lexical_cast<String>(ctx->id()) + ".objects")
@@ -114,7 +120,8 @@ Server::Server(SpaceContext* ctx, Authenticator* auth, Forwarder* forwarder, Loc
           mContext, mLocationService, mCSeg,
           mContext->mainStrand->wrap(
               std::tr1::bind(&Server::handleMigrationEvent, this, std::tr1::placeholders::_1)
-          )
+          ),
+          GetOptionValue<bool>(OPT_MIGRATION_MONITOR_KINETIC)
       );
 
     // Forwarder::setODPService creates the ODP SST datagram layer allowing us
@@ -308,6 +315,8 @@ void Server::sendSessionMessageWithRetry(const ObjectHostConnectionID& conn, Sir
 }
 
 bool Server::onObjectHostMessageReceived(const ObjectHostConnectionID& conn_id, const ShortObjectHostConnectionID short_conn_id, Sirikata::Protocol::Object::ObjectMessage* obj_msg) {
+    mObjectMessagesReceived++;
+
     // NOTE that we do forwarding even before the
 
     static UUID spaceID = UUID::null();
@@ -717,9 +726,7 @@ void Server::finishAddObject(const UUID& obj_id, OSegAddNewStatus status)
           mObjects[obj_id] = conn;
           mContext->timeSeries->report(mTimeSeriesObjects, mObjects.size());
 
-          //TODO: assumes each server process is assigned only one region... perhaps we should enforce this constraint
-          //for cleaner semantics?
-          mCSeg->reportLoad(mContext->id(), mCSeg->serverRegion(mContext->id())[0] , mObjects.size()  );
+          reportLoad();
 
           mLocalForwarder->addActiveConnection(conn);
 
@@ -1015,14 +1022,54 @@ void Server::handleMigration(const UUID& obj_id)
 
 void Server::start() {
     mForwarder->start();
+
+    if (mLoadReportInterval != Duration::zero()) {
+        mLastReportTime = mContext->simTime();
+        mLoadReportTimer = Network::IOTimer::create(
+            mContext->mainStrand,
+            std::tr1::bind(&Server::handleLoadReportTimer, this)
+        );
+        mLoadReportTimer->wait(mLoadReportInterval);
+    }
 }
 
 void Server::stop() {
+    if (mLoadReportTimer)
+        mLoadReportTimer->cancel();
     mForwarder->stop();
     mObjectHostConnectionManager->shutdown();
     mShutdownRequested = true;
 }
 
+void Server::reportLoad() {
+    // The MigrationMonitor keeps our regions up to date, so there's no need to
+    // ask CSeg, which costs a round trip to the CSeg server when we don't have
+    // a region. Without one there's nothing for the load balancer to adjust.
+    //TODO: assumes each server process is assigned only one region... perhaps we should enforce this constraint
+    //for cleaner semantics?
+    const BoundingBoxList& regions = mMigrationMonitor->regions();
+    if (regions.empty() || regions[0].degenerate())
+        return;
+    mCSeg->reportLoad(mContext->id(), regions[0], mObjects.size(), mMessageRate);
+}
+
+void Server::handleLoadReportTimer() {
+    if (mShutdownRequested)
+        return;
+
+    Time now = mContext->simTime();
+    uint32 messages = mObjectMessagesReceived.read();
+    float64 elapsed = (now - mLastReportTime).toSeconds();
+    if (elapsed > 0)
+        mMessageRate = (uint32)((messages - mLastReportMessages) / elapsed);
+    mLastReportMessages = messages;
+    mLastReportTime = now;
+
+    reportLoad();
+
+    mLoadReportTimer->wait(mLoadReportInterval);
+}
+
 void Server::handleMigrationEvent(const UUID& obj_id) {
     // * wrap up state and send message to other server
     //     to reinstantiate the object there
@@ -43,6 +43,8 @@
 
 #include <sirikata/core/util/MotionVector.hpp>
 #include <sirikata/core/util/AggregateBoundingInfo.hpp>
+#include <sirikata/core/util/AtomicTypes.hpp>
+#include <sirikata/core/network/IOTimer.hpp>
 
 #include "Protocol_Session.pbj.hpp"
 #include "Protocol_Migration.pbj.hpp"
@@ -215,6 +217,18 @@ private:
 
     bool mShutdownRequested;
 
+    // Periodically reports our load to CSeg, on the main strand
+    void reportLoad();
+    void handleLoadReportTimer();
+    Duration mLoadReportInterval;
+    Network::IOTimerPtr mLoadReportTimer;
+    // Object messages received from object hosts, and the count and time at
+    // the last periodic report, for computing message rates
+    AtomicValue<uint32> mObjectMessagesReceived;
+    uint32 mLastReportMessages;
+    Time mLastReportTime;
+    uint32 mMessageRate;
+
     ObjectHostConnectionManager* mObjectHostConnectionManager;
 
     typedef std::tr1::unordered_map<UUID, ObjectConnection*, UUID::Hasher> ObjectConnectionMap;
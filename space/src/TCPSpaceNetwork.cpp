@@ -35,12 +35,19 @@
 #include <sirikata/core/network/IOStrand.hpp>
 #include <sirikata/core/network/IOStrandImpl.hpp>
 #include <sirikata/core/network/IOWork.hpp>
+#include <sirikata/core/network/Frame.hpp>
 #include <sirikata/core/network/StreamFactory.hpp>
 #include <sirikata/core/network/StreamListenerFactory.hpp>
 #include <sirikata/core/network/StreamListener.hpp>
 #include <sirikata/core/options/CommonOptions.hpp>
 #include <sirikata/space/ServerMessage.hpp>
 #include <sirikata/core/network/ServerIDMap.hpp>
+#include <sirikata/core/trace/Trace.hpp>
+#include "Options.hpp"
+#include <boost/lexical_cast.hpp>
+
+// htonl
+#include <sirikata/core/network/Asio.hpp>
 
 using namespace Sirikata::Network;
 using namespace Sirikata;
@@ -57,18 +64,25 @@ TCPSpaceNetwork::RemoteStream::RemoteStream(TCPSpaceNetwork* parent, Sirikata::N
           connected(false),
           shutting_down(false),
           receive_queue( CountResourceMonitor(16) ),
-          paused(false)
+          paused(false),
+          chunk_pool(parent->mReceiveChunkPool)
 {
 }
 
 TCPSpaceNetwork::RemoteStream::~RemoteStream() {
     delete stream;
+
+    Chunk* unread = NULL;
+    while(receive_queue.pop(unread))
+        chunk_pool->release(unread);
 }
 
 bool TCPSpaceNetwork::RemoteStream::push(Chunk& data, bool* was_empty) {
     boost::lock_guard<boost::mutex> lck(mPushPopMutex);
 
-    Chunk* tmp = new Chunk;
+    // A pooled Chunk comes with storage already allocated, which the swap
+    // hands back to the stream for the next message
+    Chunk* tmp = chunk_pool->allocate();
     tmp->swap(data);
     *was_empty = receive_queue.probablyEmpty();
     bool pushed = receive_queue.push(tmp, false);
@@ -78,7 +92,7 @@ bool TCPSpaceNetwork::RemoteStream::push(Chunk& data, bool* was_empty) {
         TCPNET_LOG(insane,"Pausing receive from " << logical_endpoint << ".");
         paused = true;
         data.swap(*tmp); // Put the data back
-        delete tmp;
+        chunk_pool->release(tmp);
         return false;
     }
     else {
@@ -138,13 +152,25 @@ TCPSpaceNetwork::RemoteSession::~RemoteSession() {
 
 
 
-TCPSpaceNetwork::TCPSendStream::TCPSendStream(ServerID sid, RemoteSessionPtr s)
- : logical_endpoint(sid),
-   session(s)
+TCPSpaceNetwork::TCPSendStream::TCPSendStream(TCPSpaceNetwork* _parent, ServerID sid, RemoteSessionPtr s)
+ : parent(_parent),
+   logical_endpoint(sid),
+   session(s),
+   mBatchCount(0),
+   mLingerPending(false)
 {
+    if (parent->mMaxBatchBytes > 0) {
+        mBatch.reserve(parent->mMaxBatchBytes);
+        mLingerTimer = Network::IOTimer::create(
+            parent->mIOStrand,
+            std::tr1::bind(&TCPSendStream::handleLingerTimeout, this)
+        );
+    }
 }
 
 TCPSpaceNetwork::TCPSendStream::~TCPSendStream() {
+    if (mLingerTimer)
+        mLingerTimer->cancel();
     session.reset();
 }
 
@@ -160,10 +186,17 @@ bool TCPSpaceNetwork::TCPSendStream::send(const Chunk& data) {
     if (!remote_stream)
         return false;
 
-    bool success = (
-        remote_stream->connected &&
-        !remote_stream->shutting_down &&
-        remote_stream->stream->send(data, ReliableOrdered));
+    bool success = false;
+    if (parent->mMaxBatchBytes > 0) {
+        success = writable(remote_stream) && sendBatched(remote_stream, data);
+    }
+    else {
+        success = (
+            writable(remote_stream) &&
+            remote_stream->stream->send(data, ReliableOrdered));
+        if (success)
+            parent->recordWrite(1);
+    }
 
     if (!success)
         remote_stream->stream->requestReadySendCallback();
@@ -171,18 +204,120 @@ bool TCPSpaceNetwork::TCPSendStream::send(const Chunk& data) {
     return success;
 }
 
+bool TCPSpaceNetwork::TCPSendStream::writable(const RemoteStreamPtr& remote_stream) {
+    return (remote_stream->connected && !remote_stream->shutting_down);
+}
+
+bool TCPSpaceNetwork::TCPSendStream::sendBatched(const RemoteStreamPtr& remote_stream, const Chunk& data) {
+    boost::lock_guard<boost::mutex> lck(mBatchMutex);
 
-TCPSpaceNetwork::TCPReceiveStream::TCPReceiveStream(ServerID sid, RemoteSessionPtr s, Network::IOStrand* _ios)
+    uint32 max_batch = parent->mMaxBatchBytes;
+    uint32 framed_size = sizeof(uint32) + data.size();
+
+    // Make room for the new message. If the pending batch can't be written,
+    // we can't accept any more data.
+    if (!mBatch.empty() && mBatch.size() + framed_size > max_batch) {
+        if (!flushBatch(remote_stream))
+            return false;
+    }
+
+    // A message that fills a batch on its own gains nothing from being copied
+    // into one, so the header and payload are written as a two part
+    // (scatter-gather) send.
+    if (framed_size >= max_batch) {
+        uint32 encoded_len = htonl(data.size());
+        bool sent = remote_stream->stream->send(
+            MemoryReference(&encoded_len, sizeof(uint32)),
+            MemoryReference(data),
+            ReliableOrdered
+        );
+        if (sent)
+            parent->recordWrite(1);
+        return sent;
+    }
+
+    uint32 encoded_len = htonl(data.size());
+    mBatch.append((const char*)&encoded_len, sizeof(uint32));
+    if (!data.empty())
+        mBatch.append((const char*)&(data[0]), data.size());
+    mBatchCount++;
+
+    // The message has been accepted at this point. Anything left pending,
+    // either because the batch isn't full or because the stream couldn't take
+    // it yet, is written when the linger timer expires at the latest.
+    if (mBatch.size() >= max_batch)
+        flushBatch(remote_stream);
+    if (!mBatch.empty() && !mLingerPending) {
+        mLingerPending = true;
+        mLingerTimer->wait(parent->mMaxBatchLinger);
+    }
+    return true;
+}
+
+bool TCPSpaceNetwork::TCPSendStream::flushBatch(const RemoteStreamPtr& remote_stream) {
+    if (mBatch.empty())
+        return true;
+
+    if (!writable(remote_stream) ||
+        !remote_stream->stream->send(MemoryReference(mBatch), ReliableOrdered))
+        return false;
+
+    parent->recordWrite(mBatchCount);
+    mBatch.clear();
+    mBatchCount = 0;
+    return true;
+}
+
+bool TCPSpaceNetwork::TCPSendStream::flush() {
+    if (!session)
+        return true;
+
+    RemoteStreamPtr remote_stream = session->remote_stream;
+    if (!remote_stream)
+        return false;
+
+    bool success = false;
+    {
+        boost::lock_guard<boost::mutex> lck(mBatchMutex);
+        success = flushBatch(remote_stream);
+    }
+    // Outside the lock since the callback may be invoked immediately
+    if (!success)
+        remote_stream->stream->requestReadySendCallback();
+    return success;
+}
+
+void TCPSpaceNetwork::TCPSendStream::handleLingerTimeout() {
+    {
+        boost::lock_guard<boost::mutex> lck(mBatchMutex);
+        mLingerPending = false;
+    }
+    flush();
+}
+
+
+TCPSpaceNetwork::TCPReceiveStream::TCPReceiveStream(ServerID sid, RemoteSessionPtr s, Network::IOStrand* _ios, Network::ChunkPool* _chunk_pool, bool _batched)
  : logical_endpoint(sid),
    session(s),
    front_stream(),
    front_elem(NULL),
-   ios(_ios)
+   front_offset(0),
+   front_ready(false),
+   front_msg(MemoryReference::null()),
+   front_consumed(0),
+   retired_elem(NULL),
+   ios(_ios),
+   chunk_pool(_chunk_pool),
+   batched(_batched)
 {
 }
 
 TCPSpaceNetwork::TCPReceiveStream::~TCPReceiveStream()
 {
+    if (front_elem != NULL)
+        chunk_pool->release(front_elem);
+    if (retired_elem != NULL)
+        chunk_pool->release(retired_elem);
     session.reset();
     front_stream.reset();
 }
@@ -191,40 +326,74 @@ ServerID TCPSpaceNetwork::TCPReceiveStream::id() const {
     return logical_endpoint;
 }
 
-Chunk* TCPSpaceNetwork::TCPReceiveStream::front() {
+bool TCPSpaceNetwork::TCPReceiveStream::front(MemoryReference* msg) {
     if (!session)
-        return NULL;
+        return false;
 
-    if (front_elem != NULL)
-        return front_elem;
+    // Anything handed out before this call is no longer valid
+    if (retired_elem != NULL)
+        chunk_pool->release(retired_elem);
+    retired_elem = NULL;
+
+    while(!front_ready) {
+        if (front_elem == NULL) {
+            // Need to get a new front_elem
+            getCurrentRemoteStream();
+            if (!front_stream)
+                return false;
+
+            front_elem = front_stream->pop(ios);
+            if (front_elem == NULL)
+                return false;
+            front_offset = 0;
+        }
 
-    // Need to get a new front_elem
-    getCurrentRemoteStream();
-    if (!front_stream)
-        return NULL;
+        if (!batched) {
+            front_msg = MemoryReference(*front_elem);
+            front_consumed = front_elem->size();
+            front_ready = true;
+            break;
+        }
 
-    Chunk* result = front_stream->pop(ios);
-    front_elem = result;
-    return result;
-}
+        // Batches are split in place, handing out views of each message
+        uint32 remaining = front_elem->size() - front_offset;
+        if (remaining > 0)
+            front_consumed = Network::Frame::peek(&((*front_elem)[front_offset]), remaining, &front_msg);
+        if (remaining > 0 && front_consumed > 0) {
+            front_ready = true;
+        }
+        else {
+            TCPNET_LOG(error,"Discarding " << remaining << " bytes of invalid batched data from " << logical_endpoint);
+            chunk_pool->release(front_elem);
+            front_elem = NULL;
+            front_stream.reset();
+        }
+    }
 
-Chunk* TCPSpaceNetwork::TCPReceiveStream::pop() {
-    // Use front() to get the next one.
-    Chunk* result = front();
+    *msg = front_msg;
+    return true;
+}
 
-    // If front fails we can bail out now
-    if (result == NULL)
-        return NULL;
+bool TCPSpaceNetwork::TCPReceiveStream::pop(MemoryReference* msg) {
+    // Use front() to get the next one.  If front fails we can bail out now
+    if (!front(msg))
+        return false;
 
     // Otherwise, just do cleanup before returning the front item
     assert(front_stream);
-    assert(result == front_elem);
-    // We've already popped in front, we just clear out the front element and
-    // front queue
-    front_elem = NULL;
-    front_stream.reset();
+    assert(front_elem != NULL);
+    front_ready = false;
+    front_offset += front_consumed;
+    if (front_offset >= front_elem->size()) {
+        // We've used up this element, clear out the front element and front
+        // queue. The element is kept until the next call since msg points
+        // into it.
+        retired_elem = front_elem;
+        front_elem = NULL;
+        front_stream.reset();
+    }
 
-    return result;
+    return true;
 }
 
 bool TCPSpaceNetwork::TCPReceiveStream::canReadFrom(RemoteStreamPtr& strm) {
@@ -266,6 +435,18 @@ void TCPSpaceNetwork::TCPReceiveStream::getCurrentRemoteStream() {
 
 TCPSpaceNetwork::TCPSpaceNetwork(SpaceContext* ctx)
  : SpaceNetwork(ctx),
+   mMaxBatchBytes(GetOptionValue<uint32>(NETWORK_BATCH_BYTES)),
+   mMaxBatchLinger(GetOptionValue<Duration>(NETWORK_BATCH_LINGER)),
+   mStatsPoller(
+       ctx->mainStrand,
+       std::tr1::bind(&TCPSpaceNetwork::reportStats, this),
+       "TCPSpaceNetwork::reportStats",
+       Duration::seconds((int64)1)),
+   mTimeSeriesMessagesPerWriteName(String("space.server") + boost::lexical_cast<String>(ctx->id()) + ".network.messages-per-write"),
+   mMessagesWritten(0),
+   mWrites(0),
+   mTimeSeriesReceiveChunksReusedName(String("space.server") + boost::lexical_cast<String>(ctx->id()) + ".network.receive-chunks-reused"),
+   mReportedReceiveChunksReused(0),
    mSendListener(NULL),
    mReceiveListener(NULL)
 {
@@ -277,6 +458,8 @@ TCPSpaceNetwork::TCPSpaceNetwork(SpaceContext* ctx)
     mIOStrand = mContext->ioService->createStrand("TCPSpaceNetwork IO");
     mIOWork = new Network::IOWork(mContext->ioService, "TCPSpaceNetwork Work");
 
+    mReceiveChunkPool = new Network::ChunkPool();
+
     mListener = StreamListenerFactory::getSingleton().getConstructor(mStreamPlugin)(mIOStrand,mListenOptions);
 }
 
@@ -299,6 +482,13 @@ TCPSpaceNetwork::~TCPSpaceNetwork() {
 
     delete mIOStrand;
     mIOStrand = NULL;
+
+    Network::ChunkPool::Stats pool_stats = mReceiveChunkPool->stats();
+    TCPNET_LOG(info, "Received data in " << pool_stats.allocations << " chunks, " << pool_stats.reused << " reused from the pool (" << (pool_stats.reuseRate()*100.0) << "%)");
+    // Closing and pending streams may still hold chunks, the pool
+    // cleans itself up once they're released
+    mReceiveChunkPool->destroy();
+    mReceiveChunkPool = NULL;
 }
 
 
@@ -330,7 +520,7 @@ TCPSpaceNetwork::TCPSendStream* TCPSpaceNetwork::getNewSendStream(ServerID sid)
         TCPSpaceNetwork::RemoteData* data = getRemoteData(sid);
         if (data->send == NULL) {
             notify = true;
-            data->send = new TCPSendStream(sid, data->session);
+            data->send = new TCPSendStream(this, sid, data->session);
         }
         result = data->send;
     }
@@ -353,7 +543,7 @@ TCPSpaceNetwork::TCPReceiveStream* TCPSpaceNetwork::getNewReceiveStream(ServerID
         TCPSpaceNetwork::RemoteData* data = getRemoteData(sid);
         if (data->receive == NULL) {
             notify = true;
-            data->receive = new TCPReceiveStream(sid, data->session, mIOStrand);
+            data->receive = new TCPReceiveStream(sid, data->session, mIOStrand, mReceiveChunkPool, (mMaxBatchBytes > 0));
         }
         result = data->receive;
     }
@@ -547,6 +737,18 @@ void TCPSpaceNetwork::readySendCallback(RemoteStreamWPtr wstream) {
 
     assert(remote_stream->logical_endpoint != NullServerID);
 
+    // Batched data that couldn't be written earlier goes out before anything
+    // new is queued behind it.
+    if (mMaxBatchBytes > 0) {
+        TCPSendStream* send_stream = NULL;
+        {
+            boost::lock_guard<boost::recursive_mutex> lck(mRemoteDataMutex);
+            send_stream = getRemoteData(remote_stream->logical_endpoint)->send;
+        }
+        if (send_stream != NULL && !send_stream->flush())
+            return;
+    }
+
     mSendListener->networkReadyToSend(remote_stream->logical_endpoint);
 }
 
@@ -751,6 +953,43 @@ void TCPSpaceNetwork::handleClosingStreamTimeout(Sirikata::Network::IOTimerPtr t
 
 
 
+void TCPSpaceNetwork::start() {
+    SpaceNetwork::start();
+    mStatsPoller.start();
+}
+
+void TCPSpaceNetwork::stop() {
+    mStatsPoller.stop();
+    SpaceNetwork::stop();
+}
+
+void TCPSpaceNetwork::recordWrite(uint32 num_messages) {
+    mMessagesWritten += num_messages;
+    ++mWrites;
+}
+
+void TCPSpaceNetwork::reportStats() {
+    uint64 chunks_reused = mReceiveChunkPool->stats().reused;
+    mContext->timeSeries->report(
+        mTimeSeriesReceiveChunksReusedName,
+        (float32)(chunks_reused - mReportedReceiveChunksReused)
+    );
+    mReportedReceiveChunksReused = chunks_reused;
+
+    uint32 writes = mWrites.read();
+    uint32 messages = mMessagesWritten.read();
+    mWrites -= writes;
+    mMessagesWritten -= messages;
+
+    if (writes == 0)
+        return;
+
+    mContext->timeSeries->report(
+        mTimeSeriesMessagesPerWriteName,
+        (float32)messages / writes
+    );
+}
+
 void TCPSpaceNetwork::setSendListener(SendListener* sl) {
     mSendListener = sl;
 }
@@ -37,9 +37,13 @@
 #include <sirikata/core/network/Address4.hpp>
 #include <sirikata/core/network/Stream.hpp>
 #include <sirikata/core/network/StreamListener.hpp>
+#include <sirikata/core/network/ChunkPool.hpp>
 #include <sirikata/core/util/PluginManager.hpp>
 #include <sirikata/core/queue/SizedThreadSafeQueue.hpp>
 #include <sirikata/core/queue/CountResourceMonitor.hpp>
+#include <sirikata/core/network/IOTimer.hpp>
+#include <sirikata/core/service/Poller.hpp>
+#include <sirikata/core/util/AtomicTypes.hpp>
 
 namespace Sirikata {
 
@@ -92,6 +96,8 @@ class TCPSpaceNetwork : public SpaceNetwork {
                      // this stream.  If true, the stream must be
                      // unpaused the next time someone calls
                      // receiveOne
+        Network::ChunkPool* chunk_pool; // Source of the Chunks pushed onto
+                                        // receive_queue
 
         boost::mutex mPushPopMutex;
     };
@@ -132,27 +138,52 @@ class TCPSpaceNetwork : public SpaceNetwork {
     typedef std::tr1::shared_ptr<RemoteSession> RemoteSessionPtr;
     typedef std::tr1::weak_ptr<RemoteSession> RemoteSessionWPtr;
 
+    /** When batching is enabled, each write to the underlying stream holds
+     *  one or more server messages, each preceded by a Frame header.  Small
+     *  messages are coalesced into a pending batch which is written when it
+     *  fills up, when the linger timer expires, or when the stream becomes
+     *  writable again after a failed write.
+     */
     class TCPSendStream : public SpaceNetwork::SendStream {
     public:
-        TCPSendStream(ServerID sid, RemoteSessionPtr s);
+        TCPSendStream(TCPSpaceNetwork* parent, ServerID sid, RemoteSessionPtr s);
         ~TCPSendStream();
 
         virtual ServerID id() const;
         virtual bool send(const Chunk&);
 
+        // Try to write out the pending batch, if there is one. Returns true if
+        // nothing is left pending.
+        bool flush();
+
     private:
+        static bool writable(const RemoteStreamPtr& remote_stream);
+
+        // Add data to the pending batch, writing out the batch if necessary.
+        bool sendBatched(const RemoteStreamPtr& remote_stream, const Chunk& data);
+        // Must hold mBatchMutex
+        bool flushBatch(const RemoteStreamPtr& remote_stream);
+        void handleLingerTimeout();
+
+        TCPSpaceNetwork* parent;
         ServerID logical_endpoint;
         RemoteSessionPtr session;
+
+        boost::mutex mBatchMutex;
+        std::string mBatch;
+        uint32 mBatchCount;
+        Network::IOTimerPtr mLingerTimer;
+        bool mLingerPending;
     };
     typedef std::tr1::unordered_map<ServerID, TCPSendStream*> SendStreamMap;
 
     class TCPReceiveStream : public SpaceNetwork::ReceiveStream {
     public:
-        TCPReceiveStream(ServerID sid, RemoteSessionPtr s, Network::IOStrand* _ios);
+        TCPReceiveStream(ServerID sid, RemoteSessionPtr s, Network::IOStrand* _ios, Network::ChunkPool* _chunk_pool, bool _batched);
         ~TCPReceiveStream();
         virtual ServerID id() const;
-        virtual Chunk* front();
-        virtual Chunk* pop();
+        virtual bool front(MemoryReference* msg);
+        virtual bool pop(MemoryReference* msg);
 
     private:
         // Get the current queue for receiving data from the address.
@@ -174,8 +205,17 @@ class TCPSpaceNetwork : public SpaceNetwork {
                                       // item from
         Chunk* front_elem; // The front item, left out here to make it
                            // accessible since the RemoteStream doesn't give
-                           // easy access
+                           // easy access. With batching, this holds
+                           // several messages which are handed out in order
+        uint32 front_offset; // Offset of the next message in front_elem
+        bool front_ready; // Whether front_msg refers to the next message
+        MemoryReference front_msg;
+        uint32 front_consumed; // Bytes front_msg occupies in front_elem
+        Chunk* retired_elem; // Exhausted front item, kept until the next call
+                             // since the last message popped points into it
         Network::IOStrand* ios;
+        Network::ChunkPool* chunk_pool; // Where used up elements are returned
+        bool batched;
     };
     typedef std::tr1::unordered_map<ServerID, TCPReceiveStream*> ReceiveStreamMap;
 
@@ -231,6 +271,23 @@ class TCPSpaceNetwork : public SpaceNetwork {
     Network::IOStrand *mIOStrand;
     Network::IOWork* mIOWork;
 
+    // Recycles the Chunks received data is handed up in
+    Network::ChunkPool* mReceiveChunkPool;
+
+    // Batching settings, batching is disabled if mMaxBatchBytes is 0
+    uint32 mMaxBatchBytes;
+    Duration mMaxBatchLinger;
+
+    // Stats
+    Poller mStatsPoller;
+    const String mTimeSeriesMessagesPerWriteName;
+    AtomicValue<uint32> mMessagesWritten;
+    AtomicValue<uint32> mWrites;
+    const String mTimeSeriesReceiveChunksReusedName;
+    uint64 mReportedReceiveChunksReused;
+    void recordWrite(uint32 num_messages);
+    void reportStats();
+
     RemoteStreamMap mClosingStreams;
     TimerSet mClosingStreamTimers; // Timers for streams that are still closing.
 
@@ -292,6 +349,10 @@ class TCPSpaceNetwork : public SpaceNetwork {
     void bytesReceivedCallback(RemoteStreamWPtr wstream, IndirectTCPReceiveStream ind_recv_strm, Chunk& data, const Sirikata::Network::Stream::PauseReceiveCallback& pause);
     void readySendCallback(RemoteStreamWPtr wstream);
 
+    // Service Interface
+    virtual void start();
+    virtual void stop();
+
 public:
     TCPSpaceNetwork(SpaceContext* ctx);
     virtual ~TCPSpaceNetwork();
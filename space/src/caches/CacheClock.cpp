@@ -0,0 +1,185 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#include "CacheClock.hpp"
+
+#define OSEGCLOCK_LOG(lvl,msg) SILOG(osegclock, lvl, msg)
+
+namespace Sirikata {
+
+const uint32 CacheClock::EMPTY;
+
+CacheClock::Entry::Entry()
+ : id(UUID::null()),
+   sID(OSegEntry::null()),
+   inserted(Time::null()),
+   hash(0),
+   referenced(false),
+   used(false)
+{
+}
+
+CacheClock::CacheClock(Context* ctx, uint32 maxSize, Duration entryLifetime)
+ : mContext(ctx),
+   mEntryLifetime(entryLifetime),
+   mHand(0),
+   mHits(0),
+   mMisses(0),
+   mEvictions(0)
+{
+    if (maxSize == 0) maxSize = 1;
+
+    // Keep the index at most half full so probe sequences stay short
+    uint32 index_size = 1;
+    while(index_size < 2 * maxSize)
+        index_size <<= 1;
+    mIndex.resize(index_size, EMPTY);
+    mIndexMask = index_size - 1;
+
+    mEntries.resize(maxSize);
+    mFree.reserve(maxSize);
+    for(uint32 i = maxSize; i > 0; i--)
+        mFree.push_back(i-1);
+}
+
+CacheClock::~CacheClock() {
+    OSEGCLOCK_LOG(debug, "hits: " << mHits << "  misses: " << mMisses << "  evictions: " << mEvictions);
+}
+
+uint32 CacheClock::findSlot(const UUID& uuid, uint32 hash) const {
+    for(uint32 slot = homeSlot(hash); mIndex[slot] != EMPTY; slot = (slot + 1) & mIndexMask) {
+        const Entry& entry = mEntries[mIndex[slot]];
+        if (entry.hash == hash && entry.id == uuid)
+            return slot;
+    }
+    return EMPTY;
+}
+
+void CacheClock::eraseSlot(uint32 slot) {
+    uint32 hole = slot;
+    for(uint32 next = (hole + 1) & mIndexMask; mIndex[next] != EMPTY; next = (next + 1) & mIndexMask) {
+        // The entry at next can fill the hole if the hole lies between its
+        // home slot and next, i.e. it would have probed the hole first.
+        uint32 home = homeSlot(mEntries[mIndex[next]].hash);
+        if (((next - home) & mIndexMask) >= ((next - hole) & mIndexMask)) {
+            mIndex[hole] = mIndex[next];
+            hole = next;
+        }
+    }
+    mIndex[hole] = EMPTY;
+}
+
+void CacheClock::eraseEntry(uint32 idx) {
+    Entry& entry = mEntries[idx];
+    uint32 slot = findSlot(entry.id, entry.hash);
+    assert(slot != EMPTY);
+    eraseSlot(slot);
+    entry.used = false;
+    entry.referenced = false;
+}
+
+uint32 CacheClock::evict() {
+    // Every entry is in use when this is called, so at worst the hand clears
+    // every referenced bit and comes back around to where it started.
+    while(true) {
+        uint32 idx = mHand;
+        mHand = (mHand + 1) % mEntries.size();
+
+        Entry& entry = mEntries[idx];
+        if (!entry.used) continue;
+        if (entry.referenced && !expired(entry)) {
+            entry.referenced = false;
+            continue;
+        }
+        eraseEntry(idx);
+        mEvictions++;
+        return idx;
+    }
+}
+
+bool CacheClock::expired(const Entry& entry) const {
+    return (mContext->recentSimTime() - entry.inserted) > mEntryLifetime;
+}
+
+void CacheClock::insert(const UUID& uuid, const OSegEntry& sID) {
+    boost::lock_guard<boost::mutex> lck(mMutex);
+
+    uint32 hash = (uint32)uuid.hash();
+    uint32 slot = findSlot(uuid, hash);
+    if (slot != EMPTY) {
+        Entry& entry = mEntries[mIndex[slot]];
+        entry.sID = sID;
+        entry.inserted = mContext->recentSimTime();
+        entry.referenced = true;
+        return;
+    }
+
+    uint32 idx;
+    if (!mFree.empty()) {
+        idx = mFree.back();
+        mFree.pop_back();
+    }
+    else {
+        idx = evict();
+    }
+
+    Entry& entry = mEntries[idx];
+    entry.id = uuid;
+    entry.sID = sID;
+    entry.inserted = mContext->recentSimTime();
+    entry.hash = hash;
+    // New entries get one sweep of grace, like a fresh LRU entry
+    entry.referenced = true;
+    entry.used = true;
+
+    slot = homeSlot(hash);
+    while(mIndex[slot] != EMPTY)
+        slot = (slot + 1) & mIndexMask;
+    mIndex[slot] = idx;
+}
+
+const OSegEntry& CacheClock::get(const UUID& uuid) {
+    boost::lock_guard<boost::mutex> lck(mMutex);
+
+    uint32 slot = findSlot(uuid, (uint32)uuid.hash());
+    if (slot != EMPTY) {
+        uint32 idx = mIndex[slot];
+        Entry& entry = mEntries[idx];
+        if (!expired(entry)) {
+            entry.referenced = true;
+            mHits++;
+            return entry.sID;
+        }
+        // Stale, free it up now rather than waiting for the hand
+        eraseEntry(idx);
+        mFree.push_back(idx);
+    }
+
+    mMisses++;
+    static OSegEntry justnothin(OSegEntry::null());
+    return justnothin;
+}
+
+void CacheClock::remove(const UUID& uuid) {
+    boost::lock_guard<boost::mutex> lck(mMutex);
+
+    uint32 slot = findSlot(uuid, (uint32)uuid.hash());
+    if (slot == EMPTY) return;
+
+    uint32 idx = mIndex[slot];
+    eraseEntry(idx);
+    mFree.push_back(idx);
+}
+
+void CacheClock::getEntries(OSegEntryList* entries) {
+    boost::lock_guard<boost::mutex> lck(mMutex);
+
+    for(uint32 idx = 0; idx < mEntries.size(); idx++) {
+        const Entry& entry = mEntries[idx];
+        if (entry.used && !expired(entry))
+            entries->push_back(std::make_pair(entry.id, entry.sID));
+    }
+}
+
+} // namespace Sirikata
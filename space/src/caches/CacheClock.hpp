@@ -0,0 +1,80 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_CACHE_CLOCK_HPP_
+#define _SIRIKATA_CACHE_CLOCK_HPP_
+
+#include <sirikata/core/service/Context.hpp>
+#include <sirikata/space/OSegCache.hpp>
+#include <sirikata/core/util/UUID.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace Sirikata {
+
+/** CacheClock is a fixed size OSegCache. All storage is allocated up front:
+ *  entries live in a single array and are found through an open addressing
+ *  (linear probing) table of entry indices, so inserts, lookups and removals
+ *  never allocate. When the cache is full, a CLOCK hand sweeps the entry
+ *  array and evicts the first entry that hasn't been looked up since the last
+ *  sweep, approximating LRU without keeping entries ordered. Entries older
+ *  than the lifetime are treated as misses and are evicted first.
+ */
+class CacheClock : public OSegCache {
+public:
+    CacheClock(Context* ctx, uint32 maxSize, Duration entryLifetime);
+    virtual ~CacheClock();
+
+    virtual void insert(const UUID& uuid, const OSegEntry& sID);
+    virtual const OSegEntry& get(const UUID& uuid);
+    virtual void remove(const UUID& uuid);
+    virtual void getEntries(OSegEntryList* entries);
+
+private:
+    static const uint32 EMPTY = 0xFFFFFFFF;
+
+    struct Entry {
+        Entry();
+
+        UUID id;
+        OSegEntry sID;
+        Time inserted;
+        uint32 hash;
+        bool referenced;
+        bool used;
+    };
+
+    uint32 homeSlot(uint32 hash) const {
+        return hash & mIndexMask;
+    }
+    // Slot in mIndex referring to uuid, or EMPTY if it isn't cached
+    uint32 findSlot(const UUID& uuid, uint32 hash) const;
+    // Clears a slot in mIndex, shifting later entries in its probe sequence
+    // back so lookups never need tombstones.
+    void eraseSlot(uint32 slot);
+    // Frees the entry in mEntries at idx, which must be in use
+    void eraseEntry(uint32 idx);
+    // Runs the clock hand to free up an entry, returning its index
+    uint32 evict();
+    bool expired(const Entry& entry) const;
+
+    Context* mContext;
+    Duration mEntryLifetime;
+
+    boost::mutex mMutex;
+
+    std::vector<Entry> mEntries;
+    std::vector<uint32> mIndex;
+    uint32 mIndexMask;
+    // Unused indices into mEntries
+    std::vector<uint32> mFree;
+    uint32 mHand;
+
+    uint64 mHits;
+    uint64 mMisses;
+    uint64 mEvictions;
+}; // class CacheClock
+
+} // namespace Sirikata
+
+#endif //_SIRIKATA_CACHE_CLOCK_HPP_
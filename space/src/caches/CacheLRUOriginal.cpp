@@ -231,6 +231,17 @@ namespace Sirikata
   }
 
 
+  void CacheLRUOriginal::getEntries(OSegEntryList* entries)
+  {
+    boost::lock_guard<boost::mutex> lck(mMutex);
+    for (IDRecordMap::iterator iter = idRecMap.begin(); iter != idRecMap.end(); ++iter)
+    {
+      if (satisfiesCacheAgeCondition(iter->second->age))
+        entries->push_back(std::make_pair(iter->first, iter->second->sID));
+    }
+  }
+
+
 //if inAge indicates that object is young enough, then return true.
 //otherwise, return false
 bool CacheLRUOriginal::satisfiesCacheAgeCondition(int inAge)
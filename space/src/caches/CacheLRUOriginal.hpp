@@ -93,6 +93,7 @@ namespace Sirikata
     virtual void insert(const UUID& uuid, const OSegEntry& sID);
     virtual const OSegEntry& get(const UUID& uuid);
     virtual void remove(const UUID& uuid);
+    virtual void getEntries(OSegEntryList* entries);
   };
 }
 
@@ -51,12 +51,13 @@ namespace Sirikata
 
 
 
-  CommunicationCache::CommunicationCache(SpaceContext* spctx, float scalingUnits, CoordinateSegmentation* cseg,uint32 cacheSize)
+  CommunicationCache::CommunicationCache(SpaceContext* spctx, float scalingUnits, CoordinateSegmentation* cseg,uint32 cacheSize, const Duration& entryLifetime)
     : mCompleteCache(.2,"CommunicationCache",&commCacheScoreFunction,&commCacheScoreFunctionPrint,spctx,cacheSize,FLT_MAX),
       mDistScaledUnits(scalingUnits),
       mCSeg(cseg),
       ctx(spctx),
-      mCacheSize(cacheSize)
+      mCacheSize(cacheSize),
+      mEntryLifetime(entryLifetime)
   {
 
     BoundingBoxList bboxes = mCSeg->serverRegion(ctx->id());
@@ -87,7 +88,7 @@ namespace Sirikata
     float lookupWeight = sID.radius()/(mDistScaledUnits* distance*distance*logger*logger);
 
     boost::lock_guard<boost::mutex> lck(mMutex);
-    mCompleteCache.insert(uuid,sID.server(),0,0,0,0,sID.radius(),lookupWeight,1);
+    mCompleteCache.insert(uuid,sID.server(),currentTime(),0,0,0,sID.radius(),lookupWeight,1);
   }
 
   const OSegEntry& CommunicationCache::get(const UUID& uuid)
@@ -101,4 +102,15 @@ namespace Sirikata
     boost::lock_guard<boost::mutex> lck(mMutex);
     mCompleteCache.remove(oid);
   }
+
+  void CommunicationCache::getEntries(OSegEntryList* entries)
+  {
+    boost::lock_guard<boost::mutex> lck(mMutex);
+    mCompleteCache.getEntries(entries, currentTime() - mEntryLifetime.toMilliseconds());
+  }
+
+  CacheTimeMS CommunicationCache::currentTime()
+  {
+    return (ctx->recentSimTime() - Time::null()).toMilliseconds();
+  }
 }
@@ -57,14 +57,20 @@ namespace Sirikata
     SpaceContext* ctx;
     boost::mutex mMutex;
     uint32 mCacheSize;
+    // Entries aren't expired on lookup, but older ones are left out of
+    // getEntries
+    Duration mEntryLifetime;
+
+    CacheTimeMS currentTime();
 
   public:
-    CommunicationCache(SpaceContext* spctx, float scalingUnits, CoordinateSegmentation* cseg,uint32 cacheSize);
+    CommunicationCache(SpaceContext* spctx, float scalingUnits, CoordinateSegmentation* cseg,uint32 cacheSize, const Duration& entryLifetime);
       virtual ~CommunicationCache() {}
 
     virtual void insert(const UUID& uuid, const OSegEntry& sID);
     virtual const OSegEntry& get(const UUID& uuid);
     virtual void remove(const UUID& oid);
+    virtual void getEntries(OSegEntryList* entries);
 
   };
 }
@@ -199,6 +199,7 @@ namespace Sirikata
 
       //insert into time-record multimap
       FCacheRecord* rcdTimeRecMap = new FCacheRecord(toInsert,bid,0,0,0,weight,distance,radius,lookupWeight,scaler,ctx,vMag);
+      rcdTimeRecMap->mLastAccessTime = tms;
 
 
 
@@ -207,6 +208,7 @@ namespace Sirikata
 
       //insert into id-record map
       FCacheRecord* rcdIDRecMap = new FCacheRecord(toInsert,bid,0,0,0,weight,distance,radius,lookupWeight,scaler,ctx,vMag);
+      rcdIDRecMap->mLastAccessTime = tms;
       idRecMap.insert(std::pair<UUID,FCacheRecord*>(toInsert,rcdIDRecMap));
 
       maintain();
@@ -230,6 +232,15 @@ namespace Sirikata
     return justnothin;
   }
 
+  void Complete_Cache::getEntries(OSegEntryList* entries, CacheTimeMS oldest)
+  {
+    for (IDRecordMap::iterator idrecmapit = idRecMap.begin(); idrecmapit != idRecMap.end(); ++idrecmapit)
+    {
+      if (idrecmapit->second->mLastAccessTime >= oldest)
+        entries->push_back(std::make_pair(idrecmapit->first, OSegEntry(idrecmapit->second->bID, idrecmapit->second->radius)));
+    }
+  }
+
 
   //
   //For lookup, need to do the following: if find the object, change the age of the object to the current time.
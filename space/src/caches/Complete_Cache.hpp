@@ -91,6 +91,8 @@ namespace Sirikata
     ServerID lookup_dynamic(UUID uuid);
     virtual std::string getCacheName();
     virtual void remove(const UUID& oid);
+    // Entries inserted before oldest are left out
+    void getEntries(OSegEntryList* entries, CacheTimeMS oldest);
 
     void printAll();
 
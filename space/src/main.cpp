@@ -66,6 +66,8 @@
 #include <sirikata/space/ObjectSegmentation.hpp>
 #include "caches/CommunicationCache.hpp"
 #include "caches/CacheLRUOriginal.hpp"
+#include "caches/CacheClock.hpp"
+#include "OSegSnapshot.hpp"
 
 #include <sirikata/space/SpaceContext.hpp>
 #include <sirikata/mesh/Filter.hpp>
@@ -164,7 +166,7 @@ int main(int argc, char** argv) {
 
     Duration duration = GetOptionValue<Duration>("duration");
 
-    Network::IOService* ios = new Network::IOService("Space");
+    Network::IOService* ios = new Network::IOService("Space", GetOptionValue<uint32>(OPT_IOSERVICE_RUN_QUEUES));
     Network::IOStrand* mainStrand = ios->createStrand("Space Main");
 
     ODPSST::ConnectionManager* sstConnMgr = new ODPSST::ConnectionManager();
@@ -273,13 +275,18 @@ int main(int argc, char** argv) {
     uint32 cacheSize = GetOptionValue<uint32>(OSEG_CACHE_SIZE);
     if (cacheSelector == CACHE_TYPE_COMMUNICATION) {
         double cacheCommScaling = GetOptionValue<double>(CACHE_COMM_SCALING);
-        oseg_cache = new CommunicationCache(space_context, cacheCommScaling, cseg, cacheSize);
+        Duration entryLifetime = GetOptionValue<Duration>(OSEG_CACHE_ENTRY_LIFETIME);
+        oseg_cache = new CommunicationCache(space_context, cacheCommScaling, cseg, cacheSize, entryLifetime);
     }
     else if (cacheSelector == CACHE_TYPE_ORIGINAL_LRU) {
         uint32 cacheCleanGroupSize = GetOptionValue<uint32>(OSEG_CACHE_CLEAN_GROUP_SIZE);
         Duration entryLifetime = GetOptionValue<Duration>(OSEG_CACHE_ENTRY_LIFETIME);
         oseg_cache = new CacheLRUOriginal(space_context, cacheSize, cacheCleanGroupSize, entryLifetime);
     }
+    else if (cacheSelector == CACHE_TYPE_CLOCK) {
+        Duration entryLifetime = GetOptionValue<Duration>(OSEG_CACHE_ENTRY_LIFETIME);
+        oseg_cache = new CacheClock(space_context, cacheSize, entryLifetime);
+    }
     else {
         std::cout<<"\n\nUNKNOWN CACHE TYPE SELECTED.  Please re-try.\n\n";
         std::cout.flush();
@@ -294,6 +301,14 @@ int main(int argc, char** argv) {
         OSegFactory::getSingleton().getConstructor(oseg_type)(space_context, osegStrand, cseg, oseg_cache, oseg_options);
     //end create oseg
 
+    // Preload the OSeg from the last snapshot and keep saving new ones
+    OSegSnapshotter* oseg_snapshotter = NULL;
+    String oseg_snapshot_file = GetOptionValue<String>(OSEG_SNAPSHOT);
+    if (!oseg_snapshot_file.empty()) {
+        oseg_snapshotter = new OSegSnapshotter(space_context, oseg_snapshot_file, GetOptionValue<Duration>(OSEG_SNAPSHOT_INTERVAL), oseg_cache, oseg);
+        oseg_snapshotter->restore(GetOptionValue<Duration>(OSEG_SNAPSHOT_MAX_AGE));
+    }
+
 
     // We have all the info to initialize the forwarder now
     forwarder->initialize(oseg, sq, server_message_receiver, loc_service);
@@ -370,6 +385,8 @@ int main(int argc, char** argv) {
     space_context->add(cseg);
     space_context->add(loc_service);
     space_context->add(oseg);
+    if (oseg_snapshotter != NULL)
+        space_context->add(oseg_snapshotter);
     space_context->add(loadMonitor);
     space_context->add(sstConnMgr);
     space_context->add(ohSstConnMgr);
@@ -403,6 +420,7 @@ int main(int argc, char** argv) {
     delete loadMonitor;
 
     delete cseg;
+    delete oseg_snapshotter;
     delete oseg;
     delete oseg_cache;
     delete loc_service;
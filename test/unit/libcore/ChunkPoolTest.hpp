@@ -0,0 +1,81 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_CHUNK_POOL_TEST_HPP_
+#define _SIRIKATA_CHUNK_POOL_TEST_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/network/ChunkPool.hpp>
+#include <cxxtest/TestSuite.h>
+
+using Sirikata::Network::Chunk;
+using Sirikata::Network::ChunkPool;
+
+class ChunkPoolTest : public CxxTest::TestSuite
+{
+public:
+    void testReuseKeepsStorage(void) {
+        ChunkPool* pool = new ChunkPool();
+        for(int i = 0; i < 1000; i++) {
+            Chunk* chunk = pool->allocate();
+            TS_ASSERT(chunk->empty());
+            if (i > 0) TS_ASSERT(chunk->capacity() >= 512u);
+            chunk->resize(512);
+            pool->release(chunk);
+        }
+
+        ChunkPool::Stats stats = pool->stats();
+        TS_ASSERT_EQUALS(stats.allocations, 1000u);
+        TS_ASSERT_EQUALS(stats.reused, 999u);
+        TS_ASSERT_EQUALS(stats.discarded, 0u);
+        TS_ASSERT_EQUALS(stats.outstanding, 0u);
+        pool->destroy();
+    }
+
+    void testSwapReturnsStorage(void) {
+        // Taking ownership of received data by swapping it into a pooled Chunk
+        // leaves the pooled storage with the source
+        ChunkPool* pool = new ChunkPool();
+        Chunk* warm = pool->allocate();
+        warm->resize(1024);
+        pool->release(warm);
+
+        Chunk received(100, 0x5A);
+        Chunk* owned = pool->allocate();
+        owned->swap(received);
+        TS_ASSERT_EQUALS(owned->size(), 100u);
+        TS_ASSERT_EQUALS((*owned)[99], 0x5A);
+        TS_ASSERT(received.empty());
+        TS_ASSERT(received.capacity() >= 1024u);
+
+        pool->release(owned);
+        pool->destroy();
+    }
+
+    void testLimits(void) {
+        ChunkPool* pool = new ChunkPool(1, 1024);
+        Chunk* big = pool->allocate();
+        big->resize(4096);
+        Chunk* a = pool->allocate();
+        Chunk* b = pool->allocate();
+        pool->release(big);
+        pool->release(a);
+        pool->release(b);
+
+        ChunkPool::Stats stats = pool->stats();
+        TS_ASSERT_EQUALS(stats.discarded, 2u);
+        TS_ASSERT_EQUALS(stats.outstanding, 0u);
+        pool->destroy();
+    }
+
+    void testOutlivesOwner(void) {
+        ChunkPool* pool = new ChunkPool();
+        Chunk* chunk = pool->allocate();
+        pool->destroy();
+        // Releasing the last Chunk frees the pool
+        pool->release(chunk);
+    }
+};
+
+#endif //_SIRIKATA_CHUNK_POOL_TEST_HPP_
@@ -0,0 +1,213 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_COMPACT_PROXIMITY_RESULTS_TEST_HPP_
+#define _SIRIKATA_COMPACT_PROXIMITY_RESULTS_TEST_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/prox/CompactProximityResults.hpp>
+#include <sirikata/core/network/Message.hpp>
+#include <cxxtest/TestSuite.h>
+
+class CompactProximityResultsTest : public CxxTest::TestSuite
+{
+    typedef Sirikata::Time Time;
+    typedef Sirikata::Duration Duration;
+    typedef Sirikata::Vector3f Vector3f;
+    typedef Sirikata::Quaternion Quaternion;
+    typedef Sirikata::UUID UUID;
+    typedef Sirikata::String String;
+    typedef Sirikata::Protocol::Prox::ProximityResults ProximityResults;
+    typedef Sirikata::Protocol::Prox::ObjectAddition ObjectAddition;
+    typedef Sirikata::Protocol::Prox::ObjectRemoval ObjectRemoval;
+
+    static float quantum() { return 0.01f; }
+
+    Time mT;
+    Vector3f mOrigin;
+
+    UUID objectID(int i) {
+        return UUID((Sirikata::uint32)i);
+    }
+
+    void addObject(Sirikata::Protocol::Prox::IProximityUpdate update, int i, Sirikata::uint64 seqno, const Vector3f& pos, const String& mesh) {
+        Sirikata::Protocol::Prox::IObjectAddition addition = update.add_addition();
+        addition.set_object(objectID(i));
+        addition.set_seqno(seqno);
+        addition.set_type(i % 2 ? ObjectAddition::Aggregate : ObjectAddition::Object);
+
+        Sirikata::Protocol::ITimedMotionVector motion = addition.mutable_location();
+        motion.set_t(mT - Duration::milliseconds((Sirikata::int64)(i * 10)));
+        motion.set_position(pos);
+        motion.set_velocity(Vector3f(0.f, (float)i, 0.f));
+
+        Sirikata::Protocol::ITimedMotionQuaternion orient = addition.mutable_orientation();
+        orient.set_t(motion.t());
+        orient.set_position(i % 2 ? Quaternion(Vector3f(0, 1, 0), 0.5f) : Quaternion::identity());
+        orient.set_velocity(Quaternion::identity());
+
+        Sirikata::Protocol::IAggregateBoundingInfo bounds = addition.mutable_aggregate_bounds();
+        bounds.set_center_offset(Vector3f(0, 0, 0));
+        bounds.set_center_bounds_radius(i % 2 ? 10.f : 0.f);
+        bounds.set_max_object_size(1.f + i);
+
+        if (!mesh.empty())
+            addition.set_mesh(mesh);
+        if (i % 2)
+            addition.set_physics("{\"treatment\":\"static\"}");
+    }
+
+    void removeObject(Sirikata::Protocol::Prox::IProximityUpdate update, int i, Sirikata::uint64 seqno, bool permanent) {
+        Sirikata::Protocol::Prox::IObjectRemoval removal = update.add_removal();
+        removal.set_object(objectID(i));
+        removal.set_seqno(seqno);
+        removal.set_type(permanent ? ObjectRemoval::Permanent : ObjectRemoval::Transient);
+    }
+
+    void assertVectorClose(const Vector3f& a, const Vector3f& b, float delta) {
+        TS_ASSERT_DELTA(a.x, b.x, delta);
+        TS_ASSERT_DELTA(a.y, b.y, delta);
+        TS_ASSERT_DELTA(a.z, b.z, delta);
+    }
+
+    // Checks that decoded matches the original, allowing for quantization
+    void assertSameResults(const ProximityResults& orig, const ProximityResults& decoded) {
+        TS_ASSERT(orig.t() == decoded.t());
+        TS_ASSERT_EQUALS(orig.update_size(), decoded.update_size());
+        for(int u = 0; u < orig.update_size() && u < decoded.update_size(); u++) {
+            Sirikata::Protocol::Prox::ProximityUpdate ou = orig.update(u), du = decoded.update(u);
+            TS_ASSERT_EQUALS(ou.addition_size(), du.addition_size());
+            for(int a = 0; a < ou.addition_size() && a < du.addition_size(); a++) {
+                ObjectAddition oa = ou.addition(a), da = du.addition(a);
+                TS_ASSERT_EQUALS(oa.object(), da.object());
+                TS_ASSERT_EQUALS(oa.seqno(), da.seqno());
+                TS_ASSERT_EQUALS(oa.type(), da.type());
+                TS_ASSERT(oa.location().t() == da.location().t());
+                assertVectorClose(oa.location().position(), da.location().position(), quantum());
+                assertVectorClose(oa.location().velocity(), da.location().velocity(), quantum());
+                TS_ASSERT(oa.orientation().position() == da.orientation().position());
+                TS_ASSERT_EQUALS(oa.aggregate_bounds().center_bounds_radius(), da.aggregate_bounds().center_bounds_radius());
+                TS_ASSERT_EQUALS(oa.aggregate_bounds().max_object_size(), da.aggregate_bounds().max_object_size());
+                TS_ASSERT_EQUALS(oa.has_mesh(), da.has_mesh());
+                if (oa.has_mesh() && da.has_mesh())
+                    TS_ASSERT_EQUALS(oa.mesh(), da.mesh());
+                TS_ASSERT_EQUALS(oa.has_physics(), da.has_physics());
+            }
+            TS_ASSERT_EQUALS(ou.removal_size(), du.removal_size());
+            for(int r = 0; r < ou.removal_size() && r < du.removal_size(); r++) {
+                TS_ASSERT_EQUALS(ou.removal(r).object(), du.removal(r).object());
+                TS_ASSERT_EQUALS(ou.removal(r).seqno(), du.removal(r).seqno());
+                TS_ASSERT_EQUALS(ou.removal(r).type(), du.removal(r).type());
+            }
+        }
+    }
+
+    // Encodes and decodes results, returning the size of the compact encoding
+    size_t roundTrip(Sirikata::CompactProximityEncoder& encoder, Sirikata::CompactProximityDecoder& decoder, const ProximityResults& results) {
+        String payload;
+        encoder.encode(results, mOrigin, &payload);
+
+        ProximityResults decoded;
+        TS_ASSERT(decoder.decode(payload, &decoded));
+        assertSameResults(results, decoded);
+        return payload.size();
+    }
+
+public:
+    void setUp() {
+        mT = Time::null() + Duration::seconds(5000.0);
+        mOrigin = Vector3f(1000.f, -20.f, 300.f);
+    }
+
+    void testRoundTrip(void) {
+        Sirikata::CompactProximityEncoder encoder(quantum());
+        Sirikata::CompactProximityDecoder decoder;
+
+        ProximityResults results;
+        results.set_t(mT);
+        Sirikata::Protocol::Prox::IProximityUpdate update = results.add_update();
+        const char* meshes[] = { "", "meerkat:///test/a.dae", "meerkat:///test/b.dae" };
+        for(int i = 0; i < 10; i++)
+            addObject(update, i, i, mOrigin + Vector3f(i * 3.3f, -i * 1.7f, 50.f), meshes[i % 3]);
+        removeObject(update, 20, 10, true);
+
+        size_t compact_size = roundTrip(encoder, decoder, results);
+        TS_ASSERT_LESS_THAN(compact_size, Sirikata::serializePBJMessage(results).size());
+    }
+
+    void testChangedFieldsOnly(void) {
+        Sirikata::CompactProximityEncoder encoder(quantum());
+        Sirikata::CompactProximityDecoder decoder;
+        String mesh = "meerkat:///test/some/long/path/to/a/mesh.dae";
+
+        ProximityResults first;
+        first.set_t(mT);
+        addObject(first.add_update(), 1, 0, mOrigin, mesh);
+        size_t first_size = roundTrip(encoder, decoder, first);
+
+        ProximityResults removed;
+        removed.set_t(mT);
+        removeObject(removed.add_update(), 1, 1, false);
+        roundTrip(encoder, decoder, removed);
+
+        // Coming back after moving, only the location needs to be sent again
+        ProximityResults again;
+        again.set_t(mT + Duration::seconds(1.0));
+        addObject(again.add_update(), 1, 2, mOrigin + Vector3f(5.f, 0.f, 0.f), mesh);
+        size_t again_size = roundTrip(encoder, decoder, again);
+        TS_ASSERT_LESS_THAN(again_size + mesh.size(), first_size);
+
+        // After a permanent removal, everything is sent again
+        ProximityResults permanent;
+        permanent.set_t(mT);
+        removeObject(permanent.add_update(), 1, 3, true);
+        roundTrip(encoder, decoder, permanent);
+
+        ProximityResults fresh;
+        fresh.set_t(mT);
+        addObject(fresh.add_update(), 1, 4, mOrigin, mesh);
+        size_t fresh_size = roundTrip(encoder, decoder, fresh);
+        // But the mesh is still interned
+        TS_ASSERT_LESS_THAN(fresh_size + mesh.size(), first_size + 2);
+        TS_ASSERT_LESS_THAN(again_size, fresh_size);
+    }
+
+    void testFarObjects(void) {
+        Sirikata::CompactProximityEncoder encoder(quantum());
+        Sirikata::CompactProximityDecoder decoder;
+
+        // Too far away to quantize, so the full location is sent
+        ProximityResults results;
+        results.set_t(mT);
+        addObject(results.add_update(), 2, 0, Vector3f(1e9f, 0.f, -1e9f), "");
+        roundTrip(encoder, decoder, results);
+    }
+
+    void testFullResultsRejected(void) {
+        ProximityResults results;
+        results.set_t(mT);
+        addObject(results.add_update(), 1, 0, mOrigin, "meerkat:///test/mesh.dae");
+
+        Sirikata::CompactProximityDecoder decoder;
+        ProximityResults decoded;
+        TS_ASSERT(!decoder.decode(Sirikata::serializePBJMessage(results), &decoded));
+    }
+
+    void testIsCompact(void) {
+        ProximityResults results;
+        results.set_t(mT);
+        addObject(results.add_update(), 1, 0, mOrigin, "meerkat:///test/mesh.dae");
+
+        Sirikata::CompactProximityEncoder encoder(quantum());
+        String payload;
+        encoder.encode(results, mOrigin, &payload);
+        TS_ASSERT(Sirikata::CompactProximityDecoder::isCompact(payload));
+
+        TS_ASSERT(!Sirikata::CompactProximityDecoder::isCompact(Sirikata::serializePBJMessage(results)));
+        TS_ASSERT(!Sirikata::CompactProximityDecoder::isCompact(""));
+        TS_ASSERT(!Sirikata::CompactProximityDecoder::isCompact(payload.substr(0, 1)));
+    }
+};
+
+#endif //_SIRIKATA_COMPACT_PROXIMITY_RESULTS_TEST_HPP_
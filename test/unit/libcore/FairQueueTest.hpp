@@ -136,6 +136,84 @@ public:
         ASSERT_FAIR_QUEUE_POP(test_queue, 0, 2); // t = 8
         ASSERT_FAIR_QUEUE_POP(test_queue, 2, 8); // t = 9
     }
+
+    // The heap index must produce exactly the same output as the tree index,
+    // including tie breaking, weight changes and disabled queues.
+    void testHeapIndexMatchesTreeIndex(void) {
+        typedef Sirikata::FairQueue<SizedElem, Sirikata::uint32, SizedElemQueue> TreeFairQueue;
+        typedef Sirikata::FairQueue<SizedElem, Sirikata::uint32, SizedElemQueue, Sirikata::FairQueueHeapIndex> HeapFairQueue;
+        const Sirikata::uint32 kNumQueues = 50;
+        const Sirikata::uint32 kNumOps = 20000;
+
+        TreeFairQueue tree_queue;
+        HeapFairQueue heap_queue;
+        for(Sirikata::uint32 k = 0; k < kNumQueues; k++) {
+            float weight = (float)(1 + k % 4);
+            tree_queue.addQueue(new SizedElemQueue(1 << 28), k, weight);
+            heap_queue.addQueue(new SizedElemQueue(1 << 28), k, weight);
+        }
+
+        // Simple LCG so the sequence is reproducible
+        Sirikata::uint32 rand_state = 12345;
+#define FAIR_QUEUE_TEST_RAND() (rand_state = rand_state * 1103515245 + 12345, (rand_state >> 16) & 0x7FFF)
+        for(Sirikata::uint32 i = 0; i < kNumOps; i++) {
+            Sirikata::uint32 op = FAIR_QUEUE_TEST_RAND() % 10;
+            Sirikata::uint32 key = FAIR_QUEUE_TEST_RAND() % kNumQueues;
+            if (op < 5) {
+                // Small sizes so that finish times tie frequently
+                Sirikata::uint32 sz = 1 + FAIR_QUEUE_TEST_RAND() % 3;
+                tree_queue.push(key, new SizedElem(sz));
+                heap_queue.push(key, new SizedElem(sz));
+            }
+            else if (op < 8) {
+                Sirikata::uint32 tree_key = 0, heap_key = 0;
+                SizedElem* tree_elem = tree_queue.pop(&tree_key);
+                SizedElem* heap_elem = heap_queue.pop(&heap_key);
+                TS_ASSERT_EQUALS(tree_elem == NULL, heap_elem == NULL);
+                if (tree_elem != NULL && heap_elem != NULL) {
+                    TS_ASSERT_EQUALS(tree_key, heap_key);
+                    TS_ASSERT_EQUALS(tree_elem->val, heap_elem->val);
+                }
+                delete tree_elem;
+                delete heap_elem;
+            }
+            else if (op == 8) {
+                if (FAIR_QUEUE_TEST_RAND() % 2) {
+                    tree_queue.disableQueue(key);
+                    heap_queue.disableQueue(key);
+                }
+                else {
+                    tree_queue.enableQueue(key);
+                    heap_queue.enableQueue(key);
+                }
+            }
+            else {
+                float weight = (float)(FAIR_QUEUE_TEST_RAND() % 4);
+                tree_queue.setQueueWeight(key, weight);
+                heap_queue.setQueueWeight(key, weight);
+            }
+            TS_ASSERT_EQUALS(tree_queue.empty(), heap_queue.empty());
+        }
+#undef FAIR_QUEUE_TEST_RAND
+
+        // Drain everything, including disabled queues
+        for(Sirikata::uint32 k = 0; k < kNumQueues; k++) {
+            tree_queue.enableQueue(k);
+            heap_queue.enableQueue(k);
+        }
+        while(!tree_queue.empty()) {
+            Sirikata::uint32 tree_key = 0, heap_key = 0;
+            SizedElem* tree_elem = tree_queue.pop(&tree_key);
+            SizedElem* heap_elem = heap_queue.pop(&heap_key);
+            TS_ASSERT(tree_elem != NULL && heap_elem != NULL);
+            if (tree_elem == NULL || heap_elem == NULL) break;
+            TS_ASSERT_EQUALS(tree_key, heap_key);
+            TS_ASSERT_EQUALS(tree_elem->val, heap_elem->val);
+            delete tree_elem;
+            delete heap_elem;
+        }
+        TS_ASSERT(heap_queue.empty());
+    }
 };
 
 #endif //_SIRIKATA_FAIR_QUEUE_TEST_HPP_
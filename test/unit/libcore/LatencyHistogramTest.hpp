@@ -0,0 +1,81 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_LATENCY_HISTOGRAM_TEST_HPP_
+#define _SIRIKATA_LATENCY_HISTOGRAM_TEST_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/trace/LatencyHistogram.hpp>
+#include <cxxtest/TestSuite.h>
+
+using Sirikata::Duration;
+using Sirikata::int64;
+using Sirikata::Trace::LatencyHistogram;
+
+class LatencyHistogramTest : public CxxTest::TestSuite
+{
+public:
+    void testEmpty(void) {
+        LatencyHistogram hist;
+        TS_ASSERT_EQUALS(hist.count(), 0u);
+        TS_ASSERT_EQUALS(hist.percentile(0.5), Duration::zero());
+        TS_ASSERT_EQUALS(hist.average(), Duration::zero());
+    }
+
+    void testSmallValuesExact(void) {
+        LatencyHistogram hist;
+        for(int64 i = 0; i < 8; i++)
+            hist.sample(Duration::microseconds(i));
+        TS_ASSERT_EQUALS(hist.count(), 8u);
+        TS_ASSERT_EQUALS(hist.min(), Duration::microseconds((int64)0));
+        TS_ASSERT_EQUALS(hist.max(), Duration::microseconds((int64)7));
+        TS_ASSERT_EQUALS(hist.percentile(0.5), Duration::microseconds((int64)3));
+    }
+
+    void testRelativeError(void) {
+        // 1..100000us uniformly, so each percentile should be within the
+        // histogram's precision (1/8) of the exact value
+        LatencyHistogram hist;
+        for(int64 i = 1; i <= 100000; i++)
+            hist.sample(Duration::microseconds(i));
+
+        double ps[] = { 0.5, 0.9, 0.99, 0.999 };
+        for(int i = 0; i < 4; i++) {
+            double exact = ps[i] * 100000;
+            double reported = (double)hist.percentile(ps[i]).toMicroseconds();
+            TS_ASSERT(reported >= exact * 0.875);
+            TS_ASSERT(reported <= exact * 1.125);
+        }
+        TS_ASSERT_EQUALS(hist.percentile(1.0), Duration::microseconds((int64)100000));
+        TS_ASSERT_EQUALS(hist.average(), Duration::microseconds((int64)50000));
+    }
+
+    void testMerge(void) {
+        LatencyHistogram fast, slow, all;
+        for(int64 i = 0; i < 1000; i++) {
+            fast.sample(Duration::microseconds(10 + i % 5));
+            slow.sample(Duration::milliseconds(50 + i % 5));
+        }
+        all.merge(fast);
+        all.merge(slow);
+        all.merge(LatencyHistogram());
+
+        TS_ASSERT_EQUALS(all.count(), 2000u);
+        TS_ASSERT_EQUALS(all.min(), Duration::microseconds((int64)10));
+        TS_ASSERT_EQUALS(all.max(), Duration::microseconds((int64)54000));
+        TS_ASSERT(all.percentile(0.25) < Duration::microseconds((int64)20));
+        TS_ASSERT(all.percentile(0.75) > Duration::milliseconds((int64)40));
+    }
+
+    void testClamping(void) {
+        LatencyHistogram hist;
+        hist.sample(Duration::microseconds((int64)-5));
+        hist.sample(Duration::seconds(1e7));
+        TS_ASSERT_EQUALS(hist.count(), 2u);
+        TS_ASSERT_EQUALS(hist.min(), Duration::zero());
+        TS_ASSERT(hist.max() > Duration::seconds(1e6));
+    }
+};
+
+#endif //_SIRIKATA_LATENCY_HISTOGRAM_TEST_HPP_
@@ -0,0 +1,117 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_LOCK_FREE_RING_QUEUE_TEST_HPP_
+#define _SIRIKATA_LOCK_FREE_RING_QUEUE_TEST_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/queue/LockFreeRingQueue.hpp>
+#include <sirikata/core/util/Thread.hpp>
+#include <cxxtest/TestSuite.h>
+
+class LockFreeRingQueueTest : public CxxTest::TestSuite
+{
+    typedef Sirikata::LockFreeRingQueue<Sirikata::uint32> IntRingQueue;
+
+    static void producerMain(IntRingQueue* queue, Sirikata::uint32 producer, Sirikata::uint32 count) {
+        for(Sirikata::uint32 i = 0; i < count; i++) {
+            Sirikata::uint32 val = (producer << 24) | i;
+            while(!queue->push(val))
+                Sirikata::Thread::yield();
+        }
+    }
+
+public:
+    void testCapacityRoundsUp(void) {
+        IntRingQueue queue(5);
+        TS_ASSERT_EQUALS(queue.capacity(), 8u);
+    }
+
+    void testOrderAndBackPressure(void) {
+        IntRingQueue queue(4);
+        for(Sirikata::uint32 i = 0; i < 4; i++)
+            TS_ASSERT(queue.push(i));
+        TS_ASSERT(!queue.push(4));
+        TS_ASSERT_EQUALS(queue.size(), 4u);
+
+        Sirikata::uint32 result;
+        for(Sirikata::uint32 i = 0; i < 4; i++) {
+            TS_ASSERT(queue.pop(result));
+            TS_ASSERT_EQUALS(result, i);
+        }
+        TS_ASSERT(!queue.pop(result));
+        TS_ASSERT(queue.probablyEmpty());
+    }
+
+    void testWrapAround(void) {
+        IntRingQueue queue(4);
+        Sirikata::uint32 result;
+        for(Sirikata::uint32 i = 0; i < 100; i++) {
+            TS_ASSERT(queue.push(i));
+            TS_ASSERT(queue.push(i+1000));
+            TS_ASSERT(queue.pop(result));
+            TS_ASSERT_EQUALS(result, i);
+            TS_ASSERT(queue.pop(result));
+            TS_ASSERT_EQUALS(result, i+1000);
+        }
+    }
+
+    void testBatch(void) {
+        IntRingQueue queue(8);
+        std::deque<Sirikata::uint32> in;
+        for(Sirikata::uint32 i = 0; i < 10; i++)
+            in.push_back(i);
+        TS_ASSERT_EQUALS(queue.pushMultiple(in), 8u);
+        TS_ASSERT_EQUALS(in.size(), 2u);
+        TS_ASSERT_EQUALS(in.front(), 8u);
+
+        std::deque<Sirikata::uint32> out;
+        TS_ASSERT_EQUALS(queue.popMultiple(&out, 3), 3u);
+        TS_ASSERT_EQUALS(out.back(), 2u);
+        out.clear();
+        queue.popAll(&out);
+        TS_ASSERT_EQUALS(out.size(), 5u);
+        TS_ASSERT_EQUALS(out.front(), 3u);
+    }
+
+    void testMultipleProducers(void) {
+        const Sirikata::uint32 kProducers = 4;
+        const Sirikata::uint32 kPerProducer = 20000;
+        IntRingQueue queue(64);
+
+        std::vector<Sirikata::Thread*> producers;
+        for(Sirikata::uint32 p = 0; p < kProducers; p++) {
+            producers.push_back(
+                new Sirikata::Thread(
+                    "LockFreeRingQueueTest Producer",
+                    std::tr1::bind(&LockFreeRingQueueTest::producerMain, &queue, p, kPerProducer)
+                )
+            );
+        }
+
+        // Each producer's values must come out in the order it pushed them
+        std::vector<Sirikata::uint32> next(kProducers, 0);
+        Sirikata::uint32 received = 0;
+        Sirikata::uint32 val;
+        while(received < kProducers * kPerProducer) {
+            if (!queue.pop(val)) {
+                Sirikata::Thread::yield();
+                continue;
+            }
+            Sirikata::uint32 producer = val >> 24;
+            TS_ASSERT_EQUALS(val & 0xFFFFFF, next[producer]);
+            next[producer] = (val & 0xFFFFFF) + 1;
+            received++;
+        }
+
+        for(Sirikata::uint32 p = 0; p < kProducers; p++) {
+            producers[p]->join();
+            delete producers[p];
+            TS_ASSERT_EQUALS(next[p], kPerProducer);
+        }
+        TS_ASSERT(queue.probablyEmpty());
+    }
+};
+
+#endif //_SIRIKATA_LOCK_FREE_RING_QUEUE_TEST_HPP_
@@ -0,0 +1,184 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_LOOKUP_BATCHER_TEST_HPP_
+#define _SIRIKATA_LOOKUP_BATCHER_TEST_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/queue/LookupBatcher.hpp>
+#include <cxxtest/TestSuite.h>
+
+using Sirikata::uint32;
+using Sirikata::int64;
+using Sirikata::Time;
+using Sirikata::Duration;
+using Sirikata::LookupBatcher;
+
+class LookupBatcherTest : public CxxTest::TestSuite
+{
+    typedef LookupBatcher<uint32> Batcher;
+
+    static Time at(int64 ms) {
+        return Time::null() + Duration::milliseconds(ms);
+    }
+
+    // Stands in for a key-value server that answers a whole batch of keys
+    // (like a Redis MGET) a fixed delay after receiving it. The value of key k
+    // is 2k+1, and keys over 1000 are missing.
+    struct FakeStore {
+        struct Request {
+            Time answerAt;
+            std::vector<uint32> keys;
+        };
+
+        FakeStore(Duration delay) : mDelay(delay), mRequests(0) {}
+
+        void send(const std::vector<uint32>& keys, const Time& t) {
+            Request req;
+            req.answerAt = t + mDelay;
+            req.keys = keys;
+            mInFlight.push_back(req);
+            mRequests++;
+        }
+
+        // Deliver all the answers due by t, as (key, value) with value 0 for
+        // missing keys
+        void deliver(const Time& t, std::vector< std::pair<uint32, uint32> >* results) {
+            while(!mInFlight.empty() && mInFlight.front().answerAt <= t) {
+                const Request& req = mInFlight.front();
+                for(uint32 i = 0; i < req.keys.size(); i++)
+                    results->push_back(std::make_pair(req.keys[i], req.keys[i] > 1000 ? 0 : 2*req.keys[i]+1));
+                mInFlight.pop_front();
+            }
+        }
+
+        Duration mDelay;
+        std::deque<Request> mInFlight;
+        uint32 mRequests;
+    };
+
+public:
+    void testConcurrentLookupsShareBatch(void) {
+        Batcher batcher(64);
+        TS_ASSERT(batcher.add(1, at(0)));
+        for(uint32 k = 2; k <= 10; k++)
+            TS_ASSERT(!batcher.add(k, at(0)));
+        TS_ASSERT(!batcher.full());
+        TS_ASSERT_EQUALS(batcher.queued(), 10u);
+
+        std::vector<uint32> batch;
+        batcher.take(&batch);
+        TS_ASSERT_EQUALS(batch.size(), 10u);
+        TS_ASSERT(batcher.empty());
+        TS_ASSERT_EQUALS(batcher.outstanding(), 10u);
+
+        for(uint32 i = 0; i < batch.size(); i++)
+            TS_ASSERT(batcher.complete(batch[i], at(3)));
+        TS_ASSERT_EQUALS(batcher.outstanding(), 0u);
+        TS_ASSERT_EQUALS(batcher.batches(), 1u);
+        TS_ASSERT_EQUALS(batcher.batchSizePercentile(0.5), 10u);
+        TS_ASSERT_EQUALS(batcher.latency().count(), 10u);
+        TS_ASSERT_EQUALS(batcher.latency().max(), Duration::milliseconds((int64)3));
+    }
+
+    void testMaxBatchSize(void) {
+        Batcher batcher(64);
+        for(uint32 k = 0; k < 150; k++)
+            batcher.add(k, at(0));
+        TS_ASSERT(batcher.full());
+
+        std::vector<uint32> batch;
+        uint32 sizes[3] = { 64, 64, 22 };
+        for(uint32 i = 0; i < 3; i++) {
+            batcher.take(&batch);
+            TS_ASSERT_EQUALS(batch.size(), sizes[i]);
+        }
+        batcher.take(&batch);
+        TS_ASSERT(batch.empty());
+        TS_ASSERT_EQUALS(batcher.batches(), 3u);
+        TS_ASSERT_EQUALS(batcher.batchSizePercentile(1.0), 64u);
+        TS_ASSERT_EQUALS(batcher.batchSizePercentile(0.3), 22u);
+    }
+
+    void testOutstandingKeysCoalesce(void) {
+        Batcher batcher(8);
+        TS_ASSERT(batcher.add(5, at(0)));
+        TS_ASSERT(!batcher.add(5, at(1)));
+        TS_ASSERT_EQUALS(batcher.queued(), 1u);
+
+        std::vector<uint32> batch;
+        batcher.take(&batch);
+        // Still in flight, so not sent again
+        TS_ASSERT(!batcher.add(5, at(2)));
+        TS_ASSERT(batcher.empty());
+
+        TS_ASSERT(batcher.complete(5, at(4)));
+        TS_ASSERT(!batcher.complete(5, at(4)));
+        // Latency is from the first request
+        TS_ASSERT_EQUALS(batcher.latency().max(), Duration::milliseconds((int64)4));
+
+        TS_ASSERT(batcher.add(5, at(5)));
+    }
+
+    // Drive the batcher the way an OSeg does: lookups arrive over time, a
+    // batch is sent when it fills or when the window since its first key
+    // expires, and results from the stand-in store fan out as they arrive.
+    void testAgainstStandInStore(void) {
+        const int64 window_ms = 2;
+        Batcher batcher(32);
+        FakeStore store(Duration::milliseconds((int64)5));
+
+        uint32 lookups = 0, completions = 0, missing = 0;
+        Time batch_deadline = Time::null();
+        std::vector<uint32> batch;
+        std::vector< std::pair<uint32, uint32> > answers;
+
+        // Lookups arrive for 200ms, then everything outstanding finishes
+        for(int64 ms = 0; ms < 200 || batcher.outstanding() > 0; ms++) {
+            Time now = at(ms);
+
+            // Bursts of lookups, some repeated while in flight and some for
+            // keys the store doesn't have
+            uint32 count = (ms >= 200) ? 0 : (ms % 10 < 3) ? 20 : 1;
+            for(uint32 i = 0; i < count; i++) {
+                uint32 key = (uint32)((ms * 37 + i * 11) % 1100);
+                lookups++;
+                if (batcher.add(key, now))
+                    batch_deadline = now + Duration::milliseconds(window_ms);
+                while(batcher.full()) {
+                    batcher.take(&batch);
+                    store.send(batch, now);
+                    if (!batcher.empty())
+                        batch_deadline = now + Duration::milliseconds(window_ms);
+                }
+            }
+            if (!batcher.empty() && batch_deadline <= now) {
+                batcher.take(&batch);
+                store.send(batch, now);
+            }
+
+            answers.clear();
+            store.deliver(now, &answers);
+            for(uint32 i = 0; i < answers.size(); i++) {
+                TS_ASSERT(batcher.complete(answers[i].first, now));
+                completions++;
+                if (answers[i].second == 0)
+                    missing++;
+                else
+                    TS_ASSERT_EQUALS(answers[i].second, 2*answers[i].first+1);
+            }
+        }
+        TS_ASSERT(missing > 0);
+        // Far fewer requests than lookups, and every distinct outstanding
+        // lookup answered exactly once
+        TS_ASSERT(store.mRequests * 4 < lookups);
+        TS_ASSERT_EQUALS(completions, (uint32)batcher.latency().count());
+        TS_ASSERT(batcher.averageBatchSize() > 4);
+        // Nothing waits longer than the window plus the store's delay
+        TS_ASSERT(batcher.latency().max() <= Duration::milliseconds(window_ms + 5));
+        TS_ASSERT(batcher.latency().percentile(0.5) <= batcher.latency().percentile(0.99));
+    }
+};
+
+#endif //_SIRIKATA_LOOKUP_BATCHER_TEST_HPP_
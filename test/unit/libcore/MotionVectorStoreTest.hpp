@@ -0,0 +1,81 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_MOTION_VECTOR_STORE_TEST_HPP_
+#define _SIRIKATA_MOTION_VECTOR_STORE_TEST_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/util/MotionVectorStore.hpp>
+#include <cxxtest/TestSuite.h>
+
+class MotionVectorStoreTest : public CxxTest::TestSuite
+{
+    typedef Sirikata::Time Time;
+    typedef Sirikata::Duration Duration;
+    typedef Sirikata::Vector3f Vector3f;
+    typedef Sirikata::TimedMotionVector3f TimedMotionVector3f;
+    typedef Sirikata::MotionVectorStore MotionVectorStore;
+
+    TimedMotionVector3f motion(Time base, int i) {
+        return TimedMotionVector3f(
+            base + Duration::milliseconds((Sirikata::int64)(i * 7)),
+            Sirikata::MotionVector3f(Vector3f(i, -2.f*i, 100.f), Vector3f(1.f, 0.5f*i, -(float)(i%3)))
+        );
+    }
+
+    void assertClose(const Vector3f& a, const Vector3f& b) {
+        TS_ASSERT_DELTA(a.x, b.x, 1e-3);
+        TS_ASSERT_DELTA(a.y, b.y, 1e-3);
+        TS_ASSERT_DELTA(a.z, b.z, 1e-3);
+    }
+
+public:
+    void testMatchesScalar(void) {
+        Time base = Time::null() + Duration::seconds(1000.0);
+        Time now = base + Duration::seconds(2.5);
+
+        MotionVectorStore store;
+        std::vector<MotionVectorStore::Slot> slots;
+        // Not a multiple of any vector width, so the scalar tail runs too
+        const int count = 37;
+        for(int i = 0; i < count; i++)
+            slots.push_back(store.add(motion(base, i)));
+        TS_ASSERT_EQUALS(store.size(), (Sirikata::uint32)count);
+
+        std::vector<Vector3f> gathered(count);
+        std::vector<MotionVectorStore::Slot> reversed(slots.rbegin(), slots.rend());
+        store.extrapolate(now, &reversed[0], count, &gathered[0]);
+
+        std::vector<float> x(store.capacity()), y(store.capacity()), z(store.capacity());
+        store.extrapolateAll(now, &x[0], &y[0], &z[0]);
+
+        for(int i = 0; i < count; i++) {
+            Vector3f expected = motion(base, i).position(now);
+            assertClose(store.extrapolate(now, slots[i]), expected);
+            assertClose(gathered[count-1-i], expected);
+            assertClose(Vector3f(x[slots[i]], y[slots[i]], z[slots[i]]), expected);
+        }
+    }
+
+    void testSlotReuse(void) {
+        Time base = Time::null() + Duration::seconds(10.0);
+        MotionVectorStore store;
+        MotionVectorStore::Slot a = store.add(motion(base, 1));
+        MotionVectorStore::Slot b = store.add(motion(base, 2));
+        store.remove(a);
+        TS_ASSERT_EQUALS(store.size(), 1u);
+
+        MotionVectorStore::Slot c = store.add(motion(base, 3));
+        TS_ASSERT_EQUALS(c, a);
+        TS_ASSERT_EQUALS(store.size(), 2u);
+
+        store.set(b, motion(base, 4));
+        TimedMotionVector3f got = store.get(b);
+        TS_ASSERT(got.updateTime() == motion(base, 4).updateTime());
+        assertClose(got.position(), motion(base, 4).position());
+        assertClose(got.velocity(), motion(base, 4).velocity());
+    }
+};
+
+#endif //_SIRIKATA_MOTION_VECTOR_STORE_TEST_HPP_
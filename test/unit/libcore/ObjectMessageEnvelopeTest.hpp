@@ -0,0 +1,74 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_OBJECT_MESSAGE_ENVELOPE_TEST_HPP_
+#define _SIRIKATA_OBJECT_MESSAGE_ENVELOPE_TEST_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/network/ObjectMessage.hpp>
+#include <cxxtest/TestSuite.h>
+
+class ObjectMessageEnvelopeTest : public CxxTest::TestSuite
+{
+    typedef Sirikata::UUID UUID;
+    typedef Sirikata::String String;
+    typedef Sirikata::ObjectMessageEnvelope ObjectMessageEnvelope;
+    typedef Sirikata::Protocol::Object::ObjectMessage ObjectMessage;
+
+public:
+    void testMatchesFullParse(void) {
+        String payload(300, 'p');
+        ObjectMessage* msg = Sirikata::createObjectMessage(7, UUID::random(), 12, UUID::random(), 3000, payload);
+        String serialized = Sirikata::serializePBJMessage(*msg);
+
+        ObjectMessageEnvelope envelope;
+        TS_ASSERT(envelope.parse(serialized));
+        TS_ASSERT_EQUALS(envelope.source_object(), msg->source_object());
+        TS_ASSERT_EQUALS(envelope.source_port(), msg->source_port());
+        TS_ASSERT_EQUALS(envelope.dest_object(), msg->dest_object());
+        TS_ASSERT_EQUALS(envelope.dest_port(), msg->dest_port());
+        TS_ASSERT_EQUALS(envelope.unique(), msg->unique());
+        TS_ASSERT_EQUALS(envelope.ByteSize(), msg->ByteSize());
+        TS_ASSERT_EQUALS(String((const char*)envelope.payload().data(), envelope.payload().size()), payload);
+        // The envelope refers to the original data rather than copying it
+        TS_ASSERT_EQUALS(envelope.serialized().data(), (const void*)serialized.data());
+
+        delete msg;
+    }
+
+    void testEmptyPayload(void) {
+        ObjectMessage* msg = Sirikata::createObjectMessage(1, UUID::random(), 1, UUID::null(), 2, "");
+        String serialized = Sirikata::serializePBJMessage(*msg);
+
+        ObjectMessageEnvelope envelope;
+        TS_ASSERT(envelope.parse(serialized));
+        TS_ASSERT_EQUALS(envelope.dest_object(), UUID::null());
+        TS_ASSERT_EQUALS(envelope.payload().size(), 0u);
+
+        delete msg;
+    }
+
+    void testRejectsTruncated(void) {
+        ObjectMessage* msg = Sirikata::createObjectMessage(1, UUID::random(), 5, UUID::random(), 6, String(50, 'x'));
+        String serialized = Sirikata::serializePBJMessage(*msg);
+
+        for(Sirikata::uint32 len = 0; len < serialized.size(); len++) {
+            ObjectMessageEnvelope envelope;
+            ObjectMessage parsed;
+            // Whenever the envelope parses, it must agree with a full parse
+            if (envelope.parse(Sirikata::MemoryReference(serialized.data(), len))) {
+                TS_ASSERT(parsed.ParseFromArray(serialized.data(), len));
+                TS_ASSERT_EQUALS(envelope.dest_object(), parsed.dest_object());
+                TS_ASSERT_EQUALS(envelope.unique(), parsed.unique());
+            }
+        }
+
+        ObjectMessageEnvelope garbage;
+        TS_ASSERT(!garbage.parse(String("\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff")));
+
+        delete msg;
+    }
+};
+
+#endif //_SIRIKATA_OBJECT_MESSAGE_ENVELOPE_TEST_HPP_
@@ -0,0 +1,102 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_PAIRING_HEAP_TEST_HPP_
+#define _SIRIKATA_PAIRING_HEAP_TEST_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/queue/PairingHeap.hpp>
+#include <cxxtest/TestSuite.h>
+
+using Sirikata::uint32;
+using Sirikata::PairingHeap;
+
+class PairingHeapTest : public CxxTest::TestSuite
+{
+    typedef PairingHeap<uint32, uint32> Heap;
+
+    // Pops everything, checking keys come out in order, and returns how many
+    // elements there were
+    uint32 drainSorted(Heap& heap) {
+        uint32 count = 0;
+        uint32 last = 0;
+        while(!heap.empty()) {
+            TS_ASSERT(heap.topKey() >= last);
+            last = heap.topKey();
+            heap.pop();
+            count++;
+        }
+        return count;
+    }
+
+public:
+    void testPushPop(void) {
+        Heap heap;
+        TS_ASSERT(heap.empty());
+        for(uint32 i = 0; i < 1000; i++)
+            heap.push((i * 7919) % 1000, i);
+        TS_ASSERT_EQUALS(heap.size(), 1000u);
+        TS_ASSERT_EQUALS(heap.topKey(), 0u);
+        TS_ASSERT_EQUALS(drainSorted(heap), 1000u);
+    }
+
+    void testHandles(void) {
+        Heap heap;
+        Heap::Handle a = heap.push(10, 1);
+        Heap::Handle b = heap.push(20, 2);
+        Heap::Handle c = heap.push(30, 3);
+
+        heap.update(c, 5);
+        TS_ASSERT_EQUALS(heap.top(), c);
+        TS_ASSERT_EQUALS(heap.topValue(), 3u);
+
+        heap.update(c, 40);
+        TS_ASSERT_EQUALS(heap.top(), a);
+
+        heap.erase(a);
+        TS_ASSERT_EQUALS(heap.top(), b);
+        TS_ASSERT_EQUALS(heap.size(), 2u);
+
+        heap.pop();
+        TS_ASSERT_EQUALS(heap.top(), c);
+        TS_ASSERT_EQUALS(heap.key(c), 40u);
+    }
+
+    void testRandomOperations(void) {
+        // Mix of all operations, checked against a shadow copy of the keys
+        Heap heap;
+        std::vector<Heap::Handle> handles;
+        std::vector<uint32> keys;
+        uint32 seed = 12345;
+        for(uint32 i = 0; i < 20000; i++) {
+            seed = seed * 1103515245 + 12345;
+            uint32 r = (seed >> 8) % 100;
+            uint32 k = (seed >> 4) % 100000;
+            if (r < 50 || handles.empty()) {
+                handles.push_back(heap.push(k, 0));
+                keys.push_back(k);
+            }
+            else {
+                uint32 idx = (seed >> 12) % handles.size();
+                if (r < 80) {
+                    heap.update(handles[idx], k);
+                    keys[idx] = k;
+                }
+                else {
+                    heap.erase(handles[idx]);
+                    handles[idx] = handles.back(); handles.pop_back();
+                    keys[idx] = keys.back(); keys.pop_back();
+                }
+            }
+
+            if (i % 100 == 0) {
+                TS_ASSERT_EQUALS(heap.size(), (uint32)keys.size());
+                TS_ASSERT_EQUALS(heap.topKey(), *std::min_element(keys.begin(), keys.end()));
+            }
+        }
+        TS_ASSERT_EQUALS(drainSorted(heap), (uint32)keys.size());
+    }
+};
+
+#endif //_SIRIKATA_PAIRING_HEAP_TEST_HPP_
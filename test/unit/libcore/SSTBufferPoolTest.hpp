@@ -0,0 +1,88 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_SST_BUFFER_POOL_TEST_HPP_
+#define _SIRIKATA_SST_BUFFER_POOL_TEST_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/network/SSTBufferPool.hpp>
+#include <cxxtest/TestSuite.h>
+
+class PooledTestObject;
+typedef boost::intrusive_ptr<PooledTestObject> PooledTestObjectPtr;
+
+class PooledTestObject : public Sirikata::SST::SSTPooledObject {
+public:
+    static PooledTestObjectPtr create(Sirikata::SST::SSTBufferPool* pool, Sirikata::uint32 len, int* live) {
+        Sirikata::uint32 block_size = sizeof(PooledTestObject) + len;
+        void* block = pool->allocate(block_size);
+        return PooledTestObjectPtr(new (block) PooledTestObject(pool, block_size, len, live));
+    }
+
+    ~PooledTestObject() {
+        (*mLive)--;
+    }
+
+    Sirikata::uint8* mBuffer;
+
+private:
+    PooledTestObject(Sirikata::SST::SSTBufferPool* pool, Sirikata::uint32 block_size, Sirikata::uint32 len, int* live)
+     : SSTPooledObject(pool, block_size),
+       mBuffer((Sirikata::uint8*)(this+1)),
+       mLive(live)
+    {
+        memset(mBuffer, 0xAB, len);
+        (*mLive)++;
+    }
+
+    int* mLive;
+};
+
+class SSTBufferPoolTest : public CxxTest::TestSuite
+{
+public:
+    void testReuse(void) {
+        Sirikata::SST::SSTBufferPool* pool = new Sirikata::SST::SSTBufferPool();
+        int live = 0;
+        for(int i = 0; i < 1000; i++) {
+            PooledTestObjectPtr obj = PooledTestObject::create(pool, 500, &live);
+            TS_ASSERT_EQUALS(live, 1);
+        }
+        TS_ASSERT_EQUALS(live, 0);
+
+        Sirikata::SST::SSTBufferPool::Stats stats = pool->stats();
+        TS_ASSERT_EQUALS(stats.allocations, 1000u);
+        TS_ASSERT_EQUALS(stats.hits, 999u);
+        TS_ASSERT_EQUALS(stats.oversized, 0u);
+        TS_ASSERT_EQUALS(stats.outstanding, 0u);
+        pool->destroy();
+    }
+
+    void testOversized(void) {
+        Sirikata::SST::SSTBufferPool* pool = new Sirikata::SST::SSTBufferPool();
+        int live = 0;
+        {
+            PooledTestObjectPtr obj = PooledTestObject::create(pool, 10000, &live);
+            TS_ASSERT_EQUALS(obj->mBuffer[9999], 0xAB);
+        }
+        TS_ASSERT_EQUALS(pool->stats().oversized, 1u);
+        TS_ASSERT_EQUALS(pool->stats().outstanding, 0u);
+        pool->destroy();
+    }
+
+    void testOutlivesOwner(void) {
+        Sirikata::SST::SSTBufferPool* pool = new Sirikata::SST::SSTBufferPool();
+        int live = 0;
+        PooledTestObjectPtr a = PooledTestObject::create(pool, 100, &live);
+        PooledTestObjectPtr b = a;
+        pool->destroy();
+        a = PooledTestObjectPtr();
+        TS_ASSERT_EQUALS(live, 1);
+        // Releasing the last reference frees both the object and the pool
+        b = PooledTestObjectPtr();
+        TS_ASSERT_EQUALS(live, 0);
+    }
+};
+
+#endif //_SIRIKATA_SST_BUFFER_POOL_TEST_HPP_
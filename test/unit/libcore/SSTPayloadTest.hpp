@@ -0,0 +1,69 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_SST_PAYLOAD_TEST_HPP_
+#define _SIRIKATA_SST_PAYLOAD_TEST_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/network/SSTPayload.hpp>
+#include "Protocol_SSTHeader.pbj.hpp"
+#include <cxxtest/TestSuite.h>
+
+class SSTPayloadTest : public CxxTest::TestSuite
+{
+    std::string payload(Sirikata::uint32 len) {
+        std::string result;
+        for(Sirikata::uint32 i = 0; i < len; i++)
+            result.push_back((char)(i*7));
+        return result;
+    }
+
+    // Checks that gathering the payload onto the serialized header gives the
+    // same message as setting the payload
+    template<typename HeaderType>
+    void checkGathered(const HeaderType& header, Sirikata::uint32 len) {
+        std::string data = payload(len);
+
+        std::string gathered;
+        TS_ASSERT(Sirikata::SST::PayloadSerializer<HeaderType>::serializeHeader(header, len, &gathered));
+        gathered.append(data);
+
+        HeaderType parsed;
+        TS_ASSERT(Sirikata::parsePBJMessage(&parsed, gathered));
+        TS_ASSERT_EQUALS(parsed.payload(), data);
+
+        HeaderType full = header;
+        full.set_payload(data);
+        TS_ASSERT_EQUALS(Sirikata::serializePBJMessage(parsed), Sirikata::serializePBJMessage(full));
+    }
+
+public:
+    void testStreamHeader(void) {
+        Sirikata::Protocol::SST::SSTStreamHeader header;
+        header.set_lsid(3);
+        header.set_type(header.DATA);
+        header.set_flags(0);
+        header.set_window(20);
+        header.set_src_port(1);
+        header.set_dest_port(2);
+        header.set_bsn(123456789);
+
+        checkGathered(header, 0);
+        checkGathered(header, 5);
+        checkGathered(header, 1000);
+    }
+
+    void testChannelHeader(void) {
+        Sirikata::Protocol::SST::SSTChannelHeader header;
+        header.set_channel_id(1);
+        header.set_transmit_sequence_number(77);
+        header.set_ack_count(1);
+        header.set_ack_sequence_number(1ULL << 40);
+
+        checkGathered(header, 3);
+        checkGathered(header, 1300);
+    }
+};
+
+#endif //_SIRIKATA_SST_PAYLOAD_TEST_HPP_
@@ -0,0 +1,122 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_CACHE_CLOCK_TEST_HPP_
+#define _SIRIKATA_CACHE_CLOCK_TEST_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/core/network/IOService.hpp>
+#include <sirikata/core/network/IOStrand.hpp>
+#include "../../../space/src/caches/CacheClock.hpp"
+#include <cxxtest/TestSuite.h>
+
+using namespace Sirikata;
+
+class CacheClockTest : public CxxTest::TestSuite
+{
+    Network::IOService* mIOService;
+    Network::IOStrand* mStrand;
+    Context* mContext;
+
+    // Long enough that nothing expires unless a test wants it to
+    Duration lifetime() const {
+        return Duration::seconds(3600.f);
+    }
+
+public:
+    void setUp() {
+        mIOService = new Network::IOService("CacheClockTest");
+        mStrand = mIOService->createStrand("CacheClockTest");
+        mContext = new Context("CacheClockTest", mIOService, mStrand, NULL, Timer::now());
+    }
+
+    void tearDown() {
+        delete mContext;
+        delete mStrand;
+        delete mIOService;
+    }
+
+    void testInsertGetRemove(void) {
+        CacheClock cache(mContext, 16, lifetime());
+        UUID a = UUID::random(), b = UUID::random();
+
+        TS_ASSERT(cache.get(a).isNull());
+        cache.insert(a, OSegEntry(1, 2.f));
+        cache.insert(b, OSegEntry(3, 4.f));
+        TS_ASSERT_EQUALS(cache.get(a).server(), 1u);
+        TS_ASSERT_EQUALS(cache.get(b).server(), 3u);
+
+        // Inserting again replaces the entry
+        cache.insert(a, OSegEntry(5, 2.f));
+        TS_ASSERT_EQUALS(cache.get(a).server(), 5u);
+
+        cache.remove(a);
+        TS_ASSERT(cache.get(a).isNull());
+        TS_ASSERT_EQUALS(cache.get(b).server(), 3u);
+    }
+
+    void testFullCacheStaysConsistent(void) {
+        // Many more objects than entries, so the table is constantly evicting
+        // and shifting probe sequences on removal
+        const uint32 size = 64;
+        CacheClock cache(mContext, size, lifetime());
+        std::vector<UUID> ids;
+        for(uint32 i = 0; i < 1000; i++) {
+            ids.push_back(UUID::random());
+            cache.insert(ids.back(), OSegEntry(i+1, 1.f));
+            if (i % 3 == 0)
+                cache.remove(ids[i / 2]);
+        }
+
+        OSegEntryList entries;
+        cache.getEntries(&entries);
+        TS_ASSERT(entries.size() <= size);
+        // Everything listed is still reachable through the index
+        for(uint32 i = 0; i < entries.size(); i++)
+            TS_ASSERT_EQUALS(cache.get(entries[i].first).server(), entries[i].second.server());
+        // and the most recent insert is never the one evicted
+        TS_ASSERT_EQUALS(cache.get(ids.back()).server(), 1000u);
+    }
+
+    void testReferencedEntriesSurvive(void) {
+        const uint32 size = 8;
+        CacheClock cache(mContext, size, lifetime());
+        std::vector<UUID> ids;
+        for(uint32 i = 0; i < size; i++) {
+            ids.push_back(UUID::random());
+            cache.insert(ids.back(), OSegEntry(i+1, 1.f));
+        }
+
+        // The first insert sweeps every entry's grace away and evicts the
+        // first one. After that the hand evicts entries in order, except the
+        // one looked up in the meantime, which gets a second chance.
+        cache.insert(UUID::random(), OSegEntry(100, 1.f));
+        TS_ASSERT(cache.get(ids[0]).isNull());
+        TS_ASSERT_EQUALS(cache.get(ids[3]).server(), 4u);
+        for(uint32 i = 0; i < 4; i++)
+            cache.insert(UUID::random(), OSegEntry(101+i, 1.f));
+        TS_ASSERT(cache.get(ids[1]).isNull());
+        TS_ASSERT(cache.get(ids[2]).isNull());
+        TS_ASSERT_EQUALS(cache.get(ids[3]).server(), 4u);
+        TS_ASSERT(cache.get(ids[4]).isNull());
+        TS_ASSERT(cache.get(ids[5]).isNull());
+    }
+
+    void testExpiredEntriesMiss(void) {
+        CacheClock cache(mContext, 16, Duration::zero());
+        UUID a = UUID::random();
+        cache.insert(a, OSegEntry(1, 1.f));
+        TS_ASSERT_EQUALS(cache.get(a).server(), 1u);
+
+        // Entries age by the context's recent sim time
+        Time inserted = mContext->recentSimTime();
+        while(mContext->simTime() == inserted) {}
+        OSegEntryList entries;
+        cache.getEntries(&entries);
+        TS_ASSERT(entries.empty());
+        TS_ASSERT(cache.get(a).isNull());
+    }
+};
+
+#endif //_SIRIKATA_CACHE_CLOCK_TEST_HPP_
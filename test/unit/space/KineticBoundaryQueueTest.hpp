@@ -0,0 +1,96 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_KINETIC_BOUNDARY_QUEUE_TEST_HPP_
+#define _SIRIKATA_KINETIC_BOUNDARY_QUEUE_TEST_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include "../../../space/src/KineticBoundaryQueue.hpp"
+#include <cxxtest/TestSuite.h>
+
+using namespace Sirikata;
+
+class KineticBoundaryQueueTest : public CxxTest::TestSuite
+{
+    Time mStart;
+
+    static BoundingBox3f box(float minx, float maxx) {
+        return BoundingBox3f(Vector3f(minx, 0, 0), Vector3f(maxx, 10, 10));
+    }
+
+    TimedMotionVector3f motion(float x, float vx) {
+        return TimedMotionVector3f(mStart, MotionVector3f(Vector3f(x, 5, 5), Vector3f(vx, 0, 0)));
+    }
+
+    Time at(float64 secs) {
+        return mStart + Duration::seconds(secs);
+    }
+
+public:
+    void setUp() {
+        mStart = Time::null() + Duration::seconds(1000.0);
+    }
+
+    void testLeaves(void) {
+        KineticBoundaryQueue queue(Duration::milliseconds(100.0));
+        queue.setRegions(BoundingBoxList(1, box(0, 10)), mStart);
+        UUID id = UUID::random();
+        queue.add(id, motion(5, 1), mStart);
+        TS_ASSERT_EQUALS(queue.nextEventTime(), at(5));
+
+        // Reaching the boundary on the way out is leaving, no extra step
+        // needed to get outside
+        std::vector<UUID> leaving;
+        queue.expire(at(5), &leaving);
+        TS_ASSERT_EQUALS(leaving.size(), 1u);
+        if (!leaving.empty()) TS_ASSERT_EQUALS(leaving[0], id);
+
+        // And it's reported again until it's removed
+        leaving.clear();
+        queue.expire(at(5.05), &leaving);
+        TS_ASSERT(leaving.empty());
+        queue.expire(at(5.1), &leaving);
+        TS_ASSERT_EQUALS(leaving.size(), 1u);
+    }
+
+    void testAddedOnBoundaryHeadingOut(void) {
+        KineticBoundaryQueue queue(Duration::milliseconds(100.0));
+        queue.setRegions(BoundingBoxList(1, box(0, 10)), mStart);
+        queue.add(UUID::random(), motion(10, 1), mStart);
+        TS_ASSERT_EQUALS(queue.nextEventTime(), mStart);
+
+        std::vector<UUID> leaving;
+        queue.expire(mStart, &leaving);
+        TS_ASSERT_EQUALS(leaving.size(), 1u);
+        TS_ASSERT(queue.nextEventTime() > mStart);
+    }
+
+    void testOnBoundaryBetweenRegions(void) {
+        // Heading out of one region straight into another isn't leaving
+        BoundingBoxList regions;
+        regions.push_back(box(0, 10));
+        regions.push_back(box(10, 20));
+        KineticBoundaryQueue queue(Duration::milliseconds(100.0));
+        queue.setRegions(regions, mStart);
+        queue.add(UUID::random(), motion(10, 1), mStart);
+        TS_ASSERT_EQUALS(queue.nextEventTime(), at(10));
+
+        std::vector<UUID> leaving;
+        queue.expire(mStart, &leaving);
+        TS_ASSERT(leaving.empty());
+    }
+
+    void testStationaryOnBoundary(void) {
+        KineticBoundaryQueue queue(Duration::milliseconds(100.0));
+        queue.setRegions(BoundingBoxList(1, box(0, 10)), mStart);
+        queue.add(UUID::random(), motion(10, 0), mStart);
+        TS_ASSERT(queue.nextEventTime() > mStart);
+
+        std::vector<UUID> leaving;
+        queue.expire(mStart, &leaving);
+        TS_ASSERT(leaving.empty());
+    }
+};
+
+#endif //_SIRIKATA_KINETIC_BOUNDARY_QUEUE_TEST_HPP_
@@ -0,0 +1,212 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_LOAD_BALANCE_PLANNER_TEST_HPP_
+#define _SIRIKATA_LOAD_BALANCE_PLANNER_TEST_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include "../../../cseg/src/LoadBalancePlanner.hpp"
+#include <cxxtest/TestSuite.h>
+
+using namespace Sirikata;
+
+class LoadBalancePlannerTest : public CxxTest::TestSuite
+{
+    typedef LoadBalancePlanner::Parameters Parameters;
+
+    SegmentedRegion* mRoot;
+    std::vector<SegmentedRegion*> mRoots;
+    std::vector<ServerID> mIdle;
+    std::set<ServerID> mChanged;
+
+    // Costs are reported directly as object counts, with no smoothing, so
+    // each report is the leaf's cost
+    static Parameters parameters() {
+        Parameters params;
+        params.objectCost = 1.f;
+        params.messageCost = 0.f;
+        params.smoothing = 1.f;
+        return params;
+    }
+
+    static SegmentedRegion* leaf(SegmentedRegion* parent, const BoundingBox3f& bbox, ServerID server) {
+        SegmentedRegion* region = new SegmentedRegion(parent);
+        region->mBoundingBox = bbox;
+        region->mServer = server;
+        return region;
+    }
+
+    // Split a leaf in half along axis, giving the halves to the two servers
+    static void split(SegmentedRegion* region, uint32 axis, ServerID low, ServerID high) {
+        Vector3f min = region->mBoundingBox.min(), max = region->mBoundingBox.max();
+        Vector3f low_max = max, high_min = min;
+        float32 mid = (min[axis] + max[axis]) / 2;
+        if (axis == 0) low_max.x = high_min.x = mid;
+        else if (axis == 1) low_max.y = high_min.y = mid;
+        else low_max.z = high_min.z = mid;
+        region->mLeftChild = leaf(region, BoundingBox3f(min, low_max), low);
+        region->mRightChild = leaf(region, BoundingBox3f(high_min, max), high);
+    }
+
+    static bool isLeaf(SegmentedRegion* region) {
+        return (region->mLeftChild == NULL && region->mRightChild == NULL);
+    }
+
+    // Leaves reported for the cost they're planned to have, after a round
+    void reportEstimates(LoadBalancePlanner& planner, SegmentedRegion* node) {
+        if (isLeaf(node)) {
+            planner.reportLoad(node, (uint32)(planner.cost(node) + 0.5f), 0);
+            return;
+        }
+        reportEstimates(planner, node->mLeftChild);
+        reportEstimates(planner, node->mRightChild);
+    }
+
+    uint32 plan(LoadBalancePlanner& planner) {
+        mChanged.clear();
+        return planner.plan(mRoots, &mIdle, &mChanged);
+    }
+
+public:
+    void setUp() {
+        mRoot = leaf(NULL, BoundingBox3f(Vector3f(0, 0, 0), Vector3f(100, 100, 100)), 1);
+        mRoots.clear();
+        mRoots.push_back(mRoot);
+        mIdle.clear();
+        mChanged.clear();
+    }
+
+    void tearDown() {
+        mRoot->destroy();
+        delete mRoot;
+    }
+
+    void testMigrationBudget(void) {
+        // Three imbalanced pairs, each of which would move 400 to balance
+        split(mRoot, 0, 0, 0);
+        split(mRoot->mLeftChild, 1, 1, 2);
+        split(mRoot->mRightChild, 1, 0, 0);
+        split(mRoot->mRightChild->mLeftChild, 2, 3, 4);
+        split(mRoot->mRightChild->mRightChild, 2, 5, 6);
+        SegmentedRegion* pairs[3] = { mRoot->mLeftChild, mRoot->mRightChild->mLeftChild, mRoot->mRightChild->mRightChild };
+
+        Parameters params = parameters();
+        params.migrationBudget = 500.f;
+        LoadBalancePlanner planner(params);
+        for(uint32 i = 0; i < 3; i++) {
+            planner.reportLoad(pairs[i]->mLeftChild, 900, 0);
+            planner.reportLoad(pairs[i]->mRightChild, 100, 0);
+        }
+
+        // Every round moves at most the budget, however much is imbalanced
+        float64 last_migrated = 0;
+        for(uint32 round = 0; round < 4; round++) {
+            plan(planner);
+            TS_ASSERT(planner.migratedCost() - last_migrated <= params.migrationBudget + 0.01);
+            last_migrated = planner.migratedCost();
+            reportEstimates(planner, mRoot);
+        }
+        // But it gets there over several rounds
+        TS_ASSERT_DELTA(planner.migratedCost(), 1200.0, 1.0);
+        for(uint32 i = 0; i < 3; i++)
+            TS_ASSERT_DELTA(planner.cost(pairs[i]->mLeftChild), 500.f, 1.f);
+    }
+
+    void testChangesPerRound(void) {
+        split(mRoot, 0, 0, 0);
+        split(mRoot->mLeftChild, 1, 1, 2);
+        split(mRoot->mRightChild, 1, 3, 4);
+
+        Parameters params = parameters();
+        params.maxChangesPerRound = 1;
+        LoadBalancePlanner planner(params);
+        planner.reportLoad(mRoot->mLeftChild->mLeftChild, 400, 0);
+        planner.reportLoad(mRoot->mLeftChild->mRightChild, 100, 0);
+        planner.reportLoad(mRoot->mRightChild->mLeftChild, 100, 0);
+        planner.reportLoad(mRoot->mRightChild->mRightChild, 400, 0);
+
+        TS_ASSERT_EQUALS(plan(planner), 1u);
+        TS_ASSERT_EQUALS(mChanged.size(), 2u);
+    }
+
+    void testHysteresis(void) {
+        split(mRoot, 0, 1, 2);
+        SegmentedRegion* left = mRoot->mLeftChild;
+        SegmentedRegion* right = mRoot->mRightChild;
+        LoadBalancePlanner planner(parameters());
+
+        // Imbalanced, but not enough to start balancing
+        planner.reportLoad(left, 560, 0);
+        planner.reportLoad(right, 440, 0);
+        TS_ASSERT_EQUALS(plan(planner), 0u);
+
+        // Enough to start
+        planner.reportLoad(left, 700, 0);
+        planner.reportLoad(right, 300, 0);
+        TS_ASSERT_EQUALS(plan(planner), 1u);
+        float32 plane = left->mBoundingBox.max().x;
+        TS_ASSERT(plane < 50.f);
+
+        // Once started, it keeps going until within the stop threshold
+        planner.reportLoad(left, 560, 0);
+        planner.reportLoad(right, 440, 0);
+        TS_ASSERT_EQUALS(plan(planner), 1u);
+        TS_ASSERT(left->mBoundingBox.max().x < plane);
+        plane = left->mBoundingBox.max().x;
+
+        // Loads that wander around within the start threshold in either
+        // direction don't move the boundary back and forth
+        uint32 wander[4] = { 530, 470, 560, 440 };
+        for(uint32 i = 0; i < 4; i++) {
+            planner.reportLoad(left, wander[i], 0);
+            planner.reportLoad(right, 1000 - wander[i], 0);
+            TS_ASSERT_EQUALS(plan(planner), 0u);
+            TS_ASSERT_EQUALS(left->mBoundingBox.max().x, plane);
+            TS_ASSERT_EQUALS(right->mBoundingBox.min().x, plane);
+        }
+    }
+
+    void testOverloadedSplits(void) {
+        LoadBalancePlanner planner(parameters());
+        planner.reportLoad(mRoot, 3000, 0);
+
+        // No servers to split onto
+        TS_ASSERT_EQUALS(plan(planner), 0u);
+        TS_ASSERT(isLeaf(mRoot));
+
+        mIdle.push_back(7);
+        TS_ASSERT_EQUALS(plan(planner), 1u);
+        TS_ASSERT(!isLeaf(mRoot));
+        TS_ASSERT(mIdle.empty());
+        TS_ASSERT_EQUALS(mRoot->mLeftChild->mServer, 1u);
+        TS_ASSERT_EQUALS(mRoot->mRightChild->mServer, 7u);
+        TS_ASSERT_EQUALS(mChanged.size(), 2u);
+        TS_ASSERT(mChanged.count(1) && mChanged.count(7));
+        TS_ASSERT_DELTA(planner.cost(mRoot->mLeftChild), 1500.f, 0.01f);
+        TS_ASSERT_DELTA(planner.cost(mRoot->mRightChild), 1500.f, 0.01f);
+    }
+
+    void testIdleNeighboursMerge(void) {
+        split(mRoot, 0, 1, 2);
+        LoadBalancePlanner planner(parameters());
+
+        // Only lightly loaded, not idle
+        planner.reportLoad(mRoot->mLeftChild, 60, 0);
+        planner.reportLoad(mRoot->mRightChild, 50, 0);
+        TS_ASSERT_EQUALS(plan(planner), 0u);
+        TS_ASSERT(!isLeaf(mRoot));
+
+        planner.reportLoad(mRoot->mLeftChild, 20, 0);
+        planner.reportLoad(mRoot->mRightChild, 30, 0);
+        TS_ASSERT_EQUALS(plan(planner), 1u);
+        TS_ASSERT(isLeaf(mRoot));
+        TS_ASSERT_EQUALS(mRoot->mServer, 1u);
+        TS_ASSERT_EQUALS(mIdle.size(), 1u);
+        if (!mIdle.empty()) TS_ASSERT_EQUALS(mIdle[0], 2u);
+        TS_ASSERT(mChanged.count(1) && mChanged.count(2));
+        TS_ASSERT_DELTA(planner.cost(mRoot), 50.f, 0.01f);
+    }
+};
+
+#endif //_SIRIKATA_LOAD_BALANCE_PLANNER_TEST_HPP_
@@ -0,0 +1,129 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_OSEG_SNAPSHOT_TEST_HPP_
+#define _SIRIKATA_OSEG_SNAPSHOT_TEST_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include "../../../space/src/OSegSnapshot.hpp"
+#include <cxxtest/TestSuite.h>
+#include <cstdio>
+
+using namespace Sirikata;
+
+#define OSEG_SNAPSHOT_TEST_FILE "OSegSnapshotTest.snapshot"
+
+class OSegSnapshotTest : public CxxTest::TestSuite
+{
+    OSegSnapshot::Contents mContents;
+    uint64 mSize;
+
+    String readFile() {
+        String data;
+        FILE* fp = fopen(OSEG_SNAPSHOT_TEST_FILE, "rb");
+        if (fp == NULL) return data;
+        char buf[4096];
+        size_t n;
+        while((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+            data.append(buf, n);
+        fclose(fp);
+        return data;
+    }
+
+    void writeFile(const String& data) {
+        FILE* fp = fopen(OSEG_SNAPSHOT_TEST_FILE, "wb");
+        fwrite(data.data(), 1, data.size(), fp);
+        fclose(fp);
+    }
+
+    bool load() {
+        OSegSnapshot::Contents loaded;
+        return OSegSnapshot::load(OSEG_SNAPSHOT_TEST_FILE, &loaded);
+    }
+
+public:
+    void setUp() {
+        mContents = OSegSnapshot::Contents();
+        mContents.server = 7;
+        mContents.saved = Time::microseconds(1234567890123LL);
+        for(uint32 i = 0; i < 100; i++)
+            mContents.cacheEntries.push_back(std::make_pair(UUID::random(), OSegEntry(i % 5 + 1, i * .5f)));
+        for(uint32 i = 0; i < 10; i++)
+            mContents.localObjects.push_back(std::make_pair(UUID::random(), OSegEntry(7, i + 1.f)));
+        mSize = OSegSnapshot::save(OSEG_SNAPSHOT_TEST_FILE, mContents);
+    }
+
+    void tearDown() {
+        remove(OSEG_SNAPSHOT_TEST_FILE);
+    }
+
+    void testRoundTrip(void) {
+        TS_ASSERT(mSize > 0);
+        TS_ASSERT_EQUALS((uint64)readFile().size(), mSize);
+
+        OSegSnapshot::Contents loaded;
+        TS_ASSERT(OSegSnapshot::load(OSEG_SNAPSHOT_TEST_FILE, &loaded));
+        TS_ASSERT_EQUALS(loaded.server, mContents.server);
+        TS_ASSERT_EQUALS(loaded.saved, mContents.saved);
+        TS_ASSERT_EQUALS(loaded.cacheEntries.size(), mContents.cacheEntries.size());
+        TS_ASSERT_EQUALS(loaded.localObjects.size(), mContents.localObjects.size());
+        for(uint32 i = 0; i < loaded.cacheEntries.size(); i++) {
+            TS_ASSERT_EQUALS(loaded.cacheEntries[i].first, mContents.cacheEntries[i].first);
+            TS_ASSERT_EQUALS(loaded.cacheEntries[i].second.server(), mContents.cacheEntries[i].second.server());
+            TS_ASSERT_EQUALS(loaded.cacheEntries[i].second.radius(), mContents.cacheEntries[i].second.radius());
+        }
+        for(uint32 i = 0; i < loaded.localObjects.size(); i++) {
+            TS_ASSERT_EQUALS(loaded.localObjects[i].first, mContents.localObjects[i].first);
+            TS_ASSERT_EQUALS(loaded.localObjects[i].second.radius(), mContents.localObjects[i].second.radius());
+        }
+    }
+
+    void testEmpty(void) {
+        OSegSnapshot::Contents empty;
+        empty.server = 3;
+        TS_ASSERT(OSegSnapshot::save(OSEG_SNAPSHOT_TEST_FILE, empty) > 0);
+
+        OSegSnapshot::Contents loaded;
+        loaded.cacheEntries = mContents.cacheEntries;
+        TS_ASSERT(OSegSnapshot::load(OSEG_SNAPSHOT_TEST_FILE, &loaded));
+        TS_ASSERT_EQUALS(loaded.server, 3u);
+        TS_ASSERT(loaded.cacheEntries.empty());
+        TS_ASSERT(loaded.localObjects.empty());
+    }
+
+    void testMissing(void) {
+        remove(OSEG_SNAPSHOT_TEST_FILE);
+        TS_ASSERT(!load());
+    }
+
+    void testTruncated(void) {
+        String data = readFile();
+        // In the middle of the records, and in the middle of the header
+        writeFile(data.substr(0, data.size() - 10));
+        TS_ASSERT(!load());
+        writeFile(data.substr(0, 20));
+        TS_ASSERT(!load());
+        writeFile(String());
+        TS_ASSERT(!load());
+    }
+
+    void testCorrupt(void) {
+        String data = readFile();
+        // A flipped bit anywhere, header or records, is caught
+        uint32 offsets[] = { 0, 12, 30, 100, (uint32)data.size() - 1 };
+        for(uint32 i = 0; i < sizeof(offsets)/sizeof(offsets[0]); i++) {
+            String corrupt = data;
+            corrupt[offsets[i]] ^= 0x10;
+            writeFile(corrupt);
+            TS_ASSERT(!load());
+        }
+    }
+
+    void testTrailingData(void) {
+        writeFile(readFile() + "x");
+        TS_ASSERT(!load());
+    }
+};
+
+#endif //_SIRIKATA_OSEG_SNAPSHOT_TEST_HPP_
@@ -0,0 +1,205 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_OBJECT_QUERY_SHARDS_TEST_HPP_
+#define _SIRIKATA_OBJECT_QUERY_SHARDS_TEST_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include <sirikata/pintoloc/ProxSimulationTraits.hpp>
+#include <sirikata/core/prox/QueryHandlerFactory.hpp>
+#include <prox/base/LocationServiceCache.hpp>
+#include <prox/base/ZernikeDescriptor.hpp>
+#include <prox/base/AggregateListener.hpp>
+#include <prox/base/QueryEventListener.hpp>
+#include "../../../libspace/plugins/prox/ObjectQueryShards.hpp"
+#include <cxxtest/TestSuite.h>
+
+using namespace Sirikata;
+
+class ObjectQueryShardsTest : public CxxTest::TestSuite
+{
+    typedef Prox::QueryHandler<ObjectProxSimulationTraits> ProxQueryHandler;
+    typedef Prox::Aggregator<ObjectProxSimulationTraits> ProxAggregator;
+    typedef Prox::Query<ObjectProxSimulationTraits> Query;
+    typedef Prox::QueryEvent<ObjectProxSimulationTraits> QueryEvent;
+    typedef Prox::LocationUpdateListener<ObjectProxSimulationTraits> LocationUpdateListener;
+    typedef std::set<ObjectReference> ObjectSet;
+
+    // Minimal stand in for a shard's CBRLocationServiceCache: static, local
+    // objects which are announced to the handlers as they're added
+    class FakeLocationCache : public Prox::LocationServiceCache<ObjectProxSimulationTraits> {
+    public:
+        void addObject(const ObjectReference& id, const TimedMotionVector3f& loc, float32 radius) {
+            ObjectData& data = mObjects[id];
+            data.location = loc;
+            data.radius = radius;
+            data.aggregate = false;
+            for(ListenerSet::iterator it = mListeners.begin(); it != mListeners.end(); it++)
+                (*it)->locationConnected(id, false, true, loc, BoundingSphere3f(Vector3f(0,0,0), 0), radius);
+        }
+
+        virtual void addPlaceholderImposter(const ObjectID& id, const Vector3f& center_offset, const float32 center_bounds_radius, const float32 max_size, const String& zernike, const String& mesh) {
+            ObjectData& data = mObjects[id];
+            data.location = TimedMotionVector3f(Time::null(), MotionVector3f(center_offset, Vector3f(0,0,0)));
+            data.radius = max_size;
+            data.aggregate = true;
+        }
+
+        virtual Iterator startTracking(const ObjectID& id) {
+            assert(mObjects.find(id) != mObjects.end());
+            return Iterator(new ObjectReference(id));
+        }
+        virtual void stopTracking(const Iterator& id) {
+            delete (ObjectReference*)id.data;
+        }
+        virtual bool startRefcountTracking(const ObjectID& id) {
+            return (mObjects.find(id) != mObjects.end());
+        }
+        virtual void stopRefcountTracking(const ObjectID& id) {}
+
+        virtual TimedMotionVector3f location(const Iterator& id) { return data(id).location; }
+        virtual Vector3f centerOffset(const Iterator& id) { return Vector3f(0,0,0); }
+        virtual float32 centerBoundsRadius(const Iterator& id) { return 0.f; }
+        virtual float32 maxSize(const Iterator& id) { return data(id).radius; }
+        virtual bool isLocal(const Iterator& id) { return true; }
+        Prox::ZernikeDescriptor& zernikeDescriptor(const Iterator& id) { return mZernike; }
+        String mesh(const Iterator& id) { return ""; }
+
+        virtual const ObjectReference& iteratorID(const Iterator& id) { return *(ObjectReference*)id.data; }
+
+        virtual void addUpdateListener(LocationUpdateListener* listener) { mListeners.insert(listener); }
+        virtual void removeUpdateListener(LocationUpdateListener* listener) { mListeners.erase(listener); }
+
+    private:
+        struct ObjectData {
+            TimedMotionVector3f location;
+            float32 radius;
+            bool aggregate;
+        };
+        ObjectData& data(const Iterator& id) { return mObjects[iteratorID(id)]; }
+
+        typedef std::map<ObjectReference, ObjectData> ObjectDataMap;
+        typedef std::set<LocationUpdateListener*> ListenerSet;
+        ObjectDataMap mObjects;
+        ListenerSet mListeners;
+        Prox::ZernikeDescriptor mZernike;
+    };
+
+    // Stands in for LibproxProximity, recording the aggregates it would
+    // register with the LocationService and AggregateManager
+    struct AggregateRecorder : public Prox::AggregateListener<ObjectProxSimulationTraits> {
+        virtual void aggregateCreated(ProxAggregator* handler, const ObjectReference& objid) {
+            created.insert(objid);
+        }
+        virtual void aggregateChildAdded(ProxAggregator* handler, const ObjectReference& objid, const ObjectReference& child, const Vector3f& bnds_center, const float32 bnds_center_radius, const float32 max_obj_size) {}
+        virtual void aggregateChildRemoved(ProxAggregator* handler, const ObjectReference& objid, const ObjectReference& child, const Vector3f& bnds_center, const float32 bnds_center_radius, const float32 max_obj_size) {}
+        virtual void aggregateBoundsUpdated(ProxAggregator* handler, const ObjectReference& objid, const Vector3f& bnds_center, const float32 bnds_center_radius, const float32 max_obj_size) {}
+        virtual void aggregateDestroyed(ProxAggregator* handler, const ObjectReference& objid) {
+            created.erase(objid);
+        }
+        virtual void aggregateObserved(ProxAggregator* handler, const ObjectReference& objid, uint32 nobservers, uint32 nchildren) {}
+
+        ObjectSet created;
+    };
+
+    struct IgnoreQueryEvents : public Prox::QueryEventListener<ObjectProxSimulationTraits, Query> {
+        virtual void queryHasEvents(Query* query) {}
+    };
+
+    static bool trackEverything(const ObjectReference& obj_id, bool is_local, bool is_aggregate, const TimedMotionVector3f& pos, const BoundingSphere3f& region, float maxSize) {
+        return true;
+    }
+
+    // Sets up the object query handlers for num_requested shards of the
+    // given handler type the same way LibproxProximity does, indexes the same
+    // objects in each and registers a querier on the last shard. Returns the
+    // IDs that querier was sent which weren't objects or aggregates the
+    // listener was told about.
+    ObjectSet unknownResults(const String& handler_type, uint32 num_requested, uint32* num_shards_out) {
+        uint32 num_shards = objectQueryShardCount(handler_type, num_requested);
+        *num_shards_out = num_shards;
+
+        Time t = Time::null() + Duration::seconds(100.0);
+        AggregateRecorder recorder;
+        IgnoreQueryEvents query_listener;
+        std::vector<FakeLocationCache*> caches;
+        std::vector<ProxQueryHandler*> handlers;
+        for(uint32 s = 0; s < num_shards; s++) {
+            caches.push_back(new FakeLocationCache());
+            handlers.push_back(QueryHandlerFactory<ObjectProxSimulationTraits>(handler_type, "--branching=2", false));
+            setObjectQueryShardAggregateListener(s, handlers[s], &recorder);
+            handlers[s]->initialize(caches[s], caches[s], true, false, &trackEverything);
+        }
+
+        ObjectSet objects;
+        for(uint32 i = 0; i < 16; i++) {
+            ObjectReference id(UUID::random());
+            objects.insert(id);
+            TimedMotionVector3f loc(t, MotionVector3f(Vector3f(10.f * (i % 4), 10.f * (i / 4), 0), Vector3f(0,0,0)));
+            for(uint32 s = 0; s < num_shards; s++)
+                caches[s]->addObject(id, loc, 1.f);
+        }
+
+        Query* query = handlers[num_shards-1]->registerQuery(
+            TimedMotionVector3f(t, MotionVector3f(Vector3f(15,15,100), Vector3f(0,0,0))),
+            BoundingSphere3f(Vector3f(0,0,0), 0), 1.f, SolidAngle::Min
+        );
+        query->setEventListener(&query_listener);
+        for(uint32 s = 0; s < num_shards; s++)
+            handlers[s]->tick(t);
+
+        ObjectSet unknown;
+        uint32 num_results = 0;
+        std::deque<QueryEvent> evts;
+        query->popEvents(evts);
+        for(std::deque<QueryEvent>::iterator it = evts.begin(); it != evts.end(); it++) {
+            for(uint32 aidx = 0; aidx < it->additions().size(); aidx++) {
+                ObjectReference id = it->additions()[aidx].id();
+                num_results++;
+                if (objects.find(id) == objects.end() && recorder.created.find(id) == recorder.created.end())
+                    unknown.insert(id);
+            }
+        }
+        TS_ASSERT(num_results > 0);
+
+        delete query;
+        for(uint32 s = 0; s < num_shards; s++) {
+            delete handlers[s];
+            delete caches[s];
+        }
+        return unknown;
+    }
+
+public:
+    void testShardCount(void) {
+        TS_ASSERT_EQUALS(objectQueryShardCount("rtree", 0), 1u);
+        TS_ASSERT_EQUALS(objectQueryShardCount("rtree", 4), 4u);
+        TS_ASSERT_EQUALS(objectQueryShardCount("brute", 4), 4u);
+        TS_ASSERT_EQUALS(objectQueryShardCount("rtreedist", 4), 4u);
+        // Results include aggregates only the first shard can register
+        TS_ASSERT_EQUALS(objectQueryShardCount("rtreecut", 4), 1u);
+        TS_ASSERT_EQUALS(objectQueryShardCount("rtreecutagg", 4), 1u);
+        TS_ASSERT_EQUALS(objectQueryShardCount("level", 4), 1u);
+    }
+
+    void testShardedQuerierOnlySeesKnownIDs(void) {
+        // A querier on a shard which doesn't report aggregates must still only
+        // be told about objects and aggregates that were registered
+        uint32 num_shards = 0;
+        ObjectSet unknown = unknownResults("rtree", 2, &num_shards);
+        TS_ASSERT_EQUALS(num_shards, 2u);
+        TS_ASSERT(unknown.empty());
+    }
+
+    void testAggregateQuerierOnlySeesKnownIDs(void) {
+        // Asking for several shards of a handler which returns aggregates
+        // leaves a single shard, whose aggregates are all registered
+        uint32 num_shards = 0;
+        ObjectSet unknown = unknownResults("rtreecut", 2, &num_shards);
+        TS_ASSERT_EQUALS(num_shards, 1u);
+        TS_ASSERT(unknown.empty());
+    }
+};
+
+#endif //_SIRIKATA_OBJECT_QUERY_SHARDS_TEST_HPP_
@@ -0,0 +1,159 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_REDIS_BATCH_READ_TEST_HPP_
+#define _SIRIKATA_REDIS_BATCH_READ_TEST_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include "../../../libspace/plugins/redis/RedisBatchRead.hpp"
+#include <cxxtest/TestSuite.h>
+#include <cstring>
+
+using namespace Sirikata;
+
+class RedisBatchReadTest : public CxxTest::TestSuite
+{
+    // Stands in for RedisObjectSegmentation, recording how each object
+    // completed
+    struct Results {
+        std::map<UUID, String> finished;
+        std::vector<UUID> failed;
+
+        void finishReadObject(const UUID& obj_id, const String& data_str) {
+            TS_ASSERT(finished.find(obj_id) == finished.end());
+            finished[obj_id] = data_str;
+        }
+        void failReadObject(const UUID& obj_id) {
+            failed.push_back(obj_id);
+        }
+        uint32 completed() const {
+            return finished.size() + failed.size();
+        }
+    };
+
+    // Fake replies, as hiredis would hand them to the callback
+    std::vector<redisReply*> mReplies;
+    std::vector<redisReply*> mElements;
+
+    redisReply* reply(int type, const char* str = NULL) {
+        redisReply* r = new redisReply();
+        memset(r, 0, sizeof(redisReply));
+        r->type = type;
+        if (str != NULL) {
+            r->len = strlen(str);
+            r->str = const_cast<char*>(str);
+        }
+        mReplies.push_back(r);
+        return r;
+    }
+
+    redisReply* array(const std::vector<redisReply*>& elements) {
+        redisReply* r = reply(REDIS_REPLY_ARRAY);
+        mElements = elements;
+        r->elements = mElements.size();
+        r->element = mElements.empty() ? NULL : &mElements[0];
+        return r;
+    }
+
+    std::vector<UUID> objects(uint32 n) {
+        std::vector<UUID> objs;
+        for(uint32 i = 0; i < n; i++)
+            objs.push_back(UUID::random());
+        return objs;
+    }
+
+public:
+    void tearDown() {
+        for(uint32 i = 0; i < mReplies.size(); i++)
+            delete mReplies[i];
+        mReplies.clear();
+        mElements.clear();
+    }
+
+    void testAllFound(void) {
+        std::vector<UUID> objs = objects(3);
+        std::vector<redisReply*> elements;
+        elements.push_back(reply(REDIS_REPLY_STRING, "1:10"));
+        elements.push_back(reply(REDIS_REPLY_STRING, "2:20"));
+        elements.push_back(reply(REDIS_REPLY_STRING, "3:30"));
+
+        Results results;
+        dispatchMGetReply(array(elements), objs, &results);
+        TS_ASSERT(results.failed.empty());
+        TS_ASSERT_EQUALS(results.finished.size(), 3u);
+        TS_ASSERT_EQUALS(results.finished[objs[0]], "1:10");
+        TS_ASSERT_EQUALS(results.finished[objs[1]], "2:20");
+        TS_ASSERT_EQUALS(results.finished[objs[2]], "3:30");
+    }
+
+    void testMissingAndUnexpectedElements(void) {
+        // Objects without a record come back nil, and anything that isn't a
+        // string can't be a record
+        std::vector<UUID> objs = objects(4);
+        std::vector<redisReply*> elements;
+        elements.push_back(reply(REDIS_REPLY_NIL));
+        elements.push_back(reply(REDIS_REPLY_STRING, "2:20"));
+        elements.push_back(reply(REDIS_REPLY_INTEGER));
+        elements.push_back(reply(REDIS_REPLY_STRING, "4:40"));
+
+        Results results;
+        dispatchMGetReply(array(elements), objs, &results);
+        TS_ASSERT_EQUALS(results.completed(), 4u);
+        TS_ASSERT_EQUALS(results.finished[objs[1]], "2:20");
+        TS_ASSERT_EQUALS(results.finished[objs[3]], "4:40");
+        TS_ASSERT_EQUALS(results.failed.size(), 2u);
+        TS_ASSERT_EQUALS(results.failed[0], objs[0]);
+        TS_ASSERT_EQUALS(results.failed[1], objs[2]);
+    }
+
+    void testNoReply(void) {
+        std::vector<UUID> objs = objects(5);
+        Results results;
+        dispatchMGetReply(NULL, objs, &results);
+        TS_ASSERT(results.finished.empty());
+        TS_ASSERT_EQUALS(results.failed, objs);
+    }
+
+    void testErrorReply(void) {
+        std::vector<UUID> objs = objects(5);
+        Results results;
+        dispatchMGetReply(reply(REDIS_REPLY_ERROR, "ERR something went wrong"), objs, &results);
+        TS_ASSERT(results.finished.empty());
+        TS_ASSERT_EQUALS(results.failed, objs);
+    }
+
+    void testMismatchedReply(void) {
+        // A reply for the wrong number of keys can't be matched up with the
+        // objects, so all of them fail
+        std::vector<UUID> objs = objects(3);
+        std::vector<redisReply*> elements;
+        elements.push_back(reply(REDIS_REPLY_STRING, "1:10"));
+        elements.push_back(reply(REDIS_REPLY_STRING, "2:20"));
+
+        Results results;
+        dispatchMGetReply(array(elements), objs, &results);
+        TS_ASSERT(results.finished.empty());
+        TS_ASSERT_EQUALS(results.failed, objs);
+
+        Results status_results;
+        dispatchMGetReply(reply(REDIS_REPLY_STATUS, "OK"), objs, &status_results);
+        TS_ASSERT(status_results.finished.empty());
+        TS_ASSERT_EQUALS(status_results.failed, objs);
+    }
+
+    void testValueLength(void) {
+        // Values are taken by length since hiredis doesn't promise they're
+        // NUL terminated
+        std::vector<UUID> objs = objects(1);
+        redisReply* value = reply(REDIS_REPLY_STRING, "1:10");
+        value->len = 2;
+        std::vector<redisReply*> elements(1, value);
+
+        Results results;
+        dispatchMGetReply(array(elements), objs, &results);
+        TS_ASSERT_EQUALS(results.finished[objs[0]], "1:");
+    }
+};
+
+#endif //_SIRIKATA_REDIS_BATCH_READ_TEST_HPP_
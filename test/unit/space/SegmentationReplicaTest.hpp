@@ -0,0 +1,131 @@
+// Copyright (c) 2012 Sirikata Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can
+// be found in the LICENSE file.
+
+#ifndef _SIRIKATA_SEGMENTATION_REPLICA_TEST_HPP_
+#define _SIRIKATA_SEGMENTATION_REPLICA_TEST_HPP_
+
+#include <sirikata/core/util/Platform.hpp>
+#include "../../../space/src/SegmentationReplica.hpp"
+#include <cxxtest/TestSuite.h>
+
+using namespace Sirikata;
+
+class SegmentationReplicaTest : public CxxTest::TestSuite
+{
+    typedef SegmentationReplica::Leaf Leaf;
+    typedef SegmentationReplica::LeafList LeafList;
+
+    static BoundingBox3f box(float minx, float miny, float maxx, float maxy) {
+        return BoundingBox3f(Vector3f(minx, miny, 0), Vector3f(maxx, maxy, 10));
+    }
+
+    // Servers 1-4 own the quadrants of [0,100]x[0,100]:
+    //   2 4
+    //   1 3
+    static LeafList quadrants() {
+        LeafList leaves;
+        leaves.push_back(Leaf(1, box(0, 0, 50, 50)));
+        leaves.push_back(Leaf(2, box(0, 50, 50, 100)));
+        leaves.push_back(Leaf(3, box(50, 0, 100, 50)));
+        leaves.push_back(Leaf(4, box(50, 50, 100, 100)));
+        return leaves;
+    }
+
+    static Vector3f pos(float x, float y) {
+        return Vector3f(x, y, 5);
+    }
+
+public:
+    void testLookup(void) {
+        SegmentationReplica replica;
+        TS_ASSERT(!replica.valid());
+
+        replica.install(quadrants());
+        TS_ASSERT(replica.valid());
+        TS_ASSERT_EQUALS(replica.lookup(pos(10, 10)), 1u);
+        TS_ASSERT_EQUALS(replica.lookup(pos(10, 90)), 2u);
+        TS_ASSERT_EQUALS(replica.lookup(pos(90, 10)), 3u);
+        TS_ASSERT_EQUALS(replica.lookup(pos(90, 90)), 4u);
+        TS_ASSERT_EQUALS(replica.lookup(pos(200, 10)), (ServerID)NullServerID);
+        TS_ASSERT_EQUALS(replica.bounds(), box(0, 0, 100, 100));
+
+        std::vector<ServerID> servers = replica.lookupBoundingBox(box(10, 10, 20, 90));
+        TS_ASSERT_EQUALS(servers.size(), 2u);
+        TS_ASSERT_EQUALS(servers[0], 1u);
+        TS_ASSERT_EQUALS(servers[1], 2u);
+    }
+
+    void testManyRegions(void) {
+        // Enough regions that the tree has some depth, with every lookup
+        // checked against a scan of the leaves
+        LeafList leaves;
+        ServerID server = 1;
+        for(uint32 x = 0; x < 16; x++)
+            for(uint32 y = 0; y < 8; y++)
+                leaves.push_back(Leaf(server++, box(x*10.f, y*10.f, x*10.f+10, y*10.f+10)));
+        SegmentationReplica replica;
+        replica.install(leaves);
+
+        for(uint32 i = 0; i < 1000; i++) {
+            Vector3f p = pos(((i * 7919) % 15991) / 100.f, ((i * 104729) % 7993) / 100.f);
+            ServerID expected = NullServerID;
+            for(uint32 l = 0; l < leaves.size() && expected == NullServerID; l++)
+                if (leaves[l].bbox.contains(p)) expected = leaves[l].server;
+            TS_ASSERT_EQUALS(replica.lookup(p), expected);
+        }
+    }
+
+    void testPartialChange(void) {
+        SegmentationReplica replica;
+        replica.install(quadrants());
+
+        // A change only lists the servers whose regions changed. Here 1 takes
+        // over the bottom of 2's region, 3 and 4 aren't mentioned.
+        LeafList changed;
+        changed.push_back(Leaf(1, box(0, 0, 50, 75)));
+        changed.push_back(Leaf(2, box(0, 75, 50, 100)));
+        replica.applyChange(changed);
+
+        TS_ASSERT(replica.valid());
+        TS_ASSERT_EQUALS(replica.leaves().size(), 4u);
+        TS_ASSERT_EQUALS(replica.lookup(pos(10, 60)), 1u);
+        TS_ASSERT_EQUALS(replica.lookup(pos(10, 90)), 2u);
+        TS_ASSERT_EQUALS(replica.lookup(pos(90, 10)), 3u);
+        TS_ASSERT_EQUALS(replica.lookup(pos(90, 90)), 4u);
+    }
+
+    void testChangeRemovesRegion(void) {
+        SegmentationReplica replica;
+        replica.install(quadrants());
+
+        // Servers that lose their region are sent a degenerate one, and
+        // whoever took over the space is listed with its new region
+        LeafList changed;
+        changed.push_back(Leaf(3, BoundingBox3f(Vector3f(0, 0, 0), Vector3f(0, 0, 0))));
+        changed.push_back(Leaf(4, box(50, 0, 100, 100)));
+        replica.applyChange(changed);
+
+        TS_ASSERT_EQUALS(replica.leaves().size(), 3u);
+        TS_ASSERT_EQUALS(replica.lookup(pos(90, 10)), 4u);
+        TS_ASSERT_EQUALS(replica.lookup(pos(10, 10)), 1u);
+        std::vector<ServerID> servers = replica.lookupBoundingBox(box(60, 10, 70, 20));
+        TS_ASSERT_EQUALS(servers.size(), 1u);
+        TS_ASSERT_EQUALS(servers[0], 4u);
+    }
+
+    void testNoRegions(void) {
+        SegmentationReplica replica;
+        LeafList leaves;
+        leaves.push_back(Leaf(1, BoundingBox3f(Vector3f(0, 0, 0), Vector3f(0, 0, 0))));
+        replica.install(leaves);
+        TS_ASSERT(!replica.valid());
+
+        replica.install(quadrants());
+        replica.clear();
+        TS_ASSERT(!replica.valid());
+        TS_ASSERT(replica.leaves().empty());
+    }
+};
+
+#endif //_SIRIKATA_SEGMENTATION_REPLICA_TEST_HPP_